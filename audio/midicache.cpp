@@ -0,0 +1,376 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "audio/midicache.h"
+#include "audio/audiostream.h"
+#include "audio/decoders/raw.h"
+
+#include "common/config-manager.h"
+#include "common/endian.h"
+#include "common/savefile.h"
+#include "common/substream.h"
+#include "common/system.h"
+
+namespace Audio {
+
+/*
+ * A recording is stored as a 20 byte header followed by the samples as
+ * signed 16 bit little endian PCM:
+ *
+ *   uint32  'MRND'
+ *   uint32  key
+ *   uint32  sample rate
+ *   uint32  number of channels
+ *   uint32  number of samples (over all channels)
+ *
+ * The index file lists the key and the size in bytes of every stored
+ * recording, least recently used first.
+ */
+enum {
+	kRecordingHeaderSize = 20,
+	kIndexVersion = 1
+};
+
+MidiRenderCache::MidiRenderCache()
+	: _budget(0), _size(0), _state(kIdle), _recKey(0), _rate(0), _stereo(false), _recSamples(0) {
+	memset(&_stats, 0, sizeof(_stats));
+
+	_target = ConfMan.getActiveDomainName();
+	if (ConfMan.hasKey("music_cache_size") && !_target.empty())
+		_budget = MAX(ConfMan.getInt("music_cache_size"), 0) * 1024;
+
+	if (_budget)
+		loadIndex();
+}
+
+MidiRenderCache::~MidiRenderCache() {
+	freeRecording();
+	flush();
+
+	if (_budget) {
+		debug(1, "MidiRenderCache: %d hits, %d misses, %d stored, %d aborted, %d evicted, %d of %d KB used",
+			_stats.hits, _stats.misses, _stats.stored, _stats.aborted, _stats.evicted, _size / 1024, _budget / 1024);
+	}
+}
+
+uint32 MidiRenderCache::makeKey(const byte *data, uint32 size, const Common::String &settings) {
+	// FNV-1a over the track data, followed by the settings
+	uint32 hash = 2166136261U;
+	for (uint32 i = 0; i < size; ++i)
+		hash = (hash ^ data[i]) * 16777619U;
+	for (uint i = 0; i < settings.size(); ++i)
+		hash = (hash ^ (byte)settings[i]) * 16777619U;
+	return hash ^ size;
+}
+
+Common::String MidiRenderCache::getFileName(uint32 key) const {
+	return Common::String::format("%s-music-%08x.pcm", _target.c_str(), key);
+}
+
+int MidiRenderCache::findEntry(uint32 key) const {
+	for (uint i = 0; i < _entries.size(); ++i) {
+		if (_entries[i].key == key)
+			return i;
+	}
+	return -1;
+}
+
+void MidiRenderCache::touchEntry(int index) {
+	Entry entry = _entries[index];
+	_entries.remove_at(index);
+	_entries.push_back(entry);
+}
+
+void MidiRenderCache::removeEntry(int index) {
+	g_system->getSavefileManager()->removeSavefile(getFileName(_entries[index].key));
+	_size -= _entries[index].size;
+	_entries.remove_at(index);
+}
+
+void MidiRenderCache::loadIndex() {
+	_entries.clear();
+	_size = 0;
+
+	Common::InSaveFile *in = g_system->getSavefileManager()->openForLoading(_target + "-music.idx");
+	if (!in)
+		return;
+
+	if (in->readUint32BE() == MKID_BE('MIDX') && in->readUint32LE() == kIndexVersion) {
+		uint32 count = in->readUint32LE();
+		for (uint32 i = 0; i < count && !in->eos() && !in->err(); ++i) {
+			Entry entry;
+			entry.key = in->readUint32LE();
+			entry.size = in->readUint32LE();
+			_entries.push_back(entry);
+			_size += entry.size;
+		}
+	}
+
+	delete in;
+}
+
+void MidiRenderCache::saveIndex() {
+	Common::OutSaveFile *out = g_system->getSavefileManager()->openForSaving(_target + "-music.idx");
+	if (!out)
+		return;
+
+	out->writeUint32BE(MKID_BE('MIDX'));
+	out->writeUint32LE(kIndexVersion);
+	out->writeUint32LE(_entries.size());
+	for (uint i = 0; i < _entries.size(); ++i) {
+		out->writeUint32LE(_entries[i].key);
+		out->writeUint32LE(_entries[i].size);
+	}
+	out->finalize();
+	if (out->err())
+		warning("MidiRenderCache: Could not write the index");
+	delete out;
+}
+
+SeekableAudioStream *MidiRenderCache::open(uint32 key) {
+	if (!_budget)
+		return 0;
+
+	int index = findEntry(key);
+	if (index < 0) {
+		_stats.misses++;
+		return 0;
+	}
+
+	Common::InSaveFile *in = g_system->getSavefileManager()->openForLoading(getFileName(key));
+	if (in && in->readUint32BE() == MKID_BE('MRND') && in->readUint32LE() == key) {
+		int rate = in->readUint32LE();
+		uint32 channels = in->readUint32LE();
+		uint32 samples = in->readUint32LE();
+
+		if (!in->err() && rate > 0 && (channels == 1 || channels == 2) && samples) {
+			touchEntry(index);
+			saveIndex();
+			_stats.hits++;
+
+			byte flags = FLAG_16BITS | FLAG_LITTLE_ENDIAN;
+			if (channels == 2)
+				flags |= FLAG_STEREO;
+			Common::SeekableReadStream *data = new Common::SeekableSubReadStream(in,
+				kRecordingHeaderSize, kRecordingHeaderSize + samples * 2, DisposeAfterUse::YES);
+			return makeRawStream(data, rate, flags);
+		}
+	}
+
+	// The recording is gone or damaged, forget about it
+	warning("MidiRenderCache: Could not read %s", getFileName(key).c_str());
+	delete in;
+	removeEntry(index);
+	saveIndex();
+	_stats.misses++;
+	return 0;
+}
+
+void MidiRenderCache::startRecording(uint32 key) {
+	if (!_budget)
+		return;
+
+	Common::StackLock lock(_mutex);
+	freeRecording();
+	_recKey = key;
+	_state = kArmed;
+}
+
+void MidiRenderCache::finishRecording() {
+	Common::StackLock lock(_mutex);
+	if (_state == kRecording && _recSamples)
+		_state = kFinished;
+}
+
+void MidiRenderCache::abortRecording() {
+	Common::StackLock lock(_mutex);
+	if (_state == kArmed || _state == kRecording) {
+		freeRecording();
+		_stats.aborted++;
+	}
+}
+
+bool MidiRenderCache::commit() {
+	// Take over the recording, so that the audio thread is not blocked
+	// while it is written
+	PendingWrite *write = new PendingWrite();
+	{
+		Common::StackLock lock(_mutex);
+		if (_state != kFinished) {
+			if (_state != kIdle) {
+				freeRecording();
+				_stats.aborted++;
+			}
+			delete write;
+			return false;
+		}
+
+		write->chunks = _chunks;
+		_chunks.clear();
+		write->key = _recKey;
+		write->samples = _recSamples;
+		freeRecording();
+	}
+
+	write->rate = _rate;
+	write->stereo = _stereo;
+	write->nextChunk = 0;
+	write->out = 0;
+	_writes.push_back(write);
+	return true;
+}
+
+bool MidiRenderCache::update() {
+	if (_writes.empty())
+		return false;
+
+	PendingWrite *write = _writes.front();
+
+	if (!write->out) {
+		write->out = g_system->getSavefileManager()->openForSaving(getFileName(write->key));
+		if (!write->out) {
+			finishWrite(write);
+		} else {
+			write->out->writeUint32BE(MKID_BE('MRND'));
+			write->out->writeUint32LE(write->key);
+			write->out->writeUint32LE(write->rate);
+			write->out->writeUint32LE(write->stereo ? 2 : 1);
+			write->out->writeUint32LE(write->samples);
+		}
+	} else if (write->nextChunk * kChunkSamples < write->samples) {
+		int16 *chunk = write->chunks[write->nextChunk];
+		const uint32 n = MIN<uint32>(write->samples - write->nextChunk * kChunkSamples, kChunkSamples);
+#ifdef SCUMM_BIG_ENDIAN
+		for (uint32 j = 0; j < n; ++j)
+			chunk[j] = TO_LE_16(chunk[j]);
+#endif
+		write->out->write(chunk, n * 2);
+		write->nextChunk++;
+	} else {
+		finishWrite(write);
+	}
+
+	return !_writes.empty();
+}
+
+void MidiRenderCache::flush() {
+	while (update())
+		;
+}
+
+void MidiRenderCache::finishWrite(PendingWrite *write) {
+	_writes.remove_at(0);
+
+	const Common::String fileName = getFileName(write->key);
+	bool ok = false;
+
+	if (write->out) {
+		write->out->finalize();
+		ok = !write->out->err();
+		delete write->out;
+	}
+
+	for (uint i = 0; i < write->chunks.size(); ++i)
+		delete[] write->chunks[i];
+
+	const uint32 key = write->key;
+	const uint32 size = kRecordingHeaderSize + write->samples * 2;
+	delete write;
+
+	if (!ok) {
+		warning("MidiRenderCache: Could not write %s", fileName.c_str());
+		g_system->getSavefileManager()->removeSavefile(fileName);
+		return;
+	}
+
+	int index = findEntry(key);
+	if (index >= 0) {
+		_size -= _entries[index].size;
+		_entries.remove_at(index);
+	}
+	Entry entry;
+	entry.key = key;
+	entry.size = size;
+	_entries.push_back(entry);
+	_size += entry.size;
+	_stats.stored++;
+
+	// Make room by dropping the least recently used tracks, but never the
+	// one which was just added
+	while (_size > _budget && _entries.size() > 1) {
+		removeEntry(0);
+		_stats.evicted++;
+	}
+	saveIndex();
+}
+
+void MidiRenderCache::setOutputFormat(int rate, bool stereo) {
+	Common::StackLock lock(_mutex);
+	freeRecording();
+	_rate = rate;
+	_stereo = stereo;
+}
+
+void MidiRenderCache::onTick() {
+	Common::StackLock lock(_mutex);
+	if (_state == kArmed)
+		_state = kRecording;
+}
+
+void MidiRenderCache::recordSamples(const int16 *buf, int numSamples) {
+	Common::StackLock lock(_mutex);
+	if (_state != kRecording)
+		return;
+
+	// A single track that does not even fit into the cache is not worth
+	// keeping in memory
+	if (kRecordingHeaderSize + (_recSamples + numSamples) * 2 > _budget) {
+		freeRecording();
+		_stats.aborted++;
+		return;
+	}
+
+	while (numSamples > 0) {
+		const uint32 offset = _recSamples % kChunkSamples;
+		if (!offset && _recSamples / kChunkSamples == _chunks.size())
+			_chunks.push_back(new int16[kChunkSamples]);
+
+		const int n = MIN<int>(numSamples, kChunkSamples - offset);
+		memcpy(_chunks[_recSamples / kChunkSamples] + offset, buf, n * sizeof(int16));
+		buf += n;
+		numSamples -= n;
+		_recSamples += n;
+	}
+}
+
+void MidiRenderCache::freeRecording() {
+	for (uint i = 0; i < _chunks.size(); ++i)
+		delete[] _chunks[i];
+	_chunks.clear();
+	_recSamples = 0;
+	_state = kIdle;
+}
+
+} // End of namespace Audio
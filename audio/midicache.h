@@ -0,0 +1,183 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef SOUND_MIDICACHE_H
+#define SOUND_MIDICACHE_H
+
+#include "common/array.h"
+#include "common/mutex.h"
+#include "common/str.h"
+
+namespace Common {
+	class WriteStream;
+}
+
+namespace Audio {
+
+class SeekableAudioStream;
+
+/**
+ * Keeps the output of emulated MIDI drivers for whole music tracks, so
+ * that later plays of a track can be streamed back instead of being
+ * synthesized again.
+ *
+ * A track is recorded the first time it is played. The player arms the
+ * cache with startRecording(), the driver (see
+ * MidiDriver::setRenderCache()) passes every sample it generates to
+ * recordSamples() and calls onTick() on every timer tick, and the
+ * player calls finishRecording() from its end of track handler. The
+ * recording thus spans whole ticks, from the first event of the track
+ * up to its loop point, and loops without a gap. commit() then queues
+ * it for writing through the savefile manager, which compresses it. A
+ * whole track is several megabytes, so it is written in chunks by calls
+ * to update(), which the engine makes from its main loop. Once a track is
+ * written, the least recently used tracks are removed if the cache grows
+ * beyond its budget.
+ *
+ * Only players which know that a track sounds the same on every play
+ * should use the cache. Interactive music systems like iMUSE have to
+ * keep synthesizing live.
+ *
+ * The budget is taken from the "music_cache_size" config key, in KB.
+ * The cache is disabled if the key is not set or 0.
+ */
+class MidiRenderCache {
+public:
+	struct Stats {
+		uint32 hits;		///< Tracks played back from the cache
+		uint32 misses;		///< Tracks which had to be synthesized
+		uint32 stored;		///< Recordings added to the cache
+		uint32 aborted;		///< Recordings thrown away before the end of the track
+		uint32 evicted;		///< Recordings removed to stay within the budget
+	};
+
+	MidiRenderCache();
+	~MidiRenderCache();
+
+	bool isEnabled() const { return _budget != 0; }
+
+	/**
+	 * Compute the cache key of a track. The settings string has to
+	 * describe everything else the output depends on, like the driver
+	 * and its configuration.
+	 */
+	static uint32 makeKey(const byte *data, uint32 size, const Common::String &settings);
+
+	/**
+	 * Open the recording of a track.
+	 * @return the recording, or 0 if the track is not in the cache
+	 */
+	SeekableAudioStream *open(uint32 key);
+
+	/** Start recording the track with the given key on the next tick. */
+	void startRecording(uint32 key);
+	/** Mark the current recording as complete. */
+	void finishRecording();
+	/** Throw away the current recording, unless it is already complete. */
+	void abortRecording();
+	/**
+	 * Queue a complete recording for writing. Must not be called from the
+	 * audio thread.
+	 * @return true if a recording was queued
+	 */
+	bool commit();
+	/**
+	 * Write the next chunk of the queued recordings.
+	 * @return true if there is more to write
+	 */
+	bool update();
+	/** Write all queued recordings at once. */
+	void flush();
+
+	// Driver side; called from the audio thread
+	void setOutputFormat(int rate, bool stereo);
+	void onTick();
+	void recordSamples(const int16 *buf, int numSamples);
+
+	const Stats &getStats() const { return _stats; }
+	uint32 getSize() const { return _size; }
+	uint32 getBudget() const { return _budget; }
+
+private:
+	enum {
+		kChunkSamples = 32768
+	};
+
+	enum State {
+		kIdle,
+		kArmed,
+		kRecording,
+		kFinished
+	};
+
+	struct Entry {
+		uint32 key;
+		uint32 size;
+	};
+
+	/** A recording which is being written */
+	struct PendingWrite {
+		uint32 key;
+		int rate;
+		bool stereo;
+		uint32 samples;
+		Common::Array<int16 *> chunks;
+		uint nextChunk;
+		Common::WriteStream *out;	///< The savefile, once it is open
+	};
+
+	Common::String _target;
+	uint32 _budget;
+	uint32 _size;
+
+	/** Cached tracks, least recently used first */
+	Common::Array<Entry> _entries;
+
+	Common::Mutex _mutex;
+	State _state;
+	uint32 _recKey;
+	int _rate;
+	bool _stereo;
+	Common::Array<int16 *> _chunks;
+	uint32 _recSamples;
+
+	/** Recordings waiting to be written, oldest first */
+	Common::Array<PendingWrite *> _writes;
+
+	Stats _stats;
+
+	Common::String getFileName(uint32 key) const;
+	int findEntry(uint32 key) const;
+	void touchEntry(int index);
+	void removeEntry(int index);
+	void loadIndex();
+	void saveIndex();
+	void freeRecording();
+	void finishWrite(PendingWrite *write);
+};
+
+} // End of namespace Audio
+
+#endif
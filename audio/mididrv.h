@@ -34,6 +34,7 @@ class MusicDevice;
 
 namespace Audio {
 	class Mixer;
+	class MidiRenderCache;
 }
 namespace Common { class String; }
 
@@ -241,6 +242,16 @@ public:
 
 	virtual void metaEvent(byte type, byte *data, uint16 length) { }
 
+	/**
+	 * Feed the output of the driver to the given cache, or stop doing so
+	 * if cache is 0.
+	 *
+	 * @return false if the driver has no output to record, e.g. because
+	 *         it talks to a real MIDI device
+	 * @see Audio::MidiRenderCache
+	 */
+	virtual bool setRenderCache(Audio::MidiRenderCache *cache) { return false; }
+
 	// Timing functions - MidiDriver now operates timers
 	virtual void setTimerCallback(void *timer_param, Common::TimerManager::TimerProc timer_proc) = 0;
 
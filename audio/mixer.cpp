@@ -23,6 +23,7 @@
  *
  */
 
+#include "common/array.h"
 #include "common/util.h"
 #include "common/system.h"
 
@@ -44,7 +45,7 @@ namespace Audio {
  */
 class Channel {
 public:
-	Channel(Mixer *mixer, Mixer::SoundType type, AudioStream *stream, DisposeAfterUse::Flag autofreeStream, bool reverseStereo, int id, bool permanent);
+	Channel(Mixer *mixer, Mixer::SoundType type, AudioStream *stream, DisposeAfterUse::Flag autofreeStream, bool reverseStereo, int id, bool permanent, RateConverterQuality quality);
 	~Channel();
 
 	/**
@@ -54,8 +55,10 @@ public:
 	 * @param len  number of sample *pairs*. So a value of
 	 *             10 means that the buffer contains twice 10 sample, each
 	 *             16 bits, for a total of 40 bytes.
+	 * @param timeStamp the time (in ms) at which the mixer started mixing
+	 *             this buffer
 	 */
-	void mix(int16 *data, uint len);
+	void mix(int16 *data, uint len, uint32 timeStamp);
 
 	/**
 	 * Queries whether the channel is still playing or not.
@@ -160,23 +163,29 @@ private:
 #pragma mark -
 
 
-MixerImpl::MixerImpl(OSystem *system, uint sampleRate)
-	: _syst(system), _sampleRate(sampleRate), _mixerReady(false), _handleSeed(0) {
+MixerImpl::MixerImpl(OSystem *system, uint sampleRate, uint numChannels)
+	: _syst(system), _sampleRate(sampleRate), _numChannels(numChannels), _mixerReady(false), _handleSeed(0), _rateQuality(kRateQualityLow) {
 
 	assert(sampleRate > 0);
+	assert(numChannels > 0);
 
 	int i;
 
 	for (i = 0; i < ARRAYSIZE(_volumeForSoundType); i++)
 		_volumeForSoundType[i] = kMaxMixerVolume;
 
-	for (i = 0; i != NUM_CHANNELS; i++)
-		_channels[i] = 0;
+	_channels = new Channel *[_numChannels];
+	_finishedChannels = new Channel *[_numChannels];
+	for (uint c = 0; c != _numChannels; c++)
+		_channels[c] = 0;
 }
 
 MixerImpl::~MixerImpl() {
-	for (int i = 0; i != NUM_CHANNELS; i++)
+	for (uint i = 0; i != _numChannels; i++)
 		delete _channels[i];
+
+	delete[] _channels;
+	delete[] _finishedChannels;
 }
 
 void MixerImpl::setReady(bool ready) {
@@ -187,29 +196,42 @@ uint MixerImpl::getOutputRate() const {
 	return _sampleRate;
 }
 
-void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
+bool MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
 	int index = -1;
-	for (int i = 0; i != NUM_CHANNELS; i++) {
+	for (uint i = 0; i != _numChannels; i++) {
 		if (_channels[i] == 0) {
 			index = i;
 			break;
 		}
 	}
-	if (index == -1) {
-		warning("MixerImpl::out of mixer slots");
-		delete chan;
-		return;
-	}
+	if (index == -1)
+		return false;
 
 	_channels[index] = chan;
 
 	SoundHandle chanHandle;
-	chanHandle._val = index + (_handleSeed * NUM_CHANNELS);
+	chanHandle._val = index + (_handleSeed * _numChannels);
 
 	chan->setHandle(chanHandle);
+
+	// findChannel() gets the index back with a modulo, which only works as
+	// long as the handle doesn't wrap. Start over before it would, which
+	// also keeps the handles clear of the invalid 0xFFFFFFFF.
 	_handleSeed++;
+	if (_handleSeed >= 0xFFFFFFFF / _numChannels)
+		_handleSeed = 0;
+
 	if (handle)
 		*handle = chanHandle;
+
+	return true;
+}
+
+int MixerImpl::findChannel(SoundHandle handle) const {
+	const int index = handle._val % _numChannels;
+	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+		return -1;
+	return index;
 }
 
 void MixerImpl::playStream(
@@ -220,7 +242,6 @@ void MixerImpl::playStream(
 			DisposeAfterUse::Flag autofreeStream,
 			bool permanent,
 			bool reverseStereo) {
-	Common::StackLock lock(_mutex);
 
 	if (stream == 0) {
 		warning("stream is 0");
@@ -230,95 +251,141 @@ void MixerImpl::playStream(
 
 	assert(_mixerReady);
 
-	// Prevent duplicate sounds
-	if (id != -1) {
-		for (int i = 0; i != NUM_CHANNELS; i++)
-			if (_channels[i] != 0 && _channels[i]->getId() == id) {
-				// Delete the stream if were asked to auto-dispose it.
-				// Note: This could cause trouble if the client code does not
-				// yet expect the stream to be gone. The primary example to
-				// keep in mind here is QueuingAudioStream.
-				// Thus, as a quick rule of thumb, you should never, ever,
-				// try to play QueuingAudioStreams with a sound id.
-				if (autofreeStream == DisposeAfterUse::YES)
-					delete stream;
-				return;
-			}
-	}
-
 #ifdef AUDIO_REVERSE_STEREO
 	reverseStereo = !reverseStereo;
 #endif
 
-	// Create the channel
-	Channel *chan = new Channel(this, type, stream, autofreeStream, reverseStereo, id, permanent);
+	// Create the channel. This involves setting up a rate converter, which
+	// we do not want to do while holding the mixer lock, since that would
+	// stall the audio thread.
+	Channel *chan = new Channel(this, type, stream, autofreeStream, reverseStereo, id, permanent, _rateQuality);
 	chan->setVolume(volume);
 	chan->setBalance(balance);
-	insertChannel(handle, chan);
+
+	bool inserted = false;
+	{
+		Common::StackLock lock(_mutex);
+
+		// Prevent duplicate sounds
+		bool duplicate = false;
+		if (id != -1) {
+			for (uint i = 0; i != _numChannels; i++) {
+				if (_channels[i] != 0 && _channels[i]->getId() == id) {
+					duplicate = true;
+					break;
+				}
+			}
+		}
+
+		if (!duplicate) {
+			inserted = insertChannel(handle, chan);
+			if (!inserted)
+				warning("MixerImpl::out of mixer slots");
+		}
+	}
+
+	// Deleting the channel also deletes the stream if we were asked to
+	// auto-dispose it.
+	// Note: This could cause trouble if the client code does not
+	// yet expect the stream to be gone. The primary example to
+	// keep in mind here is QueuingAudioStream.
+	// Thus, as a quick rule of thumb, you should never, ever,
+	// try to play QueuingAudioStreams with a sound id.
+	if (!inserted)
+		delete chan;
 }
 
 void MixerImpl::mixCallback(byte *samples, uint len) {
 	assert(samples);
 
-	Common::StackLock lock(_mutex);
-
 	int16 *buf = (int16 *)samples;
 	len >>= 2;
 
-	// Since the mixer callback has been called, the mixer must be ready...
-	_mixerReady = true;
-
 	//  zero the buf
 	memset(buf, 0, 2 * len * sizeof(int16));
 
-	// mix all channels
-	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i]) {
-			if (_channels[i]->isFinished()) {
-				delete _channels[i];
-				_channels[i] = 0;
-			} else if (!_channels[i]->isPaused())
-				_channels[i]->mix(buf, len);
-		}
+	uint numFinished = 0;
+	const uint32 timeStamp = _syst->getMillis();
+
+	{
+		Common::StackLock lock(_mutex);
+
+		// Since the mixer callback has been called, the mixer must be ready...
+		_mixerReady = true;
+
+		// mix all channels
+		for (uint i = 0; i != _numChannels; i++)
+			if (_channels[i]) {
+				if (_channels[i]->isFinished()) {
+					_finishedChannels[numFinished++] = _channels[i];
+					_channels[i] = 0;
+				} else if (!_channels[i]->isPaused())
+					_channels[i]->mix(buf, len, timeStamp);
+			}
+	}
+
+	// Destroying a channel may free a whole decoder, so only do it once
+	// other threads can access the mixer again.
+	for (uint i = 0; i != numFinished; i++)
+		delete _finishedChannels[i];
 }
 
 void MixerImpl::stopAll() {
-	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && !_channels[i]->isPermanent()) {
-			delete _channels[i];
-			_channels[i] = 0;
+	Common::Array<Channel *> stopped;
+	{
+		Common::StackLock lock(_mutex);
+		for (uint i = 0; i != _numChannels; i++) {
+			if (_channels[i] != 0 && !_channels[i]->isPermanent()) {
+				stopped.push_back(_channels[i]);
+				_channels[i] = 0;
+			}
 		}
 	}
+
+	for (uint i = 0; i != stopped.size(); i++)
+		delete stopped[i];
 }
 
 void MixerImpl::stopID(int id) {
-	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && _channels[i]->getId() == id) {
-			delete _channels[i];
-			_channels[i] = 0;
+	Common::Array<Channel *> stopped;
+	{
+		Common::StackLock lock(_mutex);
+		for (uint i = 0; i != _numChannels; i++) {
+			if (_channels[i] != 0 && _channels[i]->getId() == id) {
+				stopped.push_back(_channels[i]);
+				_channels[i] = 0;
+			}
 		}
 	}
+
+	for (uint i = 0; i != stopped.size(); i++)
+		delete stopped[i];
 }
 
 void MixerImpl::stopHandle(SoundHandle handle) {
-	Common::StackLock lock(_mutex);
+	Channel *chan = 0;
+	{
+		Common::StackLock lock(_mutex);
 
-	// Simply ignore stop requests for handles of sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
-		return;
+		// Simply ignore stop requests for handles of sounds that already terminated
+		const int index = findChannel(handle);
+		if (index == -1)
+			return;
 
-	delete _channels[index];
-	_channels[index] = 0;
+		chan = _channels[index];
+		_channels[index] = 0;
+	}
+
+	// The channel is not reachable by the audio thread anymore, thus we
+	// can safely dispose it without holding the lock.
+	delete chan;
 }
 
 void MixerImpl::setChannelVolume(SoundHandle handle, byte volume) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findChannel(handle);
+	if (index == -1)
 		return;
 
 	_channels[index]->setVolume(volume);
@@ -327,8 +394,8 @@ void MixerImpl::setChannelVolume(SoundHandle handle, byte volume) {
 void MixerImpl::setChannelBalance(SoundHandle handle, int8 balance) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findChannel(handle);
+	if (index == -1)
 		return;
 
 	_channels[index]->setBalance(balance);
@@ -341,8 +408,8 @@ uint32 MixerImpl::getSoundElapsedTime(SoundHandle handle) {
 Timestamp MixerImpl::getElapsedTime(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findChannel(handle);
+	if (index == -1)
 		return Timestamp(0, _sampleRate);
 
 	return _channels[index]->getElapsedTime();
@@ -350,7 +417,7 @@ Timestamp MixerImpl::getElapsedTime(SoundHandle handle) {
 
 void MixerImpl::pauseAll(bool paused) {
 	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++) {
+	for (uint i = 0; i != _numChannels; i++) {
 		if (_channels[i] != 0) {
 			_channels[i]->pause(paused);
 		}
@@ -359,7 +426,7 @@ void MixerImpl::pauseAll(bool paused) {
 
 void MixerImpl::pauseID(int id, bool paused) {
 	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++) {
+	for (uint i = 0; i != _numChannels; i++) {
 		if (_channels[i] != 0 && _channels[i]->getId() == id) {
 			_channels[i]->pause(paused);
 			return;
@@ -371,8 +438,8 @@ void MixerImpl::pauseHandle(SoundHandle handle, bool paused) {
 	Common::StackLock lock(_mutex);
 
 	// Simply ignore (un)pause requests for sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findChannel(handle);
+	if (index == -1)
 		return;
 
 	_channels[index]->pause(paused);
@@ -380,7 +447,7 @@ void MixerImpl::pauseHandle(SoundHandle handle, bool paused) {
 
 bool MixerImpl::isSoundIDActive(int id) {
 	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++)
+	for (uint i = 0; i != _numChannels; i++)
 		if (_channels[i] && _channels[i]->getId() == id)
 			return true;
 	return false;
@@ -388,21 +455,20 @@ bool MixerImpl::isSoundIDActive(int id) {
 
 int MixerImpl::getSoundID(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
-	const int index = handle._val % NUM_CHANNELS;
-	if (_channels[index] && _channels[index]->getHandle()._val == handle._val)
+	const int index = findChannel(handle);
+	if (index != -1)
 		return _channels[index]->getId();
 	return 0;
 }
 
 bool MixerImpl::isSoundHandleActive(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
-	const int index = handle._val % NUM_CHANNELS;
-	return _channels[index] && _channels[index]->getHandle()._val == handle._val;
+	return findChannel(handle) != -1;
 }
 
 bool MixerImpl::hasActiveChannelOfType(SoundType type) {
 	Common::StackLock lock(_mutex);
-	for (int i = 0; i != NUM_CHANNELS; i++)
+	for (uint i = 0; i != _numChannels; i++)
 		if (_channels[i] && _channels[i]->getType() == type)
 			return true;
 	return false;
@@ -423,7 +489,7 @@ void MixerImpl::setVolumeForSoundType(SoundType type, int volume) {
 	Common::StackLock lock(_mutex);
 	_volumeForSoundType[type] = volume;
 
-	for (int i = 0; i != NUM_CHANNELS; ++i) {
+	for (uint i = 0; i != _numChannels; ++i) {
 		if (_channels[i] && _channels[i]->getType() == type)
 			_channels[i]->notifyGlobalVolChange();
 	}
@@ -441,7 +507,7 @@ int MixerImpl::getVolumeForSoundType(SoundType type) const {
 #pragma mark -
 
 Channel::Channel(Mixer *mixer, Mixer::SoundType type, AudioStream *stream,
-                 DisposeAfterUse::Flag autofreeStream, bool reverseStereo, int id, bool permanent)
+                 DisposeAfterUse::Flag autofreeStream, bool reverseStereo, int id, bool permanent, RateConverterQuality quality)
     : _type(type), _mixer(mixer), _id(id), _permanent(permanent), _volume(Mixer::kMaxChannelVolume),
       _balance(0), _pauseLevel(0), _samplesConsumed(0), _samplesDecoded(0), _mixerTimeStamp(0),
       _pauseStartTime(0), _pauseTime(0), _autofreeStream(autofreeStream), _converter(0),
@@ -450,7 +516,7 @@ Channel::Channel(Mixer *mixer, Mixer::SoundType type, AudioStream *stream,
 	assert(stream);
 
 	// Get a rate converter instance
-	_converter = makeRateConverter(_stream->getRate(), mixer->getOutputRate(), _stream->isStereo(), reverseStereo);
+	_converter = makeRateConverter(_stream->getRate(), mixer->getOutputRate(), _stream->isStereo(), reverseStereo, quality);
 }
 
 Channel::~Channel() {
@@ -538,7 +604,7 @@ Timestamp Channel::getElapsedTime() {
 	return ts;
 }
 
-void Channel::mix(int16 *data, uint len) {
+void Channel::mix(int16 *data, uint len, uint32 timeStamp) {
 	assert(_stream);
 
 	if (_stream->endOfData()) {
@@ -547,7 +613,7 @@ void Channel::mix(int16 *data, uint len) {
 		assert(_converter);
 
 		_samplesConsumed = _samplesDecoded;
-		_mixerTimeStamp = g_system->getMillis();
+		_mixerTimeStamp = timeStamp;
 		_pauseTime = 0;
 		_samplesDecoded += _converter->flow(*_stream, data, len, _volL, _volR);
 	}
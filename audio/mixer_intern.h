@@ -29,6 +29,7 @@
 #include "common/scummsys.h"
 #include "common/mutex.h"
 #include "audio/mixer.h"
+#include "audio/rate.h"
 
 namespace Audio {
 
@@ -52,25 +53,40 @@ namespace Audio {
  * @see OSystem::getMixer()
  */
 class MixerImpl : public Mixer {
-private:
+public:
 	enum {
-		NUM_CHANNELS = 16
+		kDefaultNumChannels = 16
 	};
 
+private:
 	OSystem *_syst;
 	Common::Mutex _mutex;
 
 	const uint _sampleRate;
+	const uint _numChannels;
 	bool _mixerReady;
 	uint32 _handleSeed;
+	RateConverterQuality _rateQuality;
 
 	int _volumeForSoundType[4];
-	Channel *_channels[NUM_CHANNELS];
+	Channel **_channels;
+
+	/**
+	 * Scratch list used by mixCallback() to collect finished channels, so
+	 * they can be destroyed after the mixer lock has been released.
+	 */
+	Channel **_finishedChannels;
 
 
 public:
 
-	MixerImpl(OSystem *system, uint sampleRate);
+	/**
+	 * @param system       the OSystem instance owning this mixer
+	 * @param sampleRate   the hardware output sample rate
+	 * @param numChannels  the maximal number of sounds which can be played
+	 *                     simultaneously
+	 */
+	MixerImpl(OSystem *system, uint sampleRate, uint numChannels = kDefaultNumChannels);
 	~MixerImpl();
 
 	virtual bool isReady() const { return _mixerReady; }
@@ -110,8 +126,35 @@ public:
 
 	virtual uint getOutputRate() const;
 
+	/**
+	 * Returns the maximal number of sounds which can be played at once.
+	 */
+	uint getNumChannels() const { return _numChannels; }
+
+	/**
+	 * Set the quality of the rate converters used for sounds which are
+	 * started after this call. Backends for low-end systems should stay
+	 * with the default kRateQualityLow.
+	 */
+	void setRateConverterQuality(RateConverterQuality quality) { _rateQuality = quality; }
+
 protected:
-	void insertChannel(SoundHandle *handle, Channel *chan);
+	/**
+	 * Insert the given channel into a free slot. Must be called with the
+	 * mixer lock held.
+	 *
+	 * @return false if there was no free slot left. In that case the
+	 *         caller is responsible for deleting the channel.
+	 */
+	bool insertChannel(SoundHandle *handle, Channel *chan);
+
+	/**
+	 * Look up the channel slot belonging to the given handle. Must be called
+	 * with the mixer lock held.
+	 *
+	 * @return the slot index, or -1 if the sound has already terminated
+	 */
+	int findChannel(SoundHandle handle) const;
 
 public:
 	/**
@@ -3,6 +3,7 @@ MODULE := audio
 MODULE_OBJS := \
 	audiostream.o \
 	fmopl.o \
+	midicache.o \
 	mididrv.o \
 	midiparser_smf.o \
 	midiparser_xmidi.o \
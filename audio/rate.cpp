@@ -34,9 +34,12 @@
 #include "audio/audiostream.h"
 #include "audio/rate.h"
 #include "audio/mixer.h"
+#include "common/algorithm.h"
 #include "common/frac.h"
 #include "common/util.h"
 
+#include <math.h>
+
 namespace Audio {
 
 
@@ -49,6 +52,36 @@ namespace Audio {
 #define INTERMEDIATE_BUFFER_SIZE 512
 
 
+/**
+ * Scale a block of input samples by the channel volumes and add them to
+ * the (interleaved stereo) output buffer, clamping the result.
+ *
+ * The loop body is free of data dependent branches (clampedAdd compiles
+ * down to min/max operations) and the input and output never overlap, so
+ * compilers are able to turn it into SSE2/NEON code.
+ *
+ * @param obuf   output buffer, receives frames * 2 samples
+ * @param ibuf   input buffer, holds frames (mono) or frames * 2 (stereo) samples
+ * @param frames number of sample frames to process
+ */
+template<bool stereo, bool reverseStereo>
+static inline void mixScaledSamples(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t frames, st_volume_t vol_l, st_volume_t vol_r) {
+	const int volL = vol_l;
+	const int volR = vol_r;
+
+	for (st_size_t i = 0; i < frames; ++i) {
+		const int out0 = ibuf[stereo ? 2 * i : i];
+		const int out1 = (stereo ? ibuf[2 * i + 1] : out0);
+
+		// output left channel
+		clampedAdd(obuf[2 * i + reverseStereo    ], (out0 * volL) / Audio::Mixer::kMaxMixerVolume);
+
+		// output right channel
+		clampedAdd(obuf[2 * i + (reverseStereo ^ 1)], (out1 * volR) / Audio::Mixer::kMaxMixerVolume);
+	}
+}
+
+
 /**
  * Audio rate converter based on simple resampling. Used when no
  * interpolation is required.
@@ -269,6 +302,247 @@ int LinearRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_samp
 #pragma mark -
 
 
+/**
+ * Number of filter taps used per output sample when upsampling. When
+ * downsampling the filter is widened proportionally to the rate ratio, so
+ * that the cutoff can move below the output Nyquist frequency.
+ */
+#define FILTER_BASE_TAPS 32
+
+/** Upper bound for the number of filter taps. */
+#define FILTER_MAX_TAPS 256
+
+/**
+ * Upper bound for the number of filter phases. If the (reduced) output rate
+ * exceeds this value, neighbouring phases share their coefficients. The
+ * position in the input stream is still tracked exactly, though.
+ */
+#define FILTER_MAX_PHASES 1024
+
+/** Fixed point precision of the filter coefficients. */
+#define FILTER_COEF_BITS 14
+
+/**
+ * Compute the dot product of a block of samples and a set of filter
+ * coefficients. Both arrays are contiguous and do not alias, which allows
+ * the compiler to vectorize the loop (e.g. using pmaddwd on SSE2).
+ *
+ * The coefficients of each phase have an absolute sum well below
+ * 2^(31 - 15), so the 32 bit accumulator cannot overflow.
+ */
+static inline int filterDotProduct(const st_sample_t *samples, const int16 *coefs, int taps) {
+	int32 sum = 0;
+	for (int i = 0; i < taps; ++i)
+		sum += samples[i] * coefs[i];
+	return sum;
+}
+
+static inline st_sample_t filterOutput(int32 sum) {
+	const int32 val = (sum + (1 << (FILTER_COEF_BITS - 1))) >> FILTER_COEF_BITS;
+	return (st_sample_t)CLIP<int32>(val, ST_SAMPLE_MIN, ST_SAMPLE_MAX);
+}
+
+/**
+ * Audio rate converter based on a polyphase windowed-sinc FIR filter.
+ *
+ * This gives far better quality than LinearRateConverter (in particular
+ * a lot less aliasing when upsampling low rate speech samples), at the
+ * cost of more CPU time and memory. Unlike the other converters it has no
+ * limitation on the sampling frequency.
+ *
+ * The ratio outrate / inrate is reduced to L / M. Every output sample is
+ * then computed by one of L filter phases, and for every output sample the
+ * phase advances by M. Only setting up the coefficients uses floating point
+ * arithmetic.
+ */
+template<bool stereo, bool reverseStereo>
+class FilterRateConverter : public RateConverter {
+protected:
+	st_sample_t inBuf[INTERMEDIATE_BUFFER_SIZE];
+	const st_sample_t *inPtr;
+	int inLen;
+
+	/** Number of filter taps */
+	int _taps;
+	/** Number of coefficient sets */
+	uint32 _numPhases;
+	/** Coefficients, _taps entries for each of the _numPhases phases */
+	int16 *_coefs;
+
+	/** Reduced output rate, i.e. the number of positions between two input samples */
+	uint32 _phaseCount;
+	/** Reduced input rate, i.e. the position increment per output sample */
+	uint32 _phaseInc;
+	/** Position of the output stream between the last two input samples */
+	uint32 _phase;
+
+	/**
+	 * Input history for the left and right channel. Every sample is stored
+	 * twice, _taps entries apart, so the most recent _taps samples are always
+	 * available as one contiguous block starting at _histPos + 1.
+	 */
+	st_sample_t *_hist0, *_hist1;
+	int _histPos;
+
+	void setupCoefficients(st_rate_t inrate, st_rate_t outrate);
+
+public:
+	FilterRateConverter(st_rate_t inrate, st_rate_t outrate);
+	~FilterRateConverter();
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
+		return ST_SUCCESS;
+	}
+};
+
+
+/*
+ * Prepare processing.
+ */
+template<bool stereo, bool reverseStereo>
+FilterRateConverter<stereo, reverseStereo>::FilterRateConverter(st_rate_t inrate, st_rate_t outrate) {
+	const st_rate_t div = Common::gcd(inrate, outrate);
+	_phaseCount = outrate / div;
+	_phaseInc = inrate / div;
+
+	// Widen the filter when downsampling, to keep the transition band narrow
+	if (inrate > outrate)
+		_taps = (FILTER_BASE_TAPS * inrate + outrate - 1) / outrate;
+	else
+		_taps = FILTER_BASE_TAPS;
+	_taps = MIN<int>((_taps + 3) & ~3, FILTER_MAX_TAPS);
+
+	_numPhases = MIN<uint32>(_phaseCount, FILTER_MAX_PHASES);
+	_coefs = new int16[_numPhases * _taps];
+	setupCoefficients(inrate, outrate);
+
+	_hist0 = new st_sample_t[2 * _taps];
+	_hist1 = stereo ? new st_sample_t[2 * _taps] : 0;
+	memset(_hist0, 0, 2 * _taps * sizeof(st_sample_t));
+	if (stereo)
+		memset(_hist1, 0, 2 * _taps * sizeof(st_sample_t));
+	_histPos = 0;
+
+	// Force reading an input sample before generating the first output
+	_phase = _phaseCount;
+
+	inLen = 0;
+}
+
+template<bool stereo, bool reverseStereo>
+FilterRateConverter<stereo, reverseStereo>::~FilterRateConverter() {
+	delete[] _coefs;
+	delete[] _hist0;
+	delete[] _hist1;
+}
+
+template<bool stereo, bool reverseStereo>
+void FilterRateConverter<stereo, reverseStereo>::setupCoefficients(st_rate_t inrate, st_rate_t outrate) {
+	// Cutoff frequency relative to the input Nyquist frequency. We stay a
+	// bit below the (lower) Nyquist frequency to leave room for the
+	// transition band of the filter.
+	const double cutoff = 0.95 * (inrate > outrate ? (double)outrate / inrate : 1.0);
+	const double halfTaps = _taps / 2.0;
+
+	for (uint32 phase = 0; phase < _numPhases; ++phase) {
+		const double frac = (double)phase / _numPhases;
+		int16 *coefs = _coefs + phase * _taps;
+		double tmp[FILTER_MAX_TAPS];
+		double sum = 0;
+
+		// Tap k is applied to the input sample k - _taps / 2 + 1 positions
+		// away from the sample preceding the output position.
+		for (int k = 0; k < _taps; ++k) {
+			const double x = k - halfTaps + 1 - frac;
+			const double sinc = (x == 0) ? 1.0 : sin(PI * cutoff * x) / (PI * cutoff * x);
+			// Blackman window, centered on the output position
+			const double window = 0.42 + 0.5 * cos(PI * x / halfTaps) + 0.08 * cos(2 * PI * x / halfTaps);
+			tmp[k] = (fabs(x) >= halfTaps) ? 0 : sinc * window;
+			sum += tmp[k];
+		}
+
+		// Normalize to unity gain for every phase and convert to fixed point.
+		// Any rounding error is put into the largest tap, so that a constant
+		// signal passes through unchanged.
+		int intSum = 0, maxTap = 0;
+		for (int k = 0; k < _taps; ++k) {
+			coefs[k] = (int16)floor(tmp[k] / sum * (1 << FILTER_COEF_BITS) + 0.5);
+			intSum += coefs[k];
+			if (coefs[k] > coefs[maxTap])
+				maxTap = k;
+		}
+		coefs[maxTap] += (1 << FILTER_COEF_BITS) - intSum;
+	}
+}
+
+/*
+ * Processed signed long samples from ibuf to obuf.
+ * Return number of sample pairs processed.
+ */
+template<bool stereo, bool reverseStereo>
+int FilterRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+	st_sample_t *ostart, *oend;
+
+	ostart = obuf;
+	oend = obuf + osamp * 2;
+
+	while (obuf < oend) {
+
+		// read enough input samples so that the output position lies
+		// between the two most recent input samples
+		while (_phase >= _phaseCount) {
+			// Check if we have to refill the buffer
+			if (inLen == 0) {
+				inPtr = inBuf;
+				inLen = input.readBuffer(inBuf, ARRAYSIZE(inBuf));
+				if (inLen <= 0)
+					return (obuf - ostart) / 2;
+			}
+			inLen -= (stereo ? 2 : 1);
+
+			if (++_histPos == _taps)
+				_histPos = 0;
+			_hist0[_histPos] = _hist0[_histPos + _taps] = *inPtr++;
+			if (stereo)
+				_hist1[_histPos] = _hist1[_histPos + _taps] = *inPtr++;
+
+			_phase -= _phaseCount;
+		}
+
+		// Loop as long as the output position trails behind, and as long
+		// as there is still space in the output buffer.
+		while (_phase < _phaseCount && obuf < oend) {
+			// Map the position to its coefficient set. This can not overflow,
+			// since _numPhases is at most 1024 and _phase is below the
+			// (reduced) output rate.
+			const uint32 coefPhase = (_numPhases == _phaseCount) ? _phase : (_phase * _numPhases) / _phaseCount;
+			const int16 *coefs = _coefs + coefPhase * _taps;
+
+			st_sample_t out0, out1;
+			out0 = filterOutput(filterDotProduct(_hist0 + _histPos + 1, coefs, _taps));
+			out1 = (stereo ?
+						  filterOutput(filterDotProduct(_hist1 + _histPos + 1, coefs, _taps)) :
+						  out0);
+
+			// output left channel
+			clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+
+			// output right channel
+			clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+
+			obuf += 2;
+
+			// Increment output position
+			_phase += _phaseInc;
+		}
+	}
+	return (obuf - ostart) / 2;
+}
+
+
+#pragma mark -
+
+
 /**
  * Simple audio rate converter for the case that the inrate equals the outrate.
  */
@@ -285,7 +559,6 @@ public:
 	virtual int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
 		assert(input.isStereo() == stereo);
 
-		st_sample_t *ptr;
 		st_size_t len;
 
 		st_sample_t *ostart = obuf;
@@ -304,20 +577,10 @@ public:
 		len = input.readBuffer(_buffer, osamp);
 
 		// Mix the data into the output buffer
-		ptr = _buffer;
-		for (; len > 0; len -= (stereo ? 2 : 1)) {
-			st_sample_t out0, out1;
-			out0 = *ptr++;
-			out1 = (stereo ? *ptr++ : out0);
+		const st_size_t frames = (stereo ? len / 2 : len);
+		mixScaledSamples<stereo, reverseStereo>(obuf, _buffer, frames, vol_l, vol_r);
+		obuf += frames * 2;
 
-			// output left channel
-			clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
-
-			// output right channel
-			clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
-
-			obuf += 2;
-		}
 		return (obuf - ostart) / 2;
 	}
 
@@ -330,9 +593,12 @@ public:
 #pragma mark -
 
 template<bool stereo, bool reverseStereo>
-RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate) {
+RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, RateConverterQuality quality) {
 	if (inrate != outrate) {
-		if ((inrate % outrate) == 0) {
+		// The simple and linear converters can not handle rates >= 65536
+		if (quality == kRateQualityHigh || inrate >= 65536 || outrate >= 65536) {
+			return new FilterRateConverter<stereo, reverseStereo>(inrate, outrate);
+		} else if ((inrate % outrate) == 0) {
 			return new SimpleRateConverter<stereo, reverseStereo>(inrate, outrate);
 		} else {
 			return new LinearRateConverter<stereo, reverseStereo>(inrate, outrate);
@@ -345,14 +611,14 @@ RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate) {
 /**
  * Create and return a RateConverter object for the specified input and output rates.
  */
-RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo) {
+RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo, RateConverterQuality quality) {
 	if (stereo) {
 		if (reverseStereo)
-			return makeRateConverter<true, true>(inrate, outrate);
+			return makeRateConverter<true, true>(inrate, outrate, quality);
 		else
-			return makeRateConverter<true, false>(inrate, outrate);
+			return makeRateConverter<true, false>(inrate, outrate, quality);
 	} else
-		return makeRateConverter<false, false>(inrate, outrate);
+		return makeRateConverter<false, false>(inrate, outrate, quality);
 }
 
 } // End of namespace Audio
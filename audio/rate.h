@@ -70,6 +70,17 @@ static inline void clampedAdd(int16& a, int b) {
 #endif
 }
 
+/**
+ * Quality settings for the rate converters. A higher quality results in
+ * a higher CPU and memory usage.
+ */
+enum RateConverterQuality {
+	/** Simple and linear interpolation, suited for low-end systems */
+	kRateQualityLow = 0,
+	/** Polyphase windowed-sinc filtering */
+	kRateQualityHigh = 1
+};
+
 class RateConverter {
 public:
 	RateConverter() {}
@@ -83,7 +94,7 @@ public:
 	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) = 0;
 };
 
-RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo = false);
+RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo = false, RateConverterQuality quality = kRateQualityLow);
 
 } // End of namespace Audio
 
@@ -26,9 +26,12 @@
 #define SOUND_SOFTSYNTH_EMUMIDI_H
 
 #include "audio/audiostream.h"
+#include "audio/midicache.h"
 #include "audio/mididrv.h"
 #include "audio/mixer.h"
 
+#include "common/array.h"
+
 #define FIXP_SHIFT 16
 
 class MidiDriver_Emulated : public Audio::AudioStream, public MidiDriver {
@@ -44,12 +47,106 @@ private:
 	int _nextTick;
 	int _samplesPerTick;
 
+	Audio::MidiRenderCache *_renderCache;
+
+	struct ScheduledEvent {
+		int time;		///< Offset into the buffer, in samples
+		uint32 msg;		///< The message, or 0 for SysEx data
+		uint32 sysExPos;	///< Position of the SysEx data in _sysExData
+		uint16 sysExLength;	///< Length of the SysEx data, 0 for a message
+	};
+
+	bool _scheduling;
+	int _eventTime;
+	Common::Array<ScheduledEvent> _events;
+	Common::Array<byte> _sysExData;
+
+	void addEvent(uint32 msg, const byte *sysEx, uint16 length) {
+		ScheduledEvent event;
+		event.time = _eventTime;
+		event.msg = msg;
+		event.sysExPos = _sysExData.size();
+		event.sysExLength = length;
+		for (uint16 i = 0; i < length; ++i)
+			_sysExData.push_back(sysEx[i]);
+		_events.push_back(event);
+	}
+
+	void readBufferScheduled(int16 *data, int len) {
+		const int stereoFactor = isStereo() ? 2 : 1;
+
+		// Run all timer callbacks for this buffer first and keep the events
+		// they send, along with the position they are due at
+		int pos = 0;
+		while (pos + (_nextTick >> FIXP_SHIFT) <= len) {
+			pos += _nextTick >> FIXP_SHIFT;
+			_nextTick &= (1 << FIXP_SHIFT) - 1;
+			_eventTime = pos;
+			if (_timerProc) {
+				_scheduling = true;
+				(*_timerProc)(_timerParam);
+				_scheduling = false;
+			}
+			onTimer();
+			_nextTick += _samplesPerTick;
+		}
+		_nextTick -= (len - pos) << FIXP_SHIFT;
+
+		// Then render the buffer, only stopping where an event is due
+		pos = 0;
+		for (uint i = 0; i < _events.size(); ++i) {
+			const ScheduledEvent &event = _events[i];
+			if (event.time > pos) {
+				generateSamples(data + pos * stereoFactor, event.time - pos);
+				pos = event.time;
+			}
+			if (event.sysExLength)
+				sysEx(&_sysExData[event.sysExPos], event.sysExLength);
+			else
+				send(event.msg);
+		}
+		if (pos < len)
+			generateSamples(data + pos * stereoFactor, len - pos);
+
+		_events.clear();
+		_sysExData.clear();
+	}
+
 protected:
 	virtual void generateSamples(int16 *buf, int len) = 0;
 	virtual void onTimer() {}
 
 	int _baseFreq;
 
+	/**
+	 * Set by drivers which get all their input through send() and sysEx(),
+	 * including the input of their MidiChannel objects. The timer callbacks
+	 * for a whole buffer, and onTimer(), are then run before rendering it,
+	 * and the buffer is rendered in one go, only split where an event is
+	 * due. Otherwise the buffer is split at every timer tick.
+	 *
+	 * Such drivers have to start their send() and sysEx() with a call to
+	 * scheduleEvent() and scheduleSysEx(), and return if these return true.
+	 * The event is then passed to them again once rendering reaches it.
+	 */
+	bool _scheduleEvents;
+
+	bool scheduleEvent(uint32 b) {
+		// A message of 0 would be a note off on channel 0 with running
+		// status, which is not used
+		if (!_scheduling || !b)
+			return false;
+		addEvent(b, 0, 0);
+		return true;
+	}
+
+	bool scheduleSysEx(const byte *msg, uint16 length) {
+		if (!_scheduling || !length)
+			return false;
+		addEvent(0, msg, length);
+		return true;
+	}
+
 public:
 	MidiDriver_Emulated(Audio::Mixer *mixer) : _mixer(mixer) {
 		_isOpen = false;
@@ -60,6 +157,12 @@ public:
 		_nextTick = 0;
 		_samplesPerTick = 0;
 
+		_renderCache = 0;
+
+		_scheduling = false;
+		_eventTime = 0;
+		_scheduleEvents = false;
+
 		_baseFreq = 250;
 	}
 
@@ -83,6 +186,13 @@ public:
 
 	uint32 getBaseTempo() { return 1000000 / _baseFreq; }
 
+	bool setRenderCache(Audio::MidiRenderCache *cache) {
+		if (cache)
+			cache->setOutputFormat(getRate(), isStereo());
+		_renderCache = cache;
+		return true;
+	}
+
 
 	// AudioStream API
 	int readBuffer(int16 *data, const int numSamples) {
@@ -90,15 +200,26 @@ public:
 		int len = numSamples / stereoFactor;
 		int step;
 
+		// The render cache needs to see every tick in order with the
+		// samples before it
+		if (_scheduleEvents && !_renderCache) {
+			readBufferScheduled(data, len);
+			return numSamples;
+		}
+
 		do {
 			step = len;
 			if (step > (_nextTick >> FIXP_SHIFT))
 				step = (_nextTick >> FIXP_SHIFT);
 
 			generateSamples(data, step);
+			if (_renderCache)
+				_renderCache->recordSamples(data, step * stereoFactor);
 
 			_nextTick -= step << FIXP_SHIFT;
 			if (!(_nextTick >> FIXP_SHIFT)) {
+				if (_renderCache)
+					_renderCache->onTick();
 				if (_timerProc)
 					(*_timerProc)(_timerParam);
 				onTimer();
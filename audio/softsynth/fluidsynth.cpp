@@ -74,6 +74,8 @@ MidiDriver_FluidSynth::MidiDriver_FluidSynth(Audio::Mixer *mixer)
 		_midiChannels[i].init(this, i);
 	}
 
+	_scheduleEvents = true;
+
 	// It ought to be possible to get FluidSynth to generate samples at
 	// lower
 
@@ -163,6 +165,9 @@ void MidiDriver_FluidSynth::close() {
 }
 
 void MidiDriver_FluidSynth::send(uint32 b) {
+	if (scheduleEvent(b))
+		return;
+
 	//byte param3 = (byte) ((b >> 24) & 0xFF);
 	uint param2 = (byte) ((b >> 16) & 0xFF);
 	uint param1 = (byte) ((b >>  8) & 0xFF);
@@ -278,6 +278,9 @@ MidiDriver_MT32::MidiDriver_MT32(Audio::Mixer *mixer) : MidiDriver_Emulated(mixe
 	// and means that the timer callback will be called more often.
 	// That results in more accurate timing.
 	_baseFreq = 10000;
+	// All input goes through send() and sysEx(), so the synth can render
+	// whole buffers and only stop where an event is due.
+	_scheduleEvents = true;
 	// Unfortunately bugs in the emulator cause inaccurate tuning
 	// at rates other than 32KHz, thus we produce data at 32KHz and
 	// rely on Mixer to convert.
@@ -342,6 +345,8 @@ int MidiDriver_MT32::open() {
 }
 
 void MidiDriver_MT32::send(uint32 b) {
+	if (scheduleEvent(b))
+		return;
 	_synth->playMsg(b);
 }
 
@@ -363,6 +368,8 @@ void MidiDriver_MT32::setPitchBendRange(byte channel, uint range) {
 }
 
 void MidiDriver_MT32::sysEx(const byte *msg, uint16 length) {
+	if (scheduleSysEx(msg, length))
+		return;
 	if (msg[0] == 0xf0) {
 		_synth->playSysex(msg, length);
 	} else {
@@ -46,6 +46,16 @@ void comb::mute() {
 		buffer[i] = 0;
 }
 
+bool comb::issilent() const {
+	if (filterstore != 0)
+		return false;
+	for (int i = 0; i < bufsize; i++) {
+		if (buffer[i] != 0)
+			return false;
+	}
+	return true;
+}
+
 void comb::setdamp(float val) {
 	damp1 = val;
 	damp2 = 1 - val;
@@ -79,6 +89,14 @@ void allpass::mute() {
 		buffer[i] = 0;
 }
 
+bool allpass::issilent() const {
+	for (int i = 0; i < bufsize; i++) {
+		if (buffer[i] != 0)
+			return false;
+	}
+	return true;
+}
+
 void allpass::setfeedback(float val) {
 	feedback = val;
 }
@@ -132,6 +150,9 @@ revmodel::revmodel() {
 	setdamp(initialdamp);
 	setwidth(initialwidth);
 
+	silent = false;
+	zerorun = 0;
+
 	// Buffer will be full of rubbish - so we MUST mute them
 	mute();
 }
@@ -154,8 +175,112 @@ void revmodel::mute() {
 }
 
 void revmodel::processreplace(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip) {
+	float outL[blocksize], outR[blocksize], input[blocksize];
+
+	if (skip != 1) {
+		processreplaceinterleaved(inputL, inputR, outputL, outputR, numsamples, skip);
+		return;
+	}
+
+	while (numsamples > 0) {
+		long n = numsamples < blocksize ? numsamples : blocksize;
+		long i;
+
+		bool zeroinput = true;
+		for (i = 0; i < n; i++) {
+			if (inputL[i] != 0 || inputR[i] != 0)
+				zeroinput = false;
+			input[i] = (inputL[i] + inputR[i]) * gain;
+		}
+
+		if (!zeroinput) {
+			silent = false;
+			zerorun = 0;
+		}
+
+		if (silent) {
+			// Nothing in the filters and nothing coming in, so the
+			// output is silence as well
+			for (i = 0; i < n; i++)
+				outputL[i] = outputR[i] = 0;
+		} else {
+			for (i = 0; i < n; i++) {
+				float l = 0, r = 0;
+				int j;
+
+				// Accumulate comb filters in parallel
+				for (j = 0; j < numcombs; j++) {
+					l += combL[j].process(input[i]);
+					r += combR[j].process(input[i]);
+				}
+
+				// Feed through allpasses in series
+				for (j = 0; j < numallpasses; j++) {
+					l = allpassL[j].process(l);
+					r = allpassR[j].process(r);
+				}
+
+				outL[i] = l;
+				outR[i] = r;
+			}
+
+			// Calculate output REPLACING anything already there
+			bool zerooutput = true;
+			for (i = 0; i < n; i++) {
+				outputL[i] = outL[i] * wet1 + outR[i] * wet2 + inputL[i] * dry;
+				outputR[i] = outR[i] * wet1 + outL[i] * wet2 + inputR[i] * dry;
+				if (outL[i] != 0 || outR[i] != 0)
+					zerooutput = false;
+			}
+
+			// After a whole turn of the longest comb filter without any
+			// input or output, check whether the filters have decayed
+			// completely. Checking earlier would mostly be wasted effort.
+			if (zeroinput && zerooutput) {
+				zerorun += n;
+				if (zerorun >= combtuningR8) {
+					silent = checksilent();
+					zerorun = 0;
+				}
+			} else {
+				zerorun = 0;
+			}
+		}
+
+		inputL += n;
+		inputR += n;
+		outputL += n;
+		outputR += n;
+		numsamples -= n;
+	}
+}
+
+bool revmodel::issilent() {
+	return silent;
+}
+
+bool revmodel::checksilent() {
+	int i;
+
+	for (i = 0; i < numcombs; i++) {
+		if (!combL[i].issilent() || !combR[i].issilent())
+			return false;
+	}
+
+	for (i = 0; i < numallpasses; i++) {
+		if (!allpassL[i].issilent() || !allpassR[i].issilent())
+			return false;
+	}
+
+	return true;
+}
+
+void revmodel::processreplaceinterleaved(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip) {
 	float outL, outR, input;
 
+	silent = false;
+	zerorun = 0;
+
 	while (numsamples-- > 0) {
 		int i;
 
@@ -189,6 +314,9 @@ void revmodel::processreplace(float *inputL, float *inputR, float *outputL, floa
 void revmodel::processmix(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip) {
 	float outL, outR, input;
 
+	silent = false;
+	zerorun = 0;
+
 	while (numsamples-- > 0) {
 		int i;
 
@@ -48,6 +48,7 @@ public:
 	void setbuffer(float *buf, int size);
 	inline float process(float inp);
 	void mute();
+	bool issilent() const;
 	void setdamp(float val);
 	float getdamp();
 	void setfeedback(float val);
@@ -68,11 +69,10 @@ private:
 inline float comb::process(float input) {
 	float output;
 
-	output = buffer[bufidx];
-	undenormalise(&output);
+	output = undenormalise(&buffer[bufidx]);
 
 	filterstore = (output * damp2) + (filterstore * damp1);
-	undenormalise(&filterstore);
+	filterstore = undenormalise(&filterstore);
 
 	buffer[bufidx] = input + (filterstore * feedback);
 
@@ -90,6 +90,7 @@ public:
 	void setbuffer(float *buf, int size);
 	inline float process(float inp);
 	void mute();
+	bool issilent() const;
 	void setfeedback(float val);
 	float getfeedback();
 private:
@@ -106,8 +107,7 @@ inline float allpass::process(float input) {
 	float output;
 	float bufout;
 
-	bufout = buffer[bufidx];
-	undenormalise(&bufout);
+	bufout = undenormalise(&buffer[bufidx]);
 
 	output = -input + bufout;
 	buffer[bufidx] = input + (bufout * feedback);
@@ -138,6 +138,7 @@ const float	initialwidth	= 1;
 const float	initialmode	= 0;
 const float	freezemode	= 0.5f;
 const int	stereospread	= 23;
+const int	blocksize	= 256;
 
 // These values assume 44.1KHz sample rate
 // they will probably be OK for 48KHz sample rate
@@ -177,6 +178,7 @@ public:
 	void mute();
 	void processmix(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip);
 	void processreplace(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip);
+	bool issilent();
 	void setroomsize(float value);
 	float getroomsize();
 	void setdamp(float value);
@@ -191,6 +193,8 @@ public:
 	float getmode();
 private:
 	void update();
+	bool checksilent();
+	void processreplaceinterleaved(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int skip);
 
 	float gain;
 	float roomsize, roomsize1;
@@ -200,6 +204,10 @@ private:
 	float width;
 	float mode;
 
+	// Set once all filters have decayed to zero; cleared by any non-silent input
+	bool silent;
+	long zerorun;
+
 	// The following are all declared inline
 	// to remove the need for dynamic allocation
 	// with its subsequent error-checking messiness
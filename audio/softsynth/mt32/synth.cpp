@@ -1135,27 +1135,33 @@ void Synth::doRender(Bit16s *stream, Bit32u len) {
 	partialManager->ageAll();
 
 	if (myProp.useReverb) {
+		bool reverbInput = false;
 		for (unsigned int i = 0; i < MT32EMU_MAX_PARTIALS; i++) {
 			if (partialManager->shouldReverb(i)) {
 				if (partialManager->produceOutput(i, &tmpBuffer[0], len)) {
 					ProduceOutput1(&tmpBuffer[0], stream, len, masterVolume);
+					reverbInput = true;
 				}
 			}
 		}
-		Bit32u m = 0;
-		for (unsigned int i = 0; i < len; i++) {
-			sndbufl[i] = (float)stream[m] / 32767.0f;
-			m++;
-			sndbufr[i] = (float)stream[m] / 32767.0f;
-			m++;
-		}
-		reverbModel->processreplace(sndbufl, sndbufr, outbufl, outbufr, len, 1);
-		m=0;
-		for (unsigned int i = 0; i < len; i++) {
-			stream[m] = (Bit16s)(outbufl[i] * 32767.0f);
-			m++;
-			stream[m] = (Bit16s)(outbufr[i] * 32767.0f);
-			m++;
+		// Once the reverb tail has died away, silence stays silence until
+		// a reverberated partial sounds again
+		if (reverbInput || !reverbModel->issilent()) {
+			Bit32u m = 0;
+			for (unsigned int i = 0; i < len; i++) {
+				sndbufl[i] = (float)stream[m] / 32767.0f;
+				m++;
+				sndbufr[i] = (float)stream[m] / 32767.0f;
+				m++;
+			}
+			reverbModel->processreplace(sndbufl, sndbufr, outbufl, outbufr, len, 1);
+			m=0;
+			for (unsigned int i = 0; i < len; i++) {
+				stream[m] = (Bit16s)(outbufl[i] * 32767.0f);
+				m++;
+				stream[m] = (Bit16s)(outbufr[i] * 32767.0f);
+				m++;
+			}
 		}
 		for (unsigned int i = 0; i < MT32EMU_MAX_PARTIALS; i++) {
 			if (!partialManager->shouldReverb(i)) {
@@ -174,6 +174,11 @@ static const Bit16u WaveStartTable[8] = {
 static Bit16u MulTable[ 384 ];
 #endif
 
+//The noise generator is linear, so its state after 8, 16, 32 ... 1024 steps
+//is the xor of the tables below for each of the 3 bytes of its state
+#define NOISE_LEVELS 8
+static Bit32u NoiseTable[ NOISE_LEVELS ][ 3 ][ 256 ];
+
 static Bit8u KslTable[ 8 * 16 ];
 static Bit8u TremoloTable[ TREMOLO_TABLE ];
 //Start of a channel behind the chip struct start
@@ -1034,7 +1039,16 @@ INLINE Bit32u Chip::ForwardNoise() {
 	noiseCounter += noiseAdd;
 	Bitu count = noiseCounter >> LFO_SH;
 	noiseCounter &= WAVE_MASK;
-	for ( ; count > 0; --count ) {
+	//This is hundreds of steps per sample, so take most of them through the
+	//tables. Count stays below 8 << NOISE_LEVELS for any rate above 50Hz.
+	Bitu steps = count >> 3;
+	for ( Bitu level = 0; steps; level++, steps >>= 1 ) {
+		if ( steps & 1 ) {
+			const Bit32u (*table)[ 256 ] = NoiseTable[ level ];
+			noiseValue = table[0][ noiseValue & 0xff ] ^ table[1][ ( noiseValue >> 8 ) & 0xff ] ^ table[2][ noiseValue >> 16 ];
+		}
+	}
+	for ( count &= 7; count > 0; --count ) {
 		//Noise calculation from mame
 		noiseValue ^= ( 0x800302 ) & ( 0 - (noiseValue & 1 ) );
 		noiseValue >>= 1;
@@ -1378,6 +1392,19 @@ void InitTables( void ) {
 	if ( doneTables )
 		return;
 	doneTables = true;
+	//Noise generator steps
+	for ( int level = 0; level < NOISE_LEVELS; level++ ) {
+		for ( int byte = 0; byte < 3; byte++ ) {
+			for ( int i = 0; i < 256; i++ ) {
+				Bit32u value = i << ( byte * 8 );
+				for ( int j = 0; j < ( 8 << level ); j++ ) {
+					value ^= ( 0x800302 ) & ( 0 - (value & 1 ) );
+					value >>= 1;
+				}
+				NoiseTable[ level ][ byte ][ i ] = value;
+			}
+		}
+	}
 #if ( DBOPL_WAVE == WAVE_HANDLER ) || ( DBOPL_WAVE == WAVE_TABLELOG )
 	//Exponential volume table, same as the real adlib
 	for ( int i = 0; i < 256; i++ ) {
@@ -42,6 +42,7 @@ public:
 	int getDefaultGraphicsMode() const { return 0; }
 	bool setGraphicsMode(int mode) { return true; }
 	int getGraphicsMode() const { return 0; }
+	void resetGraphicsScale() {}
 	inline Graphics::PixelFormat getScreenFormat() const {
 		return Graphics::PixelFormat::createFormatCLUT8();
 	}
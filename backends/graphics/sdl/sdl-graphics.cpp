@@ -141,7 +141,10 @@ SdlGraphicsManager::SdlGraphicsManager(SdlEventSource *sdlEventSource)
 	_currentShakePos(0), _newShakePos(0),
 	_paletteDirtyStart(0), _paletteDirtyEnd(0),
 	_screenIsLocked(false),
-	_graphicsMutex(0), _transactionMode(kTransactionNone) {
+	_graphicsMutex(0), _transactionMode(kTransactionNone),
+	_numScalerThreads(1), _scalerMutex(0), _scalerJobCond(0), _scalerDoneCond(0),
+	_scalerThreadsShouldQuit(false), _nextScalerJob(0), _unfinishedScalerJobs(0),
+	_scalerJobProc(0), _scalerJobSrcPitch(0), _scalerJobDstPitch(0) {
 
 	if (SDL_InitSubSystem(SDL_INIT_VIDEO) == -1) {
 		error("Could not initialize SDL: %s", SDL_GetError());
@@ -193,6 +196,8 @@ SdlGraphicsManager::SdlGraphicsManager(SdlEventSource *sdlEventSource)
 #else
 	_videoMode.fullscreen = true;
 #endif
+
+	initScalerThreads();
 }
 
 SdlGraphicsManager::~SdlGraphicsManager() {
@@ -200,6 +205,7 @@ SdlGraphicsManager::~SdlGraphicsManager() {
 	if (g_system->getEventManager()->getEventDispatcher() != NULL)
 		g_system->getEventManager()->getEventDispatcher()->unregisterObserver(this);
 
+	deinitScalerThreads();
 	unloadGFXMode();
 	if (_mouseSurface)
 		SDL_FreeSurface(_mouseSurface);
@@ -1072,8 +1078,8 @@ void SdlGraphicsManager::internUpdateScreen() {
 					dst_y = real2Aspect(dst_y);
 
 				assert(scalerProc != NULL);
-				scalerProc((byte *)srcSurf->pixels + (r->x * 2 + 2) + (r->y + 1) * srcPitch, srcPitch,
-					(byte *)_hwscreen->pixels + rx1 * 2 + dst_y * dstPitch, dstPitch, r->w, dst_h);
+				scaleRect(scalerProc, (byte *)srcSurf->pixels + (r->x * 2 + 2) + (r->y + 1) * srcPitch, srcPitch,
+					(byte *)_hwscreen->pixels + rx1 * 2 + dst_y * dstPitch, dstPitch, r->w, dst_h, scale1);
 			}
 
 			r->x = rx1;
@@ -1112,6 +1118,130 @@ void SdlGraphicsManager::internUpdateScreen() {
 	_mouseNeedsRedraw = false;
 }
 
+void SdlGraphicsManager::initScalerThreads() {
+	int threads = 1;
+	if (ConfMan.hasKey("scaler_threads"))
+		threads = CLIP<int>(ConfMan.getInt("scaler_threads"), 1, kMaxScalerThreads);
+
+	_numScalerThreads = 1;
+	if (threads == 1)
+		return;
+
+	_scalerThreadsShouldQuit = false;
+	_scalerMutex = SDL_CreateMutex();
+	_scalerJobCond = SDL_CreateCond();
+	_scalerDoneCond = SDL_CreateCond();
+
+	for (int i = 1; i < threads; i++) {
+		_scalerThreads[_numScalerThreads] = SDL_CreateThread(scalerThreadEntry, this);
+		if (!_scalerThreads[_numScalerThreads]) {
+			warning("Could not create scaler thread: %s", SDL_GetError());
+			break;
+		}
+		_numScalerThreads++;
+	}
+}
+
+void SdlGraphicsManager::deinitScalerThreads() {
+	if (!_scalerMutex)
+		return;
+
+	// Signal the scaler threads to end, and wait for them to actually finish
+	SDL_LockMutex(_scalerMutex);
+	_scalerThreadsShouldQuit = true;
+	SDL_CondBroadcast(_scalerJobCond);
+	SDL_UnlockMutex(_scalerMutex);
+
+	for (int i = 1; i < _numScalerThreads; i++)
+		SDL_WaitThread(_scalerThreads[i], NULL);
+
+	SDL_DestroyMutex(_scalerMutex);
+	SDL_DestroyCond(_scalerJobCond);
+	SDL_DestroyCond(_scalerDoneCond);
+	_scalerMutex = 0;
+	_scalerJobCond = 0;
+	_scalerDoneCond = 0;
+	_numScalerThreads = 1;
+}
+
+void SdlGraphicsManager::scaleRect(ScalerProc *scalerProc, const uint8 *src, uint32 srcPitch, uint8 *dst, uint32 dstPitch, int width, int height, int scaleFactor) {
+	const int bands = MIN(_numScalerThreads, height / kMinScalerBandHeight);
+
+	if (bands <= 1) {
+		scalerProc(src, srcPitch, dst, dstPitch, width, height);
+		return;
+	}
+
+	SDL_LockMutex(_scalerMutex);
+
+	_scalerJobs.clear();
+	int y = 0;
+	for (int i = 0; i < bands; i++) {
+		ScalerJob job;
+		job.src = src + y * srcPitch;
+		job.dst = dst + y * scaleFactor * dstPitch;
+		job.width = width;
+		// Keep the bands aligned to 4 rows, as the pattern of the DotMatrix
+		// scaler depends on the row
+		job.height = (i == bands - 1) ? height - y : ((height - y) / (bands - i)) & ~3;
+		_scalerJobs.push_back(job);
+		y += job.height;
+	}
+
+	_scalerJobProc = scalerProc;
+	_scalerJobSrcPitch = srcPitch;
+	_scalerJobDstPitch = dstPitch;
+	_nextScalerJob = 0;
+	_unfinishedScalerJobs = bands;
+	SDL_CondBroadcast(_scalerJobCond);
+
+	// Work on the jobs as well, then wait for the scaler threads to finish
+	// theirs
+	while (true) {
+		while (_nextScalerJob < _scalerJobs.size())
+			runNextScalerJob();
+
+		if (!_unfinishedScalerJobs)
+			break;
+
+		SDL_CondWait(_scalerDoneCond, _scalerMutex);
+	}
+
+	SDL_UnlockMutex(_scalerMutex);
+}
+
+void SdlGraphicsManager::runNextScalerJob() {
+	const ScalerJob job = _scalerJobs[_nextScalerJob++];
+	ScalerProc *scalerProc = _scalerJobProc;
+	const uint32 srcPitch = _scalerJobSrcPitch;
+	const uint32 dstPitch = _scalerJobDstPitch;
+
+	SDL_UnlockMutex(_scalerMutex);
+	scalerProc(job.src, srcPitch, job.dst, dstPitch, job.width, job.height);
+	SDL_LockMutex(_scalerMutex);
+
+	if (!--_unfinishedScalerJobs)
+		SDL_CondSignal(_scalerDoneCond);
+}
+
+void SdlGraphicsManager::scalerThread() {
+	SDL_LockMutex(_scalerMutex);
+	while (!_scalerThreadsShouldQuit) {
+		if (_nextScalerJob < _scalerJobs.size())
+			runNextScalerJob();
+		else
+			SDL_CondWait(_scalerJobCond, _scalerMutex);
+	}
+	SDL_UnlockMutex(_scalerMutex);
+}
+
+int SDLCALL SdlGraphicsManager::scalerThreadEntry(void *arg) {
+	SdlGraphicsManager *graphicsManager = (SdlGraphicsManager *)arg;
+	assert(graphicsManager);
+	graphicsManager->scalerThread();
+	return 0;
+}
+
 bool SdlGraphicsManager::saveScreenshot(const char *filename) {
 	assert(_hwscreen != NULL);
 
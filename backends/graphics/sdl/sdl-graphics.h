@@ -28,6 +28,7 @@
 
 #include "backends/graphics/graphics.h"
 #include "graphics/scaler.h"
+#include "common/array.h"
 #include "common/events.h"
 #include "common/system.h"
 
@@ -237,6 +238,34 @@ protected:
 		MAX_SCALING = 3
 	};
 
+	enum {
+		kMaxScalerThreads = 8,
+		kMinScalerBandHeight = 16	///< Rects are only split into bands of at least this many rows
+	};
+
+	/** A horizontal band of a dirty rect, to be scaled by one of the scaler threads */
+	struct ScalerJob {
+		const uint8 *src;
+		uint8 *dst;
+		int width, height;
+	};
+
+	// Scaler threads. The thread calling internUpdateScreen() works on the
+	// jobs as well, so there are _numScalerThreads - 1 extra threads.
+	int _numScalerThreads;
+	SDL_Thread *_scalerThreads[kMaxScalerThreads];
+	SDL_mutex *_scalerMutex;
+	SDL_cond *_scalerJobCond;
+	SDL_cond *_scalerDoneCond;
+	bool _scalerThreadsShouldQuit;
+
+	// Scaler jobs, protected by _scalerMutex
+	Common::Array<ScalerJob> _scalerJobs;
+	uint _nextScalerJob;
+	uint _unfinishedScalerJobs;
+	ScalerProc *_scalerJobProc;
+	uint32 _scalerJobSrcPitch, _scalerJobDstPitch;
+
 	// Dirty rect management
 	SDL_Rect _dirtyRectList[NUM_DIRTY_RECT];
 	int _numDirtyRects;
@@ -309,6 +338,27 @@ protected:
 
 	virtual void internUpdateScreen();
 
+	/**
+	 * Starts the scaler threads, as configured by the "scaler_threads"
+	 * config key. If no threads can be started, all scaling is done by the
+	 * calling thread.
+	 */
+	void initScalerThreads();
+	void deinitScalerThreads();
+
+	/**
+	 * Scales a rect. Large rects are split into horizontal bands, which are
+	 * scaled in parallel by the scaler threads. The scalers read the rows
+	 * around each band from the shared source surface, so the result is the
+	 * same as when scaling the whole rect at once.
+	 */
+	void scaleRect(ScalerProc *scalerProc, const uint8 *src, uint32 srcPitch, uint8 *dst, uint32 dstPitch, int width, int height, int scaleFactor);
+
+	/** Runs the next scaler job, _scalerMutex has to be locked */
+	void runNextScalerJob();
+	void scalerThread();
+	static int SDLCALL scalerThreadEntry(void *arg);
+
 	virtual bool loadGFXMode();
 	virtual void unloadGFXMode();
 	virtual bool hotswapGFXMode();
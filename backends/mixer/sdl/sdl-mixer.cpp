@@ -60,18 +60,28 @@ void SdlMixerManager::init() {
 	// Get the desired audio specs
 	SDL_AudioSpec desired = getAudioSpec(SAMPLES_PER_SEC);
 
+	// Determine how many sounds may be played simultaneously
+	uint numChannels = Audio::MixerImpl::kDefaultNumChannels;
+	if (ConfMan.hasKey("mixer_channels") && ConfMan.getInt("mixer_channels") > 0)
+		numChannels = ConfMan.getInt("mixer_channels");
+
 	// Start SDL audio with the desired specs
 	if (SDL_OpenAudio(&desired, &_obtainedRate) != 0) {
 		warning("Could not open audio device: %s", SDL_GetError());
 
-		_mixer = new Audio::MixerImpl(g_system, desired.freq);
+		_mixer = new Audio::MixerImpl(g_system, desired.freq, numChannels);
 		assert(_mixer); 
 		_mixer->setReady(false);
 	} else {
 		debug(1, "Output sample rate: %d Hz", _obtainedRate.freq);
 
-		_mixer = new Audio::MixerImpl(g_system, _obtainedRate.freq);
+		_mixer = new Audio::MixerImpl(g_system, _obtainedRate.freq, numChannels);
 		assert(_mixer); 
+
+		// Use the filtering rate converters, unless the user asks for the
+		// cheaper linear interpolation
+		if (!ConfMan.hasKey("resampler") || ConfMan.get("resampler") != "linear")
+			_mixer->setRateConverterQuality(Audio::kRateQualityHigh);
 		_mixer->setReady(true);
 
 		startAudio();
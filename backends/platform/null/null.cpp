@@ -27,11 +27,21 @@
 #include "base/main.h"
 
 #if defined(USE_NULL_DRIVER)
+#include "backends/audiocd/default/default-audiocd.h"
+#include "backends/events/default/default-events.h"
+#include "backends/graphics/null/null-graphics.h"
+#include "backends/mutex/null/null-mutex.h"
 #include "backends/saves/default/default-saves.h"
 #include "backends/timer/default/default-timer.h"
 #include "audio/mixer_intern.h"
+#include "common/config-manager.h"
+#include "common/EventRecorder.h"
+#include "common/file.h"
 #include "common/scummsys.h"
 
+#include <new>
+#include <time.h>
+
 /*
  * Include header files needed for the getFilesystemFactory() method.
  */
@@ -43,7 +53,63 @@
 	#include "backends/fs/windows/windows-fs-factory.h"
 #endif
 
-class OSystem_NULL : public ModularBackend {
+#ifdef NULL_COUNT_ALLOCATIONS
+/*
+ * Number of allocations done through operator new, reported per frame in
+ * benchmark mode. Replacing the global allocator affects every allocation
+ * of the program, so this is only done when NULL_COUNT_ALLOCATIONS is
+ * defined, see the --enable-count-allocations configure option.
+ */
+static uint32 s_allocationCount = 0;
+
+static void *countedAllocation(size_t size) {
+	s_allocationCount++;
+
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr) {
+#ifdef __EXCEPTIONS
+		throw std::bad_alloc();
+#else
+		// Exceptions are usually disabled, see Makefile
+		error("Out of memory allocating %u bytes", (uint)size);
+#endif
+	}
+
+	return ptr;
+}
+
+void *operator new(size_t size) throw (std::bad_alloc) {
+	return countedAllocation(size);
+}
+
+void *operator new[](size_t size) throw (std::bad_alloc) {
+	return countedAllocation(size);
+}
+
+void operator delete(void *ptr) throw () {
+	free(ptr);
+}
+
+void operator delete[](void *ptr) throw () {
+	free(ptr);
+}
+#endif
+
+/*
+ * In benchmark mode, which is enabled by setting the benchmark_file config
+ * key (usually together with record_mode=playback), the backend runs on a
+ * virtual clock: delayMillis() returns immediately and advances the clock
+ * instead, and timers and the mixer are driven by it. For every call to
+ * updateScreen(), a line is written to the benchmark file, containing the
+ * virtual time, the CPU time and the virtual (engine) time since the last
+ * frame, and the number of allocations done in between. The game is quit
+ * once the recorded events are used up.
+ *
+ * Counting the allocations replaces the global operator new, so it has to
+ * be switched on with "configure --backend=null --enable-count-allocations".
+ * Without it, the allocations column is left out.
+ */
+class OSystem_NULL : public ModularBackend, Common::EventSource {
 public:
 	OSystem_NULL();
 	virtual ~OSystem_NULL();
@@ -52,12 +118,36 @@ public:
 
 	virtual bool pollEvent(Common::Event &event);
 
+	virtual void updateScreen();
+
 	virtual uint32 getMillis();
 	virtual void delayMillis(uint msecs);
 	virtual void getTimeAndDate(TimeDate &t) const {}
 
 	virtual Common::SeekableReadStream *createConfigReadStream();
 	virtual Common::WriteStream *createConfigWriteStream();
+
+private:
+	enum {
+		kSampleRate = 22050,
+		kTimerInterval = 10	///< Virtual time between two runs of the timers, in ms
+	};
+
+	// Benchmark mode state
+	Common::DumpFile *_benchmarkFile;
+	uint32 _virtualMillis;
+	uint32 _lastTimerMillis;
+	uint32 _frameCount;
+	uint32 _lastFrameMillis;
+	clock_t _lastFrameClock;
+#ifdef NULL_COUNT_ALLOCATIONS
+	uint32 _lastFrameAllocations;
+#endif
+	uint32 _pendingSamples;	///< Samples to mix, in 1/1000 samples
+	byte *_mixBuffer;
+	bool _quitSent;
+
+	void runVirtualTime(uint msecs);
 };
 
 OSystem_NULL::OSystem_NULL() {
@@ -70,9 +160,27 @@ OSystem_NULL::OSystem_NULL() {
 	#else
 		#error Unknown and unsupported FS backend
 	#endif
+
+	_benchmarkFile = 0;
+	_virtualMillis = 0;
+	_lastTimerMillis = 0;
+	_frameCount = 0;
+	_lastFrameMillis = 0;
+	_lastFrameClock = 0;
+#ifdef NULL_COUNT_ALLOCATIONS
+	_lastFrameAllocations = 0;
+#endif
+	_pendingSamples = 0;
+	_mixBuffer = 0;
+	_quitSent = false;
 }
 
 OSystem_NULL::~OSystem_NULL() {
+	if (_benchmarkFile) {
+		_benchmarkFile->finalize();
+		delete _benchmarkFile;
+	}
+	free(_mixBuffer);
 }
 
 void OSystem_NULL::initBackend() {
@@ -81,27 +189,113 @@ void OSystem_NULL::initBackend() {
 	_eventManager = new DefaultEventManager(this);
 	_savefileManager = new DefaultSaveFileManager();
 	_graphicsManager = (GraphicsManager *)new NullGraphicsManager();
+	// The audio CD manager needs the mixer
+	_mixer = new Audio::MixerImpl(this, kSampleRate);
 	_audiocdManager = (AudioCDManager *)new DefaultAudioCDManager();
-	_mixer = new Audio::MixerImpl(this, 22050);
 
-	((Audio::MixerImpl *)_mixer)->setReady(false);
+	if (ConfMan.hasKey("benchmark_file")) {
+		_benchmarkFile = new Common::DumpFile();
+		if (!_benchmarkFile->open(ConfMan.get("benchmark_file"))) {
+			warning("Cannot open benchmark file %s. Benchmark mode was switched off", ConfMan.get("benchmark_file").c_str());
+			delete _benchmarkFile;
+			_benchmarkFile = 0;
+		}
+	}
+
+	if (_benchmarkFile) {
+#ifdef NULL_COUNT_ALLOCATIONS
+		_benchmarkFile->writeString("frame,time,cpu_us,engine_ms,allocations\n");
+		_lastFrameAllocations = s_allocationCount;
+#else
+		_benchmarkFile->writeString("frame,time,cpu_us,engine_ms\n");
+#endif
+		_lastFrameClock = clock();
+
+		// The mixer is run from delayMillis(), so the sound engines do all
+		// of their work, but the result is discarded.
+		_mixBuffer = (byte *)malloc(kSampleRate * 4 * kTimerInterval / 1000 + 4);
+		((Audio::MixerImpl *)_mixer)->setReady(true);
+	} else {
+		((Audio::MixerImpl *)_mixer)->setReady(false);
 
-	// Note that both the mixer and the timer manager are useless
-	// this way; they need to be hooked into the system somehow to
-	// be functional. Of course, can't do that in a NULL backend :).
+		// Note that both the mixer and the timer manager are useless
+		// this way; they need to be hooked into the system somehow to
+		// be functional. Of course, can't do that in a NULL backend :).
+	}
 
 	OSystem::initBackend();
 }
 
 bool OSystem_NULL::pollEvent(Common::Event &event) {
+	if (_benchmarkFile && !_quitSent && g_eventRec.isPlaybackFinished()) {
+		_quitSent = true;
+		event.type = Common::EVENT_QUIT;
+		return true;
+	}
+
 	return false;
 }
 
+void OSystem_NULL::updateScreen() {
+	ModularBackend::updateScreen();
+
+	if (!_benchmarkFile)
+		return;
+
+	const clock_t now = clock();
+	const uint32 millis = getMillis();
+	const uint32 cpuTime = (uint32)((double)(now - _lastFrameClock) * 1000000 / CLOCKS_PER_SEC);
+
+	char line[64];
+#ifdef NULL_COUNT_ALLOCATIONS
+	snprintf(line, sizeof(line), "%u,%u,%u,%u,%u\n", _frameCount, millis, cpuTime,
+	         millis - _lastFrameMillis, s_allocationCount - _lastFrameAllocations);
+	_lastFrameAllocations = s_allocationCount;
+#else
+	snprintf(line, sizeof(line), "%u,%u,%u,%u\n", _frameCount, millis, cpuTime,
+	         millis - _lastFrameMillis);
+#endif
+	_benchmarkFile->writeString(line);
+
+	_frameCount++;
+	_lastFrameMillis = millis;
+	_lastFrameClock = clock();
+}
+
 uint32 OSystem_NULL::getMillis() {
-	return 0;
+	if (!_benchmarkFile)
+		return 0;
+
+	uint32 millis = _virtualMillis;
+	g_eventRec.processMillis(millis);
+	return millis;
 }
 
 void OSystem_NULL::delayMillis(uint msecs) {
+	if (_benchmarkFile)
+		runVirtualTime(msecs);
+}
+
+void OSystem_NULL::runVirtualTime(uint msecs) {
+	// Advance the clock in steps, so that timers fire at the expected rate
+	// during long delays
+	const uint32 endMillis = _virtualMillis + msecs;
+
+	while (_virtualMillis < endMillis) {
+		const uint32 step = MIN<uint32>(endMillis - _virtualMillis, kTimerInterval - (_virtualMillis - _lastTimerMillis));
+		_virtualMillis += step;
+
+		if (_virtualMillis - _lastTimerMillis < kTimerInterval)
+			continue;
+
+		_lastTimerMillis = _virtualMillis;
+		((DefaultTimerManager *)_timerManager)->handler();
+
+		_pendingSamples += kSampleRate * kTimerInterval;
+		const uint samples = _pendingSamples / 1000;
+		_pendingSamples %= 1000;
+		((Audio::MixerImpl *)_mixer)->mixCallback(_mixBuffer, samples * 4);
+	}
 }
 
 #define DEFAULT_CONFIG_FILE "scummvm.ini"
@@ -59,6 +59,9 @@ public:
 	/** TODO: Add documentation, this is only used by the backend */
 	void processMillis(uint32 &millis);
 
+	/** Returns whether all recorded events have been played back */
+	bool isPlaybackFinished() const;
+
 private:
 	bool notifyEvent(const Event &ev);
 	bool pollEvent(Event &ev);
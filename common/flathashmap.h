@@ -0,0 +1,552 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+// The hash map implementation in this file uses open addressing with
+// linear probing and Robin Hood hashing, with backward shift deletion.
+
+#ifndef COMMON_FLATHASHMAP_H
+#define COMMON_FLATHASHMAP_H
+
+#include "common/func.h"
+#include "common/str.h"
+#include "common/util.h"
+
+namespace Common {
+
+/**
+ * FlatHashMap<Key,Val> maps objects of type Key to objects of type Val, just
+ * like HashMap, and offers the same interface. The difference lies in the
+ * way the elements are stored: instead of a table of pointers to separately
+ * allocated nodes, the nodes are stored in the table itself. Looking up a key
+ * thus touches only one or two consecutive cache lines, and no memory is
+ * allocated per element.
+ *
+ * Collisions are resolved with linear probing, using the Robin Hood scheme
+ * (an element being inserted takes the slot of any element which is closer
+ * to its home slot), which keeps the probe sequences short even for high
+ * load factors. Erasing an element moves its successors back by one slot,
+ * so no "deleted" markers are needed.
+ *
+ * This makes FlatHashMap a good choice for small keys and values which are
+ * looked up very often. For big values, which are expensive to copy, HashMap
+ * is the better choice, since elements are moved around on insertion,
+ * erasure and when the table grows.
+ *
+ * Unlike with HashMap, erase() and inserting new keys invalidate all
+ * iterators. In particular, it is not possible to erase elements while
+ * iterating over the map.
+ *
+ * Key and Val have to be default constructible and assignable.
+ */
+template<class Key, class Val, class HashFunc = Hash<Key>, class EqualFunc = EqualTo<Key> >
+class FlatHashMap {
+private:
+
+	typedef FlatHashMap<Key, Val, HashFunc, EqualFunc> HM_t;
+
+	struct Node {
+		Key _key;
+		Val _value;
+		explicit Node(const Key &key) : _key(key), _value() {}
+		Node() : _key(), _value() {}
+	};
+
+	enum {
+		FLATHASHMAP_MIN_CAPACITY = 16,
+
+		// The quotient of the next two constants controls how much the
+		// internal storage of the hashmap may fill up before being
+		// increased automatically.
+		// Note: the quotient of these two must be between and different
+		// from 0 and 1.
+		FLATHASHMAP_LOADFACTOR_NUMERATOR = 7,
+		FLATHASHMAP_LOADFACTOR_DENOMINATOR = 8,
+
+		/** Maximal probe sequence length (plus one) which can be stored */
+		FLATHASHMAP_MAX_DISTANCE = 0xFFFF
+	};
+
+	Node *_storage;		///< hashtable of size _mask + 1
+	uint16 *_dist;		///< for each slot, its distance to the home slot plus one, or 0 if unused
+	uint _mask;		///< Capacity of the HashMap minus one; must be a power of two minus one
+	uint _shift;	///< 32 minus the log2 of the capacity
+	uint _size;
+
+	HashFunc _hash;
+	EqualFunc _equal;
+
+	/** Default value, returned by the const getVal. */
+	const Val _defaultVal;
+
+	/**
+	 * Compute the home slot of a key. Since the hash functions used in
+	 * ScummVM often do not distribute their values evenly over all bits,
+	 * the hash is scrambled by a multiplication with 2^32 divided by the
+	 * golden ratio (Fibonacci hashing). The top bits are then used as slot.
+	 */
+	uint homeSlot(const Key &key) const {
+		return ((uint32)_hash(key) * 2654435769U) >> _shift;
+	}
+
+	void allocStorage(uint capacity);
+	void assign(const HM_t &map);
+	int lookup(const Key &key) const;
+	int lookupAndCreateIfMissing(const Key &key);
+	int insertNode(const Key &key);
+	void eraseSlot(uint idx);
+	void expandStorage(uint newCapacity);
+
+#if !defined(__sgi) || defined(__GNUC__)
+	template<class T> friend class IteratorImpl;
+#endif
+
+	/**
+	 * Simple FlatHashMap iterator implementation.
+	 */
+	template<class NodeType>
+	class IteratorImpl {
+		friend class FlatHashMap;
+		template<class T> friend class IteratorImpl;
+	protected:
+		typedef const FlatHashMap hashmap_t;
+
+		uint _idx;
+		hashmap_t *_hashmap;
+
+	protected:
+		IteratorImpl(uint idx, hashmap_t *hashmap) : _idx(idx), _hashmap(hashmap) {}
+
+		NodeType *deref() const {
+			assert(_hashmap != 0);
+			assert(_idx <= _hashmap->_mask);
+			assert(_hashmap->_dist[_idx] != 0);
+			return &_hashmap->_storage[_idx];
+		}
+
+	public:
+		IteratorImpl() : _idx(0), _hashmap(0) {}
+		template<class T>
+		IteratorImpl(const IteratorImpl<T> &c) : _idx(c._idx), _hashmap(c._hashmap) {}
+
+		NodeType &operator*() const { return *deref(); }
+		NodeType *operator->() const { return deref(); }
+
+		bool operator==(const IteratorImpl &iter) const { return _idx == iter._idx && _hashmap == iter._hashmap; }
+		bool operator!=(const IteratorImpl &iter) const { return !(*this == iter); }
+
+		IteratorImpl &operator++() {
+			assert(_hashmap);
+			do {
+				_idx++;
+			} while (_idx <= _hashmap->_mask && _hashmap->_dist[_idx] == 0);
+			if (_idx > _hashmap->_mask)
+				_idx = (uint)-1;
+
+			return *this;
+		}
+
+		IteratorImpl operator++(int) {
+			IteratorImpl old = *this;
+			operator ++();
+			return old;
+		}
+	};
+
+public:
+	typedef IteratorImpl<Node> iterator;
+	typedef IteratorImpl<const Node> const_iterator;
+
+	FlatHashMap();
+	FlatHashMap(const HM_t &map);
+	~FlatHashMap();
+
+	HM_t &operator=(const HM_t &map) {
+		if (this == &map)
+			return *this;
+
+		// Remove the previous content and ...
+		delete[] _storage;
+		delete[] _dist;
+		// ... copy the new stuff.
+		assign(map);
+		return *this;
+	}
+
+	bool contains(const Key &key) const;
+
+	Val &operator[](const Key &key);
+	const Val &operator[](const Key &key) const;
+
+	Val &getVal(const Key &key);
+	const Val &getVal(const Key &key) const;
+	const Val &getVal(const Key &key, const Val &defaultVal) const;
+	void setVal(const Key &key, const Val &val);
+
+	void clear(bool shrinkArray = 0);
+
+	void erase(iterator entry);
+	void erase(const Key &key);
+
+	uint size() const { return _size; }
+
+	iterator	begin() {
+		// Find and return the first non-empty entry
+		for (uint ctr = 0; ctr <= _mask; ++ctr) {
+			if (_dist[ctr])
+				return iterator(ctr, this);
+		}
+		return end();
+	}
+	iterator	end() {
+		return iterator((uint)-1, this);
+	}
+
+	const_iterator	begin() const {
+		// Find and return the first non-empty entry
+		for (uint ctr = 0; ctr <= _mask; ++ctr) {
+			if (_dist[ctr])
+				return const_iterator(ctr, this);
+		}
+		return end();
+	}
+	const_iterator	end() const {
+		return const_iterator((uint)-1, this);
+	}
+
+	iterator	find(const Key &key) {
+		int ctr = lookup(key);
+		if (ctr >= 0)
+			return iterator(ctr, this);
+		return end();
+	}
+
+	const_iterator	find(const Key &key) const {
+		int ctr = lookup(key);
+		if (ctr >= 0)
+			return const_iterator(ctr, this);
+		return end();
+	}
+
+	bool empty() const {
+		return (_size == 0);
+	}
+};
+
+//-------------------------------------------------------
+// FlatHashMap functions
+
+/**
+ * Base constructor, creates an empty hashmap.
+ */
+template<class Key, class Val, class HashFunc, class EqualFunc>
+FlatHashMap<Key, Val, HashFunc, EqualFunc>::FlatHashMap()
+//
+// We have to skip _defaultVal() on PS2 to avoid gcc 3.2.2 ICE
+//
+#ifdef __PLAYSTATION2__
+	{
+#else
+	: _defaultVal() {
+#endif
+	allocStorage(FLATHASHMAP_MIN_CAPACITY);
+	_size = 0;
+}
+
+/**
+ * Copy constructor, creates a full copy of the given hashmap.
+ * We must provide a custom copy constructor as we use pointers
+ * to heap buffers for the internal storage.
+ */
+template<class Key, class Val, class HashFunc, class EqualFunc>
+FlatHashMap<Key, Val, HashFunc, EqualFunc>::FlatHashMap(const HM_t &map) :
+	_defaultVal() {
+	assign(map);
+}
+
+/**
+ * Destructor, frees all used memory.
+ */
+template<class Key, class Val, class HashFunc, class EqualFunc>
+FlatHashMap<Key, Val, HashFunc, EqualFunc>::~FlatHashMap() {
+	delete[] _storage;
+	delete[] _dist;
+}
+
+/**
+ * Internal method for allocating empty storage of the given capacity,
+ * which has to be a power of two.
+ *
+ * @note We do *not* deallocate the previous storage here -- the caller is
+ *       responsible for doing that!
+ */
+template<class Key, class Val, class HashFunc, class EqualFunc>
+void FlatHashMap<Key, Val, HashFunc, EqualFunc>::allocStorage(uint capacity) {
+	assert(capacity >= FLATHASHMAP_MIN_CAPACITY && (capacity & (capacity - 1)) == 0);
+
+	_mask = capacity - 1;
+	_shift = 32;
+	for (uint c = capacity; c > 1; c >>= 1)
+		_shift--;
+
+	_storage = new Node[capacity];
+	assert(_storage != NULL);
+	_dist = new uint16[capacity];
+	assert(_dist != NULL);
+	memset(_dist, 0, capacity * sizeof(uint16));
+}
+
+/**
+ * Internal method for assigning the content of another FlatHashMap
+ * to this one.
+ *
+ * @note We do *not* deallocate the previous storage here -- the caller is
+ *       responsible for doing that!
+ */
+template<class Key, class Val, class HashFunc, class EqualFunc>
+void FlatHashMap<Key, Val, HashFunc, EqualFunc>::assign(const HM_t &map) {
+	allocStorage(map._mask + 1);
+
+	// Simply clone the map given to us, slot by slot.
+	for (uint ctr = 0; ctr <= _mask; ++ctr) {
+		if (map._dist[ctr])
+			_storage[ctr] = map._storage[ctr];
+	}
+	memcpy(_dist, map._dist, (_mask + 1) * sizeof(uint16));
+	_size = map._size;
+}
+
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+void FlatHashMap<Key, Val, HashFunc, EqualFunc>::clear(bool shrinkArray) {
+	if (shrinkArray && _mask >= FLATHASHMAP_MIN_CAPACITY) {
+		delete[] _storage;
+		delete[] _dist;
+		allocStorage(FLATHASHMAP_MIN_CAPACITY);
+	} else {
+		// Reset the used nodes, so that they release their resources
+		for (uint ctr = 0; ctr <= _mask; ++ctr) {
+			if (_dist[ctr]) {
+				_storage[ctr] = Node();
+				_dist[ctr] = 0;
+			}
+		}
+	}
+
+	_size = 0;
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+void FlatHashMap<Key, Val, HashFunc, EqualFunc>::expandStorage(uint newCapacity) {
+	assert(newCapacity > _mask+1);
+
+#ifndef NDEBUG
+	const uint old_size = _size;
+#endif
+	const uint old_mask = _mask;
+	Node *old_storage = _storage;
+	uint16 *old_dist = _dist;
+
+	// allocate a new array
+	allocStorage(newCapacity);
+	_size = 0;
+
+	// rehash all the old elements
+	for (uint ctr = 0; ctr <= old_mask; ++ctr) {
+		if (old_dist[ctr] == 0)
+			continue;
+
+		// Since we know that no key exists twice in the old table, we
+		// don't have to look for it before inserting it.
+		const int idx = insertNode(old_storage[ctr]._key);
+		assert(idx >= 0);
+		_storage[idx]._value = old_storage[ctr]._value;
+	}
+
+	// Perform a sanity check: Old number of elements should match the new one!
+	// This check will fail if some previous operation corrupted this hashmap.
+	assert(_size == old_size);
+
+	delete[] old_storage;
+	delete[] old_dist;
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+int FlatHashMap<Key, Val, HashFunc, EqualFunc>::lookup(const Key &key) const {
+	uint ctr = homeSlot(key);
+
+	// Since elements further away from their home slot are never placed
+	// in front of elements closer to theirs, we can stop searching as soon
+	// as we meet an element closer to its home slot than the key would be.
+	for (uint dist = 1; _dist[ctr] >= dist; ++dist) {
+		if (_dist[ctr] == dist && _equal(_storage[ctr]._key, key))
+			return ctr;
+		ctr = (ctr + 1) & _mask;
+	}
+
+	return -1;
+}
+
+/**
+ * Internal method for inserting a key, which must not be contained in the
+ * map yet, with a default constructed value.
+ *
+ * @return the slot the key was put in
+ */
+template<class Key, class Val, class HashFunc, class EqualFunc>
+int FlatHashMap<Key, Val, HashFunc, EqualFunc>::insertNode(const Key &key) {
+	Node node(key);
+	uint ctr = homeSlot(key);
+	uint dist = 1;
+	int result = -1;
+
+	while (_dist[ctr] != 0) {
+		if (_dist[ctr] < dist) {
+			// The element in this slot is closer to its home slot than the
+			// element we are inserting: take its place, and continue with
+			// finding a new place for the displaced element.
+			SWAP(node, _storage[ctr]);
+			const uint16 tmp = _dist[ctr];
+			_dist[ctr] = dist;
+			dist = tmp;
+
+			if (result == -1)
+				result = ctr;
+		}
+
+		ctr = (ctr + 1) & _mask;
+		dist++;
+		assert(dist < FLATHASHMAP_MAX_DISTANCE);
+	}
+
+	_storage[ctr] = node;
+	_dist[ctr] = dist;
+	_size++;
+
+	if (result == -1)
+		result = ctr;
+	return result;
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+int FlatHashMap<Key, Val, HashFunc, EqualFunc>::lookupAndCreateIfMissing(const Key &key) {
+	int ctr = lookup(key);
+	if (ctr >= 0)
+		return ctr;
+
+	// Keep the load factor below a certain threshold.
+	uint capacity = _mask + 1;
+	if ((_size + 1) * FLATHASHMAP_LOADFACTOR_DENOMINATOR >
+	        capacity * FLATHASHMAP_LOADFACTOR_NUMERATOR) {
+		capacity = capacity < 500 ? (capacity * 4) : (capacity * 2);
+		expandStorage(capacity);
+	}
+
+	return insertNode(key);
+}
+
+/**
+ * Internal method for erasing the element in the given slot. All following
+ * elements of the same probe sequence are moved back by one slot.
+ */
+template<class Key, class Val, class HashFunc, class EqualFunc>
+void FlatHashMap<Key, Val, HashFunc, EqualFunc>::eraseSlot(uint idx) {
+	assert(idx <= _mask);
+	assert(_dist[idx] != 0);
+
+	uint next = (idx + 1) & _mask;
+	while (_dist[next] > 1) {
+		_storage[idx] = _storage[next];
+		_dist[idx] = _dist[next] - 1;
+		idx = next;
+		next = (next + 1) & _mask;
+	}
+
+	// Reset the node, so that it releases its resources
+	_storage[idx] = Node();
+	_dist[idx] = 0;
+	_size--;
+}
+
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+bool FlatHashMap<Key, Val, HashFunc, EqualFunc>::contains(const Key &key) const {
+	return lookup(key) >= 0;
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+Val &FlatHashMap<Key, Val, HashFunc, EqualFunc>::operator[](const Key &key) {
+	return getVal(key);
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+const Val &FlatHashMap<Key, Val, HashFunc, EqualFunc>::operator[](const Key &key) const {
+	return getVal(key);
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+Val &FlatHashMap<Key, Val, HashFunc, EqualFunc>::getVal(const Key &key) {
+	// The lookup may reallocate the storage, so it has to be done before
+	// _storage is read
+	const int ctr = lookupAndCreateIfMissing(key);
+	return _storage[ctr]._value;
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+const Val &FlatHashMap<Key, Val, HashFunc, EqualFunc>::getVal(const Key &key) const {
+	return getVal(key, _defaultVal);
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+const Val &FlatHashMap<Key, Val, HashFunc, EqualFunc>::getVal(const Key &key, const Val &defaultVal) const {
+	int ctr = lookup(key);
+	if (ctr >= 0)
+		return _storage[ctr]._value;
+	else
+		return defaultVal;
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+void FlatHashMap<Key, Val, HashFunc, EqualFunc>::setVal(const Key &key, const Val &val) {
+	const int ctr = lookupAndCreateIfMissing(key);
+	_storage[ctr]._value = val;
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+void FlatHashMap<Key, Val, HashFunc, EqualFunc>::erase(iterator entry) {
+	// Check whether we have a valid iterator
+	assert(entry._hashmap == this);
+	eraseSlot(entry._idx);
+}
+
+template<class Key, class Val, class HashFunc, class EqualFunc>
+void FlatHashMap<Key, Val, HashFunc, EqualFunc>::erase(const Key &key) {
+	int ctr = lookup(key);
+	if (ctr >= 0)
+		eraseSlot(ctr);
+}
+
+}	// End of namespace Common
+
+#endif
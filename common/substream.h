@@ -86,6 +86,25 @@ public:
 	virtual bool seek(int32 offset, int whence = SEEK_SET);
 };
 
+/**
+ * A SeekableSubReadStream which repositions the parent stream before every
+ * read. This removes the exclusivity demand of SeekableSubReadStream, at
+ * the cost of a seek() on the parent stream for every read().
+ *
+ * Several SafeSeekableSubReadStreams on the same parent stream can thus be
+ * used at the same time without stepping on each others toes. They do,
+ * however, reposition the parent stream, so do not depend on its position
+ * after reading from one of them.
+ */
+class SafeSeekableSubReadStream : public SeekableSubReadStream {
+public:
+	SafeSeekableSubReadStream(SeekableReadStream *parentStream, uint32 begin, uint32 end, DisposeAfterUse::Flag disposeParentStream = DisposeAfterUse::NO)
+		: SeekableSubReadStream(parentStream, begin, end, disposeParentStream) {
+	}
+
+	virtual uint32 read(void *dataPtr, uint32 dataSize);
+};
+
 /**
  * This is a SeekableSubReadStream subclass which adds non-endian
  * read methods whose endianness is set on the stream creation.
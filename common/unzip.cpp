@@ -107,6 +107,10 @@ typedef struct {
 #include "common/unzip.h"
 #include "common/file.h"
 #include "common/memstream.h"
+#include "common/mutex.h"
+#include "common/ptr.h"
+#include "common/substream.h"
+#include "common/zlib.h"
 
 #include "common/hashmap.h"
 #include "common/hash-str.h"
@@ -274,6 +278,13 @@ int unzOpenCurrentFile(unzFile file);
   If there is no error, the return value is UNZ_OK.
 */
 
+int unzGetCurrentFileDataPos(unzFile file, uLong *pos);
+/*
+  Get the position of the (possibly compressed) data of the current file
+  in the zipfile, so it can be read without unzOpenCurrentFile.
+  If there is no error, the return value is UNZ_OK.
+*/
+
 int unzCloseCurrentFile(unzFile file);
 /*
   Close the file in zip opened with unzOpenCurrentFile
@@ -633,6 +644,8 @@ unzFile unzOpen(Common::SeekableReadStream *stream) {
   Close a ZipFile opened with unzipOpen.
   If there is files inside the .Zip opened with unzipOpenCurrentFile (see later),
     these files MUST be closed with unzipCloseCurrentFile before call unzipClose.
+  Note that the stream passed to unzOpen is not deleted, since member
+    streams may still be reading from it.
   return UNZ_OK if there is no problem. */
 int unzClose(unzFile file) {
 	unz_s *s;
@@ -643,7 +656,6 @@ int unzClose(unzFile file) {
 	if (s->pfile_in_zip_read != NULL)
 		unzCloseCurrentFile(file);
 
-	delete s->_stream;
 	delete s;
 	return UNZ_OK;
 }
@@ -1033,6 +1045,32 @@ static int unzlocal_CheckCurrentFileCoherencyHeader(unz_s* s, uInt* piSizeVar,
 	return err;
 }
 
+/*
+  Get the position of the (possibly compressed) data of the current file
+  in the zipfile.
+  If there is no error, the return value is UNZ_OK.
+*/
+int unzGetCurrentFileDataPos(unzFile file, uLong *pos) {
+	uInt iSizeVar;
+	unz_s* s;
+	uLong offset_local_extrafield;  /* offset of the local extra field */
+	uInt  size_local_extrafield;    /* size of the local extra field */
+
+	if (file==NULL || pos==NULL)
+		return UNZ_PARAMERROR;
+	s=(unz_s*)file;
+	if (!s->current_file_ok)
+		return UNZ_PARAMERROR;
+
+	if (unzlocal_CheckCurrentFileCoherencyHeader(s,&iSizeVar,
+				&offset_local_extrafield,&size_local_extrafield)!=UNZ_OK)
+		return UNZ_BADZIPFILE;
+
+	*pos = s->cur_file_info_internal.offset_curfile + SIZEZIPLOCALHEADER +
+		iSizeVar + s->byte_before_the_zipfile;
+	return UNZ_OK;
+}
+
 /*
   Open for reading data the current file in the zipfile.
   If there is no error and the file is opened, the return value is UNZ_OK.
@@ -1419,11 +1457,61 @@ int unzGetGlobalComment(unzFile file, char *szComment, uLong uSizeBuf) {
 namespace Common {
 
 
+/**
+ * The stream containing a ZIP archive. It is shared by the archive and all
+ * member streams created from it, since those may outlive the archive.
+ * Member streams may also be read from other threads (e.g. sounds played by
+ * the mixer), hence every access to the stream has to hold the mutex.
+ */
+struct ZipArchiveStream {
+	SeekableReadStream *stream;
+	Mutex mutex;
+
+	ZipArchiveStream(SeekableReadStream *s) : stream(s) {}
+	~ZipArchiveStream() { delete stream; }
+};
+
+typedef SharedPtr<ZipArchiveStream> ZipArchiveStreamPtr;
+
+/**
+ * A stream for (part of) the data of a ZIP archive member. Reads directly
+ * from the archive stream, independently of other member streams.
+ */
+class ZipMemberStream : public SafeSeekableSubReadStream {
+	ZipArchiveStreamPtr _archiveStream;
+
+public:
+	ZipMemberStream(ZipArchiveStreamPtr archiveStream, uint32 begin, uint32 end)
+		: SafeSeekableSubReadStream(archiveStream->stream, begin, end),
+		  _archiveStream(archiveStream) {
+	}
+
+	virtual uint32 read(void *dataPtr, uint32 dataSize) {
+		StackLock lock(_archiveStream->mutex);
+		return SafeSeekableSubReadStream::read(dataPtr, dataSize);
+	}
+
+	virtual bool seek(int32 offset, int whence = SEEK_SET) {
+		StackLock lock(_archiveStream->mutex);
+		return SafeSeekableSubReadStream::seek(offset, whence);
+	}
+};
+
 class ZipArchive : public Archive {
 	unzFile _zipFile;
+	ZipArchiveStreamPtr _archiveStream;
+
+	enum {
+		/**
+		 * Compressed members up to this size are decompressed into memory
+		 * right away, since the state needed for decompressing them on the
+		 * fly would take up about as much memory.
+		 */
+		kMaxInMemoryMemberSize = 64 * 1024
+	};
 
 public:
-	ZipArchive(unzFile zipFile);
+	ZipArchive(unzFile zipFile, SeekableReadStream *stream);
 
 
 	~ZipArchive();
@@ -1452,19 +1540,24 @@ public:
 };
 */
 
-ZipArchive::ZipArchive(unzFile zipFile) : _zipFile(zipFile) {
+ZipArchive::ZipArchive(unzFile zipFile, SeekableReadStream *stream)
+	: _zipFile(zipFile), _archiveStream(new ZipArchiveStream(stream)) {
 	assert(_zipFile);
 }
 
 ZipArchive::~ZipArchive() {
+	StackLock lock(_archiveStream->mutex);
 	unzClose(_zipFile);
 }
 
 bool ZipArchive::hasFile(const Common::String &name) {
+	StackLock lock(_archiveStream->mutex);
 	return (unzLocateFile(_zipFile, name.c_str(), 2) == UNZ_OK);
 }
 
 int ZipArchive::listMembers(Common::ArchiveMemberList &list) {
+	StackLock lock(_archiveStream->mutex);
+
 	int matches = 0;
 	int err = unzGoToFirstFile(_zipFile);
 
@@ -1489,22 +1582,53 @@ ArchiveMemberPtr ZipArchive::getMember(const String &name) {
 }
 
 Common::SeekableReadStream *ZipArchive::createReadStreamForMember(const Common::String &name) const {
-	if (unzLocateFile(_zipFile, name.c_str(), 2) != UNZ_OK)
-		return 0;
-
 	unz_file_info fileInfo;
-	unzOpenCurrentFile(_zipFile);
-	unzGetCurrentFileInfo(_zipFile, &fileInfo, NULL, 0, NULL, 0, NULL, 0);
-	byte *buffer = (byte *)malloc(fileInfo.uncompressed_size);
-	assert(buffer);
-	unzReadCurrentFile(_zipFile, buffer, fileInfo.uncompressed_size);
-	unzCloseCurrentFile(_zipFile);
-	return new Common::MemoryReadStream(buffer, fileInfo.uncompressed_size, DisposeAfterUse::YES);
-
-	// FIXME: instead of reading all into a memory stream, we could
-	// instead create a new ZipStream class. But then we have to be
-	// careful to handle the case where the client code opens multiple
-	// files in the archive and tries to use them indepenendtly.
+	SeekableReadStream *compressedStream = 0;
+
+	{
+		StackLock lock(_archiveStream->mutex);
+
+		if (unzLocateFile(_zipFile, name.c_str(), 2) != UNZ_OK)
+			return 0;
+
+		unzGetCurrentFileInfo(_zipFile, &fileInfo, NULL, 0, NULL, 0, NULL, 0);
+
+		// Stored members are read straight from the archive, and bigger
+		// compressed members are decompressed on the fly. Either way, the
+		// member streams read from the archive stream independently of each
+		// other, so several members can be used at the same time.
+		uLong dataPos;
+		if (fileInfo.compression_method == 0) {
+			if (unzGetCurrentFileDataPos(_zipFile, &dataPos) != UNZ_OK)
+				return 0;
+			return new ZipMemberStream(_archiveStream, dataPos, dataPos + fileInfo.uncompressed_size);
+		}
+
+#ifdef USE_ZLIB
+		if (fileInfo.uncompressed_size > kMaxInMemoryMemberSize) {
+			if (unzGetCurrentFileDataPos(_zipFile, &dataPos) != UNZ_OK)
+				return 0;
+			compressedStream = new ZipMemberStream(_archiveStream, dataPos, dataPos + fileInfo.compressed_size);
+		}
+#endif
+
+		if (!compressedStream) {
+			unzOpenCurrentFile(_zipFile);
+			byte *buffer = (byte *)malloc(fileInfo.uncompressed_size);
+			assert(buffer);
+			unzReadCurrentFile(_zipFile, buffer, fileInfo.uncompressed_size);
+			unzCloseCurrentFile(_zipFile);
+			return new Common::MemoryReadStream(buffer, fileInfo.uncompressed_size, DisposeAfterUse::YES);
+		}
+	}
+
+#ifdef USE_ZLIB
+	// The member stream does its own locking, so this has to be done after
+	// releasing the archive lock.
+	return wrapDeflateReadStream(compressedStream, fileInfo.uncompressed_size);
+#else
+	return 0;
+#endif
 }
 
 Archive *makeZipArchive(const String &name) {
@@ -1524,7 +1648,7 @@ Archive *makeZipArchive(SeekableReadStream *stream) {
 		// goes wrong.
 		return 0;
 	}
-	return new ZipArchive(zipFile);
+	return new ZipArchive(zipFile, stream);
 }
 
 }	// End of namespace Common
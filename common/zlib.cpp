@@ -24,6 +24,9 @@
  */
 
 #include "common/zlib.h"
+#include "common/array.h"
+#include "common/debug.h"
+#include "common/memstream.h"
 #include "common/util.h"
 #include "common/stream.h"
 
@@ -51,12 +54,37 @@ bool uncompress(byte *dst, unsigned long *dstLen, const byte *src, unsigned long
 /**
  * A simple wrapper class which can be used to wrap around an arbitrary
  * other SeekableReadStream and will then provide on-the-fly decompression support.
- * Assumes the compressed data to be in gzip format.
+ * Assumes the compressed data to be in gzip format, or to be a raw deflate
+ * stream (as used in ZIP archives) if the uncompressed size is passed in.
+ *
+ * While decompressing, the stream builds an index of decompressor states
+ * (in the spirit of zlib's zran.c example), one every _checkpointInterval
+ * bytes. Seeks then only need to decompress data from the closest
+ * checkpoint on, instead of restarting at the beginning of the stream.
+ * Every checkpoint costs about as much memory as the zlib window (32 KB).
+ * Once the index exceeds MAX_CHECKPOINT_MEMORY, every other checkpoint is
+ * dropped and the interval is doubled, so the index still covers the whole
+ * stream.
  */
 class GZipReadStream : public Common::SeekableReadStream {
 protected:
 	enum {
-		BUFSIZE = 16384		// 1 << MAX_WBITS
+		BUFSIZE = 16384,		// 1 << MAX_WBITS
+		CHECKPOINT_SIZE = (1 << MAX_WBITS) + 8192,	// window plus inflate state
+		MAX_CHECKPOINT_MEMORY = 1024 * 1024
+	};
+
+	/**
+	 * A saved decompressor state. The z_stream has to stay at a fixed
+	 * address, since zlib keeps a pointer back to it in its internal state.
+	 */
+	struct Checkpoint {
+		uint32 outPos;		///< position in the uncompressed data
+		uint32 inPos;		///< position in the wrapped stream
+		z_stream *state;
+
+		uint32 hits;		///< number of seeks which resumed from here
+		uint32 bytesSaved;	///< uncompressed bytes not decompressed again thanks to this checkpoint
 	};
 
 	byte	_buf[BUFSIZE];
@@ -66,41 +94,133 @@ protected:
 	int _zlibErr;
 	uint32 _pos;
 	uint32 _origSize;
+	bool _knownSize;
 	bool _eos;
 
+	Common::Array<Checkpoint> _checkpoints;
+	uint32 _checkpointInterval;
+	uint32 _nextCheckpoint;
+
+	/** Number of seeks which had to restart decompression from the start */
+	uint32 _restarts;
+
+	void addCheckpoint() {
+		if ((_checkpoints.size() + 1) * CHECKPOINT_SIZE > MAX_CHECKPOINT_MEMORY)
+			thinCheckpoints();
+
+		Checkpoint cp;
+		cp.outPos = _pos;
+		cp.inPos = _wrapped->pos() - _stream.avail_in;
+		cp.hits = 0;
+		cp.bytesSaved = 0;
+		cp.state = new z_stream;
+		if (inflateCopy(cp.state, &_stream) != Z_OK) {
+			delete cp.state;
+			return;
+		}
+		_checkpoints.push_back(cp);
+		_nextCheckpoint = _pos + _checkpointInterval;
+	}
+
+	void freeCheckpoint(Checkpoint &cp) {
+		inflateEnd(cp.state);
+		delete cp.state;
+		cp.state = 0;
+	}
+
+	/**
+	 * Drop every other checkpoint and double the checkpoint interval, to
+	 * make room for new checkpoints further into the stream.
+	 */
+	void thinCheckpoints() {
+		uint kept = 0;
+		for (uint i = 0; i < _checkpoints.size(); ++i) {
+			if (i & 1)
+				freeCheckpoint(_checkpoints[i]);
+			else
+				_checkpoints[kept++] = _checkpoints[i];
+		}
+		_checkpoints.resize(kept);
+		_checkpointInterval *= 2;
+	}
+
+	bool restoreCheckpoint(Checkpoint &cp, uint32 newPos) {
+		inflateEnd(&_stream);
+		_zlibErr = inflateCopy(&_stream, cp.state);
+		if (_zlibErr != Z_OK)
+			return false;
+
+		// Count what this saved us compared to the alternative, i.e.
+		// restarting from the beginning or skipping ahead from here.
+		cp.hits++;
+		cp.bytesSaved += (newPos < _pos ? cp.outPos : cp.outPos - _pos);
+
+		_pos = cp.outPos;
+		_wrapped->seek(cp.inPos, SEEK_SET);
+		_stream.next_in = _buf;
+		_stream.avail_in = 0;
+		return true;
+	}
+
+	bool restart() {
+		_restarts++;
+		_pos = 0;
+		_wrapped->seek(0, SEEK_SET);
+		_zlibErr = inflateReset(&_stream);
+		if (_zlibErr != Z_OK)
+			return false;
+		_stream.next_in = _buf;
+		_stream.avail_in = 0;
+		return true;
+	}
+
 public:
 
-	GZipReadStream(Common::SeekableReadStream *w) : _wrapped(w) {
+	GZipReadStream(Common::SeekableReadStream *w, uint32 knownSize = 0, uint32 checkpointInterval = 0)
+		: _wrapped(w), _checkpointInterval(checkpointInterval), _restarts(0) {
 		assert(w != 0);
 
 		_stream.zalloc = Z_NULL;
 		_stream.zfree = Z_NULL;
 		_stream.opaque = Z_NULL;
 
-		// Verify file header is correct
-		w->seek(0, SEEK_SET);
-		uint16 header = w->readUint16BE();
-		assert(header == 0x1F8B ||
-		       ((header & 0x0F00) == 0x0800 && header % 31 == 0));
-
-		if (header == 0x1F8B) {
-			// Retrieve the original file size
-			w->seek(-4, SEEK_END);
-			_origSize = w->readUint32LE();
+		_knownSize = (knownSize != 0);
+		if (_knownSize) {
+			// Raw deflate data, without any header
+			_origSize = knownSize;
 		} else {
-			// Original size not available in zlib format
-			_origSize = 0;
+			// Verify file header is correct
+			w->seek(0, SEEK_SET);
+			uint16 header = w->readUint16BE();
+			assert(header == 0x1F8B ||
+			       ((header & 0x0F00) == 0x0800 && header % 31 == 0));
+
+			if (header == 0x1F8B) {
+				// Retrieve the original file size
+				w->seek(-4, SEEK_END);
+				_origSize = w->readUint32LE();
+			} else {
+				// Original size not available in zlib format
+				_origSize = 0;
+			}
 		}
 		_pos = 0;
 		w->seek(0, SEEK_SET);
 		_eos = false;
+		_nextCheckpoint = _checkpointInterval;
 
-		// Adding 32 to windowBits indicates to zlib that it is supposed to
-		// automatically detect whether gzip or zlib headers are used for
-		// the compressed file. This feature was added in zlib 1.2.0.4,
-		// released 10 August 2003.
-		// Note: This is *crucial* for savegame compatibility, do *not* remove!
-		_zlibErr = inflateInit2(&_stream, MAX_WBITS + 32);
+		if (_knownSize) {
+			// A negative windowBits value tells zlib that there is no
+			// header at all.
+			_zlibErr = inflateInit2(&_stream, -MAX_WBITS);
+		} else {
+			// Adding 32 to windowBits indicates to zlib that it is supposed to
+			// automatically detect whether gzip or zlib headers are used for
+			// the compressed file. This feature was added in zlib 1.2.0.4,
+			// released 10 August 2003.
+			// Note: This is *crucial* for savegame compatibility, do *not* remove!
+			_zlibErr = inflateInit2(&_stream, MAX_WBITS + 32);
+		}
 		if (_zlibErr != Z_OK)
 			return;
 
@@ -110,6 +230,16 @@ public:
 	}
 
 	~GZipReadStream() {
+		if (_restarts || !_checkpoints.empty()) {
+			debug(3, "GZipReadStream: %d checkpoints every %d bytes, %d restarts from the beginning",
+			      _checkpoints.size(), _checkpointInterval, _restarts);
+		}
+
+		for (uint i = 0; i < _checkpoints.size(); ++i) {
+			debug(4, "GZipReadStream: checkpoint at %d: %d seeks, saved decompressing %d bytes",
+			      _checkpoints[i].outPos, _checkpoints[i].hits, _checkpoints[i].bytesSaved);
+			freeCheckpoint(_checkpoints[i]);
+		}
 		inflateEnd(&_stream);
 		delete _wrapped;
 	}
@@ -121,6 +251,13 @@ public:
 	}
 
 	uint32 read(void *dataPtr, uint32 dataSize) {
+		// Raw deflate data is not terminated by a trailer, so do not try to
+		// read beyond the known size
+		if (_knownSize && dataSize > _origSize - _pos) {
+			dataSize = _origSize - _pos;
+			_eos = true;
+		}
+
 		_stream.next_out = (byte *)dataPtr;
 		_stream.avail_out = dataSize;
 
@@ -140,6 +277,9 @@ public:
 		if (_zlibErr == Z_STREAM_END && _stream.avail_out > 0)
 			_eos = true;
 
+		if (_checkpointInterval && _zlibErr == Z_OK && _pos >= _nextCheckpoint)
+			addCheckpoint();
+
 		return dataSize - _stream.avail_out;
 	}
 
@@ -154,40 +294,49 @@ public:
 	}
 	bool seek(int32 offset, int whence = SEEK_SET) {
 		int32 newPos = 0;
-		assert(whence != SEEK_END);	// SEEK_END not supported
+		assert(whence != SEEK_END || _origSize);	// SEEK_END requires a known size
 		switch (whence) {
 		case SEEK_SET:
 			newPos = offset;
 			break;
 		case SEEK_CUR:
 			newPos = _pos + offset;
+			break;
+		case SEEK_END:
+			newPos = _origSize + offset;
 		}
 
 		assert(newPos >= 0);
 
-		if ((uint32)newPos < _pos) {
+		// Find the closest checkpoint in front of the new position
+		int checkpoint = -1;
+		for (uint i = 0; i < _checkpoints.size() && _checkpoints[i].outPos <= (uint32)newPos; ++i)
+			checkpoint = i;
+
+		if (checkpoint != -1 && ((uint32)newPos < _pos || _checkpoints[checkpoint].outPos > _pos)) {
+			// Resume decompression from the checkpoint, which saves us from
+			// decompressing everything in front of it.
+			if (!restoreCheckpoint(_checkpoints[checkpoint], newPos))
+				return false;	// FIXME: STREAM REWRITE
+		} else if ((uint32)newPos < _pos) {
 			// To search backward, we have to restart the whole decompression
 			// from the start of the file. A rather wasteful operation, best
 			// to avoid it. :/
 #if DEBUG
 			warning("Backward seeking in GZipReadStream detected");
 #endif
-			_pos = 0;
-			_wrapped->seek(0, SEEK_SET);
-			_zlibErr = inflateReset(&_stream);
-			if (_zlibErr != Z_OK)
+			if (!restart())
 				return false;	// FIXME: STREAM REWRITE
-			_stream.next_in = _buf;
-			_stream.avail_in = 0;
 		}
 
 		offset = newPos - _pos;
+		_eos = false;
 
 		// Skip the given amount of data (very inefficient if one tries to skip
 		// huge amounts of data, but usually client code will only skip a few
 		// bytes, so this should be fine.
 		byte tmpBuf[1024];
-		while (!err() && offset > 0) {
+		while (!err() && !_eos && offset > 0) {
 			offset -= read(tmpBuf, MIN((int32)sizeof(tmpBuf), offset));
 		}
 
@@ -308,7 +457,7 @@ public:
 
 #endif	// USE_ZLIB
 
-Common::SeekableReadStream *wrapCompressedReadStream(Common::SeekableReadStream *toBeWrapped) {
+Common::SeekableReadStream *wrapCompressedReadStream(Common::SeekableReadStream *toBeWrapped, uint32 checkpointInterval) {
 #if defined(USE_ZLIB)
 	if (toBeWrapped) {
 		uint16 header = toBeWrapped->readUint16BE();
@@ -317,12 +466,27 @@ Common::SeekableReadStream *wrapCompressedReadStream(Common::SeekableReadStream
 				      header % 31 == 0));
 		toBeWrapped->seek(-2, SEEK_CUR);
 		if (isCompressed)
-			return new GZipReadStream(toBeWrapped);
+			return new GZipReadStream(toBeWrapped, 0, checkpointInterval);
 	}
 #endif
 	return toBeWrapped;
 }
 
+#if defined(USE_ZLIB)
+Common::SeekableReadStream *wrapDeflateReadStream(Common::SeekableReadStream *toBeWrapped, uint32 knownSize, uint32 checkpointInterval) {
+	if (!toBeWrapped)
+		return 0;
+
+	if (knownSize == 0) {
+		// Nothing to decompress
+		delete toBeWrapped;
+		return new Common::MemoryReadStream(0, 0);
+	}
+
+	return new GZipReadStream(toBeWrapped, knownSize, checkpointInterval);
+}
+#endif
+
 Common::WriteStream *wrapCompressedWriteStream(Common::WriteStream *toBeWrapped) {
 #if defined(USE_ZLIB)
 	if (toBeWrapped)
@@ -53,10 +53,44 @@ bool uncompress(byte *dst, unsigned long *dstLen, const byte *src, unsigned long
  * format. In the former case, the original stream is returned unmodified
  * (and in particular, not wrapped).
  *
+ * While decompressing, the stream records a checkpoint of the decompressor
+ * state every checkpointInterval bytes, so that seeks (in particular
+ * backward ones) can resume from there instead of decompressing everything
+ * again from the start. The memory used for checkpoints is bounded; if it
+ * runs out, the interval is increased.
+ *
+ * It is safe to call this with a NULL parameter (in this case, NULL is
+ * returned).
+ *
+ * @param toBeWrapped			the stream to be wrapped (if it is compressed)
+ * @param checkpointInterval	distance between checkpoints in the
+ *								uncompressed data, or 0 to disable them
+ */
+SeekableReadStream *wrapCompressedReadStream(SeekableReadStream *toBeWrapped, uint32 checkpointInterval = 256 * 1024);
+
+#if defined(USE_ZLIB)
+
+/**
+ * Take an arbitrary SeekableReadStream containing raw deflate compressed
+ * data (i.e. without any gzip or zlib header, as found in ZIP archives) and
+ * wrap it in a custom stream which provides transparent on-the-fly
+ * decompression. The data is only decompressed when it is read, and seeking
+ * resumes decompression from periodically saved checkpoints (see
+ * wrapCompressedReadStream).
+ *
+ * The wrapped stream is owned and deleted by the returned stream.
+ *
  * It is safe to call this with a NULL parameter (in this case, NULL is
  * returned).
+ *
+ * @param toBeWrapped			the stream containing the compressed data
+ * @param knownSize				the size of the uncompressed data
+ * @param checkpointInterval	distance between checkpoints in the
+ *								uncompressed data, or 0 to disable them
  */
-SeekableReadStream *wrapCompressedReadStream(SeekableReadStream *toBeWrapped);
+SeekableReadStream *wrapDeflateReadStream(SeekableReadStream *toBeWrapped, uint32 knownSize, uint32 checkpointInterval = 256 * 1024);
+
+#endif
 
 /**
  * Take an arbitrary WriteStream and wrap it in a custom stream which provides
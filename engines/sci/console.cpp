@@ -40,6 +40,7 @@
 #include "sci/sound/music.h"
 #include "sci/sound/drivers/mididriver.h"
 #include "sci/sound/drivers/map-mt32-to-gm.h"
+#include "sci/graphics/cache.h"
 #include "sci/graphics/cursor.h"
 #include "sci/graphics/screen.h"
 #include "sci/graphics/paint.h"
@@ -76,6 +77,7 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	// Variables
 	DVar_Register("sleeptime_factor",	&g_debug_sleeptime_factor, DVAR_INT, 0);
 	DVar_Register("gc_interval",		&engine->_gamestate->scriptGCInterval, DVAR_INT, 0);
+	DVar_Register("gc_step_size",		&engine->_gamestate->scriptGCStepSize, DVAR_INT, 0);
 	DVar_Register("simulated_key",		&g_debug_simulated_key, DVAR_INT, 0);
 	DVar_Register("track_mouse_clicks",	&g_debug_track_mouse_clicks, DVAR_BOOL, 0);
 	DVar_Register("script_abort_flag",	&_engine->_gamestate->abortScriptProcessing, DVAR_INT, 0);
@@ -104,6 +106,7 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	DCmd_Register("resource_id",		WRAP_METHOD(Console, cmdResourceId));
 	DCmd_Register("resource_info",		WRAP_METHOD(Console, cmdResourceInfo));
 	DCmd_Register("resource_types",		WRAP_METHOD(Console, cmdResourceTypes));
+	DCmd_Register("resource_cache",		WRAP_METHOD(Console, cmdResourceCache));
 	DCmd_Register("list",				WRAP_METHOD(Console, cmdList));
 	DCmd_Register("hexgrep",			WRAP_METHOD(Console, cmdHexgrep));
 	DCmd_Register("verify_scripts",		WRAP_METHOD(Console, cmdVerifyScripts));
@@ -122,6 +125,7 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	DCmd_Register("draw_cel",			WRAP_METHOD(Console, cmdDrawCel));
 	DCmd_Register("undither",           WRAP_METHOD(Console, cmdUndither));
 	DCmd_Register("pic_visualize",		WRAP_METHOD(Console, cmdPicVisualize));
+	DCmd_Register("gfx_cache",			WRAP_METHOD(Console, cmdGfxCache));
 	DCmd_Register("play_video",         WRAP_METHOD(Console, cmdPlayVideo));
 	// Segments
 	DCmd_Register("segment_table",		WRAP_METHOD(Console, cmdPrintSegmentTable));
@@ -191,6 +195,8 @@ Console::Console(SciEngine *engine) : GUI::Debugger(),
 	DCmd_Register("bpe",				WRAP_METHOD(Console, cmdBreakpointFunction));		// alias
 	// VM
 	DCmd_Register("script_steps",		WRAP_METHOD(Console, cmdScriptSteps));
+	DCmd_Register("selector_cache",		WRAP_METHOD(Console, cmdSelectorCache));
+	DCmd_Register("avoidpath_cache",	WRAP_METHOD(Console, cmdAvoidPathCache));
 	DCmd_Register("vm_varlist",			WRAP_METHOD(Console, cmdVMVarlist));
 	DCmd_Register("vmvarlist",			WRAP_METHOD(Console, cmdVMVarlist));				// alias
 	DCmd_Register("vl",					WRAP_METHOD(Console, cmdVMVarlist));				// alias
@@ -298,6 +304,7 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	DebugPrintf("---------\n");
 	DebugPrintf("sleeptime_factor: Factor to multiply with wait times in kWait()\n");
 	DebugPrintf("gc_interval: Number of kernel calls in between garbage collections\n");
+	DebugPrintf("gc_step_size: Amount of work per kernel call of an incremental garbage collection, 0 to collect at once\n");
 	DebugPrintf("simulated_key: Add a key with the specified scan code to the event list\n");
 	DebugPrintf("track_mouse_clicks: Toggles mouse click tracking to the console\n");
 	DebugPrintf("weak_validations: Turns some validation errors into warnings\n");
@@ -334,6 +341,7 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	DebugPrintf(" resource_id - Identifies a resource number by splitting it up in resource type and resource number\n");
 	DebugPrintf(" resource_info - Shows info about a resource\n");
 	DebugPrintf(" resource_types - Shows the valid resource types\n");
+	DebugPrintf(" resource_cache - Shows statistics of the resource cache, or changes its size and pinned types\n");
 	DebugPrintf(" list - Lists all the resources of a given type\n");
 	DebugPrintf(" hexgrep - Searches some resources for a particular sequence of bytes, represented as hexadecimal numbers\n");
 	DebugPrintf(" verify_scripts - Performs sanity checks on SCI1.1-SCI2.1 game scripts (e.g. if they're up to 64KB in total)\n");
@@ -354,6 +362,7 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	DebugPrintf(" draw_cel - Draws a cel from a view resource\n");
 	DebugPrintf(" pic_visualize - Enables visualization of the drawing process of EGA pictures\n");
 	DebugPrintf(" undither - Enable/disable undithering\n");
+	DebugPrintf(" gfx_cache - Shows statistics of the view and font cache, or changes its size\n");
 	DebugPrintf("\n");
 	DebugPrintf("Segments:\n");
 	DebugPrintf(" segment_table / segtable - Lists all segments\n");
@@ -407,6 +416,8 @@ bool Console::cmdHelp(int argc, const char **argv) {
 	DebugPrintf("\n");
 	DebugPrintf("VM:\n");
 	DebugPrintf(" script_steps - Shows the number of executed SCI operations\n");
+	DebugPrintf(" selector_cache - Shows or resets statistics of the selector lookup cache\n");
+	DebugPrintf(" avoidpath_cache - Shows or resets statistics of the visibility graph cache of kAvoidPath\n");
 	DebugPrintf(" vm_varlist / vmvarlist / vl - Shows the addresses of variables in the VM\n");
 	DebugPrintf(" vm_vars / vmvars / vv - Displays or changes variables in the VM\n");
 	DebugPrintf(" stack - Lists the specified number of stack elements\n");
@@ -771,6 +782,50 @@ bool Console::cmdResourceTypes(int argc, const char **argv) {
 	return true;
 }
 
+bool Console::cmdResourceCache(int argc, const char **argv) {
+	ResourceManager *resMan = _engine->getResMan();
+
+	if (argc == 2 && !scumm_stricmp(argv[1], "reset")) {
+		resMan->resetCacheStats();
+	} else if (argc == 3 && !scumm_stricmp(argv[1], "size")) {
+		resMan->setMaxMemory(atoi(argv[2]) * 1024);
+	} else if (argc == 3 && (!scumm_stricmp(argv[1], "pin") || !scumm_stricmp(argv[1], "unpin"))) {
+		ResourceType restype = parseResourceType(argv[2]);
+		if (restype == kResourceTypeInvalid) {
+			DebugPrintf("Resource type '%s' is not valid\n", argv[2]);
+			return true;
+		}
+		resMan->setResourceTypePinned(restype, !scumm_stricmp(argv[1], "pin"));
+	} else if (argc != 1) {
+		DebugPrintf("Shows statistics of the resource cache, or changes its size and pinned types.\n");
+		DebugPrintf("Usage: %s [reset | size <KB> | pin <resource type> | unpin <resource type>]\n", argv[0]);
+		DebugPrintf("reset: reset the statistics\n");
+		DebugPrintf("size: set the amount of memory used for resources which aren't locked\n");
+		DebugPrintf("pin / unpin: keep resources of the given type in memory as long as possible\n");
+		return true;
+	}
+
+	const ResourceManager::CacheStats &stats = resMan->getCacheStats();
+	const uint32 lookups = stats.hits + stats.misses;
+	DebugPrintf("Cache size: %d KB, %d KB used by %d resources, %d KB locked\n", resMan->getMaxMemory() / 1024,
+	            resMan->getLRUMemory() / 1024, resMan->getLRUSize(), resMan->getLockedMemory() / 1024);
+	DebugPrintf("%d lookups, %d hits, %d misses (%d%% hit rate), %d evictions\n", lookups, stats.hits, stats.misses,
+	            lookups ? (int)((stats.hits * 100.0) / lookups) : 0, stats.evictions);
+	DebugPrintf("%d KB loaded in %d ms\n", stats.bytesLoaded / 1024, stats.loadTime);
+
+	DebugPrintf("Pinned resource types:");
+	bool pinned = false;
+	for (int i = 0; i < kResourceTypeInvalid; i++) {
+		if (resMan->isResourceTypePinned((ResourceType)i)) {
+			DebugPrintf(" %s", getResourceTypeName((ResourceType)i));
+			pinned = true;
+		}
+	}
+	DebugPrintf(pinned ? "\n" : " none\n");
+
+	return true;
+}
+
 bool Console::cmdHexgrep(int argc, const char **argv) {
 	if (argc < 4) {
 		DebugPrintf("Searches some resources for a particular sequence of bytes, represented as decimal or hexadecimal numbers.\n");
@@ -1544,6 +1599,37 @@ bool Console::cmdPicVisualize(int argc, const char **argv) {
 	return true;
 }
 
+bool Console::cmdGfxCache(int argc, const char **argv) {
+	GfxCache *cache = _engine->_gfxCache;
+
+	if (argc == 2 && !scumm_stricmp(argv[1], "reset")) {
+		cache->resetStats();
+	} else if (argc == 3 && !scumm_stricmp(argv[1], "size")) {
+		cache->setMaxViewMemory(atoi(argv[2]) * 1024);
+	} else if (argc != 1) {
+		DebugPrintf("Shows statistics of the view and font cache, or changes its size.\n");
+		DebugPrintf("Usage: %s [reset | size <KB>]\n", argv[0]);
+		DebugPrintf("reset: reset the statistics\n");
+		DebugPrintf("size: set the amount of memory used for views and their unpacked cels\n");
+		return true;
+	}
+
+	const GfxCache::CacheStats &viewStats = cache->getViewStats();
+	const uint32 viewLookups = viewStats.hits + viewStats.misses;
+	DebugPrintf("View cache size: %d KB, %d KB used by %d views, %d of them pinned\n", cache->getMaxViewMemory() / 1024,
+	            cache->getViewMemory() / 1024, cache->getViewCount(), cache->getPinnedViewCount());
+	DebugPrintf("%d lookups, %d hits, %d misses (%d%% hit rate), %d evictions\n", viewLookups, viewStats.hits, viewStats.misses,
+	            viewLookups ? (int)((viewStats.hits * 100.0) / viewLookups) : 0, viewStats.evictions);
+
+	const GfxCache::CacheStats &fontStats = cache->getFontStats();
+	const uint32 fontLookups = fontStats.hits + fontStats.misses;
+	DebugPrintf("Font cache: %d of %d fonts\n", cache->getFontCount(), MAX_CACHED_FONTS);
+	DebugPrintf("%d lookups, %d hits, %d misses (%d%% hit rate), %d evictions\n", fontLookups, fontStats.hits, fontStats.misses,
+	            fontLookups ? (int)((fontStats.hits * 100.0) / fontLookups) : 0, fontStats.evictions);
+
+	return true;
+}
+
 bool Console::cmdPlayVideo(int argc, const char **argv) {
 	if (argc < 2) {
 		DebugPrintf("Plays a SEQ, AVI, VMD, RBT or DUK video.\n");
@@ -2436,6 +2522,107 @@ bool Console::cmdScriptSteps(int argc, const char **argv) {
 	return true;
 }
 
+struct CallsiteStatsEntry {
+	reg_t callsite;
+	SelectorLookupCache::CallsiteStats stats;
+};
+
+struct CallsiteStatsLess {
+	bool operator()(const CallsiteStatsEntry &a, const CallsiteStatsEntry &b) const {
+		// Sort by number of misses first, then by number of lookups
+		if (a.stats.misses != b.stats.misses)
+			return a.stats.misses > b.stats.misses;
+		return a.stats.hits > b.stats.hits;
+	}
+};
+
+bool Console::cmdSelectorCache(int argc, const char **argv) {
+	SelectorLookupCache &cache = _engine->_gamestate->_segMan->getSelectorLookupCache();
+
+	if (argc > 2) {
+		DebugPrintf("Shows or resets statistics of the selector lookup cache.\n");
+		DebugPrintf("Usage: %s [track|notrack|reset]\n", argv[0]);
+		DebugPrintf("track / notrack: enable/disable counting lookups per call site\n");
+		DebugPrintf("reset: reset all statistics\n");
+		return true;
+	}
+
+	if (argc == 2) {
+		if (!scumm_stricmp(argv[1], "track")) {
+			cache.setTrackCallsites(true);
+		} else if (!scumm_stricmp(argv[1], "notrack")) {
+			cache.setTrackCallsites(false);
+		} else if (!scumm_stricmp(argv[1], "reset")) {
+			cache.resetStats();
+		} else {
+			DebugPrintf("Unknown option: %s\n", argv[1]);
+			return true;
+		}
+	}
+
+	const uint32 lookups = cache.getHits() + cache.getMisses();
+	DebugPrintf("Selector lookup cache: %d entries, %d flushes\n", cache.getSize(), cache.getFlushes());
+	DebugPrintf("%d lookups, %d hits, %d misses (%d%% hit rate)\n", lookups, cache.getHits(), cache.getMisses(),
+	            lookups ? (int)((cache.getHits() * 100.0) / lookups) : 0);
+
+	if (!cache.getTrackCallsites()) {
+		DebugPrintf("Call site statistics are disabled, use \"%s track\" to enable them\n", argv[0]);
+		return true;
+	}
+
+	Common::Array<CallsiteStatsEntry> callsites;
+	const SelectorLookupCache::CallsiteStatsMap &map = cache.getCallsites();
+	for (SelectorLookupCache::CallsiteStatsMap::const_iterator it = map.begin(); it != map.end(); ++it) {
+		CallsiteStatsEntry entry;
+		entry.callsite = it->_key;
+		entry.stats = it->_value;
+		callsites.push_back(entry);
+	}
+
+	Common::sort(callsites.begin(), callsites.end(), CallsiteStatsLess());
+
+	// Only show the call sites with the most misses
+	const uint count = MIN<uint>(callsites.size(), 20);
+	DebugPrintf("%d call sites, top %d by misses (address after the send):\n", callsites.size(), count);
+	for (uint i = 0; i < count; i++) {
+		const reg_t pc = callsites[i].callsite;
+		const Script *scr = _engine->_gamestate->_segMan->getScriptIfLoaded(pc.segment);
+		DebugPrintf(" %04x:%04x (script %d): %d hits, %d misses\n", PRINT_REG(pc),
+		            scr ? scr->getScriptNumber() : -1, callsites[i].stats.hits, callsites[i].stats.misses);
+	}
+
+	return true;
+}
+
+bool Console::cmdAvoidPathCache(int argc, const char **argv) {
+	EngineState *s = _engine->_gamestate;
+
+	if (argc == 2 && !scumm_stricmp(argv[1], "reset")) {
+		resetAvoidPathCacheStats(s);
+	} else if (argc != 1) {
+		DebugPrintf("Shows or resets statistics of the visibility graph cache of kAvoidPath.\n");
+		DebugPrintf("Usage: %s [reset]\n", argv[0]);
+		DebugPrintf("reset: reset all statistics\n");
+		return true;
+	}
+
+	const AvoidPathCacheStats stats = getAvoidPathCacheStats(s);
+	const uint32 searches = stats.hits + stats.misses;
+	DebugPrintf("%d path searches, %d with a cached polygon set (%d%% hit rate), %d without the cache\n", searches, stats.hits,
+	            searches ? (int)((stats.hits * 100.0) / searches) : 0, stats.bypasses);
+
+	const uint32 rows = stats.rowsComputed + stats.rowsReused;
+	DebugPrintf("%d visibility rows, %d computed, %d reused (%d%% hit rate)\n", rows, stats.rowsComputed, stats.rowsReused,
+	            rows ? (int)((stats.rowsReused * 100.0) / rows) : 0);
+
+	// Reused rows would have taken as long to compute, per test, as the
+	// computed ones did
+	DebugPrintf("%d ms spent on %d visibility tests, about %d ms saved by skipping %d tests\n", stats.rowTime, stats.testsDone,
+	            stats.testsDone ? (int)(((double)stats.rowTime * stats.testsSaved) / stats.testsDone) : 0, stats.testsSaved);
+
+	return true;
+}
+
 bool Console::cmdBacktrace(int argc, const char **argv) {
 	DebugPrintf("Call stack (current base: 0x%x):\n", _engine->_gamestate->executionStackBase);
 	Common::List<ExecStack>::iterator iter;
@@ -25,6 +25,7 @@
 
 #include "sci/engine/gc.h"
 #include "common/array.h"
+#include "common/system.h"
 
 namespace Sci {
 
@@ -53,6 +54,48 @@ struct WorklistManager {
 	}
 };
 
+/**
+ * State of an incremental garbage collection. A cycle first traces the
+ * references from the root set a few at a time (marking). Since the VM keeps
+ * running in between, the root set and all objects which may have been
+ * modified in the meantime are traced again at once when the worklist runs
+ * empty (remarking). Objects are modified either directly by the VM, which
+ * only happens for script objects, locals and clones, or through the
+ * segment manager, whose write barrier records the entries it hands out.
+ * Afterwards, the unreachable entries are freed a few at a time (sweeping).
+ * Entries allocated or modified while sweeping are recorded by the write
+ * barrier as well, and are never freed.
+ */
+struct GCState {
+	enum Phase {
+		kPhaseMark,
+		kPhaseSweep
+	};
+
+	Phase phase;
+	WorklistManager wm;
+	AddrSet *activeRefs;	///< Normalized set of reachable references, while sweeping
+
+	SegmentId sweepSegment;	///< Segment being swept
+	Common::Array<reg_t> sweepList;	///< Deallocatable entries of that segment
+	uint sweepPos;	///< Next entry in sweepList to check
+
+	// Statistics
+	uint32 startTime;
+	uint32 pauseTime;	///< Sum of the time spent in all steps
+	uint32 maxPauseTime;	///< Maximum time spent in a single step
+	uint steps;
+	uint freedEntries;
+	uint freedBytes;
+
+	GCState() : phase(kPhaseMark), activeRefs(0), sweepSegment(1), sweepPos(0),
+		startTime(0), pauseTime(0), maxPauseTime(0), steps(0), freedEntries(0), freedBytes(0) {}
+
+	~GCState() {
+		delete activeRefs;
+	}
+};
+
 static AddrSet *normalizeAddresses(SegManager *segMan, const AddrSet &nonnormal_map) {
 	AddrSet *normal_map = new AddrSet();
 
@@ -69,14 +112,26 @@ static AddrSet *normalizeAddresses(SegManager *segMan, const AddrSet &nonnormal_
 	return normal_map;
 }
 
-static void processWorkList(SegManager *segMan, WorklistManager &wm, const Common::Array<SegmentObj *> &heap) {
+/**
+ * Traces the references on the worklist.
+ * @param maxItems		Maximum number of references to trace, 0 to empty
+ *						the worklist
+ * @param skipInvalid	If set, references which aren't valid anymore are
+ *						skipped. An incremental collection needs this, since
+ *						the referenced entries may have been freed after
+ *						the references have been pushed.
+ */
+static void processWorkList(SegManager *segMan, WorklistManager &wm, const Common::Array<SegmentObj *> &heap, uint maxItems = 0, bool skipInvalid = false) {
 	SegmentId stackSegment = segMan->findSegmentByType(SEG_TYPE_STACK);
-	while (!wm._worklist.empty()) {
+	uint items = 0;
+	while (!wm._worklist.empty() && (!maxItems || items++ < maxItems)) {
 		reg_t reg = wm._worklist.back();
 		wm._worklist.pop_back();
 		if (reg.segment != stackSegment) { // No need to repeat this one
 			debugC(kDebugLevelGC, "[GC] Checking %04x:%04x", PRINT_REG(reg));
 			if (reg.segment < heap.size() && heap[reg.segment]) {
+				if (skipInvalid && !heap[reg.segment]->isValidOffset(reg.offset))
+					continue;
 				// Valid heap object? Find its outgoing references!
 				wm.pushArray(heap[reg.segment]->listAllOutgoingReferences(reg));
 			}
@@ -84,11 +139,13 @@ static void processWorkList(SegManager *segMan, WorklistManager &wm, const Commo
 	}
 }
 
-AddrSet *findAllActiveReferences(EngineState *s) {
+/**
+ * Pushes the root set, i.e. the registers, the value stack, the execution
+ * stack and the objects of explicitly loaded scripts.
+ */
+static void pushRootSet(EngineState *s, WorklistManager &wm) {
 	assert(!s->_executionStack.empty());
 
-	WorklistManager wm;
-
 	// Initialize registers
 	wm.push(s->r_acc);
 	wm.push(s->r_prev);
@@ -140,14 +197,49 @@ AddrSet *findAllActiveReferences(EngineState *s) {
 	}
 
 	debugC(kDebugLevelGC, "[GC] -- Finished explicitly loaded scripts, done with root set");
+}
+
+AddrSet *findAllActiveReferences(EngineState *s) {
+	WorklistManager wm;
+
+	pushRootSet(s, wm);
 
-	processWorkList(s->_segMan, wm, heap);
+	processWorkList(s->_segMan, wm, s->_segMan->getSegments());
 
 	return normalizeAddresses(s->_segMan, wm._map);
 }
 
+/**
+ * Returns the (approximate) amount of memory used by an entry which is
+ * about to be freed, for the statistics.
+ */
+static uint getEntrySize(SegmentObj *mobj, reg_t addr) {
+	switch (mobj->getType()) {
+	case SEG_TYPE_CLONES:
+		return sizeof(Clone) + ((CloneTable *)mobj)->_table[addr.offset].getVarCount() * sizeof(reg_t);
+	case SEG_TYPE_LISTS:
+		return sizeof(List);
+	case SEG_TYPE_NODES:
+		return sizeof(Node);
+#ifdef ENABLE_SCI32
+	case SEG_TYPE_ARRAY:
+		return sizeof(SciArray<reg_t>) + ((ArrayTable *)mobj)->_table[addr.offset].getSize() * sizeof(reg_t);
+	case SEG_TYPE_STRING:
+		return sizeof(SciString) + ((StringTable *)mobj)->_table[addr.offset].getSize();
+#endif
+	default:
+		return 0;
+	}
+}
+
 void run_gc(EngineState *s) {
 	SegManager *segMan = s->_segMan;
+	const uint32 startTime = g_system->getMillis();
+	uint freedEntries = 0;
+	uint freedBytes = 0;
+
+	// A full collection supersedes a running incremental one
+	abort_gc(s);
 
 	// Some debug stuff
 	debugC(kDebugLevelGC, "[GC] Running...");
@@ -180,6 +272,8 @@ void run_gc(EngineState *s) {
 				const reg_t addr = *it;
 				if (!activeRefs->contains(addr)) {
 					// Not found -> we can free it
+					freedBytes += getEntrySize(mobj, addr);
+					freedEntries++;
 					mobj->freeAtAddress(segMan, addr);
 					debugC(kDebugLevelGC, "[GC] Deallocating %04x:%04x", PRINT_REG(addr));
 #ifdef GC_DEBUG_CODE
@@ -200,6 +294,175 @@ void run_gc(EngineState *s) {
 		if (segcount[i])
 			debugC(kDebugLevelGC, "\t%d\t* %s", segcount[i], segnames[i]);
 #endif
+
+	debugC(1, kDebugLevelGC, "[GC] Full collection: %d ms pause, freed %d entries (%d bytes)",
+		g_system->getMillis() - startTime, freedEntries, freedBytes);
+}
+
+void abort_gc(EngineState *s) {
+	if (!s->_gcState)
+		return;
+
+	debugC(1, kDebugLevelGC, "[GC] Aborting incremental collection after %d steps", s->_gcState->steps);
+	s->_segMan->setGCBarrier(false);
+	delete s->_gcState;
+	s->_gcState = 0;
+}
+
+void free_gc_state(GCState *state) {
+	delete state;
+}
+
+/**
+ * Ends the mark phase: Traces everything which may have changed since
+ * marking started, then prepares sweeping.
+ */
+static void remark(EngineState *s, GCState *gc) {
+	SegManager *segMan = s->_segMan;
+	const Common::Array<SegmentObj *> &heap = segMan->getSegments();
+	WorklistManager &wm = gc->wm;
+
+	pushRootSet(s, wm);
+
+	// Script objects, locals and clones are modified directly by the VM,
+	// so we have to rescan all of them, whether already traced or not.
+	for (uint seg = 1; seg < heap.size(); seg++) {
+		SegmentObj *mobj = heap[seg];
+		if (!mobj)
+			continue;
+
+		Common::Array<reg_t> objects;
+		if (mobj->getType() == SEG_TYPE_SCRIPT)
+			objects = ((Script *)mobj)->listObjectReferences();
+		else if (mobj->getType() == SEG_TYPE_CLONES)
+			objects = mobj->listAllDeallocatable(seg);
+		else
+			continue;
+
+		for (Common::Array<reg_t>::const_iterator it = objects.begin(); it != objects.end(); ++it) {
+			if (it->segment < heap.size() && heap[it->segment])
+				wm.pushArray(heap[it->segment]->listAllOutgoingReferences(*it));
+		}
+	}
+
+	// The same goes for the entries recorded by the write barrier. They are
+	// also kept alive, as they may have been allocated after the roots were
+	// traced.
+	AddrSet &barrierSet = segMan->getGCBarrierSet();
+	for (AddrSet::const_iterator it = barrierSet.begin(); it != barrierSet.end(); ++it) {
+		const reg_t addr = it->_key;
+		SegmentObj *mobj = segMan->getSegmentObj(addr.segment);
+		if (!mobj || !mobj->isValidOffset(addr.offset))
+			continue;
+
+		// The stack is part of the root set, scripts and locals have been
+		// rescanned above
+		const SegmentType type = mobj->getType();
+		if (type != SEG_TYPE_STACK && type != SEG_TYPE_SCRIPT && type != SEG_TYPE_LOCALS) {
+			wm.push(addr);
+			wm.pushArray(mobj->listAllOutgoingReferences(addr));
+		}
+	}
+	barrierSet.clear();
+
+	processWorkList(segMan, wm, heap, 0, true);
+
+	gc->activeRefs = normalizeAddresses(segMan, wm._map);
+	wm._map.clear(true);
+	gc->phase = GCState::kPhaseSweep;
+	gc->sweepSegment = 1;
+	gc->sweepList.clear();
+	gc->sweepPos = 0;
+}
+
+/**
+ * Frees up to maxItems unreachable entries.
+ * @return true if all segments have been swept
+ */
+static bool sweep(EngineState *s, GCState *gc, uint maxItems) {
+	SegManager *segMan = s->_segMan;
+	const Common::Array<SegmentObj *> &heap = segMan->getSegments();
+	const AddrSet &barrierSet = segMan->getGCBarrierSet();
+	uint items = 0;
+
+	while (gc->sweepSegment < heap.size()) {
+		SegmentObj *mobj = heap[gc->sweepSegment];
+		if (!mobj) {
+			gc->sweepSegment++;
+			continue;
+		}
+
+		if (gc->sweepPos == 0 && gc->sweepList.empty())
+			gc->sweepList = mobj->listAllDeallocatable(gc->sweepSegment);
+
+		while (gc->sweepPos < gc->sweepList.size()) {
+			if (items++ >= maxItems)
+				return false;
+
+			const reg_t addr = gc->sweepList[gc->sweepPos++];
+			// Skip entries which have been freed by the scripts, or which
+			// have been allocated or modified since remarking
+			if (!mobj->isValidOffset(addr.offset) || gc->activeRefs->contains(addr) || barrierSet.contains(addr))
+				continue;
+
+			gc->freedBytes += getEntrySize(mobj, addr);
+			gc->freedEntries++;
+			mobj->freeAtAddress(segMan, addr);
+			debugC(kDebugLevelGC, "[GC] Deallocating %04x:%04x", PRINT_REG(addr));
+		}
+
+		gc->sweepSegment++;
+		gc->sweepList.clear();
+		gc->sweepPos = 0;
+	}
+
+	return true;
+}
+
+void run_gc_step(EngineState *s) {
+	SegManager *segMan = s->_segMan;
+	const uint32 stepStart = g_system->getMillis();
+	const uint stepSize = MAX(s->scriptGCStepSize, 1);
+	GCState *gc = s->_gcState;
+
+	if (gc && segMan->haveGCSegmentsChanged()) {
+		// Scripts have been loaded or unloaded in the meantime, so the
+		// traced references may be stale. Collect everything at once
+		// instead, which is what we'd have done without incremental
+		// collections anyway.
+		run_gc(s);
+		return;
+	}
+
+	if (!gc) {
+		debugC(kDebugLevelGC, "[GC] Starting incremental collection...");
+		gc = s->_gcState = new GCState();
+		gc->startTime = stepStart;
+		segMan->setGCBarrier(true);
+		pushRootSet(s, gc->wm);
+	}
+
+	bool finished = false;
+	if (gc->phase == GCState::kPhaseMark) {
+		processWorkList(segMan, gc->wm, segMan->getSegments(), stepSize, true);
+		if (gc->wm._worklist.empty())
+			remark(s, gc);
+	} else {
+		finished = sweep(s, gc, stepSize);
+	}
+
+	const uint32 pause = g_system->getMillis() - stepStart;
+	gc->pauseTime += pause;
+	gc->maxPauseTime = MAX(gc->maxPauseTime, pause);
+	gc->steps++;
+
+	if (finished) {
+		debugC(1, kDebugLevelGC, "[GC] Incremental collection: %d steps in %d ms, %d ms total pause, %d ms max pause, freed %d entries (%d bytes)",
+			gc->steps, g_system->getMillis() - gc->startTime, gc->pauseTime, gc->maxPauseTime, gc->freedEntries, gc->freedBytes);
+		segMan->setGCBarrier(false);
+		delete gc;
+		s->_gcState = 0;
+	}
 }
 
 } // End of namespace Sci
@@ -27,23 +27,19 @@
 #ifndef SCI_ENGINE_GC_H
 #define SCI_ENGINE_GC_H
 
-#include "common/hashmap.h"
+#include "common/flathashmap.h"
 #include "sci/engine/vm_types.h"
 #include "sci/engine/state.h"
 
 namespace Sci {
 
-struct reg_t_Hash {
-	uint operator()(const reg_t& x) const {
-		return (x.segment << 3) ^ x.offset ^ (x.offset << 16);
-	}
-};
-
 /*
  * The AddrSet is a "set" of reg_t values.
- * We don't have a HashSet type, so we abuse a HashMap for this.
+ * We don't have a HashSet type, so we abuse a hash map for this. The
+ * garbage collector performs lots of lookups on it, so we use the flat
+ * variant, which does not need a separate allocation per element.
  */
-typedef Common::HashMap<reg_t, bool, reg_t_Hash> AddrSet;
+typedef Common::FlatHashMap<reg_t, bool, reg_t_Hash> AddrSet;
 
 /**
  * Finds all used references and normalises them to their memory addresses
@@ -58,6 +54,30 @@ AddrSet *findAllActiveReferences(EngineState *s);
  */
 void run_gc(EngineState *s);
 
+/**
+ * Performs one step of an incremental garbage collection, starting a new
+ * collection if none is running. Each step traces or sweeps at most
+ * EngineState::scriptGCStepSize entries, apart from the last step of the
+ * mark phase, which has to rescan everything that may have changed since
+ * the collection started. Statistics of each collection are logged to the
+ * "GC" debug channel.
+ * @param s The state in which we should gc
+ */
+void run_gc_step(EngineState *s);
+
+/**
+ * Stops a running incremental garbage collection, if any. Nothing is freed.
+ * @param s The state in which we should stop the gc
+ */
+void abort_gc(EngineState *s);
+
+/**
+ * Frees the state of a running incremental garbage collection, without
+ * touching the segment manager, which may be gone already.
+ * @param state The state to free, may be 0
+ */
+void free_gc_state(GCState *state);
+
 } // End of namespace Sci
 
 #endif // SCI_ENGINE_GC_H
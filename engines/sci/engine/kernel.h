@@ -274,6 +274,35 @@ private:
 	const Common::String _invalid;
 };
 
+/**
+ * Statistics of the visibility graph cache of kAvoidPath.
+ */
+struct AvoidPathCacheStats {
+	uint32 hits;			///< Paths searched in a polygon set with a cached graph
+	uint32 misses;			///< Paths searched in a new polygon set
+	uint32 bypasses;		///< Paths searched without the graph, as an edge was split
+	uint32 rowsComputed;	///< Rows of a graph that had to be computed
+	uint32 rowsReused;		///< Rows of a graph that were computed before
+	uint32 testsDone;		///< Visibility tests done for computing rows
+	uint32 testsSaved;		///< Visibility tests avoided by reusing rows
+	uint32 rowTime;			///< Time spent computing rows, in ms
+};
+
+/**
+ * Frees the visibility graphs cached by kAvoidPath.
+ */
+void freeAvoidPathCache(EngineState *s);
+
+/**
+ * Returns the statistics of the visibility graph cache of kAvoidPath.
+ */
+AvoidPathCacheStats getAvoidPathCacheStats(EngineState *s);
+
+/**
+ * Resets the statistics of the visibility graph cache of kAvoidPath.
+ */
+void resetAvoidPathCacheStats(EngineState *s);
+
 /* Maximum length of a savegame name (including terminator character). */
 #define SCI_MAX_SAVENAME_LENGTH 0x24
 
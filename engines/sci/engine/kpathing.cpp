@@ -31,6 +31,7 @@
 #include "sci/graphics/palette.h"
 #include "sci/graphics/screen.h"
 
+#include "common/array.h"
 #include "common/debug-channels.h"
 #include "common/list.h"
 #include "common/system.h"
@@ -59,6 +60,12 @@ enum {
 
 #define HUGE_DISTANCE 0xFFFFFFFF
 
+// Number of polygon sets of which the visibility graph is cached
+#define VISIBILITY_CACHE_SIZE 4
+
+// Number of cells per axis of the spatial grid of polygon edges
+#define EDGE_GRID_SIZE 16
+
 #define VERTEX_HAS_EDGES(V) ((V) != CLIST_NEXT(V))
 
 // Error codes
@@ -95,10 +102,14 @@ struct Vertex {
 	// Previous vertex in shortest path
 	Vertex *path_prev;
 
+	// Position in the vertex index of the pathfinding state
+	int _index;
+
 public:
 	Vertex(const Common::Point &p) : v(p) {
 		costG = HUGE_DISTANCE;
 		path_prev = NULL;
+		_index = -1;
 	}
 };
 
@@ -215,6 +226,56 @@ public:
 
 typedef Common::List<Polygon *> PolygonList;
 
+/**
+ * Visibility graph of a polygon set, not including the start and end points
+ * of the path. Vertices are referred to by their position in the polygon set.
+ */
+struct VisibilityGraph {
+	// Hash of the signature
+	uint32 hash;
+
+	// Types, sizes and points of all polygons, used to identify the polygon set
+	Common::Array<int16> signature;
+
+	// Total number of vertices
+	int vertices;
+
+	// Vertices visible from each vertex, in ascending order. The rows are
+	// only computed when A* first needs them.
+	Common::Array<Common::Array<uint16> > visible;
+	Common::Array<bool> computed;
+
+	// Spatial grid of the polygon edges, used to find the edges that may
+	// intersect a line. Each cell lists the edges (by their first vertex)
+	// of which the bounding box overlaps the cell.
+	Common::Point gridOrigin;
+	int cellWidth, cellHeight;
+	Common::Array<uint16> cells[EDGE_GRID_SIZE * EDGE_GRID_SIZE];
+
+	// Marks the edges which have been checked already in a grid query
+	Common::Array<uint32> edgeMarks;
+	uint32 edgeStamp;
+
+	VisibilityGraph(const PolygonList &polygons, uint32 hash_, const Common::Array<int16> &signature_);
+
+	void getCellRange(const Common::Point &p, const Common::Point &q, int &x1, int &y1, int &x2, int &y2) const;
+};
+
+// Cache of the visibility graphs of the most recently used polygon sets
+struct AvoidPathCache {
+	Common::List<VisibilityGraph *> graphs;
+	AvoidPathCacheStats stats;
+
+	AvoidPathCache() {
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	~AvoidPathCache() {
+		for (Common::List<VisibilityGraph *>::iterator it = graphs.begin(); it != graphs.end(); ++it)
+			delete *it;
+	}
+};
+
 // Pathfinding state
 struct PathfindingState {
 	// List of all polygons
@@ -236,6 +297,19 @@ struct PathfindingState {
 	// Screen size
 	int _width, _height;
 
+	// Cached visibility graph of the polygons, NULL if it can't be used
+	VisibilityGraph *_graph;
+
+	// Statistics of the cache holding _graph
+	AvoidPathCacheStats *_cacheStats;
+
+	// Position of the first vertex of _graph in the vertex index. Vertices
+	// in front of it are the start and/or end point.
+	int _graphOffset;
+
+	// Set when the start or end point was merged into a polygon edge
+	bool _edgeSplit;
+
 	PathfindingState(int width, int height) : _width(width), _height(height) {
 		vertex_start = NULL;
 		vertex_end = NULL;
@@ -243,6 +317,10 @@ struct PathfindingState {
 		_prependPoint = NULL;
 		_appendPoint = NULL;
 		vertices = 0;
+		_graph = NULL;
+		_cacheStats = NULL;
+		_graphOffset = 0;
+		_edgeSplit = false;
 	}
 
 	~PathfindingState() {
@@ -638,6 +716,139 @@ static int inside(const Common::Point &p, Vertex *vertex) {
 	return 0;
 }
 
+/**
+ * Determines whether or not an edge blocks the line between two vertices
+ * @param vertex_cur	the first vertex
+ * @param vertex		the second vertex
+ * @param edge			the first vertex of the edge
+ * @return true if the line (vertex_cur, vertex) is blocked by the edge
+ */
+static bool edge_blocks(Vertex *vertex_cur, Vertex *vertex, Vertex *edge) {
+	if (!VERTEX_HAS_EDGES(edge))
+		return false;
+
+	// If we hit a vertex, make sure we can pass through it without intersecting its polygon
+	if (between(vertex_cur->v, vertex->v, edge->v))
+		return inside(vertex_cur->v, edge) || inside(vertex->v, edge);
+
+	return intersect_proper(vertex_cur->v, vertex->v, edge->v, CLIST_NEXT(edge)->v);
+}
+
+/**
+ * Determines whether or not two vertices are visible from each other. The
+ * result doesn't depend on the order of the vertices.
+ * @param s				the pathfinding state
+ * @param vertex_cur	the first vertex
+ * @param vertex		the second vertex
+ * @return true if the vertices are visible from each other
+ */
+static bool is_visible(PathfindingState *s, Vertex *vertex_cur, Vertex *vertex) {
+	// Make sure we don't intersect a polygon locally at the vertices
+	if ((vertex == vertex_cur) || (inside(vertex->v, vertex_cur)) || (inside(vertex_cur->v, vertex)))
+		return false;
+
+	VisibilityGraph *graph = s->_graph;
+
+	if (!graph) {
+		// Check for intersecting edges
+		for (int j = 0; j < s->vertices; j++) {
+			if (edge_blocks(vertex_cur, vertex, s->vertex_index[j]))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Only check the edges in the grid cells covered by the bounding box of
+	// the line. Edges outside of it can't intersect the line.
+	if (++graph->edgeStamp == 0) {
+		for (uint i = 0; i < graph->edgeMarks.size(); i++)
+			graph->edgeMarks[i] = 0;
+		graph->edgeStamp = 1;
+	}
+
+	int x1, y1, x2, y2;
+	graph->getCellRange(vertex_cur->v, vertex->v, x1, y1, x2, y2);
+
+	for (int y = y1; y <= y2; y++) {
+		for (int x = x1; x <= x2; x++) {
+			const Common::Array<uint16> &cell = graph->cells[y * EDGE_GRID_SIZE + x];
+
+			for (uint i = 0; i < cell.size(); i++) {
+				if (graph->edgeMarks[cell[i]] == graph->edgeStamp)
+					continue;
+				graph->edgeMarks[cell[i]] = graph->edgeStamp;
+
+				if (edge_blocks(vertex_cur, vertex, s->vertex_index[s->_graphOffset + cell[i]]))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+VisibilityGraph::VisibilityGraph(const PolygonList &polygons, uint32 hash_, const Common::Array<int16> &signature_)
+	: hash(hash_), signature(signature_), vertices(0), edgeStamp(0) {
+	Common::Point minPoint(0x7fff, 0x7fff), maxPoint(-0x8000, -0x8000);
+	Vertex *vertex;
+
+	for (PolygonList::const_iterator it = polygons.begin(); it != polygons.end(); ++it) {
+		CLIST_FOREACH(vertex, &(*it)->vertices) {
+			minPoint.x = MIN(minPoint.x, vertex->v.x);
+			minPoint.y = MIN(minPoint.y, vertex->v.y);
+			maxPoint.x = MAX(maxPoint.x, vertex->v.x);
+			maxPoint.y = MAX(maxPoint.y, vertex->v.y);
+			vertices++;
+		}
+	}
+
+	visible.resize(vertices);
+	computed.resize(vertices);
+	edgeMarks.resize(vertices);
+	for (int i = 0; i < vertices; i++) {
+		computed[i] = false;
+		edgeMarks[i] = 0;
+	}
+
+	if (!vertices)
+		minPoint = maxPoint = Common::Point(0, 0);
+
+	gridOrigin = minPoint;
+	cellWidth = (maxPoint.x - minPoint.x) / EDGE_GRID_SIZE + 1;
+	cellHeight = (maxPoint.y - minPoint.y) / EDGE_GRID_SIZE + 1;
+
+	int index = 0;
+
+	for (PolygonList::const_iterator it = polygons.begin(); it != polygons.end(); ++it) {
+		CLIST_FOREACH(vertex, &(*it)->vertices) {
+			if (VERTEX_HAS_EDGES(vertex)) {
+				int x1, y1, x2, y2;
+				getCellRange(vertex->v, CLIST_NEXT(vertex)->v, x1, y1, x2, y2);
+
+				for (int y = y1; y <= y2; y++) {
+					for (int x = x1; x <= x2; x++)
+						cells[y * EDGE_GRID_SIZE + x].push_back(index);
+				}
+			}
+
+			index++;
+		}
+	}
+}
+
+/**
+ * Determines the grid cells covered by the bounding box of a line
+ * Parameters: (const Common::Point &) p, q: The line (p, q)
+ * Returns   : (int &) x1, y1, x2, y2: The inclusive range of cells
+ */
+void VisibilityGraph::getCellRange(const Common::Point &p, const Common::Point &q, int &x1, int &y1, int &x2, int &y2) const {
+	x1 = CLIP((MIN(p.x, q.x) - gridOrigin.x) / cellWidth, 0, EDGE_GRID_SIZE - 1);
+	y1 = CLIP((MIN(p.y, q.y) - gridOrigin.y) / cellHeight, 0, EDGE_GRID_SIZE - 1);
+	x2 = CLIP((MAX(p.x, q.x) - gridOrigin.x) / cellWidth, 0, EDGE_GRID_SIZE - 1);
+	y2 = CLIP((MAX(p.y, q.y) - gridOrigin.y) / cellHeight, 0, EDGE_GRID_SIZE - 1);
+}
+
 /**
  * Returns a list of all vertices that are visible from a particular vertex.
  * @param s				the pathfinding state
@@ -646,37 +857,51 @@ static int inside(const Common::Point &p, Vertex *vertex) {
  */
 static VertexList *visible_vertices(PathfindingState *s, Vertex *vertex_cur) {
 	VertexList *visVerts = new VertexList();
+	VisibilityGraph *graph = s->_graph;
 
-	for (int i = 0; i < s->vertices; i++) {
-		Vertex *vertex = s->vertex_index[i];
+	if (!graph || vertex_cur->_index < s->_graphOffset) {
+		for (int i = 0; i < s->vertices; i++) {
+			if (is_visible(s, vertex_cur, s->vertex_index[i]))
+				visVerts->push_front(s->vertex_index[i]);
+		}
 
-		// Make sure we don't intersect a polygon locally at the vertices
-		if ((vertex == vertex_cur) || (inside(vertex->v, vertex_cur)) || (inside(vertex_cur->v, vertex)))
-			continue;
+		return visVerts;
+	}
 
-		// Check for intersecting edges
-		int j;
-		for (j = 0; j < s->vertices; j++) {
-			Vertex *edge = s->vertex_index[j];
-			if (VERTEX_HAS_EDGES(edge)) {
-				if (between(vertex_cur->v, vertex->v, edge->v)) {
-					// If we hit a vertex, make sure we can pass through it without intersecting its polygon
-					if ((inside(vertex_cur->v, edge)) || (inside(vertex->v, edge)))
-						break;
-
-					// This edge won't properly intersect, so we continue
-					continue;
-				}
+	// Visibility between polygon vertices is taken from the cached graph,
+	// only the start and end points have to be checked. The resulting list
+	// has the same order as above.
+	for (int i = 0; i < s->_graphOffset; i++) {
+		if (is_visible(s, vertex_cur, s->vertex_index[i]))
+			visVerts->push_front(s->vertex_index[i]);
+	}
 
-				if (intersect_proper(vertex_cur->v, vertex->v, edge->v, CLIST_NEXT(edge)->v))
-					break;
-			}
+	const int index = vertex_cur->_index - s->_graphOffset;
+	Common::Array<uint16> &row = graph->visible[index];
+
+	if (!graph->computed[index]) {
+		// A row takes far less than a millisecond, but as it starts at a
+		// random point within one, the sum of the differences still comes
+		// out right on average
+		const uint32 startTime = g_system->getMillis();
+
+		for (int i = 0; i < graph->vertices; i++) {
+			if (is_visible(s, vertex_cur, s->vertex_index[s->_graphOffset + i]))
+				row.push_back(i);
 		}
+		graph->computed[index] = true;
 
-		if (j == s->vertices)
-			visVerts->push_front(vertex);
+		s->_cacheStats->rowTime += g_system->getMillis() - startTime;
+		s->_cacheStats->rowsComputed++;
+		s->_cacheStats->testsDone += graph->vertices;
+	} else {
+		s->_cacheStats->rowsReused++;
+		s->_cacheStats->testsSaved += graph->vertices;
 	}
 
+	for (uint i = 0; i < row.size(); i++)
+		visVerts->push_front(s->vertex_index[s->_graphOffset + row[i]]);
+
 	return visVerts;
 }
 
@@ -1062,6 +1287,7 @@ static Vertex *merge_point(PathfindingState *s, const Common::Point &v) {
 				if (between(vertex->v, next->v, v)) {
 					// Split edge by adding vertex
 					polygon->vertices.insertAfter(vertex, v_new);
+					s->_edgeSplit = true;
 					return v_new;
 				}
 			}
@@ -1164,6 +1390,79 @@ static void change_polygons_opt_0(PathfindingState *s) {
 	}
 }
 
+/**
+ * Looks up the visibility graph of a polygon set in the cache, and adds a new
+ * (empty) graph for it if it isn't cached yet
+ * Parameters: (EngineState *) s: The game state
+ *             (const PolygonList &) polygons: The polygon set
+ * Returns   : (VisibilityGraph *) The visibility graph of the polygon set
+ */
+static VisibilityGraph *lookup_visibility_graph(EngineState *s, const PolygonList &polygons) {
+	Common::Array<int16> signature;
+	Vertex *vertex;
+
+	for (PolygonList::const_iterator it = polygons.begin(); it != polygons.end(); ++it) {
+		signature.push_back((*it)->type);
+		signature.push_back((*it)->vertices.size());
+		CLIST_FOREACH(vertex, &(*it)->vertices) {
+			signature.push_back(vertex->v.x);
+			signature.push_back(vertex->v.y);
+		}
+	}
+
+	// FNV-1a
+	uint32 hash = 2166136261U;
+	for (uint i = 0; i < signature.size(); i++)
+		hash = (hash ^ (uint16)signature[i]) * 16777619;
+
+	if (!s->_avoidPathCache)
+		s->_avoidPathCache = new AvoidPathCache();
+
+	AvoidPathCache *cache = s->_avoidPathCache;
+
+	for (Common::List<VisibilityGraph *>::iterator it = cache->graphs.begin(); it != cache->graphs.end(); ++it) {
+		VisibilityGraph *graph = *it;
+		if (graph->hash == hash && graph->signature == signature) {
+			cache->graphs.erase(it);
+			cache->graphs.push_front(graph);
+			cache->stats.hits++;
+			return graph;
+		}
+	}
+
+	cache->stats.misses++;
+	debugC(kDebugLevelAvoidPath, "AvoidPath: new polygon set %08x (%d hits, %d misses so far)", hash, cache->stats.hits, cache->stats.misses);
+
+	VisibilityGraph *graph = new VisibilityGraph(polygons, hash, signature);
+	cache->graphs.push_front(graph);
+
+	if (cache->graphs.size() > VISIBILITY_CACHE_SIZE) {
+		delete cache->graphs.back();
+		cache->graphs.pop_back();
+	}
+
+	return graph;
+}
+
+void freeAvoidPathCache(EngineState *s) {
+	delete s->_avoidPathCache;
+	s->_avoidPathCache = 0;
+}
+
+AvoidPathCacheStats getAvoidPathCacheStats(EngineState *s) {
+	if (s->_avoidPathCache)
+		return s->_avoidPathCache->stats;
+
+	AvoidPathCacheStats stats;
+	memset(&stats, 0, sizeof(stats));
+	return stats;
+}
+
+void resetAvoidPathCacheStats(EngineState *s) {
+	if (s->_avoidPathCache)
+		memset(&s->_avoidPathCache->stats, 0, sizeof(s->_avoidPathCache->stats));
+}
+
 /**
  * Converts the SCI input data for pathfinding
  * Parameters: (EngineState *) s: The game state
@@ -1179,6 +1478,7 @@ static PathfindingState *convert_polygon_set(EngineState *s, reg_t poly_list, Co
 	Polygon *polygon;
 	int err;
 	int count = 0;
+	Common::Point startPoint, endPoint;
 	PathfindingState *pf_s = new PathfindingState(width, height);
 
 	// Convert all polygons
@@ -1219,14 +1519,13 @@ static PathfindingState *convert_polygon_set(EngineState *s, reg_t poly_list, Co
 		if (err == PF_OK) {
 			// Intersection was found, prepend original start position after pathfinding
 			pf_s->_prependPoint = new Common::Point(start);
-			// Merge new start point into polygon set
-			pf_s->vertex_start = merge_point(pf_s, intersection);
+			// Use new start point
+			startPoint = intersection;
 		} else {
 			// Otherwise we proceed with the original start point
-			pf_s->vertex_start = merge_point(pf_s, start);
+			startPoint = start;
 		}
-		// Merge end point into polygon set
-		pf_s->vertex_end = merge_point(pf_s, end);
+		endPoint = end;
 	} else {
 		Common::Point *new_start = fixup_start_point(pf_s, start);
 
@@ -1252,14 +1551,22 @@ static PathfindingState *convert_polygon_set(EngineState *s, reg_t poly_list, Co
 			new_start = new Common::Point(77, 107);
 		}
 
-		// Merge start and end points into polygon set
-		pf_s->vertex_start = merge_point(pf_s, *new_start);
-		pf_s->vertex_end = merge_point(pf_s, *new_end);
+		startPoint = *new_start;
+		endPoint = *new_end;
 
 		delete new_start;
 		delete new_end;
 	}
 
+	// The visibility graph of the polygons doesn't depend on the start and
+	// end points, unless they end up on an edge
+	VisibilityGraph *graph = lookup_visibility_graph(s, pf_s->polygons);
+	int polygonCount = pf_s->polygons.size();
+
+	// Merge start and end points into polygon set
+	pf_s->vertex_start = merge_point(pf_s, startPoint);
+	pf_s->vertex_end = merge_point(pf_s, endPoint);
+
 	// Allocate and build vertex index
 	pf_s->vertex_index = (Vertex**)malloc(sizeof(Vertex *) * (count + 2));
 
@@ -1270,12 +1577,24 @@ static PathfindingState *convert_polygon_set(EngineState *s, reg_t poly_list, Co
 		Vertex *vertex;
 
 		CLIST_FOREACH(vertex, &polygon->vertices) {
+			vertex->_index = count;
 			pf_s->vertex_index[count++] = vertex;
 		}
 	}
 
 	pf_s->vertices = count;
 
+	// Start and end points which didn't match an existing vertex were
+	// added as single-vertex polygons in front of the others
+	if (!pf_s->_edgeSplit) {
+		pf_s->_graph = graph;
+		pf_s->_cacheStats = &s->_avoidPathCache->stats;
+		pf_s->_graphOffset = pf_s->polygons.size() - polygonCount;
+		assert(pf_s->_graphOffset + graph->vertices == count);
+	} else {
+		s->_avoidPathCache->stats.bypasses++;
+	}
+
 	return pf_s;
 }
 
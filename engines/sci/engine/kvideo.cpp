@@ -31,6 +31,7 @@
 #include "sci/graphics/screen.h"
 #include "graphics/cursorman.h"
 #include "video/avi_decoder.h"
+#include "video/decode_ahead.h"
 #include "video/qt_decoder.h"
 #include "sci/video/seq_decoder.h"
 #ifdef ENABLE_SCI32
@@ -43,6 +44,11 @@ void playVideo(Video::VideoDecoder *videoDecoder, VideoState videoState) {
 	if (!videoDecoder)
 		return;
 
+	// Decode the frames in the background, so that large frames don't stall
+	// the playback loop
+	Video::DecodeAheadVideoDecoder *decodeAhead = new Video::DecodeAheadVideoDecoder(videoDecoder);
+	videoDecoder = decodeAhead;
+
 	byte *scaleBuffer = 0;
 	byte bytesPerPixel = videoDecoder->getPixelFormat().bytesPerPixel;
 	uint16 width = videoDecoder->getWidth();
@@ -107,7 +113,10 @@ void playVideo(Video::VideoDecoder *videoDecoder, VideoState videoState) {
 				skipVideo = true;
 		}
 
-		g_system->delayMillis(10);
+		// Use the wait for the next frame to decode ahead, which is all the
+		// decoding ahead for video with slow frames
+		if (!decodeAhead->prefetchFrame())
+			g_system->delayMillis(10);
 	}
 
 	delete[] scaleBuffer;
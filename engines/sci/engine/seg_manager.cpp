@@ -40,6 +40,9 @@ enum {
 SegManager::SegManager(ResourceManager *resMan) {
 	_heap.push_back(0);
 
+	_gcBarrierEnabled = false;
+	_gcSegmentsChanged = false;
+
 	_clonesSegId = 0;
 	_listsSegId = 0;
 	_nodesSegId = 0;
@@ -118,6 +121,8 @@ SegmentId SegManager::findFreeSegment() const {
 SegmentObj *SegManager::allocSegment(SegmentObj *mem, SegmentId *segid) {
 	// Find a free segment
 	SegmentId id = findFreeSegment();
+	if (_gcBarrierEnabled)
+		_gcSegmentsChanged = true;
 	if (segid)
 		*segid = id;
 
@@ -156,9 +161,13 @@ void SegManager::deallocate(SegmentId seg, bool recursive) {
 
 	SegmentObj *mobj = _heap[seg];
 
+	if (_gcBarrierEnabled)
+		_gcSegmentsChanged = true;
+
 	if (mobj->getType() == SEG_TYPE_SCRIPT) {
 		Script *scr = (Script *)mobj;
 		_scriptSegMap.erase(scr->getScriptNumber());
+		_selectorLookupCache.flush();
 		if (recursive && scr->_localsSegment)
 			deallocate(scr->_localsSegment, recursive);
 	}
@@ -175,6 +184,12 @@ bool SegManager::isHeapObject(reg_t pos) const {
 	return !(scr && scr->isMarkedAsDeleted());
 }
 
+void SegManager::setGCBarrier(bool enable) {
+	_gcBarrierEnabled = enable;
+	_gcSegmentsChanged = false;
+	_gcBarrierSet.clear(true);
+}
+
 void SegManager::deallocateScript(int script_nr) {
 	SegmentId seg = getScriptSegment(script_nr);
 	deallocate(seg, true);
@@ -452,6 +467,7 @@ Clone *SegManager::allocateClone(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_clonesSegId, offset);
+	gcBarrier(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -466,6 +482,7 @@ List *SegManager::allocateList(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_listsSegId, offset);
+	gcBarrier(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -480,6 +497,7 @@ Node *SegManager::allocateNode(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_nodesSegId, offset);
+	gcBarrier(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -506,6 +524,7 @@ List *SegManager::lookupList(reg_t addr) {
 		return NULL;
 	}
 
+	gcBarrier(addr);
 	return &(lt->_table[addr.offset]);
 }
 
@@ -530,6 +549,7 @@ Node *SegManager::lookupNode(reg_t addr, bool stopOnDiscarded) {
 		return NULL;
 	}
 
+	gcBarrier(addr);
 	return &(nt->_table[addr.offset]);
 }
 
@@ -543,6 +563,7 @@ SegmentRef SegManager::dereference(reg_t pointer) {
 	}
 
 	SegmentObj *mobj = _heap[pointer.segment];
+	gcBarrier(pointer);
 	return mobj->dereference(pointer);
 }
 
@@ -882,6 +903,7 @@ SciArray<reg_t> *SegManager::allocateArray(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_arraysSegId, offset);
+	gcBarrier(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -894,6 +916,7 @@ SciArray<reg_t> *SegManager::lookupArray(reg_t addr) {
 	if (!arrayTable->isValidEntry(addr.offset))
 		error("Attempt to use non-array %04x:%04x as array", PRINT_REG(addr));
 
+	gcBarrier(addr);
 	return &(arrayTable->_table[addr.offset]);
 }
 
@@ -922,6 +945,7 @@ SciString *SegManager::allocateString(reg_t *addr) {
 	offset = table->allocEntry();
 
 	*addr = make_reg(_stringSegId, offset);
+	gcBarrier(*addr);
 	return &(table->_table[offset]);
 }
 
@@ -1009,6 +1033,10 @@ int SegManager::instantiateScript(int scriptNum) {
 		scr = allocateScript(scriptNum, &segmentId);
 	}
 
+	// The selectors of the objects in the newly loaded script may differ
+	// from those previously cached at the same addresses
+	_selectorLookupCache.flush();
+
 	scr->init(scriptNum, _resMan);
 	scr->load(_resMan);
 	scr->initialiseLocals(this);
@@ -1045,6 +1073,7 @@ void SegManager::uninstantiateScript(int script_nr) {
 	if (!scr->getLockers()) {
 		// The actual script deletion seems to be done by SCI scripts themselves
 		scr->markDeleted();
+		_selectorLookupCache.flush();
 		debugC(kDebugLevelScripts, "Unloaded script 0x%x.", script_nr);
 	}
 }
@@ -27,8 +27,10 @@
 #define SCI_ENGINE_SEGMAN_H
 
 #include "common/scummsys.h"
+#include "common/flathashmap.h"
 #include "common/serializer.h"
 #include "sci/engine/script.h"
+#include "sci/engine/selector.h"
 #include "sci/engine/vm.h"
 #include "sci/engine/vm_types.h"
 #include "sci/engine/segment.h"
@@ -453,11 +455,38 @@ public:
 
 	const Common::Array<SegmentObj *> &getSegments() const { return _heap; }
 
+	/** Returns the cache of selector lookups, see lookupSelector(). */
+	SelectorLookupCache &getSelectorLookupCache() { return _selectorLookupCache; }
+
+	// Write barrier of the incremental garbage collector, see gc.cpp
+
+	/**
+	 * Enables or disables the garbage collector's write barrier. While it is
+	 * enabled, all list, node, clone, array and string entries which are
+	 * allocated or handed out for modification are recorded, so that the
+	 * collector can rescan them before sweeping.
+	 */
+	void setGCBarrier(bool enable);
+
+	/** Returns the entries recorded by the write barrier. */
+	Common::FlatHashMap<reg_t, bool, reg_t_Hash> &getGCBarrierSet() { return _gcBarrierSet; }
+
+	/**
+	 * Determines whether segments were allocated or freed since the write
+	 * barrier was enabled. The collector has to abort its cycle then.
+	 */
+	bool haveGCSegmentsChanged() const { return _gcSegmentsChanged; }
+
 private:
 	Common::Array<SegmentObj *> _heap;
 	Common::Array<Class> _classTable; /**< Table of all classes */
 	/** Map script ids to segment ids. */
 	Common::HashMap<int, SegmentId> _scriptSegMap;
+	SelectorLookupCache _selectorLookupCache;
+
+	bool _gcBarrierEnabled;
+	bool _gcSegmentsChanged;
+	Common::FlatHashMap<reg_t, bool, reg_t_Hash> _gcBarrierSet;
 
 	ResourceManager *_resMan;
 
@@ -476,6 +505,11 @@ private:
 #endif
 
 private:
+	void gcBarrier(reg_t addr) {
+		if (_gcBarrierEnabled)
+			_gcBarrierSet.setVal(addr, true);
+	}
+
 	SegmentObj *allocSegment(SegmentObj *mem, SegmentId *segid);
 	void deallocate(SegmentId seg, bool recursive);
 	void createClassTable();
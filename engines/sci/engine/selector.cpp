@@ -249,38 +249,19 @@ void invokeSelector(EngineState *s, reg_t object, int selectorId,
 	run_vm(s); // Start a new vm
 }
 
-SelectorType lookupSelector(SegManager *segMan, reg_t obj_location, Selector selectorId, ObjVarRef *varp, reg_t *fptr) {
-	const Object *obj = segMan->getObject(obj_location);
-	int index;
-	bool oldScriptHeader = (getSciVersion() == SCI_VERSION_0_EARLY);
-
-	// Early SCI versions used the LSB in the selector ID as a read/write
-	// toggle, meaning that we must remove it for selector lookup.
-	if (oldScriptHeader)
-		selectorId &= ~1;
-
-	if (!obj) {
-		error("lookupSelector(): Attempt to send to non-object or invalid script. Address was %04x:%04x",
-				PRINT_REG(obj_location));
-	}
-
-	index = obj->locateVarSelector(segMan, selectorId);
+static SelectorType lookupSelectorUncached(SegManager *segMan, const Object *obj, Selector selectorId, int *varIndex, reg_t *fptr) {
+	int index = obj->locateVarSelector(segMan, selectorId);
 
 	if (index >= 0) {
 		// Found it as a variable
-		if (varp) {
-			varp->obj = obj_location;
-			varp->varindex = index;
-		}
+		*varIndex = index;
 		return kSelectorVariable;
 	} else {
 		// Check if it's a method, with recursive lookup in superclasses
 		while (obj) {
 			index = obj->funcSelectorPosition(selectorId);
 			if (index >= 0) {
-				if (fptr)
-					*fptr = obj->getFunction(index);
-
+				*fptr = obj->getFunction(index);
 				return kSelectorMethod;
 			} else {
 				obj = segMan->getObject(obj->getSuperClassSelector());
@@ -289,9 +270,47 @@ SelectorType lookupSelector(SegManager *segMan, reg_t obj_location, Selector sel
 
 		return kSelectorNone;
 	}
+}
 
+SelectorType lookupSelector(SegManager *segMan, reg_t obj_location, Selector selectorId, ObjVarRef *varp, reg_t *fptr, const reg_t *callsite) {
+	const Object *obj = segMan->getObject(obj_location);
+	bool oldScriptHeader = (getSciVersion() == SCI_VERSION_0_EARLY);
+
+	// Early SCI versions used the LSB in the selector ID as a read/write
+	// toggle, meaning that we must remove it for selector lookup.
+	if (oldScriptHeader)
+		selectorId &= ~1;
+
+	if (!obj) {
+		error("lookupSelector(): Attempt to send to non-object or invalid script. Address was %04x:%04x",
+				PRINT_REG(obj_location));
+	}
+
+	SelectorLookupCache &cache = segMan->getSelectorLookupCache();
+	const SelectorLookupCache::Entry *entry = cache.find(obj->getPos(), selectorId);
+	if (callsite)
+		cache.countCallsite(*callsite, entry != 0);
+
+	SelectorLookupCache::Entry newEntry;
+	if (!entry) {
+		newEntry.varIndex = -1;
+		newEntry.func = NULL_REG;
+		newEntry.type = lookupSelectorUncached(segMan, obj, selectorId, &newEntry.varIndex, &newEntry.func);
+		cache.insert(obj->getPos(), selectorId, newEntry);
+		entry = &newEntry;
+	}
+
+	if (entry->type == kSelectorVariable) {
+		if (varp) {
+			varp->obj = obj_location;
+			varp->varindex = entry->varIndex;
+		}
+	} else if (entry->type == kSelectorMethod) {
+		if (fptr)
+			*fptr = entry->func;
+	}
 
-//	return _lookupSelector_function(segMan, obj, selectorId, fptr);
+	return entry->type;
 }
 
 } // End of namespace Sci
@@ -27,6 +27,7 @@
 #define SCI_ENGINE_SELECTOR_H
 
 #include "common/scummsys.h"
+#include "common/flathashmap.h"
 
 #include "sci/engine/vm_types.h"	// for reg_t
 #include "sci/engine/vm.h"
@@ -155,6 +156,119 @@ struct SelectorCache {
 #endif
 };
 
+/**
+ * Caches the results of lookupSelector(), so that sending a message doesn't
+ * have to scan the selector tables of the object and its superclasses each
+ * time. Entries are keyed by the position of the object in its script and
+ * the selector. Clones share the entries of the object they were cloned
+ * from, as they have the same selectors. The results only depend on script
+ * data, so the segment manager flushes the cache whenever scripts are loaded
+ * or unloaded.
+ *
+ * The hits and misses of the lookups done by send_selector() can also be
+ * counted per call site, see the "selector_cache" console command.
+ */
+class SelectorLookupCache {
+public:
+	struct Entry {
+		SelectorType type;
+		int varIndex;	///< Index of the variable, for kSelectorVariable
+		reg_t func;	///< Address of the method, for kSelectorMethod
+	};
+
+	struct CallsiteStats {
+		uint32 hits;
+		uint32 misses;
+
+		CallsiteStats() : hits(0), misses(0) {}
+	};
+
+	typedef Common::FlatHashMap<reg_t, CallsiteStats, reg_t_Hash> CallsiteStatsMap;
+
+	SelectorLookupCache() : _hits(0), _misses(0), _flushes(0), _trackCallsites(false) {}
+
+	/**
+	 * Looks up a cached result.
+	 * @param obj		position of the object (see Object::getPos())
+	 * @param selector	the selector to look up
+	 * @return the cached entry, or NULL if there is none
+	 */
+	const Entry *find(reg_t obj, Selector selector) {
+		const EntryMap::const_iterator it = _entries.find(Key(obj, selector));
+		if (it == _entries.end()) {
+			_misses++;
+			return 0;
+		}
+		_hits++;
+		return &it->_value;
+	}
+
+	void insert(reg_t obj, Selector selector, const Entry &entry) {
+		_entries[Key(obj, selector)] = entry;
+	}
+
+	/** Removes all cached entries. The statistics are kept. */
+	void flush() {
+		if (!_entries.empty()) {
+			_entries.clear();
+			_flushes++;
+		}
+	}
+
+	/** Adds a lookup done at the given call site to the statistics, if enabled. */
+	void countCallsite(reg_t callsite, bool hit) {
+		if (!_trackCallsites)
+			return;
+		CallsiteStats &stats = _callsites[callsite];
+		if (hit)
+			stats.hits++;
+		else
+			stats.misses++;
+	}
+
+	void setTrackCallsites(bool track) { _trackCallsites = track; }
+	bool getTrackCallsites() const { return _trackCallsites; }
+
+	void resetStats() {
+		_hits = _misses = _flushes = 0;
+		_callsites.clear(true);
+	}
+
+	uint getSize() const { return _entries.size(); }
+	uint32 getHits() const { return _hits; }
+	uint32 getMisses() const { return _misses; }
+	uint32 getFlushes() const { return _flushes; }
+	const CallsiteStatsMap &getCallsites() const { return _callsites; }
+
+private:
+	struct Key {
+		reg_t obj;
+		Selector selector;
+
+		Key() : obj(NULL_REG), selector(0) {}
+		Key(reg_t o, Selector s) : obj(o), selector(s) {}
+
+		bool operator==(const Key &x) const {
+			return obj == x.obj && selector == x.selector;
+		}
+	};
+
+	struct Key_Hash {
+		uint operator()(const Key &x) const {
+			return ((x.obj.segment << 16) | x.obj.offset) ^ (x.selector * 31);
+		}
+	};
+
+	typedef Common::FlatHashMap<Key, Entry, Key_Hash> EntryMap;
+
+	EntryMap _entries;
+	CallsiteStatsMap _callsites;
+	uint32 _hits;
+	uint32 _misses;
+	uint32 _flushes;
+	bool _trackCallsites;
+};
+
 /**
  * Map a selector name to a selector id. Shortcut for accessing the selector cache.
  */
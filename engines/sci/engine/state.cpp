@@ -29,6 +29,7 @@
 #include "sci/debug.h"	// for g_debug_sleeptime_factor
 #include "sci/event.h"
 
+#include "sci/engine/gc.h"
 #include "sci/engine/kernel.h"
 #include "sci/engine/state.h"
 #include "sci/engine/selector.h"
@@ -71,12 +72,16 @@ static const uint16 s_halfWidthSJISMap[256] = {
 };
 
 EngineState::EngineState(SegManager *segMan)
-: _segMan(segMan), _dirseeker() {
+: _segMan(segMan), _dirseeker(), _gcState(0), _avoidPathCache(0) {
 
 	reset(false);
 }
 
 EngineState::~EngineState() {
+	// The segment manager is gone by now, SciEngine aborts a running
+	// collection before deleting it
+	free_gc_state(_gcState);
+	freeAvoidPathCache(this);
 	delete _msgState;
 }
 
@@ -102,6 +107,7 @@ void EngineState::reset(bool isRestoring) {
 	lastWaitTime = 0;
 
 	gcCountDown = 0;
+	abort_gc(this);
 
 	_throttleCounter = 0;
 	_throttleLastTime = 0;
@@ -117,6 +123,7 @@ void EngineState::reset(bool isRestoring) {
 
 	scriptStepCounter = 0;
 	scriptGCInterval = GC_INTERVAL;
+	scriptGCStepSize = GC_STEP_SIZE;
 
 	_videoState.reset();
 	_syncedAudioOptions = false;
@@ -45,7 +45,9 @@ namespace Common {
 
 namespace Sci {
 
+struct AvoidPathCache;
 class EventManager;
+struct GCState;
 class MessageState;
 class SoundCommandParser;
 
@@ -206,6 +208,7 @@ public:
 
 	int scriptStepCounter; // Counts the number of steps executed
 	int scriptGCInterval; // Number of steps in between gcs
+	int scriptGCStepSize; // Amount of work done per step of an incremental gc, 0 for non-incremental gcs
 
 	uint16 currentRoomNumber() const;
 	void setRoomNumber(uint16 roomNumber);
@@ -222,6 +225,8 @@ public:
 	void shrinkStackToBase();
 
 	int gcCountDown; /**< Number of kernel calls until next gc */
+	GCState *_gcState; /**< State of the running incremental gc, if any */
+	AvoidPathCache *_avoidPathCache; /**< Visibility graphs cached by kAvoidPath */
 
 	MessageState *_msgState;
 
@@ -441,7 +441,7 @@ ExecStack *send_selector(EngineState *s, reg_t send_obj, reg_t work_obj, StackPt
 #endif // VM_DEBUG_SEND
 
 		ObjVarRef varp;
-		switch (lookupSelector(s->_segMan, send_obj, selector, &varp, &funcp)) {
+		switch (lookupSelector(s->_segMan, send_obj, selector, &varp, &funcp, &s->xs->addr.pc)) {
 		case kSelectorNone:
 			error("Send to invalid selector 0x%x of object at %04x:%04x", 0xffff & selector, PRINT_REG(send_obj));
 			break;
@@ -827,9 +827,15 @@ static void callKernelFunc(EngineState *s, int kernelCallNr, int argc) {
 }
 
 static void gcCountDown(EngineState *s) {
-	if (s->gcCountDown-- <= 0) {
+	if (s->_gcState) {
+		// Continue the running incremental collection
+		run_gc_step(s);
+	} else if (s->gcCountDown-- <= 0) {
 		s->gcCountDown = s->scriptGCInterval;
-		run_gc(s);
+		if (s->scriptGCStepSize > 0)
+			run_gc_step(s);
+		else
+			run_gc(s);
 	}
 }
 
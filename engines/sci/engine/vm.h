@@ -118,6 +118,11 @@ enum {
 	GC_INTERVAL = 32768
 };
 
+/** Number of references traced or entries swept per step of an incremental gc */
+enum {
+	GC_STEP_SIZE = 256
+};
+
 // Opcode formats
 enum opcode_format {
 	Script_Invalid = -1,
@@ -337,6 +342,9 @@ void script_debug(EngineState *s);
  * 							fptr is written to iff it is non-NULL and the
  * 							selector indicates a member function of that
  * 							object.
+ * @param[in] callsite		If not NULL, the address of the send instruction
+ * 							doing the lookup, for the statistics of the
+ * 							selector lookup cache.
  * @return					kSelectorNone if the selector was not found in
  * 							the object or its superclasses.
  * 							kSelectorVariable if the selector represents an
@@ -345,7 +353,7 @@ void script_debug(EngineState *s);
  * 							method
  */
 SelectorType lookupSelector(SegManager *segMan, reg_t obj, Selector selectorid,
-		ObjVarRef *varp, reg_t *fptr);
+		ObjVarRef *varp, reg_t *fptr, const reg_t *callsite = NULL);
 
 /**
  * Read a PMachine instruction from a memory buffer and return its length.
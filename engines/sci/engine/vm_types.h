@@ -67,6 +67,13 @@ static inline reg_t make_reg(SegmentId segment, uint16 offset) {
 
 #define PRINT_REG(r) (0xffff) & (unsigned) (r).segment, (unsigned) (r).offset
 
+/** Hash function for using reg_t values as hash map keys */
+struct reg_t_Hash {
+	uint operator()(const reg_t& x) const {
+		return (x.segment << 3) ^ x.offset ^ (x.offset << 16);
+	}
+};
+
 // Stack pointer type
 typedef reg_t *StackPtr;
 
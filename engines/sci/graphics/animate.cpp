@@ -226,12 +226,16 @@ void GfxAnimate::fill(byte &old_picNotValid) {
 	AnimateList::iterator it;
 	const AnimateList::iterator end = _list.end();
 
+	// Keep the views of the current cast in the cache
+	_cache->unpinViews();
+
 	for (it = _list.begin(); it != end; ++it) {
 		curObject = it->object;
 		signal = it->signal;
 
 		// Get the corresponding view
 		view = _cache->getView(it->viewId);
+		_cache->pinView(it->viewId);
 
 		// adjust loop and cel, if any of those is invalid
 		//  this seems to be completely crazy code
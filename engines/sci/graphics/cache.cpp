@@ -39,6 +39,9 @@ namespace Sci {
 
 GfxCache::GfxCache(ResourceManager *resMan, GfxScreen *screen, GfxPalette *palette)
 	: _resMan(resMan), _screen(screen), _palette(palette) {
+	_maxViewMemory = DEFAULT_MAX_VIEW_MEMORY;
+	_useCounter = 0;
+	resetStats();
 }
 
 GfxCache::~GfxCache() {
@@ -48,8 +51,8 @@ GfxCache::~GfxCache() {
 
 void GfxCache::purgeFontCache() {
 	for (FontCache::iterator iter = _cachedFonts.begin(); iter != _cachedFonts.end(); ++iter) {
-		delete iter->_value;
-		iter->_value = 0;
+		delete iter->_value.font;
+		iter->_value.font = 0;
 	}
 
 	_cachedFonts.clear();
@@ -57,36 +60,125 @@ void GfxCache::purgeFontCache() {
 
 void GfxCache::purgeViewCache() {
 	for (ViewCache::iterator iter = _cachedViews.begin(); iter != _cachedViews.end(); ++iter) {
-		delete iter->_value;
-		iter->_value = 0;
+		delete iter->_value.view;
+		iter->_value.view = 0;
 	}
 
 	_cachedViews.clear();
 }
 
+void GfxCache::freeViewMemory(GuiResourceId keepViewId) {
+	// Cel bitmaps are unpacked after their view got cached, so the sizes
+	// are only added up here, when something may have to be freed
+	uint32 memory = getViewMemory();
+
+	while (memory > _maxViewMemory) {
+		ViewCache::iterator oldest = _cachedViews.end();
+		for (ViewCache::iterator iter = _cachedViews.begin(); iter != _cachedViews.end(); ++iter) {
+			if (iter->_value.pinned || iter->_key == keepViewId)
+				continue;
+			if (oldest == _cachedViews.end() || iter->_value.lastUsed < oldest->_value.lastUsed)
+				oldest = iter;
+		}
+
+		// Everything left is in use, so go over the budget for now
+		if (oldest == _cachedViews.end())
+			break;
+
+		memory -= oldest->_value.view->getMemorySize();
+		delete oldest->_value.view;
+		_cachedViews.erase(oldest);
+		_viewStats.evictions++;
+	}
+}
+
 GfxFont *GfxCache::getFont(GuiResourceId fontId) {
-	if (_cachedFonts.size() >= MAX_CACHED_FONTS)
-		purgeFontCache();
-
-	if (!_cachedFonts.contains(fontId)) {
-		// Create special SJIS font in japanese games, when font 900 is selected
-		if ((fontId == 900) && (g_sci->getLanguage() == Common::JA_JPN))
-			_cachedFonts[fontId] = new GfxFontSjis(_screen, fontId);
-		else
-			_cachedFonts[fontId] = new GfxFontFromResource(_resMan, _screen, fontId);
+	FontCache::iterator iter = _cachedFonts.find(fontId);
+	if (iter != _cachedFonts.end()) {
+		_fontStats.hits++;
+		iter->_value.lastUsed = ++_useCounter;
+		return iter->_value.font;
 	}
+	_fontStats.misses++;
+
+	if (_cachedFonts.size() >= MAX_CACHED_FONTS) {
+		FontCache::iterator oldest = _cachedFonts.begin();
+		for (iter = _cachedFonts.begin(); iter != _cachedFonts.end(); ++iter) {
+			if (iter->_value.lastUsed < oldest->_value.lastUsed)
+				oldest = iter;
+		}
+		delete oldest->_value.font;
+		_cachedFonts.erase(oldest);
+		_fontStats.evictions++;
+	}
+
+	CachedFont entry;
+	// Create special SJIS font in japanese games, when font 900 is selected
+	if ((fontId == 900) && (g_sci->getLanguage() == Common::JA_JPN))
+		entry.font = new GfxFontSjis(_screen, fontId);
+	else
+		entry.font = new GfxFontFromResource(_resMan, _screen, fontId);
+	entry.lastUsed = ++_useCounter;
+	_cachedFonts[fontId] = entry;
 
-	return _cachedFonts[fontId];
+	return entry.font;
 }
 
 GfxView *GfxCache::getView(GuiResourceId viewId) {
-	if (_cachedViews.size() >= MAX_CACHED_VIEWS)
-		purgeViewCache();
+	ViewCache::iterator iter = _cachedViews.find(viewId);
+	if (iter != _cachedViews.end()) {
+		_viewStats.hits++;
+		iter->_value.lastUsed = ++_useCounter;
+		return iter->_value.view;
+	}
+	_viewStats.misses++;
+
+	CachedView entry;
+	entry.view = new GfxView(_resMan, _screen, _palette, viewId);
+	entry.lastUsed = ++_useCounter;
+	entry.pinned = false;
+	_cachedViews[viewId] = entry;
+
+	freeViewMemory(viewId);
+
+	return entry.view;
+}
 
-	if (!_cachedViews.contains(viewId))
-		_cachedViews[viewId] = new GfxView(_resMan, _screen, _palette, viewId);
+void GfxCache::pinView(GuiResourceId viewId) {
+	ViewCache::iterator iter = _cachedViews.find(viewId);
+	if (iter != _cachedViews.end())
+		iter->_value.pinned = true;
+}
+
+void GfxCache::unpinViews() {
+	for (ViewCache::iterator iter = _cachedViews.begin(); iter != _cachedViews.end(); ++iter)
+		iter->_value.pinned = false;
+}
+
+void GfxCache::setMaxViewMemory(uint32 maxMemory) {
+	_maxViewMemory = maxMemory;
+	freeViewMemory(-1);
+}
+
+uint32 GfxCache::getViewMemory() {
+	uint32 memory = 0;
+	for (ViewCache::iterator iter = _cachedViews.begin(); iter != _cachedViews.end(); ++iter)
+		memory += iter->_value.view->getMemorySize();
+	return memory;
+}
+
+uint GfxCache::getPinnedViewCount() const {
+	uint count = 0;
+	for (ViewCache::const_iterator iter = _cachedViews.begin(); iter != _cachedViews.end(); ++iter) {
+		if (iter->_value.pinned)
+			count++;
+	}
+	return count;
+}
 
-	return _cachedViews[viewId];
+void GfxCache::resetStats() {
+	memset(&_viewStats, 0, sizeof(_viewStats));
+	memset(&_fontStats, 0, sizeof(_fontStats));
 }
 
 int16 GfxCache::kernelViewGetCelWidth(GuiResourceId viewId, int16 loopNo, int16 celNo) {
@@ -33,28 +33,80 @@ namespace Sci {
 class GfxFont;
 class GfxView;
 
-typedef Common::HashMap<int, GfxFont *> FontCache;
-typedef Common::HashMap<int, GfxView *> ViewCache;
+struct CachedFont {
+	GfxFont *font;
+	uint32 lastUsed;
+};
+
+struct CachedView {
+	GfxView *view;
+	uint32 lastUsed;
+	bool pinned;
+};
+
+typedef Common::HashMap<int, CachedFont> FontCache;
+typedef Common::HashMap<int, CachedView> ViewCache;
 
 /**
  * Cache class, handles caching of views/fonts
+ *
+ * Views are kept within a memory budget, which covers the view objects and
+ * their unpacked cel bitmaps. Once it is exceeded, the least recently used
+ * views are freed, except for the pinned ones, which are drawn on the
+ * current screen. Fonts are limited by count and also freed least recently
+ * used first.
  */
 class GfxCache {
 public:
+	/** Statistics of a cache */
+	struct CacheStats {
+		uint32 hits;		///< Lookups of views or fonts which were cached
+		uint32 misses;		///< Lookups which had to load the view or font
+		uint32 evictions;	///< Views or fonts freed to stay within the limit
+	};
+
 	GfxCache(ResourceManager *resMan, GfxScreen *screen, GfxPalette *palette);
 	~GfxCache();
 
 	GfxFont *getFont(GuiResourceId fontId);
 	GfxView *getView(GuiResourceId viewId);
 
+	/**
+	 * Keep a cached view until unpinViews() is called, because it is
+	 * used by the current screen.
+	 */
+	void pinView(GuiResourceId viewId);
+	void unpinViews();
+
 	int16 kernelViewGetCelWidth(GuiResourceId viewId, int16 loopNo, int16 celNo);
 	int16 kernelViewGetCelHeight(GuiResourceId viewId, int16 loopNo, int16 celNo);
 	int16 kernelViewGetLoopCount(GuiResourceId viewId);
 	int16 kernelViewGetCelCount(GuiResourceId viewId, int16 loopNo);
 
+	void setMaxViewMemory(uint32 maxMemory);
+	uint32 getMaxViewMemory() const { return _maxViewMemory; }
+	uint32 getViewMemory();
+	uint getViewCount() const { return _cachedViews.size(); }
+	uint getPinnedViewCount() const;
+	uint getFontCount() const { return _cachedFonts.size(); }
+
+	const CacheStats &getViewStats() const { return _viewStats; }
+	const CacheStats &getFontStats() const { return _fontStats; }
+	void resetStats();
+
 private:
+	// Default number of bytes used for cached views
+	enum {
+#ifndef __DS__
+		DEFAULT_MAX_VIEW_MEMORY = 2 * 1024 * 1024	// 2MB
+#else
+		DEFAULT_MAX_VIEW_MEMORY = 256 * 1024	// 256KB
+#endif
+	};
+
 	void purgeFontCache();
 	void purgeViewCache();
+	void freeViewMemory(GuiResourceId keepViewId);
 
 	ResourceManager *_resMan;
 	GfxScreen *_screen;
@@ -62,6 +114,11 @@ private:
 
 	FontCache _cachedFonts;
 	ViewCache _cachedViews;
+
+	uint32 _maxViewMemory;
+	uint32 _useCounter;
+	CacheStats _viewStats;
+	CacheStats _fontStats;
 };
 
 } // End of namespace Sci
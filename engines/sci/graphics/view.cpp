@@ -324,6 +324,19 @@ uint16 GfxView::getCelCount(int16 loopNo) const {
 	return _loop[loopNo].celCount;
 }
 
+uint32 GfxView::getMemorySize() const {
+	uint32 size = sizeof(GfxView) + _loopCount * sizeof(LoopInfo);
+	for (uint16 loopNo = 0; loopNo < _loopCount; loopNo++) {
+		size += _loop[loopNo].celCount * sizeof(CelInfo);
+		for (uint16 celNo = 0; celNo < _loop[loopNo].celCount; celNo++) {
+			const CelInfo &cel = _loop[loopNo].cel[celNo];
+			if (cel.rawBitmap)
+				size += cel.width * cel.height;
+		}
+	}
+	return size;
+}
+
 Palette *GfxView::getPalette() {
 	return _embeddedPal ? &_viewPalette : NULL;
 }
@@ -73,6 +73,8 @@ public:
 	void drawScaled(const Common::Rect &rect, const Common::Rect &clipRect, const Common::Rect &clipRectTranslated, int16 loopNo, int16 celNo, byte priority, int16 scaleX, int16 scaleY);
 	uint16 getLoopCount() const { return _loopCount; }
 	uint16 getCelCount(int16 loopNo) const;
+	/** Memory used by the view and its unpacked cels, without the resource */
+	uint32 getMemorySize() const;
 	Palette *getPalette();
 
 	bool isScaleable();
@@ -28,6 +28,7 @@
 #include "common/file.h"
 #include "common/fs.h"
 #include "common/macresman.h"
+#include "common/system.h"
 
 #include "sci/resource.h"
 #include "sci/resource_intern.h"
@@ -188,6 +189,8 @@ Resource::Resource(ResourceManager *resMan, ResourceId id) : _resMan(resMan), _i
 	_fileOffset = 0;
 	_status = kResStatusNoMalloc;
 	_lockers = 0;
+	_loadCost = 0;
+	_cachePriority = 0;
 	_source = NULL;
 	_header = NULL;
 	_headerSize = 0;
@@ -367,7 +370,18 @@ Common::SeekableReadStream *ResourceManager::getVolumeFile(ResourceSource *sourc
 }
 
 void ResourceManager::loadResource(Resource *res) {
+	const uint32 startTime = g_system->getMillis();
+
+	// Sources which decompress their data overwrite this with a better
+	// estimate, see Resource::decompress()
+	res->_loadCost = 0;
 	res->_source->loadResource(this, res);
+	if (!res->_loadCost)
+		res->_loadCost = res->size;
+
+	_cacheStats.misses++;
+	_cacheStats.bytesLoaded += res->size;
+	_cacheStats.loadTime += g_system->getMillis() - startTime;
 }
 
 
@@ -887,6 +901,10 @@ void ResourceManager::init(bool initFromFallbackDetector) {
 	_memoryLocked = 0;
 	_memoryLRU = 0;
 	_LRU.clear();
+	_maxMemory = DEFAULT_MAX_MEMORY;
+	_cacheInflation = 0;
+	memset(_pinnedTypes, 0, sizeof(_pinnedTypes));
+	resetCacheStats();
 	_resMap.clear();
 	_audioMapSCI1 = NULL;
 
@@ -998,6 +1016,12 @@ void ResourceManager::addToLRU(Resource *res) {
 	}
 	_LRU.push_front(res);
 	_memoryLRU += res->size;
+
+	// The eviction priority follows the GreedyDual-Size algorithm: resources
+	// which are expensive to load relative to the memory they take up are
+	// kept longer. Adding the priority of the last evicted resource ages the
+	// resources which have not been used since.
+	res->_cachePriority = _cacheInflation + ((LOAD_COST_OVERHEAD + res->_loadCost) << 4) / MAX<uint32>(res->size, 1);
 #if SCI_VERBOSE_RESMAN
 	debug("Adding %s.%03d (%d bytes) to lru control: %d bytes total",
 	      getResourceTypeName(res->type), res->number, res->size,
@@ -1024,15 +1048,48 @@ void ResourceManager::printLRU() {
 }
 
 void ResourceManager::freeOldResources() {
-	while (MAX_MEMORY < _memoryLRU) {
+	while (_maxMemory < (uint32)_memoryLRU) {
 		assert(!_LRU.empty());
-		Resource *goner = *_LRU.reverse_begin();
+
+		// Pick the resource with the lowest priority, preferring resources
+		// of types which aren't pinned. On ties, the least recently used
+		// resource goes first.
+		Resource *goner = 0;
+		bool gonerPinned = true;
+		for (Common::List<Resource *>::iterator it = _LRU.reverse_begin(); it != _LRU.end(); --it) {
+			Resource *res = *it;
+			const bool pinned = _pinnedTypes[res->getType()];
+			if (!goner || (gonerPinned && !pinned) || (pinned == gonerPinned && res->_cachePriority < goner->_cachePriority)) {
+				goner = res;
+				gonerPinned = pinned;
+			}
+		}
+
+		_cacheInflation = MAX(_cacheInflation, goner->_cachePriority);
 		removeFromLRU(goner);
 		goner->unalloc();
+		_cacheStats.evictions++;
 #ifdef SCI_VERBOSE_RESMAN
 		debug("resMan-debug: LRU: Freeing %s.%03d (%d bytes)", getResourceTypeName(goner->type), goner->number, goner->size);
 #endif
 	}
+
+	// Rebase the priorities long before they could overflow
+	if (_cacheInflation >= 0x40000000) {
+		for (Common::List<Resource *>::iterator it = _LRU.begin(); it != _LRU.end(); ++it)
+			(*it)->_cachePriority -= MIN((*it)->_cachePriority, _cacheInflation);
+		_cacheInflation = 0;
+	}
+}
+
+void ResourceManager::setMaxMemory(uint32 maxMemory) {
+	_maxMemory = maxMemory;
+	freeOldResources();
+}
+
+void ResourceManager::setResourceTypePinned(ResourceType type, bool pinned) {
+	assert(type < kResourceTypeInvalid);
+	_pinnedTypes[type] = pinned;
 }
 
 Common::List<ResourceId> *ResourceManager::listResources(ResourceType type, int mapNumber) {
@@ -1056,8 +1113,11 @@ Resource *ResourceManager::findResource(ResourceId id, bool lock) {
 
 	if (retval->_status == kResStatusNoMalloc)
 		loadResource(retval);
-	else if (retval->_status == kResStatusEnqueued)
-		removeFromLRU(retval);
+	else {
+		_cacheStats.hits++;
+		if (retval->_status == kResStatusEnqueued)
+			removeFromLRU(retval);
+	}
 	// Unless an error occurred, the resource is now either
 	// locked or allocated, but never queued or freed.
 
@@ -1959,6 +2019,12 @@ int Resource::decompress(ResVersion volVersion, Common::SeekableReadStream *file
 		return SCI_ERROR_UNKNOWN_COMPRESSION;
 	}
 
+	// Compressed resources are more expensive to reload, which is taken
+	// into account by the cache
+	_loadCost = szPacked;
+	if (compression != kCompNone)
+		_loadCost += size * ResourceManager::LOAD_COST_DECOMPRESSION;
+
 	data = new byte[size];
 	_status = kResStatusAllocated;
 	errorNum = data ? dec->unpack(file, data, szPacked, size) : SCI_ERROR_RESOURCE_TOO_BIG;
@@ -242,6 +242,8 @@ protected:
 	int32 _fileOffset; /**< Offset in file */
 	ResourceStatus _status;
 	uint16 _lockers; /**< Number of places where this resource was locked */
+	uint32 _loadCost; /**< Estimated cost of loading this resource, see ResourceManager::loadResource() */
+	uint32 _cachePriority; /**< Eviction priority while in the LRU, see ResourceManager::addToLRU() */
 	ResourceSource *_source;
 	ResourceManager *_resMan;
 
@@ -338,6 +340,42 @@ public:
 	const char *getVolVersionDesc() const { return versionDescription(_volVersion); }
 	ResVersion getVolVersion() const { return _volVersion; }
 
+	// Estimated costs of loading a resource, in "bytes read" (see loadResource())
+	enum {
+		LOAD_COST_OVERHEAD = 4096,	///< Cost of opening/seeking, independent of the size
+		LOAD_COST_DECOMPRESSION = 4	///< Cost of decompressing one byte
+	};
+
+	/**
+	 * Sets the amount of memory which may be used for caching resources
+	 * which aren't locked.
+	 * @param maxMemory	the cache budget in bytes
+	 */
+	void setMaxMemory(uint32 maxMemory);
+	uint32 getMaxMemory() const { return _maxMemory; }
+
+	/**
+	 * Pins or unpins the resources of a type in the cache. Pinned resources
+	 * are only evicted once no unpinned resources are left in the cache.
+	 */
+	void setResourceTypePinned(ResourceType type, bool pinned);
+	bool isResourceTypePinned(ResourceType type) const { return _pinnedTypes[type]; }
+
+	/** Statistics of the resource cache */
+	struct CacheStats {
+		uint32 hits;	///< Lookups of resources which were in memory already
+		uint32 misses;	///< Lookups which had to load the resource
+		uint32 evictions;	///< Resources freed to stay within the budget
+		uint32 bytesLoaded;	///< Total size of all loaded resources
+		uint32 loadTime;	///< Total time spent loading and decompressing, in ms
+	};
+
+	const CacheStats &getCacheStats() const { return _cacheStats; }
+	void resetCacheStats() { memset(&_cacheStats, 0, sizeof(_cacheStats)); }
+	int getLockedMemory() const { return _memoryLocked; }
+	int getLRUMemory() const { return _memoryLRU; }
+	uint getLRUSize() const { return _LRU.size(); }
+
 	/**
 	 * Adds the appropriate GM patch from the Sierra MIDI utility as 4.pat, without
 	 * requiring the user to rename the file to 4.pat. Thus, the original Sierra
@@ -383,12 +421,16 @@ public:
 	ResourceType convertResType(byte type);
 
 protected:
-	// Maximum number of bytes to allow being allocated for resources
+	// Default number of bytes to allow being allocated for resources
 	// Note: maxMemory will not be interpreted as a hard limit, only as a restriction
 	// for resources which are not explicitly locked. However, a warning will be
 	// issued whenever this limit is exceeded.
 	enum {
-		MAX_MEMORY = 256 * 1024	// 256KB
+#ifndef __DS__
+		DEFAULT_MAX_MEMORY = 4 * 1024 * 1024	// 4MB
+#else
+		DEFAULT_MAX_MEMORY = 256 * 1024	// 256KB
+#endif
 	};
 
 	ViewType _viewType; // Used to determine if the game has EGA or VGA graphics
@@ -396,6 +438,10 @@ protected:
 	int _memoryLocked;	///< Amount of resource bytes in locked memory
 	int _memoryLRU;		///< Amount of resource bytes under LRU control
 	Common::List<Resource *> _LRU; ///< Last Resource Used list
+	uint32 _maxMemory;	///< Maximum amount of resource bytes under LRU control
+	uint32 _cacheInflation;	///< Priority of the last evicted resource, see addToLRU()
+	bool _pinnedTypes[kResourceTypeInvalid + 1];
+	CacheStats _cacheStats;
 	ResourceMap _resMap;
 	Common::List<Common::File *> _volumeFiles; ///< list of opened volume files
 	ResourceSource *_audioMapSCI1; ///< Currently loaded audio map for SCI1
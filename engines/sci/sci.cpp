@@ -40,6 +40,7 @@
 #include "sci/engine/features.h"
 #include "sci/engine/message.h"
 #include "sci/engine/object.h"
+#include "sci/engine/gc.h"
 #include "sci/engine/state.h"
 #include "sci/engine/kernel.h"
 #include "sci/engine/script.h"	// for script_adjust_opcode_formats
@@ -177,6 +178,9 @@ SciEngine::~SciEngine() {
 	delete _gfxMacIconBar;
 
 	delete _eventMan;
+	// Lift the write barrier of an incremental collection while the
+	// segment manager is still there
+	abort_gc(_gamestate);
 	delete _gamestate->_segMan;
 	delete _gamestate;
 	delete _resMan;	// should be deleted last
@@ -192,12 +196,23 @@ Common::Error SciEngine::run() {
 	ConfMan.registerDefault("sci_originalsaveload", "false");
 	ConfMan.registerDefault("native_fb01", "false");
 	ConfMan.registerDefault("windows_cursors", "false");	// Windows cursors for KQ6 Windows
+	ConfMan.registerDefault("sci_resource_cache_pin", "false");
 
 	_resMan = new ResourceManager();
 	assert(_resMan);
 	_resMan->addAppropriateSources();
 	_resMan->init();
 
+	// Resource cache settings, mostly useful for tuning on low memory systems
+	if (ConfMan.hasKey("sci_resource_cache_size"))
+		_resMan->setMaxMemory(ConfMan.getInt("sci_resource_cache_size") * 1024);
+	if (ConfMan.getBool("sci_resource_cache_pin")) {
+		_resMan->setResourceTypePinned(kResourceTypeView, true);
+		_resMan->setResourceTypePinned(kResourceTypePic, true);
+		_resMan->setResourceTypePinned(kResourceTypeScript, true);
+		_resMan->setResourceTypePinned(kResourceTypeHeap, true);
+	}
+
 	// TODO: Add error handling. Check return values of addAppropriateSources
 	// and init. We first have to *add* sensible return values, though ;).
 /*
@@ -601,6 +616,8 @@ void SciEngine::initGraphics() {
 
 	_gfxPalette = new GfxPalette(_resMan, _gfxScreen, paletteMerging);
 	_gfxCache = new GfxCache(_resMan, _gfxScreen, _gfxPalette);
+	if (ConfMan.hasKey("sci_view_cache_size"))
+		_gfxCache->setMaxViewMemory(ConfMan.getInt("sci_view_cache_size") * 1024);
 	_gfxCursor = new GfxCursor(_resMan, _gfxPalette, _gfxScreen);
 
 #ifdef ENABLE_SCI32
@@ -40,6 +40,8 @@
 
 namespace Scumm {
 
+extern const char *resTypeFromId(int id);
+
 void debugC(int channel, const char *s, ...) {
 	char buf[STRINGBUFLEN];
 	va_list va;
@@ -101,6 +103,9 @@ ScummDebugger::ScummDebugger(ScummEngine *s)
 	DCmd_Register("imuse",     WRAP_METHOD(ScummDebugger, Cmd_IMuse));
 
 	DCmd_Register("resetcursors",    WRAP_METHOD(ScummDebugger, Cmd_ResetCursors));
+
+	DCmd_Register("stripcache", WRAP_METHOD(ScummDebugger, Cmd_StripCache));
+	DCmd_Register("resources", WRAP_METHOD(ScummDebugger, Cmd_Resources));
 }
 
 ScummDebugger::~ScummDebugger() {
@@ -868,4 +873,61 @@ bool ScummDebugger::Cmd_ResetCursors(int argc, const char **argv) {
 	return false;
 }
 
+bool ScummDebugger::Cmd_StripCache(int argc, const char **argv) {
+	Gdi *gdi = _vm->_gdi;
+
+	if (argc > 1) {
+		if (!strcmp(argv[1], "flush")) {
+			gdi->flushStripCache();
+		} else if (!strcmp(argv[1], "reset")) {
+			gdi->resetStripCacheStats();
+		} else if (!strcmp(argv[1], "budget") && argc > 2) {
+			gdi->setStripCacheBudget(atoi(argv[2]) * 1024);
+		} else {
+			DebugPrintf("Syntax: stripcache [flush | reset | budget <KB>]\n");
+			return true;
+		}
+	}
+
+	const Gdi::StripCacheStats &stats = gdi->getStripCacheStats();
+	DebugPrintf("Strip cache: %d strips, %d of %d KB\n", gdi->getStripCacheEntryCount(),
+		gdi->getStripCacheSize() / 1024, gdi->getStripCacheBudget() / 1024);
+	DebugPrintf("  hits %d, misses %d, evictions %d, flushes %d\n",
+		stats.hits, stats.misses, stats.evictions, stats.flushes);
+
+	return true;
+}
+
+bool ScummDebugger::Cmd_Resources(int argc, const char **argv) {
+	ResourceManager *res = _vm->_res;
+
+	if (argc > 1) {
+		if (!strcmp(argv[1], "reset")) {
+			res->resetStats();
+		} else if (!strcmp(argv[1], "budget") && argc > 2) {
+			int budget = MAX(atoi(argv[2]), 550) * 1024;
+			res->setHeapThreshold(MAX(400000, budget / 2), budget);
+		} else {
+			DebugPrintf("Syntax: resources [reset | budget <KB>]\n");
+			return true;
+		}
+	}
+
+	uint weights[rtNumTypes];
+	res->getExpiryWeights(weights);
+
+	DebugPrintf("Resource heap: %d of %d KB\n", res->getAllocatedSize() / 1024, res->getHeapThreshold() / 1024);
+	DebugPrintf("Type           Hits  Misses Reloads Expired Load ms Load KB  Aging\n");
+	for (int i = rtFirst; i <= rtLast; i++) {
+		const ResourceManager::TypeStats &stats = res->stats[i];
+		if (!res->mode[i] && !stats.hits && !stats.misses)
+			continue;
+		DebugPrintf("%-12s %6d %7d %7d %7d %7d %7d %5d%%\n", resTypeFromId(i),
+			stats.hits, stats.misses, stats.reloads, stats.expired, stats.loadTime, stats.loadSize / 1024,
+			weights[i] * 100 / ResourceManager::kExpiryWeightOne);
+	}
+
+	return true;
+}
+
 } // End of namespace Scumm
@@ -70,6 +70,9 @@ private:
 
 	bool Cmd_ResetCursors(int argc, const char **argv);
 
+	bool Cmd_StripCache(int argc, const char **argv);
+	bool Cmd_Resources(int argc, const char **argv);
+
 	void printBox(int box);
 	void drawBox(int box);
 };
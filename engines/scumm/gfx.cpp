@@ -195,6 +195,9 @@ static const TransitionEffect transitionEffects[6] = {
 
 };
 
+enum {
+	kStripCacheDefaultBudget = 2 * 1024 * 1024
+};
 
 Gdi::Gdi(ScummEngine *vm) : _vm(vm) {
 	_numZBuffer = 0;
@@ -210,9 +213,22 @@ Gdi::Gdi(ScummEngine *vm) : _vm(vm) {
 	_zbufferDisabled = false;
 	_objectMode = false;
 	_distaff = false;
+
+	_stripCache = 0;
+	_stripCacheCount = 0;
+	_stripCacheActive = false;
+	_stripCacheImage = 0;
+	_stripCacheRoom = 0;
+	_stripCacheBytesPerPixel = 0;
+	memset(_stripCachePalette, 0, sizeof(_stripCachePalette));
+	_stripCacheSize = 0;
+	_stripCacheBudget = kStripCacheDefaultBudget;
+	_stripCacheClock = 0;
+	memset(&_stripCacheStats, 0, sizeof(_stripCacheStats));
 }
 
 Gdi::~Gdi() {
+	flushStripCache();
 }
 
 GdiNES::GdiNES(ScummEngine *vm) : Gdi(vm) {
@@ -249,6 +265,8 @@ Gdi16Bit::Gdi16Bit(ScummEngine *vm) : Gdi(vm) {
 #endif
 
 void Gdi::init() {
+	flushStripCache();
+
 	_numStrips = _vm->_screenWidth / 8;
 
 	// Increase the number of screen strips by one; needed for smooth scrolling
@@ -266,6 +284,7 @@ void Gdi::init() {
 }
 
 void Gdi::roomChanged(byte *roomptr) {
+	flushStripCache();
 }
 
 void GdiNES::roomChanged(byte *roomptr) {
@@ -996,7 +1015,7 @@ void ScummEngine::redrawBGStrip(int start, int num) {
 	else
 		room = getResourceAddress(rtRoom, _roomResource);
 
-	_gdi->drawBitmap(room + _IM00_offs, &_virtscr[kMainVirtScreen], s, 0, _roomWidth, _virtscr[kMainVirtScreen].h, s, num, 0);
+	_gdi->drawBitmap(room + _IM00_offs, &_virtscr[kMainVirtScreen], s, 0, _roomWidth, _virtscr[kMainVirtScreen].h, s, num, Gdi::dbCacheStrips);
 }
 
 void ScummEngine::restoreBackground(Common::Rect rect, byte backColor) {
@@ -1762,6 +1781,8 @@ void Gdi::drawBitmap(const byte *ptr, VirtScreen *vs, int x, const int y, const
 	_objectMode = (flag & dbObjectMode) == dbObjectMode;
 	prepareDrawBitmap(ptr, vs, x, y, width, height, stripnr, numstrip);
 
+	_stripCacheActive = (flag & dbCacheStrips) && prepareStripCache(ptr, vs, height);
+
 	sx = x - vs->xstart / 8;
 	if (sx < 0) {
 		numstrip -= -sx;
@@ -1834,6 +1855,130 @@ void Gdi::drawBitmap(const byte *ptr, VirtScreen *vs, int x, const int y, const
 		}
 #endif
 	}
+
+	_stripCacheActive = false;
+}
+
+/**
+ * Check whether the strip cache can be used for drawing the room image ptr,
+ * and drop its contents if they were decoded from another image or with
+ * another palette.
+ */
+bool Gdi::prepareStripCache(const byte *ptr, const VirtScreen *vs, int height) {
+	if (!_stripCacheBudget)
+		return false;
+
+	const byte *palette = _roomPalette;
+	uint paletteSize = 256;
+#ifdef USE_RGB_COLOR
+	if (_vm->_game.features & GF_16BIT_COLOR) {
+		palette = _vm->_hePalettes + 2048;
+		paletteSize = 512;
+	}
+#endif
+
+	if (ptr != _stripCacheImage || _vm->_roomResource != _stripCacheRoom ||
+			vs->bytesPerPixel != _stripCacheBytesPerPixel || memcmp(palette, _stripCachePalette, paletteSize)) {
+		flushStripCache();
+
+		_stripCacheImage = ptr;
+		_stripCacheRoom = _vm->_roomResource;
+		_stripCacheBytesPerPixel = vs->bytesPerPixel;
+		memcpy(_stripCachePalette, palette, paletteSize);
+	}
+
+	const int count = MAX(_vm->_roomWidth, (int)vs->w) / 8;
+	if (count > _stripCacheCount) {
+		_stripCache = (StripCacheEntry *)realloc(_stripCache, count * sizeof(StripCacheEntry));
+		memset(_stripCache + _stripCacheCount, 0, (count - _stripCacheCount) * sizeof(StripCacheEntry));
+		_stripCacheCount = count;
+	}
+
+	return true;
+}
+
+Gdi::StripCacheEntry *Gdi::getStripCacheEntry(int stripnr, int height) {
+	if (stripnr < 0 || stripnr >= _stripCacheCount)
+		return 0;
+
+	StripCacheEntry *entry = &_stripCache[stripnr];
+	if (entry->height != height) {
+		freeStripCacheEntry(*entry);
+		entry->height = height;
+	}
+
+	entry->lastUse = ++_stripCacheClock;
+	return entry;
+}
+
+/**
+ * Make room for size more bytes in the strip cache, by dropping the least
+ * recently used strips other than keep.
+ */
+bool Gdi::reserveStripCache(uint32 size, const StripCacheEntry *keep) {
+	if (size > _stripCacheBudget)
+		return false;
+
+	while (_stripCacheSize + size > _stripCacheBudget) {
+		StripCacheEntry *oldest = 0;
+		for (int i = 0; i < _stripCacheCount; i++) {
+			StripCacheEntry *entry = &_stripCache[i];
+			if (entry != keep && (entry->pixels || entry->masks) && (!oldest || entry->lastUse < oldest->lastUse))
+				oldest = entry;
+		}
+
+		if (!oldest)
+			return false;
+
+		freeStripCacheEntry(*oldest);
+		_stripCacheStats.evictions++;
+	}
+
+	return true;
+}
+
+void Gdi::freeStripCacheEntry(StripCacheEntry &entry) {
+	if (entry.pixels) {
+		free(entry.pixels);
+		_stripCacheSize -= 8 * _stripCacheBytesPerPixel * entry.height;
+		entry.pixels = 0;
+	}
+
+	if (entry.masks) {
+		free(entry.masks);
+		_stripCacheSize -= entry.numMasks * entry.height;
+		entry.masks = 0;
+	}
+}
+
+void Gdi::flushStripCache() {
+	if (!_stripCache)
+		return;
+
+	for (int i = 0; i < _stripCacheCount; i++)
+		freeStripCacheEntry(_stripCache[i]);
+
+	free(_stripCache);
+	_stripCache = 0;
+	_stripCacheCount = 0;
+	_stripCacheImage = 0;
+	_stripCacheStats.flushes++;
+	assert(_stripCacheSize == 0);
+}
+
+void Gdi::setStripCacheBudget(uint32 bytes) {
+	_stripCacheBudget = bytes;
+	if (!reserveStripCache(0, 0))
+		flushStripCache();
+}
+
+int Gdi::getStripCacheEntryCount() const {
+	int count = 0;
+	for (int i = 0; i < _stripCacheCount; i++) {
+		if (_stripCache[i].pixels || _stripCache[i].masks)
+			count++;
+	}
+	return count;
 }
 
 bool Gdi::drawStrip(byte *dstPtr, VirtScreen *vs, int x, int y, const int width, const int height,
@@ -1859,7 +2004,38 @@ bool Gdi::drawStrip(byte *dstPtr, VirtScreen *vs, int x, int y, const int width,
 	}
 	assertRange(0, offset, smapLen-1, "screen strip");
 
-	return decompressBitmap(dstPtr, vs->pitch, smap_ptr + offset, height);
+	StripCacheEntry *entry = _stripCacheActive ? getStripCacheEntry(stripnr, height) : 0;
+	const int rowSize = 8 * vs->bytesPerPixel;
+
+	if (entry && entry->pixels) {
+		_stripCacheStats.hits++;
+		const byte *src = entry->pixels;
+		for (int h = 0; h < height; h++) {
+			memcpy(dstPtr, src, rowSize);
+			dstPtr += vs->pitch;
+			src += rowSize;
+		}
+		return false;
+	}
+
+	const bool transpStrip = decompressBitmap(dstPtr, vs->pitch, smap_ptr + offset, height);
+
+	// Transparent strips depend on what was drawn before, so only opaque
+	// ones can be cached
+	if (entry) {
+		_stripCacheStats.misses++;
+		if (!transpStrip && reserveStripCache(rowSize * height, entry)) {
+			byte *dst = entry->pixels = (byte *)malloc(rowSize * height);
+			_stripCacheSize += rowSize * height;
+			for (int h = 0; h < height; h++) {
+				memcpy(dst, dstPtr, rowSize);
+				dstPtr += vs->pitch;
+				dst += rowSize;
+			}
+		}
+	}
+
+	return transpStrip;
 }
 
 bool GdiNES::drawStrip(byte *dstPtr, VirtScreen *vs, int x, int y, const int width, const int height,
@@ -1931,6 +2107,27 @@ void Gdi::decodeMask(int x, int y, const int width, const int height,
 				decompressMaskImg(mask_ptr, z_plane_ptr, height);
 		}
 	} else {
+		// The masks are cached when they replace the buffer contents
+		// completely
+		StripCacheEntry *entry = 0;
+		if (_stripCacheActive && numzbuf > 1 && !tmsk_ptr && !(transpStrip && (flag & dbAllowMaskOr))) {
+			entry = getStripCacheEntry(stripnr, height);
+			for (i = 1; entry && i < numzbuf; i++) {
+				if (!zplane_list[i])
+					entry = 0;
+			}
+		}
+
+		if (entry && entry->masks && entry->numMasks == numzbuf - 1) {
+			const byte *src = entry->masks;
+			for (i = 1; i < numzbuf; i++) {
+				mask_ptr = getMaskBuffer(x, y, i);
+				for (int h = 0; h < height; h++)
+					mask_ptr[h * _numStrips] = *src++;
+			}
+			return;
+		}
+
 		for (i = 1; i < numzbuf; i++) {
 			uint32 offs;
 
@@ -1968,6 +2165,25 @@ void Gdi::decodeMask(int x, int y, const int width, const int height,
 						mask_ptr[h * _numStrips] = 0;
 			}
 		}
+
+		if (entry) {
+			if (entry->masks) {
+				free(entry->masks);
+				_stripCacheSize -= entry->numMasks * entry->height;
+				entry->masks = 0;
+			}
+
+			if (reserveStripCache((numzbuf - 1) * height, entry)) {
+				byte *dst = entry->masks = (byte *)malloc((numzbuf - 1) * height);
+				entry->numMasks = numzbuf - 1;
+				_stripCacheSize += entry->numMasks * height;
+				for (i = 1; i < numzbuf; i++) {
+					mask_ptr = getMaskBuffer(x, y, i);
+					for (int h = 0; h < height; h++)
+						*dst++ = mask_ptr[h * _numStrips];
+				}
+			}
+		}
 	}
 }
 
@@ -3259,6 +3475,38 @@ void Gdi::drawStripHE(byte *dst, int dstPitch, const byte *src, int width, int h
 	shift = 24;
 
 	int x = width;
+
+	// Opaque 8-bit strips are written directly, without going through
+	// writeRoomColor() for every pixel
+	if (!transpCheck && _vm->_bytesPerPixel == 1) {
+		byte pixel = _roomPalette[(color + _paletteMod) & 0xFF];
+		while (1) {
+			*dst++ = pixel;
+			if (--x == 0) {
+				x = width;
+				dst += dstPitch - width;
+				if (--height == 0)
+					return;
+			}
+			FILL_BITS(1);
+			if (READ_BIT) {
+				FILL_BITS(1);
+				if (READ_BIT) {
+					FILL_BITS(3);
+					color += delta_color[data & 7];
+					shift -= 3;
+					data >>= 3;
+				} else {
+					FILL_BITS(_decomp_shr);
+					color = data & _decomp_mask;
+					shift -= _decomp_shr;
+					data >>= _decomp_shr;
+				}
+				pixel = _roomPalette[(color + _paletteMod) & 0xFF];
+			}
+		}
+	}
+
 	while (1) {
 		if (!transpCheck || color != _transparentColor)
 			writeRoomColor(dst, color);
@@ -3317,11 +3565,16 @@ void Gdi::drawStrip3DO(byte *dst, int dstPitch, const byte *src, int height, con
 					dst += dstPitch - 8; // Next row
 			}
 		} else {
+			// Fill the run row by row
 			byte color = *src++;
-			for (; len > 0; len--, dst++) {
-				if (!transpCheck || color != _transparentColor)
-					*dst = _roomPalette[color];
-				curSize++;
+			const bool transparent = transpCheck && color == _transparentColor;
+			while (len > 0) {
+				const int count = MIN(len, 8 - (curSize & 7));
+				if (!transparent)
+					memset(dst, _roomPalette[color], count);
+				dst += count;
+				curSize += count;
+				len -= count;
 				if (!(curSize & 7))
 					dst += dstPitch - 8; // Next row
 			}
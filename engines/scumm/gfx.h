@@ -195,6 +195,31 @@ protected:
 	/** Flag which is true when an object is being rendered, false otherwise. */
 	bool _objectMode;
 
+	/**
+	 * Cache of decoded room background strips and their z-plane masks, so
+	 * that redrawing a strip, e.g. while scrolling, only has to copy it.
+	 * It only holds strips of the current room image and is dropped as
+	 * soon as the image or the palette it was decoded with changes.
+	 */
+	struct StripCacheEntry {
+		byte *pixels;	///< 8 * height pixels, 0 if not cached
+		byte *masks;	///< height bytes for each of z-planes 1 and up, 0 if not cached
+		int height;
+		int numMasks;
+		uint32 lastUse;
+	};
+
+	StripCacheEntry *_stripCache;
+	int _stripCacheCount;
+	bool _stripCacheActive;
+	const byte *_stripCacheImage;
+	int _stripCacheRoom;
+	int _stripCacheBytesPerPixel;
+	byte _stripCachePalette[512];
+	uint32 _stripCacheSize;
+	uint32 _stripCacheBudget;
+	uint32 _stripCacheClock;
+
 public:
 	/** Flag which is true when loading objects or titles for distaff, in PCEngine version of Loom. */
 	bool _distaff;
@@ -231,6 +256,12 @@ protected:
 	/* Misc */
 	int getZPlanes(const byte *smap_ptr, const byte *zplane_list[9], bool bmapImage) const;
 
+	/* Strip cache */
+	bool prepareStripCache(const byte *ptr, const VirtScreen *vs, int height);
+	StripCacheEntry *getStripCacheEntry(int stripnr, int height);
+	bool reserveStripCache(uint32 size, const StripCacheEntry *keep);
+	void freeStripCacheEntry(StripCacheEntry &entry);
+
 	virtual bool drawStrip(byte *dstPtr, VirtScreen *vs,
 					int x, int y, const int width, const int height,
 					int stripnr, const byte *smap_ptr);
@@ -269,8 +300,28 @@ public:
 	enum DrawBitmapFlags {
 		dbAllowMaskOr   = 1 << 0,
 		dbDrawMaskOnAll = 1 << 1,
-		dbObjectMode    = 2 << 2
+		dbObjectMode    = 2 << 2,
+		dbCacheStrips   = 1 << 4	///< Room background, may use the strip cache
+	};
+
+	/** Statistics of the strip cache */
+	struct StripCacheStats {
+		uint32 hits;		///< Strips copied from the cache
+		uint32 misses;		///< Strips decoded while the cache was in use
+		uint32 evictions;	///< Strips dropped to stay within the budget
+		uint32 flushes;		///< Number of times the whole cache was dropped
 	};
+
+	void flushStripCache();
+	void setStripCacheBudget(uint32 bytes);
+	uint32 getStripCacheBudget() const { return _stripCacheBudget; }
+	uint32 getStripCacheSize() const { return _stripCacheSize; }
+	int getStripCacheEntryCount() const;
+	const StripCacheStats &getStripCacheStats() const { return _stripCacheStats; }
+	void resetStripCacheStats() { memset(&_stripCacheStats, 0, sizeof(_stripCacheStats)); }
+
+protected:
+	StripCacheStats _stripCacheStats;
 };
 
 class GdiNES : public Gdi {
@@ -689,139 +689,50 @@ void Wiz::copyRawWizImage(uint8 *dst, const uint8 *src, int dstPitch, int dstTyp
 	}
 }
 
-#ifdef USE_RGB_COLOR
-template <int type>
-void Wiz::write16BitColor(uint8 *dstPtr, const uint8 *dataPtr, int dstType, const uint8 *xmapPtr) {
-	uint16 col = READ_LE_UINT16(dataPtr);
-	if (type == kWizXMap) {
-		uint16 srcColor = (col >> 1) & 0x7DEF;
-		uint16 dstColor = (READ_UINT16(dstPtr) >> 1) & 0x7DEF;
-		uint16 newColor = srcColor + dstColor;
-		writeColor(dstPtr, dstType, newColor);
-	}
-	if (type == kWizCopy) {
-		writeColor(dstPtr, dstType, col);
-	}
-}
-
-template <int type>
-void Wiz::decompress16BitWizImage(uint8 *dst, int dstPitch, int dstType, const uint8 *src, const Common::Rect &srcRect, int flags, const uint8 *xmapPtr) {
-	const uint8 *dataPtr, *dataPtrNext;
-	uint8 code;
-	uint8 *dstPtr, *dstPtrNext;
-	int h, w, xoff, dstInc;
-
-	if (type == kWizXMap) {
-		assert(xmapPtr != 0);
-	}
-
-	dstPtr = dst;
-	dataPtr = src;
-
-	// Skip over the first 'srcRect->top' lines in the data
-	h = srcRect.top;
-	while (h--) {
-		dataPtr += READ_LE_UINT16(dataPtr) + 2;
-	}
-	h = srcRect.height();
-	w = srcRect.width();
-	if (h <= 0 || w <= 0)
-		return;
-
-	if (flags & kWIFFlipY) {
-		dstPtr += (h - 1) * dstPitch;
-		dstPitch = -dstPitch;
-	}
-	dstInc = 2;
-	if (flags & kWIFFlipX) {
-		dstPtr += (w - 1) * 2;
-		dstInc = -2;
-	}
-
-	while (h--) {
-		xoff = srcRect.left;
-		w = srcRect.width();
-		uint16 lineSize = READ_LE_UINT16(dataPtr); dataPtr += 2;
-		dstPtrNext = dstPtr + dstPitch;
-		dataPtrNext = dataPtr + lineSize;
-		if (lineSize != 0) {
-			while (w > 0) {
-				code = *dataPtr++;
-				if (code & 1) {
-					code >>= 1;
-					if (xoff > 0) {
-						xoff -= code;
-						if (xoff >= 0)
-							continue;
-
-						code = -xoff;
-					}
-					dstPtr += dstInc * code;
-					w -= code;
-				} else if (code & 2) {
-					code = (code >> 2) + 1;
-					if (xoff > 0) {
-						xoff -= code;
-						dataPtr += 2;
-						if (xoff >= 0)
-							continue;
+/*
+ * The Wiz decoders below are instantiated for every combination of color
+ * mode (type), destination bit depth and destination byte order, so that the
+ * inner loops don't have to check them for every pixel. 16-bit pixels are
+ * written in native byte order to the screen and cursors, and in little
+ * endian byte order to memory and resources.
+ */
 
-						code = -xoff;
-						dataPtr -= 2;
-					}
-					w -= code;
-					if (w < 0) {
-						code += w;
-					}
-					while (code--) {
-						write16BitColor<type>(dstPtr, dataPtr, dstType, xmapPtr);
-						dstPtr += dstInc;
-					}
-					dataPtr += 2;
-				} else {
-					code = (code >> 2) + 1;
-					if (xoff > 0) {
-						xoff -= code;
-						dataPtr += code * 2;
-						if (xoff >= 0)
-							continue;
+enum {
+	kWizMinBlockRun = 16	///< Shorter 8-bit runs are written pixel by pixel instead of using memset()
+};
 
-						code = -xoff;
-						dataPtr += xoff * 2;
-					}
-					w -= code;
-					if (w < 0) {
-						code += w;
-					}
-					while (code--) {
-						write16BitColor<type>(dstPtr, dataPtr, dstType, xmapPtr);
-						dataPtr += 2;
-						dstPtr += dstInc;
-					}
-				}
-			}
-		}
-		dataPtr = dataPtrNext;
-		dstPtr = dstPtrNext;
-	}
+template <bool nativeOrder>
+static inline void writeWizColor(uint8 *dstPtr, uint16 color) {
+	if (nativeOrder)
+		WRITE_UINT16(dstPtr, color);
+	else
+		WRITE_LE_UINT16(dstPtr, color);
 }
-#endif
 
-template <int type>
-void Wiz::write8BitColor(uint8 *dstPtr, const uint8 *dataPtr, int dstType, const uint8 *palPtr, const uint8 *xmapPtr, uint8 bitDepth) {
-	if (bitDepth == 2) {
+/** Write a single pixel. dataPtr points to a palette index, or to a 16-bit color for 16-bit images. */
+template <int type, int bitDepth, bool nativeOrder, bool srcIs16Bit>
+static inline void writeWizPixel(uint8 *dstPtr, const uint8 *dataPtr, const uint8 *palPtr, const uint8 *xmapPtr) {
+	if (srcIs16Bit) {
+		uint16 col = READ_LE_UINT16(dataPtr);
+		if (type == kWizXMap) {
+			uint16 srcColor = (col >> 1) & 0x7DEF;
+			uint16 dstColor = (READ_UINT16(dstPtr) >> 1) & 0x7DEF;
+			writeWizColor<nativeOrder>(dstPtr, srcColor + dstColor);
+		} else {
+			writeWizColor<nativeOrder>(dstPtr, col);
+		}
+	} else if (bitDepth == 2) {
 		if (type == kWizXMap) {
 			uint16 color = READ_LE_UINT16(palPtr + *dataPtr * 2);
 			uint16 srcColor = (color >> 1) & 0x7DEF;
 			uint16 dstColor = (READ_UINT16(dstPtr) >> 1) & 0x7DEF;
-			uint16 newColor = srcColor + dstColor;
-			writeColor(dstPtr, dstType, newColor);
+			writeWizColor<nativeOrder>(dstPtr, srcColor + dstColor);
 		}
 		if (type == kWizRMap) {
-			writeColor(dstPtr, dstType, READ_LE_UINT16(palPtr + *dataPtr * 2));
+			writeWizColor<nativeOrder>(dstPtr, READ_LE_UINT16(palPtr + *dataPtr * 2));
 		}
 		if (type == kWizCopy) {
-			writeColor(dstPtr, dstType, *dataPtr);
+			writeWizColor<nativeOrder>(dstPtr, *dataPtr);
 		}
 	} else {
 		if (type == kWizXMap) {
@@ -836,19 +747,67 @@ void Wiz::write8BitColor(uint8 *dstPtr, const uint8 *dataPtr, int dstType, const
 	}
 }
 
-template <int type>
-void Wiz::decompressWizImage(uint8 *dst, int dstPitch, int dstType, const uint8 *src, const Common::Rect &srcRect, int flags, const uint8 *palPtr, const uint8 *xmapPtr, uint8 bitDepth) {
-	const uint8 *dataPtr, *dataPtrNext;
-	uint8 code, *dstPtr, *dstPtrNext;
-	int h, w, xoff, dstInc;
-
+/** Write count pixels of the same color, and return the position after them. */
+template <int type, int bitDepth, bool nativeOrder, bool srcIs16Bit>
+static inline uint8 *writeWizRun(uint8 *dstPtr, int dstInc, const uint8 *dataPtr, int count, const uint8 *palPtr, const uint8 *xmapPtr) {
 	if (type == kWizXMap) {
-		assert(xmapPtr != 0);
+		// Blended with the destination, so every pixel differs
+		while (count--) {
+			writeWizPixel<type, bitDepth, nativeOrder, srcIs16Bit>(dstPtr, dataPtr, palPtr, xmapPtr);
+			dstPtr += dstInc;
+		}
+	} else if (bitDepth == 1) {
+		const uint8 color = (type == kWizRMap) ? palPtr[*dataPtr] : *dataPtr;
+		if (count < kWizMinBlockRun) {
+			while (count--) {
+				*dstPtr = color;
+				dstPtr += dstInc;
+			}
+		} else if (dstInc > 0) {
+			memset(dstPtr, color, count);
+			dstPtr += count;
+		} else {
+			dstPtr -= count;
+			memset(dstPtr + 1, color, count);
+		}
+	} else {
+		uint16 color;
+		if (srcIs16Bit)
+			color = READ_LE_UINT16(dataPtr);
+		else if (type == kWizRMap)
+			color = READ_LE_UINT16(palPtr + *dataPtr * 2);
+		else
+			color = *dataPtr;
+
+		while (count--) {
+			writeWizColor<nativeOrder>(dstPtr, color);
+			dstPtr += dstInc;
+		}
 	}
-	if (type == kWizRMap) {
-		assert(palPtr != 0);
+
+	return dstPtr;
+}
+
+/** Write count pixels from dataPtr, and return the position after them. */
+template <int type, int bitDepth, bool nativeOrder, bool srcIs16Bit>
+static inline uint8 *writeWizLiteral(uint8 *dstPtr, int dstInc, const uint8 *dataPtr, int count, const uint8 *palPtr, const uint8 *xmapPtr) {
+	const int srcInc = srcIs16Bit ? 2 : 1;
+	while (count--) {
+		writeWizPixel<type, bitDepth, nativeOrder, srcIs16Bit>(dstPtr, dataPtr, palPtr, xmapPtr);
+		dataPtr += srcInc;
+		dstPtr += dstInc;
 	}
 
+	return dstPtr;
+}
+
+template <int type, int bitDepth, bool nativeOrder, bool srcIs16Bit>
+static void decompressWizImageIntern(uint8 *dst, int dstPitch, const uint8 *src, const Common::Rect &srcRect, int flags, const uint8 *palPtr, const uint8 *xmapPtr) {
+	const int srcInc = srcIs16Bit ? 2 : 1;
+	const uint8 *dataPtr, *dataPtrNext;
+	uint8 code, *dstPtr, *dstPtrNext;
+	int h, w, xoff, dstInc;
+
 	dstPtr = dst;
 	dataPtr = src;
 
@@ -896,42 +855,36 @@ void Wiz::decompressWizImage(uint8 *dst, int dstPitch, int dstType, const uint8
 					code = (code >> 2) + 1;
 					if (xoff > 0) {
 						xoff -= code;
-						++dataPtr;
+						dataPtr += srcInc;
 						if (xoff >= 0)
 							continue;
 
 						code = -xoff;
-						--dataPtr;
+						dataPtr -= srcInc;
 					}
 					w -= code;
 					if (w < 0) {
 						code += w;
 					}
-					while (code--) {
-						write8BitColor<type>(dstPtr, dataPtr, dstType, palPtr, xmapPtr, bitDepth);
-						dstPtr += dstInc;
-					}
-					dataPtr++;
+					dstPtr = writeWizRun<type, bitDepth, nativeOrder, srcIs16Bit>(dstPtr, dstInc, dataPtr, code, palPtr, xmapPtr);
+					dataPtr += srcInc;
 				} else {
 					code = (code >> 2) + 1;
 					if (xoff > 0) {
 						xoff -= code;
-						dataPtr += code;
+						dataPtr += code * srcInc;
 						if (xoff >= 0)
 							continue;
 
 						code = -xoff;
-						dataPtr += xoff;
+						dataPtr += xoff * srcInc;
 					}
 					w -= code;
 					if (w < 0) {
 						code += w;
 					}
-					while (code--) {
-						write8BitColor<type>(dstPtr, dataPtr, dstType, palPtr, xmapPtr, bitDepth);
-						dataPtr++;
-						dstPtr += dstInc;
-					}
+					dstPtr = writeWizLiteral<type, bitDepth, nativeOrder, srcIs16Bit>(dstPtr, dstInc, dataPtr, code, palPtr, xmapPtr);
+					dataPtr += code * srcInc;
 				}
 			}
 		}
@@ -940,6 +893,70 @@ void Wiz::decompressWizImage(uint8 *dst, int dstPitch, int dstType, const uint8
 	}
 }
 
+#ifdef USE_RGB_COLOR
+template <int type>
+void Wiz::write16BitColor(uint8 *dstPtr, const uint8 *dataPtr, int dstType, const uint8 *xmapPtr) {
+	uint16 col = READ_LE_UINT16(dataPtr);
+	if (type == kWizXMap) {
+		uint16 srcColor = (col >> 1) & 0x7DEF;
+		uint16 dstColor = (READ_UINT16(dstPtr) >> 1) & 0x7DEF;
+		uint16 newColor = srcColor + dstColor;
+		writeColor(dstPtr, dstType, newColor);
+	}
+	if (type == kWizCopy) {
+		writeColor(dstPtr, dstType, col);
+	}
+}
+
+template <int type>
+void Wiz::decompress16BitWizImage(uint8 *dst, int dstPitch, int dstType, const uint8 *src, const Common::Rect &srcRect, int flags, const uint8 *xmapPtr) {
+	if (type == kWizXMap) {
+		assert(xmapPtr != 0);
+	}
+
+	switch (dstType) {
+	case kDstCursor:
+	case kDstScreen:
+		decompressWizImageIntern<type, 2, true, true>(dst, dstPitch, src, srcRect, flags, NULL, xmapPtr);
+		break;
+	case kDstMemory:
+	case kDstResource:
+		decompressWizImageIntern<type, 2, false, true>(dst, dstPitch, src, srcRect, flags, NULL, xmapPtr);
+		break;
+	default:
+		error("decompress16BitWizImage: Unknown dstType %d", dstType);
+	}
+}
+#endif
+
+template <int type>
+void Wiz::decompressWizImage(uint8 *dst, int dstPitch, int dstType, const uint8 *src, const Common::Rect &srcRect, int flags, const uint8 *palPtr, const uint8 *xmapPtr, uint8 bitDepth) {
+	if (type == kWizXMap) {
+		assert(xmapPtr != 0);
+	}
+	if (type == kWizRMap) {
+		assert(palPtr != 0);
+	}
+
+	if (bitDepth != 2) {
+		decompressWizImageIntern<type, 1, true, false>(dst, dstPitch, src, srcRect, flags, palPtr, xmapPtr);
+		return;
+	}
+
+	switch (dstType) {
+	case kDstCursor:
+	case kDstScreen:
+		decompressWizImageIntern<type, 2, true, false>(dst, dstPitch, src, srcRect, flags, palPtr, xmapPtr);
+		break;
+	case kDstMemory:
+	case kDstResource:
+		decompressWizImageIntern<type, 2, false, false>(dst, dstPitch, src, srcRect, flags, palPtr, xmapPtr);
+		break;
+	default:
+		error("decompressWizImage: Unknown dstType %d", dstType);
+	}
+}
+
 // NOTE: These templates are used outside this file. We don't want the compiler to optimize them away, so we need to explicitely instantiate them.
 template void Wiz::decompressWizImage<kWizXMap>(uint8 *dst, int dstPitch, int dstType, const uint8 *src, const Common::Rect &srcRect, int flags, const uint8 *palPtr, const uint8 *xmapPtr, uint8 bitDepth);
 template void Wiz::decompressWizImage<kWizRMap>(uint8 *dst, int dstPitch, int dstType, const uint8 *src, const Common::Rect &srcRect, int flags, const uint8 *palPtr, const uint8 *xmapPtr, uint8 bitDepth);
@@ -954,6 +971,16 @@ void Wiz::decompressRawWizImage(uint8 *dst, int dstPitch, int dstType, const uin
 	if (w <= 0 || h <= 0) {
 		return;
 	}
+
+	if (type == kWizCopy && bitDepth == 1 && transColor == -1) {
+		while (h--) {
+			memcpy(dst, src, w);
+			src += srcPitch;
+			dst += dstPitch;
+		}
+		return;
+	}
+
 	while (h--) {
 		for (int i = 0; i < w; ++i) {
 			uint8 col = src[i];
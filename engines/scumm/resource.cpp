@@ -50,7 +50,14 @@ enum {
 	RF_USAGE = 0x7F,
 	RF_USAGE_MAX = RF_USAGE,
 
-	RS_MODIFIED = 0x10
+	RS_MODIFIED = 0x10,
+	RS_EXPIRED = 0x20,	///< Resource was thrown out by expireResources()
+	RS_REFAULTED = 0x40	///< Resource had to be reloaded after being expired
+};
+
+enum {
+	kMinExpiryLoads = 8,		///< Loads of a type needed before its load cost is used
+	kMinExpiryLoadTime = 50		///< Load time in ms of all types needed before load costs are used
 };
 
 
@@ -609,7 +616,9 @@ void ScummEngine::ensureResourceLoaded(int type, int i) {
 	if (addr)
 		return;
 
+	uint32 loadStart = _system->getMillis();
 	loadResource(type, i);
+	_res->countMiss(type, i, _system->getMillis() - loadStart);
 
 	if (_game.version == 5 && type == rtRoom && i == _roomResource)
 		VAR(VAR_ROOM_FLAG) = 1;
@@ -728,8 +737,11 @@ byte *ScummEngine::getResourceAddress(int type, int idx) {
 		return NULL;
 	}
 
-	if (_res->mode[type] && !_res->address[type][idx]) {
-		ensureResourceLoaded(type, idx);
+	if (_res->mode[type]) {
+		if (_res->address[type][idx])
+			_res->countHit(type);
+		else
+			ensureResourceLoaded(type, idx);
 	}
 
 	if (!(ptr = (byte *)_res->address[type][idx])) {
@@ -952,10 +964,11 @@ bool ResourceManager::isModified(int type, int i) const {
 
 void ResourceManager::expireResources(uint32 size) {
 	int i, j;
-	byte flag;
-	byte best_counter;
+	byte counter;
+	uint weight, best_weight;
 	int best_type, best_res = 0;
 	uint32 oldAllocatedSize;
+	uint weights[rtNumTypes];
 
 	if (_expireCounter != 0xFF) {
 		_expireCounter = 0xFF;
@@ -967,16 +980,33 @@ void ResourceManager::expireResources(uint32 size) {
 
 	oldAllocatedSize = _allocatedSize;
 
+	// The usage counters are weighted by how long each type takes to load
+	// per byte, so that the resources which are quick to read back are
+	// thrown out first
+	getExpiryWeights(weights);
+
 	do {
 		best_type = 0;
-		best_counter = 2;
+		best_weight = 0;
 
 		for (i = rtFirst; i <= rtLast; i++)
 			if (mode[i]) {
 				for (j = num[i]; --j >= 0;) {
-					flag = flags[i][j];
-					if (!(flag & RF_LOCK) && flag >= best_counter && address[i][j] && !_vm->isResourceInUse(i, j)) {
-						best_counter = flag;
+					counter = flags[i][j];
+					if ((counter & RF_LOCK) || !address[i][j])
+						continue;
+					// Resources which were already reloaded once after
+					// being expired age at half speed, so that the working
+					// set of a room is not repeatedly thrown out and read
+					// back from disk.
+					if (status[i][j] & RS_REFAULTED)
+						counter = (counter + 1) / 2;
+					// Resources used since the last expiry are kept
+					if (counter < 2)
+						continue;
+					weight = counter * weights[i];
+					if (weight >= best_weight && !_vm->isResourceInUse(i, j)) {
+						best_weight = weight;
 						best_type = i;
 						best_res = j;
 					}
@@ -986,6 +1016,8 @@ void ResourceManager::expireResources(uint32 size) {
 		if (!best_type)
 			break;
 		nukeResource(best_type, best_res);
+		status[best_type][best_res] |= RS_EXPIRED;
+		stats[best_type].expired++;
 	} while (size + _allocatedSize > _minHeapThreshold);
 
 	increaseResourceCounter();
@@ -1057,6 +1089,49 @@ void ResourceManager::resourceStats() {
 	debug(1, "Total allocated size=%d, locked=%d(%d)", _allocatedSize, lockedSize, lockedNum);
 }
 
+void ResourceManager::resetStats() {
+	memset(stats, 0, sizeof(stats));
+}
+
+void ResourceManager::countMiss(int type, int idx, uint32 loadTime) {
+	stats[type].misses++;
+	stats[type].loadTime += loadTime;
+
+	if (!address[type] || idx < 0 || idx >= num[type])
+		return;
+	if (address[type][idx])
+		stats[type].loadSize += ((MemBlkHeader *)address[type][idx])->size;
+	if (status[type][idx] & RS_EXPIRED) {
+		stats[type].reloads++;
+		status[type][idx] &= ~RS_EXPIRED;
+		status[type][idx] |= RS_REFAULTED;
+	}
+}
+
+void ResourceManager::getExpiryWeights(uint *weights) const {
+	uint32 totalTime = 0, totalSize = 0;
+	int i;
+
+	for (i = rtFirst; i <= rtLast; i++) {
+		totalTime += stats[i].loadTime;
+		totalSize += stats[i].loadSize;
+	}
+
+	for (i = rtFirst; i <= rtLast; i++) {
+		weights[i] = kExpiryWeightOne;
+
+		// Most loads take less than a millisecond, so the load times only
+		// mean something once enough of them were added up
+		if (totalTime < kMinExpiryLoadTime || stats[i].misses < kMinExpiryLoads || !stats[i].loadSize)
+			continue;
+
+		// Types which take twice as long per byte as the average age at
+		// two thirds of the speed, types which load instantly twice as fast
+		const double relativeCost = ((double)stats[i].loadTime / stats[i].loadSize) / ((double)totalTime / totalSize);
+		weights[i] = CLIP<uint>((uint)(2 * kExpiryWeightOne / (1 + relativeCost)), kExpiryWeightOne / 4, 2 * kExpiryWeightOne);
+	}
+}
+
 void ScummEngine_v5::readMAXS(int blockSize) {
 	debug(9, "ScummEngine_v5 readMAXS: MAXS has blocksize %d", blockSize);
 
@@ -1282,7 +1282,14 @@ void ScummEngine::setupScumm() {
 		maxHeapThreshold = 550000;
 	}
 
-	_res->setHeapThreshold(400000, maxHeapThreshold);
+	// Allow users with plenty of memory to keep more resources around,
+	// instead of reloading them from the data files.
+	if (ConfMan.hasKey("scumm_resource_cache_size"))
+		maxHeapThreshold = MAX(ConfMan.getInt("scumm_resource_cache_size"), 550) * 1024;
+
+	// When the heap is full, expire resources until it is only half full again.
+	// With the original limits this still expires down to 400000 bytes.
+	_res->setHeapThreshold(MAX(400000, maxHeapThreshold / 2), maxHeapThreshold);
 
 	free(_compositeBuf);
 	_compositeBuf = (byte *)malloc(_screenWidth * _textSurfaceMultiplier * _screenHeight * _textSurfaceMultiplier * _bytesPerPixelOutput);
@@ -391,6 +391,21 @@ public:
 	uint32 *roomoffs[rtNumTypes];
 	uint32 *globsize[rtNumTypes];
 
+	/**
+	 * Per resource type usage statistics, as shown by the debugger's
+	 * 'resources' command.
+	 */
+	struct TypeStats {
+		uint32 hits;		///< Lookups that found the resource in memory
+		uint32 misses;		///< Lookups that had to load the resource
+		uint32 reloads;		///< Misses on resources which had been expired before
+		uint32 expired;		///< Resources thrown out by expireResources()
+		uint32 loadTime;	///< Time spent in loadResource(), in milliseconds
+		uint32 loadSize;	///< Bytes loaded by loadResource()
+	};
+
+	TypeStats stats[rtNumTypes];
+
 protected:
 	uint32 _allocatedSize;
 	uint32 _maxHeapThreshold, _minHeapThreshold;
@@ -400,7 +415,13 @@ public:
 	ResourceManager(ScummEngine *vm);
 	~ResourceManager();
 
+	enum {
+		kExpiryWeightOne = 16	///< Expiry weight of types with an average load cost
+	};
+
 	void setHeapThreshold(int min, int max);
+	uint32 getHeapThreshold() const { return _maxHeapThreshold; }
+	uint32 getAllocatedSize() const { return _allocatedSize; }
 
 	void allocResTypeData(int id, uint32 tag, int num, const char *name, int mode);
 	void freeResources();
@@ -422,6 +443,17 @@ public:
 	void increaseResourceCounter();
 
 	void resourceStats();
+	void resetStats();
+
+	void countHit(int type) { stats[type].hits++; }
+	void countMiss(int type, int index, uint32 loadTime);
+
+	/**
+	 * Computes how fast the resources of each type age for
+	 * expireResources(), in units of kExpiryWeightOne, from the load times
+	 * per byte measured so far.
+	 */
+	void getExpiryWeights(uint *weights) const;
 
 //protected:
 	bool validateResource(const char *str, int type, int index) const;
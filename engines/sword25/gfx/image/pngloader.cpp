@@ -215,21 +215,27 @@ bool PNGLoader::doDecodeImage(const byte *fileDataPtr, uint fileSize, byte *&unc
 	// Destroy libpng structures
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 #else
+	// Read the image size from the header, so that the image can be decoded
+	// straight into the final buffer
+	if (!doImageProperties(fileDataPtr, fileSize, width, height))
+		error("Error while reading PNG image");
+
+	pitch = GraphicEngine::calcPitch(GraphicEngine::CF_ARGB32, width);
+	uncompressedDataPtr = new byte[pitch * height];
+
+	Graphics::Surface pngSurface;
+	pngSurface.w = width;
+	pngSurface.h = height;
+	pngSurface.pitch = pitch;
+	pngSurface.bytesPerPixel = 4;
+	pngSurface.pixels = uncompressedDataPtr;
+
 	Common::MemoryReadStream *fileStr = new Common::MemoryReadStream(fileDataPtr, fileSize, DisposeAfterUse::NO);
 	Graphics::PNG *png = new Graphics::PNG();
-	if (!png->read(fileStr))	// the fileStr pointer, and thus pFileData will be deleted after this is done
-		error("Error while reading PNG image");	
-
 	Graphics::PixelFormat format = Graphics::PixelFormat(4, 8, 8, 8, 8, 16, 8, 0, 24);
-	Graphics::Surface *pngSurface = png->getSurface(format);
-
-	width = pngSurface->w;
-	height = pngSurface->h;
-	uncompressedDataPtr = new byte[pngSurface->pitch * pngSurface->h];
-	memcpy(uncompressedDataPtr, (byte *)pngSurface->pixels, pngSurface->pitch * pngSurface->h);
-	pngSurface->free();
+	if (!png->read(fileStr, pngSurface, format))	// the fileStr pointer, and thus pFileData will be deleted after this is done
+		error("Error while reading PNG image");
 
-	delete pngSurface;
 	delete png;
 
 #endif
@@ -281,7 +287,12 @@ bool PNGLoader::doImageProperties(const byte *fileDataPtr, uint fileSize, int &w
 	// Die Strukturen freigeben
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 #else
-	// We don't need to read the image properties here...
+	// Check for a valid PNG signature, followed by the header chunk
+	if (fileSize < 24 || memcmp(fileDataPtr, "\x89PNG\r\n\x1a\n", 8) || memcmp(fileDataPtr + 12, "IHDR", 4))
+		return false;
+
+	width = READ_BE_UINT32(fileDataPtr + 16);
+	height = READ_BE_UINT32(fileDataPtr + 20);
 #endif
 	return true;
 
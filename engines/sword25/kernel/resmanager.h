@@ -36,7 +36,7 @@
 #define SWORD25_RESOURCEMANAGER_H
 
 #include "common/list.h"
-#include "common/hashmap.h"
+#include "common/flathashmap.h"
 #include "common/hash-str.h"
 
 #include "sword25/kernel/common.h"
@@ -135,7 +135,7 @@ private:
 	Kernel *_kernelPtr;
 	Common::Array<ResourceService *> _resourceServices;
 	Common::List<Resource *> _resources;
-	typedef Common::HashMap<Common::String, Resource *> ResMap;
+	typedef Common::FlatHashMap<Common::String, Resource *> ResMap;
 	ResMap _resourceHashMap;
 };
 
@@ -23,15 +23,33 @@
  *
  */
 
+#include "audio/midicache.h"
+
 #include "touche/console.h"
+#include "touche/midi.h"
 #include "touche/touche.h"
 
 namespace Touche {
 
 ToucheConsole::ToucheConsole(ToucheEngine *vm) : GUI::Debugger(), _vm(vm) {
+	DCmd_Register("musiccache", WRAP_METHOD(ToucheConsole, Cmd_MusicCache));
 }
 
 ToucheConsole::~ToucheConsole() {
 }
 
+bool ToucheConsole::Cmd_MusicCache(int argc, const char **argv) {
+	const Audio::MidiRenderCache *cache = _vm->_midiPlayer->getRenderCache();
+	if (!cache) {
+		DebugPrintf("The music cache is disabled, or the music driver cannot be recorded\n");
+		return true;
+	}
+
+	const Audio::MidiRenderCache::Stats &stats = cache->getStats();
+	DebugPrintf("Music cache: %d of %d KB\n", cache->getSize() / 1024, cache->getBudget() / 1024);
+	DebugPrintf("  hits %d, misses %d, stored %d, aborted %d, evicted %d\n",
+		stats.hits, stats.misses, stats.stored, stats.aborted, stats.evicted);
+	return true;
+}
+
 } // End of namespace Touche
@@ -39,6 +39,8 @@ public:
 
 private:
 	ToucheEngine *_vm;
+
+	bool Cmd_MusicCache(int argc, const char **argv);
 };
 
 } // End of namespace Touche
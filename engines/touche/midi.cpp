@@ -25,7 +25,10 @@
 
 #include "common/config-manager.h"
 #include "common/stream.h"
+#include "common/system.h"
 
+#include "audio/audiostream.h"
+#include "audio/midicache.h"
 #include "audio/midiparser.h"
 
 #include "touche/midi.h"
@@ -33,7 +36,8 @@
 namespace Touche {
 
 MidiPlayer::MidiPlayer()
-	: _driver(0), _parser(0), _midiData(0), _isLooping(false), _isPlaying(false), _masterVolume(0) {
+	: _driver(0), _parser(0), _midiData(0), _isLooping(false), _isPlaying(false), _masterVolume(0),
+	_renderCache(0), _cachedVolume(0) {
 	memset(_channelsTable, 0, sizeof(_channelsTable));
 	memset(_channelsVolume, 0, sizeof(_channelsVolume));
 	open();
@@ -48,17 +52,45 @@ void MidiPlayer::play(Common::ReadStream &stream, int size, bool loop) {
 	_midiData = (uint8 *)malloc(size);
 	if (_midiData) {
 		stream.read(_midiData, size);
+
+		uint32 cacheKey = 0;
+		if (_renderCache) {
+			// Store the previous track, if it was recorded completely. It
+			// is written in the background, see updateRenderCache().
+			_renderCache->commit();
+
+			// Touche applies the music volume to the MIDI data, so it
+			// is part of the key
+			cacheKey = Audio::MidiRenderCache::makeKey(_midiData, size,
+				_renderSettings + Common::String::format(":%d", _masterVolume));
+			Audio::SeekableAudioStream *cached = _renderCache->open(cacheKey);
+			if (cached) {
+				free(_midiData);
+				_midiData = 0;
+				_cachedVolume = _masterVolume;
+				g_system->getMixer()->playStream(Audio::Mixer::kPlainSoundType, &_cachedHandle,
+					Audio::makeLoopingAudioStream(cached, loop ? 0 : 1));
+				return;
+			}
+		}
+
 		_mutex.lock();
 		_parser->loadMusic(_midiData, size);
 		_parser->setTrack(0);
 		_isLooping = loop;
 		_isPlaying = true;
+		if (_renderCache)
+			_renderCache->startRecording(cacheKey);
 		_mutex.unlock();
 	}
 }
 
 void MidiPlayer::stop() {
+	g_system->getMixer()->stopHandle(_cachedHandle);
+	_cachedVolume = 0;
 	_mutex.lock();
+	if (_renderCache)
+		_renderCache->abortRecording();
 	if (_isPlaying) {
 		_isPlaying = false;
 		_parser->unloadMusic();
@@ -76,13 +108,26 @@ void MidiPlayer::updateTimer() {
 	_mutex.unlock();
 }
 
+void MidiPlayer::updateRenderCache() {
+	if (_renderCache)
+		_renderCache->update();
+}
+
 void MidiPlayer::adjustVolume(int diff) {
 	setVolume(_masterVolume + diff);
 }
 
 void MidiPlayer::setVolume(int volume) {
-	_masterVolume = CLIP(volume, 0, 255);
+	volume = CLIP(volume, 0, 255);
+	if (volume == _masterVolume)
+		return;
+	_masterVolume = volume;
+	if (_cachedVolume)
+		g_system->getMixer()->setChannelVolume(_cachedHandle, MIN(_masterVolume * 255 / _cachedVolume, 255));
 	_mutex.lock();
+	// The recording would no longer match its key
+	if (_renderCache)
+		_renderCache->abortRecording();
 	for (int i = 0; i < NUM_CHANNELS; ++i) {
 		if (_channelsTable[i]) {
 			_channelsTable[i]->volume(_channelsVolume[i] * _masterVolume / 255);
@@ -106,6 +151,19 @@ int MidiPlayer::open() {
 			_driver->sendMT32Reset();
 		else
 			_driver->sendGMReset();
+
+		// Touche music always plays the same way, so emulated drivers
+		// only need to synthesize every track once
+		_renderCache = new Audio::MidiRenderCache();
+		if (_renderCache->isEnabled() && _driver->setRenderCache(_renderCache)) {
+			// Everything else the synthesized samples depend on
+			_renderSettings = Common::String::format("%s:%s:%s:%s:%d",
+				MidiDriver::getDeviceString(dev, MidiDriver::kDriverId).c_str(), _nativeMT32 ? "mt32" : "gm",
+				ConfMan.get("opl_driver").c_str(), ConfMan.get("soundfont").c_str(), g_system->getMixer()->getOutputRate());
+		} else {
+			delete _renderCache;
+			_renderCache = 0;
+		}
 	}
 	return ret;
 }
@@ -117,6 +175,11 @@ void MidiPlayer::close() {
 	_driver->close();
 	delete _driver;
 	_driver = 0;
+	if (_renderCache) {
+		_renderCache->commit();
+		delete _renderCache;
+		_renderCache = 0;
+	}
 	_parser->setMidiDriver(NULL);
 	delete _parser;
 	_mutex.unlock();
@@ -154,6 +217,8 @@ void MidiPlayer::send(uint32 b) {
 void MidiPlayer::metaEvent(byte type, byte *data, uint16 length) {
 	switch (type) {
 	case 0x2F: // end of Track
+		if (_renderCache)
+			_renderCache->finishRecording();
 		if (_isLooping) {
 			_parser->jumpToTick(0);
 		} else {
@@ -30,9 +30,14 @@
 #include "common/mutex.h"
 
 #include "audio/mididrv.h"
+#include "audio/mixer.h"
 
 class MidiParser;
 
+namespace Audio {
+	class MidiRenderCache;
+}
+
 namespace Common {
 	class ReadStream;
 }
@@ -56,6 +61,8 @@ public:
 	void setVolume(int volume);
 	int getVolume() const { return _masterVolume; }
 	void setLooping(bool loop) { _isLooping = loop; }
+	void updateRenderCache();
+	const Audio::MidiRenderCache *getRenderCache() const { return _renderCache; }
 
 	// MidiDriver interface
 	int open();
@@ -82,6 +89,11 @@ private:
 	uint8 _channelsVolume[NUM_CHANNELS];
 	Common::Mutex _mutex;
 
+	Audio::MidiRenderCache *_renderCache;
+	Common::String _renderSettings;
+	Audio::SoundHandle _cachedHandle;
+	int _cachedVolume;
+
 	static const uint8 _gmToRol[];
 };
 
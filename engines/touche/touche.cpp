@@ -294,6 +294,7 @@ void ToucheEngine::mainLoop() {
 		do {
 			processEvents();
 			_system->updateScreen();
+			_midiPlayer->updateRenderCache();
 			_system->delayMillis(10);
 			now = _system->getMillis();
 		} while (now < nextFrame && !_fastMode);
@@ -360,6 +360,8 @@ enum GameState {
 class MidiPlayer;
 
 class ToucheEngine: public Engine {
+	friend class ToucheConsole;
+
 public:
 
 	enum {
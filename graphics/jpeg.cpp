@@ -45,23 +45,25 @@ static const uint8 _zigZagOrder[64] = {
 	53, 60, 61, 54, 47, 55, 62, 63
 };
 
-// IDCT table built with :
-// _idct8x8[x][y] = cos(((2 * x + 1) * y) * (PI / 16.0)) * 0.5;
-// _idct8x8[x][y] /= sqrt(2.0) if y == 0
-static const double _idct8x8[8][8] = {
-	{ 0.353553390593274,  0.490392640201615,  0.461939766255643,  0.415734806151273,  0.353553390593274,  0.277785116509801,  0.191341716182545,  0.097545161008064 },
-	{ 0.353553390593274,  0.415734806151273,  0.191341716182545, -0.097545161008064, -0.353553390593274, -0.490392640201615, -0.461939766255643, -0.277785116509801 },
-	{ 0.353553390593274,  0.277785116509801, -0.191341716182545, -0.490392640201615, -0.353553390593274,  0.097545161008064,  0.461939766255643,  0.415734806151273 },
-	{ 0.353553390593274,  0.097545161008064, -0.461939766255643, -0.277785116509801,  0.353553390593274,  0.415734806151273, -0.191341716182545, -0.490392640201615 },
-	{ 0.353553390593274, -0.097545161008064, -0.461939766255643,  0.277785116509801,  0.353553390593274, -0.415734806151273, -0.191341716182545,  0.490392640201615 },
-	{ 0.353553390593274, -0.277785116509801, -0.191341716182545,  0.490392640201615, -0.353553390593273, -0.097545161008064,  0.461939766255643, -0.415734806151273 },
-	{ 0.353553390593274, -0.415734806151273,  0.191341716182545,  0.097545161008064, -0.353553390593274,  0.490392640201615, -0.461939766255643,  0.277785116509801 },
-	{ 0.353553390593274, -0.490392640201615,  0.461939766255643, -0.415734806151273,  0.353553390593273, -0.277785116509801,  0.191341716182545, -0.097545161008064 }
+// Scale factors of the AAN IDCT, in natural order and with 14 bits of
+// fractional precision:
+// _idctScale[y * 8 + x] = scale(x) * scale(y) * 16384
+// scale(k) = cos(k * PI / 16.0) * sqrt(2.0) if k != 0, 1.0 otherwise
+static const uint16 _idctScale[64] = {
+	16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+	22725, 31521, 29692, 26722, 22725, 17855, 12299,  6270,
+	21407, 29692, 27969, 25172, 21407, 16819, 11585,  5906,
+	19266, 26722, 25172, 22654, 19266, 15137, 10426,  5315,
+	16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+	12873, 17855, 16819, 15137, 12873, 10114,  6967,  3552,
+	 8867, 12299, 11585, 10426,  8867,  6967,  4799,  2446,
+	 4520,  6270,  5906,  5315,  4520,  3552,  2446,  1247
 };
 
 JPEG::JPEG() :
 	_stream(NULL), _w(0), _h(0), _numComp(0), _components(NULL), _numScanComp(0),
-	_scanComp(NULL), _currentComp(NULL) {
+	_scanComp(NULL), _currentComp(NULL), _restartInterval(0), _bitsData(0), _bitsNumber(0),
+	_bitsMarker(false) {
 
 	// Initialize the quantization tables
 	for (int i = 0; i < JPEG_MAX_QUANT_TABLES; i++)
@@ -71,8 +73,7 @@ JPEG::JPEG() :
 	for (int i = 0; i < 2 * JPEG_MAX_HUFF_TABLES; i++) {
 		_huff[i].count = 0;
 		_huff[i].values = NULL;
-		_huff[i].sizes = NULL;
-		_huff[i].codes = NULL;
+		memset(_huff[i].lookup, 0, sizeof(_huff[i].lookup));
 	}
 }
 
@@ -89,28 +90,59 @@ Surface *JPEG::getSurface(const PixelFormat &format) {
 	if (format.bytesPerPixel == 1)
 		return 0;
 
-	// Get our component surfaces
-	Graphics::Surface *yComponent = getComponent(1);
-	Graphics::Surface *uComponent = getComponent(2);
-	Graphics::Surface *vComponent = getComponent(3);
-
 	Graphics::Surface *output = new Graphics::Surface();
-	output->create(yComponent->w, yComponent->h, format.bytesPerPixel);
-
-	for (uint16 i = 0; i < output->h; i++) {
-		for (uint16 j = 0; j < output->w; j++) {
-			byte r = 0, g = 0, b = 0;
-			YUV2RGB(*((byte *)yComponent->getBasePtr(j, i)), *((byte *)uComponent->getBasePtr(j, i)), *((byte *)vComponent->getBasePtr(j, i)), r, g, b);
-			if (format.bytesPerPixel == 2)
-				*((uint16 *)output->getBasePtr(j, i)) = format.RGBToColor(r, g, b);
-			else
-				*((uint32 *)output->getBasePtr(j, i)) = format.RGBToColor(r, g, b);
-		}
+	output->create(_w, _h, format.bytesPerPixel);
+
+	if (!convertTo(*output, format)) {
+		output->free();
+		delete output;
+		return 0;
 	}
 
 	return output;
 }
 
+bool JPEG::convertTo(Surface &output, const PixelFormat &format) {
+	// Make sure we have loaded data
+	if (!isLoaded())
+		return false;
+
+	// Only accept 16bpp and 32bpp surfaces
+	if (format.bytesPerPixel != 2 && format.bytesPerPixel != 4)
+		return false;
+
+	assert(output.bytesPerPixel == format.bytesPerPixel);
+	assert(output.w >= _w && output.h >= _h);
+
+	// Get our component surfaces
+	const Graphics::Surface *yComponent = getComponent(1);
+	const Graphics::Surface *uComponent = getComponent(2);
+	const Graphics::Surface *vComponent = getComponent(3);
+
+	for (uint16 i = 0; i < _h; i++) {
+		const byte *y = (const byte *)yComponent->getBasePtr(0, i);
+		const byte *u = (const byte *)uComponent->getBasePtr(0, i);
+		const byte *v = (const byte *)vComponent->getBasePtr(0, i);
+		byte r, g, b;
+
+		if (format.bytesPerPixel == 2) {
+			uint16 *dst = (uint16 *)output.getBasePtr(0, i);
+			for (uint16 j = 0; j < _w; j++) {
+				YUV2RGB(y[j], u[j], v[j], r, g, b);
+				dst[j] = format.RGBToColor(r, g, b);
+			}
+		} else {
+			uint32 *dst = (uint32 *)output.getBasePtr(0, i);
+			for (uint16 j = 0; j < _w; j++) {
+				YUV2RGB(y[j], u[j], v[j], r, g, b);
+				dst[j] = format.RGBToColor(r, g, b);
+			}
+		}
+	}
+
+	return true;
+}
+
 void JPEG::reset() {
 	// Reset member variables
 	_stream = NULL;
@@ -126,6 +158,7 @@ void JPEG::reset() {
 	delete[] _scanComp; _scanComp = NULL;
 	_numScanComp = 0;
 	_currentComp = NULL;
+	_restartInterval = 0;
 
 	// Free the quantization tables
 	for (int i = 0; i < JPEG_MAX_QUANT_TABLES; i++) {
@@ -137,8 +170,7 @@ void JPEG::reset() {
 	for (int i = 0; i < 2 * JPEG_MAX_HUFF_TABLES; i++) {
 		_huff[i].count = 0;
 		delete[] _huff[i].values; _huff[i].values = NULL;
-		delete[] _huff[i].sizes; _huff[i].sizes = NULL;
-		delete[] _huff[i].codes; _huff[i].codes = NULL;
+		memset(_huff[i].lookup, 0, sizeof(_huff[i].lookup));
 	}
 }
 
@@ -207,6 +239,9 @@ bool JPEG::read(Common::SeekableReadStream *stream) {
 		case 0xDB: // Define Quantization Tables
 			ok = readDQT();
 			break;
+		case 0xDD: // Define Restart Interval
+			ok = readDRI();
+			break;
 		case 0xE0: // JFIF/JFXX segment
 			ok = readJFIF();
 			break;
@@ -303,49 +338,58 @@ bool JPEG::readDHT() {
 		tableId &= 0xF;
 		uint8 tableNum = (tableId << 1) + tableType;
 
+		// Validate the table id
+		if (tableId >= JPEG_MAX_HUFF_TABLES) {
+			warning("JPEG: Invalid Huffman table");
+			return false;
+		}
+
+		HuffmanTable &table = _huff[tableNum];
+
 		// Free the Huffman table
-		delete[] _huff[tableNum].values; _huff[tableNum].values = NULL;
-		delete[] _huff[tableNum].sizes; _huff[tableNum].sizes = NULL;
-		delete[] _huff[tableNum].codes;	_huff[tableNum].codes = NULL;
+		delete[] table.values; table.values = NULL;
+		memset(table.lookup, 0, sizeof(table.lookup));
 
 		// Read the number of values for each length
 		uint8 numValues[16];
-		_huff[tableNum].count = 0;
+		table.count = 0;
 		for (int len = 0; len < 16; len++) {
 			numValues[len] = _stream->readByte();
-			_huff[tableNum].count += numValues[len];
+			table.count += numValues[len];
 		}
 
-		// Allocate memory for the current table
-		_huff[tableNum].values = new uint8[_huff[tableNum].count];
-		_huff[tableNum].sizes = new uint8[_huff[tableNum].count];
-		_huff[tableNum].codes = new uint16[_huff[tableNum].count];
-
 		// Read the table contents
+		table.values = new uint8[table.count];
+		for (int i = 0; i < table.count; i++)
+			table.values[i] = _stream->readByte();
+
+		// Assign the Huffman codes, and fill the lookup table with the
+		// codes short enough to be decoded in one step
+		int32 curCode = 0;
 		int cur = 0;
-		for (int len = 0; len < 16; len++) {
-			for (int i = 0; i < numValues[len]; i++) {
-				_huff[tableNum].values[cur] = _stream->readByte();
-				_huff[tableNum].sizes[cur] = len + 1;
-				cur++;
-			}
-		}
+		for (int len = 1; len <= 16; len++) {
+			table.valPtr[len] = cur;
+			table.minCode[len] = curCode;
+
+			for (int i = 0; i < numValues[len - 1]; i++) {
+				if (curCode >= (1 << len)) {
+					warning("JPEG: Invalid Huffman table");
+					return false;
+				}
+
+				if (len <= kHuffLookupBits) {
+					int shift = kHuffLookupBits - len;
+					uint16 entry = (len << 8) | table.values[cur];
+					for (int j = 0; j < (1 << shift); j++)
+						table.lookup[(curCode << shift) | j] = entry;
+				}
 
-		// Fill the table of Huffman codes
-		cur = 0;
-		uint16 curCode = 0;
-		uint8 curCodeSize = _huff[tableNum].sizes[0];
-		while (cur < _huff[tableNum].count) {
-			// Increase the code size to fit the request
-			while (_huff[tableNum].sizes[cur] != curCodeSize) {
-				curCode <<= 1;
-				curCodeSize++;
+				curCode++;
+				cur++;
 			}
 
-			// Assign the current code
-			_huff[tableNum].codes[cur] = curCode;
-			curCode++;
-			cur++;
+			table.maxCode[len] = numValues[len - 1] ? curCode - 1 : -1;
+			curCode <<= 1;
 		}
 	}
 
@@ -429,7 +473,9 @@ bool JPEG::readSOS() {
 	}
 
 	// Entropy coded sequence starts, initialize Huffman decoder
+	_bitsData = 0;
 	_bitsNumber = 0;
+	_bitsMarker = false;
 
 	// Read all the scan MCUs
 	uint16 xMCU = _w / (_maxFactorH * 8);
@@ -447,9 +493,22 @@ bool JPEG::readSOS() {
 	}
 
 	bool ok = true;
-	for (int y = 0; ok && (y < yMCU); y++)
-		for (int x = 0; ok && (x < xMCU); x++)
-			ok = readMCU(x, y);
+	uint16 restartCount = _restartInterval;
+	for (int y = 0; ok && (y < yMCU); y++) {
+		for (int x = 0; ok && (x < xMCU); x++) {
+			// Handle the end of a restart interval
+			if (_restartInterval) {
+				if (restartCount == 0) {
+					ok = readRST();
+					restartCount = _restartInterval;
+				}
+				restartCount--;
+			}
+
+			if (ok)
+				ok = readMCU(x, y);
+		}
+	}
 
 	// Trim Component surfaces back to image height and width
 	// Note: Code using jpeg must use surface.pitch correctly...
@@ -474,20 +533,59 @@ bool JPEG::readDQT() {
 
 		// Validate the table id
 		tableId &= 0xF;
-		if (tableId > JPEG_MAX_QUANT_TABLES) {
+		if (tableId >= JPEG_MAX_QUANT_TABLES) {
 			warning("JPEG: Invalid number of components");
 			return false;
 		}
 
 		// Create the new table if necessary
 		if (!_quant[tableId])
-			_quant[tableId] = new uint16[64];
+			_quant[tableId] = new int32[64];
+
+		// Read the table (stored in Zig-Zag order), folding the scale
+		// factors of the IDCT into it. 12 fractional bits are kept.
+		for (int i = 0; i < 64; i++) {
+			int32 quant = highPrecision ? _stream->readUint16BE() : _stream->readByte();
+			_quant[tableId][i] = (quant * _idctScale[_zigZagOrder[i]] + 2) >> 2;
+		}
+	}
+
+	return true;
+}
+
+// Marker 0xDD (Define Restart Interval)
+bool JPEG::readDRI() {
+	debug(5, "JPEG: readDRI");
+	uint16 size = _stream->readUint16BE();
+	if (size != 4) {
+		warning("JPEG: Invalid restart interval");
+		return false;
+	}
+
+	_restartInterval = _stream->readUint16BE();
+	return true;
+}
+
+// Markers 0xD0 to 0xD7 (Restart), between the intervals of a scan
+bool JPEG::readRST() {
+	// Drop the padding bits of the finished interval
+	_bitsData = 0;
+	_bitsNumber = 0;
+	_bitsMarker = false;
+
+	uint8 marker = _stream->readByte();
+	while (marker == 0xFF && !_stream->eos())
+		marker = _stream->readByte();
 
-		// Read the table (stored in Zig-Zag order)
-		for (int i = 0; i < 64; i++)
-			_quant[tableId][i] = highPrecision ? _stream->readUint16BE() : _stream->readByte();
+	if (marker < 0xD0 || marker > 0xD7) {
+		warning("JPEG: Missing restart marker");
+		return false;
 	}
 
+	// Restart the DC prediction
+	for (int c = 0; c < _numScanComp; c++)
+		_scanComp[c]->DCpredictor = 0;
+
 	return true;
 }
 
@@ -506,81 +604,136 @@ bool JPEG::readMCU(uint16 xMCU, uint16 yMCU) {
 	return ok;
 }
 
-void JPEG::idct8x8(float result[64], const int16 dct[64]) {
-	float tmp[64];
+// Fixed point constants of the AAN IDCT, with 8 bits of fractional precision
+#define JPEG_FIX_1_082392200 277
+#define JPEG_FIX_1_414213562 362
+#define JPEG_FIX_1_847759065 473
+#define JPEG_FIX_2_613125930 669
 
-	// Apply 1D IDCT to rows
-	for (int y = 0; y < 8; y++) {
-		for (int x = 0; x < 8; x++) {
-			tmp[y + x * 8] = dct[0] * _idct8x8[x][0]
-							+ dct[1] * _idct8x8[x][1]
-							+ dct[2] * _idct8x8[x][2]
-							+ dct[3] * _idct8x8[x][3]
-							+ dct[4] * _idct8x8[x][4]
-							+ dct[5] * _idct8x8[x][5]
-							+ dct[6] * _idct8x8[x][6]
-							+ dct[7] * _idct8x8[x][7];
-		}
+#define JPEG_MULTIPLY(x, c) (((x) * (c)) >> 8)
 
-		dct += 8;
-	}
+void JPEG::idct8x8(byte result[64], int32 dct[64]) {
+	// Arai, Agui and Nakajima's scaled IDCT. The scale factors have
+	// already been applied together with the dequantization, so this only
+	// needs 5 multiplications per 1D IDCT. The coefficients carry four
+	// fractional bits, which are removed in the second pass.
+	int32 tmp[64];
 
 	// Apply 1D IDCT to columns
 	for (int x = 0; x < 8; x++) {
-		const float *u = tmp + x * 8;
-		for (int y = 0; y < 8; y++) {
-			result[y * 8 + x] = u[0] * _idct8x8[y][0]
-								+ u[1] * _idct8x8[y][1]
-								+ u[2] * _idct8x8[y][2]
-								+ u[3] * _idct8x8[y][3]
-								+ u[4] * _idct8x8[y][4]
-								+ u[5] * _idct8x8[y][5]
-								+ u[6] * _idct8x8[y][6]
-								+ u[7] * _idct8x8[y][7];
+		const int32 *in = dct + x;
+		int32 *out = tmp + x;
+
+		// Most columns only have a DC coefficient left after quantization
+		if (!in[8] && !in[16] && !in[24] && !in[32] && !in[40] && !in[48] && !in[56]) {
+			for (int y = 0; y < 8; y++)
+				out[y * 8] = in[0];
+			continue;
 		}
+
+		// Even part
+		int32 tmp10 = in[0] + in[32];
+		int32 tmp11 = in[0] - in[32];
+		int32 tmp13 = in[16] + in[48];
+		int32 tmp12 = JPEG_MULTIPLY(in[16] - in[48], JPEG_FIX_1_414213562) - tmp13;
+
+		int32 tmp0 = tmp10 + tmp13;
+		int32 tmp3 = tmp10 - tmp13;
+		int32 tmp1 = tmp11 + tmp12;
+		int32 tmp2 = tmp11 - tmp12;
+
+		// Odd part
+		int32 z13 = in[40] + in[24];
+		int32 z10 = in[40] - in[24];
+		int32 z11 = in[8] + in[56];
+		int32 z12 = in[8] - in[56];
+
+		int32 tmp7 = z11 + z13;
+		int32 z5 = JPEG_MULTIPLY(z10 + z12, JPEG_FIX_1_847759065);
+		tmp11 = JPEG_MULTIPLY(z11 - z13, JPEG_FIX_1_414213562);
+		tmp10 = JPEG_MULTIPLY(z12, JPEG_FIX_1_082392200) - z5;
+		tmp12 = z5 - JPEG_MULTIPLY(z10, JPEG_FIX_2_613125930);
+
+		int32 tmp6 = tmp12 - tmp7;
+		int32 tmp5 = tmp11 - tmp6;
+		int32 tmp4 = tmp10 + tmp5;
+
+		out[ 0] = tmp0 + tmp7;
+		out[56] = tmp0 - tmp7;
+		out[ 8] = tmp1 + tmp6;
+		out[48] = tmp1 - tmp6;
+		out[16] = tmp2 + tmp5;
+		out[40] = tmp2 - tmp5;
+		out[32] = tmp3 + tmp4;
+		out[24] = tmp3 - tmp4;
+	}
+
+	// Apply 1D IDCT to rows, removing the scaling and level shifting the
+	// values to make them unsigned
+	for (int y = 0; y < 8; y++) {
+		const int32 *in = tmp + y * 8;
+		byte *out = result + y * 8;
+
+		// Bias the DC value for rounding and the level shift
+		int32 dc = in[0] + (1 << 6) + (128 << 7);
+
+		// Even part
+		int32 tmp10 = dc + in[4];
+		int32 tmp11 = dc - in[4];
+		int32 tmp13 = in[2] + in[6];
+		int32 tmp12 = JPEG_MULTIPLY(in[2] - in[6], JPEG_FIX_1_414213562) - tmp13;
+
+		int32 tmp0 = tmp10 + tmp13;
+		int32 tmp3 = tmp10 - tmp13;
+		int32 tmp1 = tmp11 + tmp12;
+		int32 tmp2 = tmp11 - tmp12;
+
+		// Odd part
+		int32 z13 = in[5] + in[3];
+		int32 z10 = in[5] - in[3];
+		int32 z11 = in[1] + in[7];
+		int32 z12 = in[1] - in[7];
+
+		int32 tmp7 = z11 + z13;
+		int32 z5 = JPEG_MULTIPLY(z10 + z12, JPEG_FIX_1_847759065);
+		tmp11 = JPEG_MULTIPLY(z11 - z13, JPEG_FIX_1_414213562);
+		tmp10 = JPEG_MULTIPLY(z12, JPEG_FIX_1_082392200) - z5;
+		tmp12 = z5 - JPEG_MULTIPLY(z10, JPEG_FIX_2_613125930);
+
+		int32 tmp6 = tmp12 - tmp7;
+		int32 tmp5 = tmp11 - tmp6;
+		int32 tmp4 = tmp10 + tmp5;
+
+		out[0] = CLIP<int32>((tmp0 + tmp7) >> 7, 0, 255);
+		out[7] = CLIP<int32>((tmp0 - tmp7) >> 7, 0, 255);
+		out[1] = CLIP<int32>((tmp1 + tmp6) >> 7, 0, 255);
+		out[6] = CLIP<int32>((tmp1 - tmp6) >> 7, 0, 255);
+		out[2] = CLIP<int32>((tmp2 + tmp5) >> 7, 0, 255);
+		out[5] = CLIP<int32>((tmp2 - tmp5) >> 7, 0, 255);
+		out[4] = CLIP<int32>((tmp3 + tmp4) >> 7, 0, 255);
+		out[3] = CLIP<int32>((tmp3 - tmp4) >> 7, 0, 255);
 	}
 }
 
+#undef JPEG_MULTIPLY
+
 bool JPEG::readDataUnit(uint16 x, uint16 y) {
 	// Prepare an empty data array
-	int16 readData[64];
-	for (int i = 1; i < 64; i++)
-		readData[i] = 0;
+	int32 DCT[64];
+	memset(DCT, 0, sizeof(DCT));
 
-	// Read the DC component
-	readData[0] = _currentComp->DCpredictor + readDC();
-	_currentComp->DCpredictor = readData[0];
+	// Read the DC component, and dequantize it keeping four fractional bits
+	const int32 *quant = _quant[_currentComp->quantTableSelector];
+	_currentComp->DCpredictor += readDC();
+	DCT[0] = (_currentComp->DCpredictor * quant[0] + (1 << 7)) >> 8;
 
 	// Read the AC components (stored in Zig-Zag)
-	readAC(readData);
-
-	// Calculate the DCT coefficients from the input sequence
-	int16 DCT[64];
-	for (uint8 i = 0; i < 64; i++) {
-		// Dequantize
-		int16 val = readData[i];
-		int16 quant = _quant[_currentComp->quantTableSelector][i];
-		val *= quant;
-
-		// Store the normalized coefficients, undoing the Zig-Zag
-		DCT[_zigZagOrder[i]] = val;
-	}
+	readAC(DCT);
 
 	// Apply the IDCT
-	float result[64];
+	byte result[64];
 	idct8x8(result, DCT);
 
-	// Level shift to make the values unsigned
-	for (int i = 0; i < 64; i++) {
-		result[i] = result[i] + 128;
-
-		if (result[i] < 0)
-			result[i] = 0;
-
-		if (result[i] > 255)
-			result[i] = 255;
-	}
-
 	// Paint the component surface
 	uint8 scalingV = _maxFactorV / _currentComp->factorV;
 	uint8 scalingH = _maxFactorH / _currentComp->factorH;
@@ -590,13 +743,20 @@ bool JPEG::readDataUnit(uint16 x, uint16 y) {
 	y <<= 3;
 
 	for (uint8 j = 0; j < 8; j++) {
+		const byte *src = result + j * 8;
+
 		for (uint16 sV = 0; sV < scalingV; sV++) {
 			// Get the beginning of the block line
 			byte *ptr = (byte *)_currentComp->surface.getBasePtr(x * scalingH, (y + j) * scalingV + sV);
 
+			if (scalingH == 1) {
+				memcpy(ptr, src, 8);
+				continue;
+			}
+
 			for (uint8 i = 0; i < 8; i++) {
 				for (uint16 sH = 0; sH < scalingH; sH++) {
-					*ptr = (byte)(result[j * 8 + i]);
+					*ptr = src[i];
 					ptr++;
 				}
 			}
@@ -617,9 +777,10 @@ int16 JPEG::readDC() {
 	return readSignedBits(numBits);
 }
 
-void JPEG::readAC(int16 *out) {
+void JPEG::readAC(int32 *out) {
 	// AC is type 1
 	uint8 tableNum = (_currentComp->ACentropyTableSelector << 1) + 1;
+	const int32 *quant = _quant[_currentComp->quantTableSelector];
 
 	// Start reading AC element 1
 	uint8 cur = 1;
@@ -639,87 +800,100 @@ void JPEG::readAC(int16 *out) {
 		} else {
 			// Skip r values
 			cur += r;
+			if (cur >= 64)
+				break;
 
-			// Read the next value
-			out[cur] = readSignedBits(s);
+			// Read the next value, dequantize it and undo the Zig-Zag
+			out[_zigZagOrder[cur]] = (readSignedBits(s) * quant[cur] + (1 << 7)) >> 8;
 			cur++;
 		}
 	}
 }
 
 int16 JPEG::readSignedBits(uint8 numBits) {
-	uint16 ret = 0;
+	if (numBits == 0)
+		return 0;
 	if (numBits > 16) error("requested %d bits", numBits); //XXX
 
+	if (_bitsNumber < numBits)
+		fillBits();
+
 	// MSB=0 for negatives, 1 for positives
-	for (int i = 0; i < numBits; i++)
-		ret = (ret << 1) + readBit();
+	int32 ret = (_bitsData >> (_bitsNumber - numBits)) & ((1 << numBits) - 1);
+	_bitsNumber -= numBits;
 
 	// Extend sign bits (PAG109)
-	if (!(ret >> (numBits - 1)))
-	{
-		uint16 tmp = ((uint16)-1 << numBits) + 1;
-		ret = ret + tmp;
-	}
+	if (ret < (1 << (numBits - 1)))
+		ret -= (1 << numBits) - 1;
+
 	return ret;
 }
 
-// TODO: optimize?
 uint8 JPEG::readHuff(uint8 table) {
-	bool foundCode = false;
-	uint8 val = 0;
-
-	uint8 cur = 0;
-	uint8 codeSize = 1;
-	uint16 code = readBit();
-	while (!foundCode) {
-		// Prepare a code of the current size
-		while (codeSize < _huff[table].sizes[cur]) {
-			code = (code << 1) + readBit();
-			codeSize++;
-		}
+	const HuffmanTable &huff = _huff[table];
 
-		// Compare the codes of the current size
-		while (!foundCode && (codeSize == _huff[table].sizes[cur])) {
-			if (code == _huff[table].codes[cur]) {
-				// Found the code
-				val = _huff[table].values[cur];
-				foundCode = true;
-			} else {
-				// Continue reading
-				cur++;
-			}
+	if (_bitsNumber < 16)
+		fillBits();
+
+	// Most codes are short enough to be found in the lookup table
+	uint16 entry = huff.lookup[(_bitsData >> (_bitsNumber - kHuffLookupBits)) & ((1 << kHuffLookupBits) - 1)];
+	if (entry) {
+		_bitsNumber -= entry >> 8;
+		return entry & 0xFF;
+	}
+
+	// Compare the longer codes against the largest code of each size
+	for (uint8 codeSize = kHuffLookupBits + 1; codeSize <= 16; codeSize++) {
+		int32 code = (_bitsData >> (_bitsNumber - codeSize)) & ((1 << codeSize) - 1);
+		if (code <= huff.maxCode[codeSize]) {
+			_bitsNumber -= codeSize;
+			return huff.values[huff.valPtr[codeSize] + code - huff.minCode[codeSize]];
 		}
 	}
 
-	return val;
+	warning("JPEG: Invalid Huffman code in entropy data");
+	_bitsNumber -= 16;
+	return 0;
 }
 
-uint8 JPEG::readBit() {
-	// Read a whole byte if necessary
-	if (_bitsNumber == 0) {
-		_bitsData = _stream->readByte();
-		_bitsNumber = 8;
-
-		// Detect markers
-		if (_bitsData == 0xFF) {
-			uint8 byte2 = _stream->readByte();
-
-			// A stuffed 0 validates the previous byte
-			if (byte2 != 0) {
-				if (byte2 == 0xDC) {
-					// DNL marker: Define Number of Lines
-					// TODO: terminate scan
-					printf("DNL marker detected: terminate scan\n");
-				} else {
-					printf("Error: marker 0x%02X read in entropy data\n", byte2);
+void JPEG::fillBits() {
+	// Read whole bytes until at least 25 bits are buffered, which is
+	// enough for any Huffman code or any amount of extra bits
+	while (_bitsNumber <= 24) {
+		byte data = 0;
+
+		if (!_bitsMarker) {
+			data = _stream->readByte();
+
+			// Detect markers
+			if (data == 0xFF) {
+				uint8 byte2 = _stream->readByte();
+
+				// A stuffed 0 validates the previous byte
+				if (byte2 != 0) {
+					if (byte2 == 0xDC) {
+						// DNL marker: Define Number of Lines
+						// TODO: terminate scan
+						warning("JPEG: DNL marker detected: terminate scan");
+					}
+
+					// The marker ends the entropy coded data. Leave it
+					// in the stream and pad the remaining data with zeros.
+					_stream->seek(-2, SEEK_CUR);
+					_bitsMarker = true;
+					data = 0;
 				}
 			}
+
+			if (_stream->eos()) {
+				_bitsMarker = true;
+				data = 0;
+			}
 		}
-	}
-	_bitsNumber--;
 
-	return (_bitsData & (1 << _bitsNumber)) ? 1 : 0;
+		_bitsData = (_bitsData << 8) | data;
+		_bitsNumber += 8;
+	}
 }
 
 Surface *JPEG::getComponent(uint c) {
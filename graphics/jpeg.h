@@ -52,6 +52,13 @@ public:
 	Surface *getComponent(uint c);
 	Surface *getSurface(const PixelFormat &format);
 
+	/**
+	 * Convert the decoded image straight into an existing surface. The
+	 * surface has to use the given >8bpp format and must be at least
+	 * getWidth() x getHeight() pixels in size.
+	 */
+	bool convertTo(Surface &output, const PixelFormat &format);
+
 private:
 	void reset();
 
@@ -83,19 +90,35 @@ private:
 	Component **_scanComp;
 	Component *_currentComp;
 
+	// Number of MCUs between restart markers, or 0 if there are none
+	uint16 _restartInterval;
+
 	// Maximum sampling factors, used to calculate the interleaving of the MCU
 	uint8 _maxFactorV;
 	uint8 _maxFactorH;
 
-	// Quantization tables
-	uint16 *_quant[JPEG_MAX_QUANT_TABLES];
+	// Quantization tables, in Zig-Zag order and prescaled for the IDCT
+	int32 *_quant[JPEG_MAX_QUANT_TABLES];
 
 	// Huffman tables
+	enum {
+		kHuffLookupBits = 9
+	};
+
 	struct HuffmanTable {
-		uint8 count;
+		uint16 count;
 		uint8 *values;
-		uint8 *sizes;
-		uint16 *codes;
+
+		// Smallest and largest code of each length, and the index of the
+		// first value using that length
+		int32 minCode[17];
+		int32 maxCode[17];
+		int32 valPtr[17];
+
+		// Size and value of all codes of up to kHuffLookupBits bits,
+		// indexed by the next kHuffLookupBits bits of the stream. The size
+		// is stored in the upper 8 bits; 0 marks a longer code.
+		uint16 lookup[1 << kHuffLookupBits];
 	} _huff[2 * JPEG_MAX_HUFF_TABLES];
 
 	// Marker read functions
@@ -104,22 +127,25 @@ private:
 	bool readDHT();
 	bool readSOS();
 	bool readDQT();
+	bool readDRI();
+	bool readRST();
 
 	// Helper functions
 	bool readMCU(uint16 xMCU, uint16 yMCU);
 	bool readDataUnit(uint16 x, uint16 y);
 	int16 readDC();
-	void readAC(int16 *out);
+	void readAC(int32 *out);
 	int16 readSignedBits(uint8 numBits);
 
 	// Huffman decoding
 	uint8 readHuff(uint8 table);
-	uint8 readBit();
-	uint8 _bitsData;
+	void fillBits();
+	uint32 _bitsData;
 	uint8 _bitsNumber;
+	bool _bitsMarker;
 
 	// Inverse Discrete Cosine Transformation
-	void idct8x8(float dst[64], const int16 src[64]);
+	void idct8x8(byte dst[64], int32 src[64]);
 };
 
 } // End of Graphics namespace
@@ -27,8 +27,8 @@
 #include "graphics/png.h"
 #include "graphics/pixelformat.h"
 
+#include "common/array.h"
 #include "common/endian.h"
-#include "common/memstream.h"
 #include "common/stream.h"
 #include "common/util.h"
 #include "common/zlib.h"
@@ -101,8 +101,124 @@ enum PNGFilters {
 
 #define PNG_HEADER(a, b, c, d) CONSTANT_LE_32(d | (c << 8) | (b << 16) | (a << 24))
 
-PNG::PNG() : _compressedBuffer(0), _compressedBufferSize(0), 
-			_unfilteredSurface(0), _transparentColorSpecified(false) {
+/**
+ * Presents the contents of the consecutive IDAT chunks of a PNG file as one
+ * stream, so that the image data can be inflated straight from the file,
+ * without first collecting it in a separate buffer.
+ */
+class PNGImageDataStream : public Common::SeekableReadStream {
+public:
+	/**
+	 * Creates the stream. The file has to be positioned at the data of the
+	 * first IDAT chunk, whose length is given.
+	 */
+	PNGImageDataStream(Common::SeekableReadStream *file, uint32 firstChunkLength) :
+		_file(file), _size(0), _pos(0), _chunk(0), _eos(false) {
+
+		// Locate all the IDAT chunks
+		uint32 chunkLength = firstChunkLength;
+		uint32 chunkType = kChunkIDAT;
+		while (chunkType == kChunkIDAT && !_file->eos()) {
+			Chunk chunk;
+			chunk.filePos = _file->pos();
+			chunk.dataPos = _size;
+			chunk.length = chunkLength;
+			_chunks.push_back(chunk);
+			_size += chunkLength;
+
+			// Skip the chunk data and the CRC checksum
+			_file->seek(chunkLength + 4, SEEK_CUR);
+			_endPos = _file->pos() - 4;
+
+			chunkLength = _file->readUint32BE();
+			chunkType = _file->readUint32BE();
+		}
+
+		_file->seek(_chunks[0].filePos, SEEK_SET);
+	}
+
+	/**
+	 * Returns the position of the CRC checksum of the last IDAT chunk in the
+	 * file.
+	 */
+	int32 getEndPos() const { return _endPos; }
+
+	bool eos() const { return _eos; }
+	void clearErr() { _eos = false; }
+	int32 pos() const { return _pos; }
+	int32 size() const { return _size; }
+
+	uint32 read(void *dataPtr, uint32 dataSize) {
+		byte *dst = (byte *)dataPtr;
+		uint32 total = 0;
+
+		while (dataSize > 0) {
+			// Move on to the chunk containing the current position
+			while (_chunk < _chunks.size() && _pos >= _chunks[_chunk].dataPos + _chunks[_chunk].length) {
+				_chunk++;
+				if (_chunk < _chunks.size())
+					_file->seek(_chunks[_chunk].filePos, SEEK_SET);
+			}
+
+			if (_chunk >= _chunks.size()) {
+				_eos = true;
+				break;
+			}
+
+			uint32 n = MIN(dataSize, _chunks[_chunk].dataPos + _chunks[_chunk].length - _pos);
+			n = _file->read(dst, n);
+			if (n == 0) {
+				_eos = true;
+				break;
+			}
+
+			dst += n;
+			dataSize -= n;
+			total += n;
+			_pos += n;
+		}
+
+		return total;
+	}
+
+	bool seek(int32 offset, int whence = SEEK_SET) {
+		if (whence == SEEK_CUR)
+			offset += _pos;
+		else if (whence == SEEK_END)
+			offset += _size;
+
+		if (offset < 0 || (uint32)offset > _size)
+			return false;
+
+		_pos = offset;
+		_eos = false;
+
+		// Find the chunk containing the new position
+		_chunk = 0;
+		while (_chunk + 1 < _chunks.size() && _pos >= _chunks[_chunk].dataPos + _chunks[_chunk].length)
+			_chunk++;
+		_file->seek(_chunks[_chunk].filePos + (_pos - _chunks[_chunk].dataPos), SEEK_SET);
+
+		return true;
+	}
+
+private:
+	struct Chunk {
+		int32 filePos;	// offset of the chunk data in the file
+		uint32 dataPos;	// offset of the chunk data in this stream
+		uint32 length;
+	};
+
+	Common::SeekableReadStream *_file;
+	Common::Array<Chunk> _chunks;
+	uint32 _size;
+	uint32 _pos;
+	uint _chunk;
+	int32 _endPos;
+	bool _eos;
+};
+
+PNG::PNG() : _imageData(0), _unfilteredSurface(0), _transparentColorSpecified(false) {
 }
 
 PNG::~PNG() {
@@ -115,88 +231,75 @@ PNG::~PNG() {
 Graphics::Surface *PNG::getSurface(const PixelFormat &format) {
 	Graphics::Surface *output = new Graphics::Surface();
 	output->create(_unfilteredSurface->w, _unfilteredSurface->h, format.bytesPerPixel);
-	byte *src = (byte *)_unfilteredSurface->pixels;
-	byte a = 0xFF;
-
-	if (_header.colorType != kIndexed) {
-		if (_header.colorType == kTrueColor || _header.colorType == kTrueColorWithAlpha) {
-			if (_unfilteredSurface->bytesPerPixel != 3 && _unfilteredSurface->bytesPerPixel != 4)
-				error("Unsupported truecolor PNG format");
-		} else if (_header.colorType == kGrayScale || _header.colorType == kGrayScaleWithAlpha) {
-			if (_unfilteredSurface->bytesPerPixel != 1 && _unfilteredSurface->bytesPerPixel != 2)
-				error("Unsupported grayscale PNG format");
-		}
 
-		for (uint16 i = 0; i < output->h; i++) {
-			for (uint16 j = 0; j < output->w; j++) {
-				if (format.bytesPerPixel == 2) {
-					if (_unfilteredSurface->bytesPerPixel == 1) {		// Grayscale
-						if (_transparentColorSpecified)
-							a = (src[0] == _transparentColor[0]) ? 0 : 0xFF;
-						*((uint16 *)output->getBasePtr(j, i)) = format.ARGBToColor(    a, src[0], src[0], src[0]);
-					} else if (_unfilteredSurface->bytesPerPixel == 2) {	// Grayscale + alpha
-						*((uint16 *)output->getBasePtr(j, i)) = format.ARGBToColor(src[1], src[0], src[0], src[0]);
-					} else if (_unfilteredSurface->bytesPerPixel == 3) {	// RGB
-						if (_transparentColorSpecified) {
-							bool isTransparentColor = (src[0] == _transparentColor[0] &&
-													   src[1] == _transparentColor[1] &&
-													   src[2] == _transparentColor[2]);
-							a = isTransparentColor ? 0 : 0xFF;
-						}
-						*((uint16 *)output->getBasePtr(j, i)) = format.ARGBToColor(     a, src[0], src[1], src[2]);
-					} else if (_unfilteredSurface->bytesPerPixel == 4) {	// RGBA
-						*((uint16 *)output->getBasePtr(j, i)) = format.ARGBToColor(src[3], src[0], src[1], src[2]);
-					}
-				} else {
-					if (_unfilteredSurface->bytesPerPixel == 1) {		// Grayscale
-						if (_transparentColorSpecified)
-							a = (src[0] == _transparentColor[0]) ? 0 : 0xFF;
-						*((uint32 *)output->getBasePtr(j, i)) = format.ARGBToColor(     a, src[0], src[0], src[0]);
-					} else if (_unfilteredSurface->bytesPerPixel == 2) {	// Grayscale + alpha
-						*((uint32 *)output->getBasePtr(j, i)) = format.ARGBToColor(src[1], src[0], src[0], src[0]);
-					} else if (_unfilteredSurface->bytesPerPixel == 3) {	// RGB
-						if (_transparentColorSpecified) {
-							bool isTransparentColor = (src[0] == _transparentColor[0] &&
-													   src[1] == _transparentColor[1] &&
-													   src[2] == _transparentColor[2]);
-							a = isTransparentColor ? 0 : 0xFF;
-						}
-						*((uint32 *)output->getBasePtr(j, i)) = format.ARGBToColor(     a, src[0], src[1], src[2]);
-					} else if (_unfilteredSurface->bytesPerPixel == 4) {	// RGBA
-						*((uint32 *)output->getBasePtr(j, i)) = format.ARGBToColor(src[3], src[0], src[1], src[2]);
-					}
-				}
-
-				src += _unfilteredSurface->bytesPerPixel;
-			}
-		}
-	} else {
-		byte index, r, g, b;
-
-		// Convert the indexed surface to the target pixel format
-		for (uint16 i = 0; i < output->h; i++) {
-			for (uint16 j = 0; j < output->w; j++) {
-				index = *src;
-				r = _palette[index * 4 + 0];
-				g = _palette[index * 4 + 1];
-				b = _palette[index * 4 + 2];
-				a = _palette[index * 4 + 3];
-
-				if (format.bytesPerPixel == 2)
-					*((uint16 *)output->getBasePtr(j, i)) = format.ARGBToColor(a, r, g, b);
-				else
-					*((uint32 *)output->getBasePtr(j, i)) = format.ARGBToColor(a, r, g, b);
-
-				src++;
+	for (uint16 i = 0; i < output->h; i++)
+		convertScanLine((byte *)output->getBasePtr(0, i), (const byte *)_unfilteredSurface->getBasePtr(0, i), format);
+
+	return output;
+}
+
+void PNG::convertScanLine(byte *dest, const byte *src, const PixelFormat &format) {
+	byte r = 0, g = 0, b = 0, a = 0xFF;
+
+	for (uint32 x = 0; x < _header.width; x++) {
+		switch (_header.colorType) {
+		case kGrayScale:
+			if (_transparentColorSpecified)
+				a = (src[0] == _transparentColor[0]) ? 0 : 0xFF;
+			r = g = b = src[0];
+			src += 1;
+			break;
+		case kTrueColor:
+			if (_transparentColorSpecified) {
+				bool isTransparentColor = (src[0] == _transparentColor[0] &&
+										   src[1] == _transparentColor[1] &&
+										   src[2] == _transparentColor[2]);
+				a = isTransparentColor ? 0 : 0xFF;
 			}
+			r = src[0];
+			g = src[1];
+			b = src[2];
+			src += 3;
+			break;
+		case kIndexed:
+			r = _palette[src[0] * 4 + 0];
+			g = _palette[src[0] * 4 + 1];
+			b = _palette[src[0] * 4 + 2];
+			a = _palette[src[0] * 4 + 3];
+			src += 1;
+			break;
+		case kGrayScaleWithAlpha:
+			r = g = b = src[0];
+			a = src[1];
+			src += 2;
+			break;
+		case kTrueColorWithAlpha:
+			r = src[0];
+			g = src[1];
+			b = src[2];
+			a = src[3];
+			src += 4;
+			break;
 		}
-	}
 
-	return output;
+		if (format.bytesPerPixel == 2)
+			((uint16 *)dest)[x] = format.ARGBToColor(a, r, g, b);
+		else
+			((uint32 *)dest)[x] = format.ARGBToColor(a, r, g, b);
+	}
 }
 
 bool PNG::read(Common::SeekableReadStream *str) {
+	return readImage(str, 0, 0);
+}
+
+bool PNG::read(Common::SeekableReadStream *str, Graphics::Surface &output, const PixelFormat &format) {
+	return readImage(str, &output, &format);
+}
+
+bool PNG::readImage(Common::SeekableReadStream *str, Graphics::Surface *output, const PixelFormat *format) {
 	uint32 chunkLength = 0, chunkType = 0;
+	bool imageRead = false;
 	_stream = str;
 
 	// First, check the PNG signature
@@ -219,24 +322,32 @@ bool PNG::read(Common::SeekableReadStream *str) {
 		case kChunkIHDR:
 			readHeaderChunk();
 			break;
-		case kChunkIDAT:
-			if (_compressedBufferSize == 0) {
-				_compressedBufferSize += chunkLength;
-				_compressedBuffer = new byte[_compressedBufferSize];
-				_stream->read(_compressedBuffer, chunkLength);
-			} else {
-				// Expand the buffer
-				uint32 prevSize = _compressedBufferSize;
-				_compressedBufferSize += chunkLength;
-				byte *tmp = new byte[prevSize];
-				memcpy(tmp, _compressedBuffer, prevSize);
-				delete[] _compressedBuffer;
-				_compressedBuffer = new byte[_compressedBufferSize];
-				memcpy(_compressedBuffer, tmp, prevSize);
-				delete[] tmp;
-				_stream->read(_compressedBuffer + prevSize, chunkLength);
-			}
+		case kChunkIDAT: {
+			if (imageRead)
+				error("The image data chunks of a PNG file are not consecutive");
+
+			// All the critical chunks needed to interpret the image data
+			// precede it, so the image can be decoded while it is read.
+			PNGImageDataStream *compData = new PNGImageDataStream(_stream, chunkLength);
+			int32 endPos = compData->getEndPos();
+
+			// The image data is only read sequentially, so there is no need
+			// for seek checkpoints
+			_imageData = Common::wrapCompressedReadStream(compData, 0);
+
+			// Construct the final image
+			constructImage(output, format);
+
+			// Close the uncompressed stream, which will also delete the
+			// image data stream
+			delete _imageData;
+			_imageData = 0;
+
+			// Continue after the last image data chunk
+			_stream->seek(endPos, SEEK_SET);
+			imageRead = true;
 			break;
+		}
 		case kChunkPLTE:	// only available in indexed PNGs
 			if (_header.colorType != kIndexed)
 				error("A palette chunk has been found in a non-indexed PNG file");
@@ -259,24 +370,20 @@ bool PNG::read(Common::SeekableReadStream *str) {
 
 		if (chunkType != kChunkIEND)
 			_stream->skip(4);	// skip the chunk CRC checksum
+
+		if (_stream->eos()) {
+			warning("Unexpected end of PNG file");
+			delete _stream;
+			_stream = 0;
+			return false;
+		}
 	}
 
 	// We no longer need the file stream, thus close it here
 	delete _stream;
 	_stream = 0;
 
-	// Unpack the compressed buffer
-	Common::MemoryReadStream *compData = new Common::MemoryReadStream(_compressedBuffer, _compressedBufferSize, DisposeAfterUse::YES);
-	_imageData = Common::wrapCompressedReadStream(compData);
-	
-	// Construct the final image
-	constructImage();
-
-	// Close the uncompressed stream, which will also delete the memory stream,
-	// and thus the original compressed buffer
-	delete _imageData;
-
-	return true;
+	return imageRead;
 }
 
 /**
@@ -302,105 +409,137 @@ byte PNG::paethPredictor(int16 a, int16 b, int16 c) {
 }
 
 /**
- * Unfilters a filtered PNG scan line.
+ * Unfilters a filtered PNG scan line in place.
  * PNG filters are defined in: http://www.w3.org/TR/PNG/#9Filters
  * Note that filters are always applied to bytes
  *
+ * The first scan line has no previous one, which is the same as a previous
+ * line of zeros. The filters are simplified accordingly, so that each loop
+ * only does the work actually needed. The Up filter has no dependency
+ * between bytes, and can be vectorized by the compiler.
+ *
  * Taken from lodePNG
  */
-void PNG::unfilterScanLine(byte *dest, const byte *scanLine, const byte *prevLine, uint16 byteWidth, byte filterType, uint16 length) {
-	uint16 i;
+void PNG::unfilterScanLine(byte *scanLine, const byte *prevLine, uint16 byteWidth, byte filterType, uint32 length) {
+	uint32 i;
+
+	if (!prevLine) {
+		if (filterType == kFilterUp)
+			filterType = kFilterNone;	// adding zeros
+		else if (filterType == kFilterPaeth)
+			filterType = kFilterSub;	// paethPredictor(a, 0, 0) is always a
+	}
 
 	switch (filterType) {
 	case kFilterNone:		// no change
-		for (i = 0; i < length; i++)
-			dest[i] = scanLine[i];
 		break;
 	case kFilterSub:		// add the bytes to the left
-		for (i = 0; i < byteWidth; i++)
-			dest[i] = scanLine[i];
 		for (i = byteWidth; i < length; i++)
-			dest[i] = scanLine[i] + dest[i - byteWidth];
+			scanLine[i] += scanLine[i - byteWidth];
 		break;
 	case kFilterUp:			// add the bytes of the above scanline
-		if (prevLine) {
-			for (i = 0; i < length; i++)
-				dest[i] = scanLine[i] + prevLine[i];
-		} else {
-			for (i = 0; i < length; i++)
-				dest[i] = scanLine[i];
-		}
+		for (i = 0; i < length; i++)
+			scanLine[i] += prevLine[i];
 		break;
 	case kFilterAverage:	// average value of the left and top left
 		if (prevLine) {
 			for (i = 0; i < byteWidth; i++)
-				dest[i] = scanLine[i] + prevLine[i] / 2;
+				scanLine[i] += prevLine[i] / 2;
 			for (i = byteWidth; i < length; i++)
-				dest[i] = scanLine[i] + ((dest[i - byteWidth] + prevLine[i]) / 2);
+				scanLine[i] += (scanLine[i - byteWidth] + prevLine[i]) / 2;
 		} else {
-			for (i = 0; i < byteWidth; i++)
-				dest[i] = scanLine[i];
 			for (i = byteWidth; i < length; i++)
-				dest[i] = scanLine[i] + dest[i - byteWidth] / 2;
+				scanLine[i] += scanLine[i - byteWidth] / 2;
 		}
 		break;
 	case kFilterPaeth:		// Paeth filter: http://www.w3.org/TR/PNG/#9Filter-type-4-Paeth
-		if (prevLine) {
-			for(i = 0; i < byteWidth; i++)
-				dest[i] = (scanLine[i] + prevLine[i]); // paethPredictor(0, prevLine[i], 0) is always prevLine[i]
-			for(i = byteWidth; i < length; i++)
-				dest[i] = (scanLine[i] + paethPredictor(dest[i - byteWidth], prevLine[i], prevLine[i - byteWidth]));
-		} else {
-			for(i = 0; i < byteWidth; i++)
-				dest[i] = scanLine[i];
-			for(i = byteWidth; i < length; i++)
-				dest[i] = (scanLine[i] + dest[i - byteWidth]); // paethPredictor(dest[i - byteWidth], 0, 0) is always dest[i - byteWidth]
-		}
+		for (i = 0; i < byteWidth; i++)
+			scanLine[i] += prevLine[i]; // paethPredictor(0, prevLine[i], 0) is always prevLine[i]
+		for (i = byteWidth; i < length; i++)
+			scanLine[i] += paethPredictor(scanLine[i - byteWidth], prevLine[i], prevLine[i - byteWidth]);
 		break;
 	default:
 		error("Unknown line filter");
 	}
-
 }
 
-void PNG::constructImage() {
-	assert (_header.bitDepth != 0);
+void PNG::expandScanLine(byte *dest, const byte *scanLine) {
+	const byte bitDepth = _header.bitDepth;
+	const byte mask = (1 << bitDepth) - 1;
 
-	byte *dest;
-	byte *scanLine;
-	byte *prevLine = 0;
-	byte filterType;
-	uint16 scanLineWidth = (_header.width * getNumColorChannels() * _header.bitDepth + 7) / 8;
+	// Grayscale samples are scaled to the full 8 bit range, palette indices
+	// are kept as they are
+	const byte scale = (_header.colorType == kGrayScale) ? 0xFF / mask : 1;
 
-	if (_unfilteredSurface) {
-		_unfilteredSurface->free();
-		delete _unfilteredSurface;
+	for (uint32 x = 0; x < _header.width; x++) {
+		uint32 bitPos = x * bitDepth;
+		dest[x] = ((scanLine[bitPos >> 3] >> (8 - bitDepth - (bitPos & 7))) & mask) * scale;
 	}
-	_unfilteredSurface = new Graphics::Surface();
-	_unfilteredSurface->create(_header.width, _header.height, (getNumColorChannels() * _header.bitDepth + 7) / 8);
-	scanLine = new byte[_unfilteredSurface->pitch];
-	dest = (byte *)_unfilteredSurface->getBasePtr(0, 0);
-
-	switch(_header.interlaceType) {
-	case kNonInterlaced:
-		for (uint16 y = 0; y < _unfilteredSurface->h; y++) {
-			filterType = _imageData->readByte();
-			_imageData->read(scanLine, scanLineWidth);
-			unfilterScanLine(dest, scanLine, prevLine, _unfilteredSurface->bytesPerPixel, filterType, scanLineWidth);
-			prevLine = dest;
-			dest += _unfilteredSurface->pitch;
-		}
-		break;
-	case kInterlaced:
+}
+
+void PNG::constructImage(Graphics::Surface *output, const PixelFormat *format) {
+	assert (_header.bitDepth != 0);
+
+	if (_header.interlaceType != kNonInterlaced) {
 		// Theoretically, this shouldn't be needed, as interlacing is only
 		// useful for web images. Interlaced PNG images require more complex
 		// handling, so unless having support for such images is needed, there
 		// is no reason to add support for them.
 		error("TODO: Support for interlaced PNG images");
-		break;
 	}
 
-	delete[] scanLine;
+	// Filters work on whole pixels, or on bytes for bit depths below 8
+	byte bytesPerPixel = (getNumColorChannels() * _header.bitDepth + 7) / 8;
+	uint32 scanLineWidth = (_header.width * getNumColorChannels() * _header.bitDepth + 7) / 8;
+
+	if (output) {
+		assert(format && output->bytesPerPixel == format->bytesPerPixel);
+		assert(format->bytesPerPixel == 2 || format->bytesPerPixel == 4);
+		assert(output->w >= _header.width && output->h >= _header.height);
+	} else {
+		if (_unfilteredSurface) {
+			_unfilteredSurface->free();
+			delete _unfilteredSurface;
+		}
+		_unfilteredSurface = new Graphics::Surface();
+		_unfilteredSurface->create(_header.width, _header.height, bytesPerPixel);
+	}
+
+	// Scan lines are unfiltered in place, so all that is needed apart from
+	// the output is the current and the previous line. When keeping the
+	// unfiltered surface around with 8 bit samples, the lines are read
+	// straight into it.
+	bool directLines = !output && _header.bitDepth == 8;
+	byte *lines = directLines ? 0 : new byte[2 * scanLineWidth];
+	byte *expandedLine = (output && _header.bitDepth < 8) ? new byte[_header.width] : 0;
+	byte *prevLine = 0;
+
+	for (uint32 y = 0; y < _header.height; y++) {
+		byte *scanLine;
+		if (directLines)
+			scanLine = (byte *)_unfilteredSurface->getBasePtr(0, y);
+		else
+			scanLine = lines + (y & 1) * scanLineWidth;
+
+		byte filterType = _imageData->readByte();
+		_imageData->read(scanLine, scanLineWidth);
+		unfilterScanLine(scanLine, prevLine, bytesPerPixel, filterType, scanLineWidth);
+		prevLine = scanLine;
+
+		if (output) {
+			const byte *pixels = scanLine;
+			if (expandedLine) {
+				expandScanLine(expandedLine, scanLine);
+				pixels = expandedLine;
+			}
+			convertScanLine((byte *)output->getBasePtr(0, y), pixels, *format);
+		} else if (!directLines) {
+			expandScanLine((byte *)_unfilteredSurface->getBasePtr(0, y), scanLine);
+		}
+	}
+
+	delete[] lines;
+	delete[] expandedLine;
 }
 
 void PNG::readHeaderChunk() {
@@ -455,6 +594,9 @@ void PNG::readTransparencyChunk(uint32 chunkLength) {
 	switch(_header.colorType) {
 	case kGrayScale:
 		_transparentColor[0] = _stream->readUint16BE();
+		// Match the scaling of samples with less than 8 bits
+		if (_header.bitDepth < 8)
+			_transparentColor[0] *= 0xFF / ((1 << _header.bitDepth) - 1);
 		_transparentColor[1] = _transparentColor[0];
 		_transparentColor[2] = _transparentColor[0];
 		break;
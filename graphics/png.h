@@ -95,6 +95,16 @@ public:
 	 */
 	bool read(Common::SeekableReadStream *str);
 
+	/**
+	 * Reads a PNG image from the specified stream, and decodes it row by row
+	 * straight into the given surface, converting it to the specified 16bpp
+	 * or 32bpp pixel format. The surface has to be at least as large as the
+	 * image. Apart from the output, only two scan lines are kept in memory.
+	 *
+	 * getSurface() and getIndexedSurface() can't be used afterwards.
+	 */
+	bool read(Common::SeekableReadStream *str, Graphics::Surface &output, const PixelFormat &format);
+
 	/**
 	 * Returns the information obtained from the PNG header.
 	 */
@@ -133,8 +143,11 @@ private:
 	void readPaletteChunk();
 	void readTransparencyChunk(uint32 chunkLength);
 
-	void constructImage();
-	void unfilterScanLine(byte *dest, const byte *scanLine, const byte *prevLine, uint16 byteWidth, byte filterType, uint16 length);
+	bool readImage(Common::SeekableReadStream *str, Graphics::Surface *output, const PixelFormat *format);
+	void constructImage(Graphics::Surface *output, const PixelFormat *format);
+	void unfilterScanLine(byte *scanLine, const byte *prevLine, uint16 byteWidth, byte filterType, uint32 length);
+	void expandScanLine(byte *dest, const byte *scanLine);
+	void convertScanLine(byte *dest, const byte *src, const PixelFormat &format);
 	byte paethPredictor(int16 a, int16 b, int16 c);
 
 	// The original file stream
@@ -149,9 +162,6 @@ private:
 	uint16 _transparentColor[3];
 	bool _transparentColorSpecified;
 
-	byte *_compressedBuffer;
-	uint32 _compressedBufferSize;
-
 	Graphics::Surface *_unfilteredSurface;
 };
 
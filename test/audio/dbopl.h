@@ -0,0 +1,115 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/softsynth/opl/dbopl.h"
+
+#ifndef DISABLE_DOSBOX_OPL
+
+class DBOPLTestSuite : public CxxTest::TestSuite
+{
+private:
+	uint32 _seed;
+
+	uint32 random(uint32 max) {
+		_seed = _seed * 1103515245 + 12345;
+		return (_seed >> 16) % max;
+	}
+
+	// Write a random operator or channel register, of either register
+	// bank if opl3 is set
+	void writeRandomRegister(OPL::DOSBox::DBOPL::Chip &chip, bool opl3) {
+		static const uint8 opOffsets[18] = {
+			0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x08, 0x09, 0x0a,
+			0x0b, 0x0c, 0x0d, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15
+		};
+		const uint32 bank = (opl3 && random(2)) ? 0x100 : 0;
+		const uint32 op = opOffsets[random(18)];
+		const uint32 ch = random(9);
+
+		switch (random(10)) {
+		case 0:
+			chip.WriteReg(bank | (0x20 + op), random(256));
+			break;
+		case 1:
+			// Keep the attenuation low enough to hear something
+			chip.WriteReg(bank | (0x40 + op), random(256) & 0xdf);
+			break;
+		case 2:
+			chip.WriteReg(bank | (0x60 + op), random(256));
+			break;
+		case 3:
+			chip.WriteReg(bank | (0x80 + op), random(256));
+			break;
+		case 4:
+			chip.WriteReg(bank | (0xe0 + op), random(8));
+			break;
+		case 5:
+			chip.WriteReg(bank | (0xa0 + ch), random(256));
+			break;
+		case 6:
+		case 7:
+			// Key on or off with a new frequency
+			chip.WriteReg(bank | (0xa0 + ch), random(256));
+			chip.WriteReg(bank | (0xb0 + ch), random(64));
+			break;
+		case 8:
+			chip.WriteReg(bank | (0xc0 + ch), random(256));
+			break;
+		case 9:
+			if (!random(4))
+				chip.WriteReg(0xbd, random(256));
+			else if (opl3 && !random(4))
+				chip.WriteReg(0x104, random(64));
+			else
+				chip.WriteReg(bank | (0xb0 + ch), random(64));
+			break;
+		}
+	}
+
+	// Render a stream of random register writes and return a hash of the
+	// output, so that changes to the emulator can be checked for being
+	// sample exact
+	uint32 renderHash(uint32 rate, bool opl3, int seconds) {
+		OPL::DOSBox::DBOPL::InitTables();
+		OPL::DOSBox::DBOPL::Chip chip;
+		chip.Setup(rate);
+
+		chip.WriteReg(0x01, 0x20);
+		if (opl3)
+			chip.WriteReg(0x105, 0x01);
+
+		_seed = opl3 ? 3 : 2;
+		for (int i = 0; i < 400; ++i)
+			writeRandomRegister(chip, opl3);
+
+		int32 buffer[512 * 2];
+		uint32 hash = 2166136261U;
+		uint32 left = rate * seconds;
+		while (left > 0) {
+			const uint32 samples = MIN<uint32>(left, 1 + random(512));
+			if (opl3)
+				chip.GenerateBlock3(samples, buffer);
+			else
+				chip.GenerateBlock2(samples, buffer);
+
+			for (uint32 i = 0; i < samples * (opl3 ? 2 : 1); ++i)
+				hash = (hash ^ (uint32)buffer[i]) * 16777619U;
+			left -= samples;
+
+			for (int i = random(24); i > 0; --i)
+				writeRandomRegister(chip, opl3);
+		}
+
+		return hash;
+	}
+
+public:
+	void test_opl2_output() {
+		TS_ASSERT_EQUALS(renderHash(22050, false, 10), 4236350457u);
+	}
+
+	void test_opl3_output() {
+		TS_ASSERT_EQUALS(renderHash(44100, true, 10), 934501724u);
+	}
+};
+
+#endif // !DISABLE_DOSBOX_OPL
@@ -0,0 +1,126 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/softsynth/emumidi.h"
+
+#include "common/array.h"
+
+// Records where in its output every event is applied
+class EmulatedTestDriver : public MidiDriver_Emulated {
+public:
+	uint32 pos;
+	Common::Array<uint32> eventPos;
+	Common::Array<uint32> events;
+	uint generateCalls;
+
+	EmulatedTestDriver(int rate, int baseFreq, bool scheduleEvents)
+		: MidiDriver_Emulated(0), pos(0), generateCalls(0), _rate(rate) {
+		_baseFreq = baseFreq;
+		_scheduleEvents = scheduleEvents;
+	}
+
+	void close() {}
+
+	void send(uint32 b) {
+		if (scheduleEvent(b))
+			return;
+		eventPos.push_back(pos);
+		events.push_back(b);
+	}
+
+	void sysEx(const byte *msg, uint16 length) {
+		if (scheduleSysEx(msg, length))
+			return;
+		eventPos.push_back(pos);
+		events.push_back(0xF0 | (msg[0] << 8) | (length << 16));
+	}
+
+	MidiChannel *allocateChannel() { return 0; }
+	MidiChannel *getPercussionChannel() { return 0; }
+
+	bool isStereo() const { return false; }
+	int getRate() const { return _rate; }
+
+protected:
+	void generateSamples(int16 *buf, int len) {
+		for (int i = 0; i < len; ++i)
+			buf[i] = (int16)pos++;
+		generateCalls++;
+	}
+
+private:
+	int _rate;
+};
+
+class EmulatedMidiTestSuite : public CxxTest::TestSuite
+{
+private:
+	struct Player {
+		EmulatedTestDriver *driver;
+		uint ticks;
+	};
+
+	// Sends messages on most ticks and SysEx data on some of them
+	static void timerProc(void *param) {
+		Player *player = (Player *)param;
+		const uint tick = player->ticks++;
+		if (tick % 5 != 4)
+			player->driver->send(0x90 | ((tick & 0x7F) << 8) | (0x40 << 16));
+		if (tick % 3 == 0) {
+			byte data[4] = { (byte)(tick & 0x7F), 1, 2, 3 };
+			player->driver->sysEx(data, 1 + tick % 4);
+		}
+	}
+
+	// Renders the same buffers with and without scheduled events, and checks
+	// that every event is applied at the same position
+	void compare(int rate, int baseFreq, const int *lengths, int count) {
+		EmulatedTestDriver ticked(rate, baseFreq, false);
+		EmulatedTestDriver scheduled(rate, baseFreq, true);
+		Player tickedPlayer = { &ticked, 0 };
+		Player scheduledPlayer = { &scheduled, 0 };
+
+		ticked.open();
+		scheduled.open();
+		ticked.setTimerCallback(&tickedPlayer, timerProc);
+		scheduled.setTimerCallback(&scheduledPlayer, timerProc);
+
+		int16 buffer[1024];
+		for (int i = 0; i < count; ++i) {
+			ticked.readBuffer(buffer, lengths[i]);
+			scheduled.readBuffer(buffer, lengths[i]);
+			// The output is contiguous
+			TS_ASSERT_EQUALS(buffer[0], (int16)(scheduled.pos - lengths[i]));
+		}
+
+		TS_ASSERT_EQUALS(ticked.pos, scheduled.pos);
+		TS_ASSERT_EQUALS(tickedPlayer.ticks, scheduledPlayer.ticks);
+		TS_ASSERT(ticked.events.size() > 0);
+		TS_ASSERT_EQUALS(ticked.events.size(), scheduled.events.size());
+		for (uint i = 0; i < ticked.events.size() && i < scheduled.events.size(); ++i) {
+			TS_ASSERT_EQUALS(ticked.events[i], scheduled.events[i]);
+			TS_ASSERT_EQUALS(ticked.eventPos[i], scheduled.eventPos[i]);
+		}
+
+		// Only the event positions and the buffer ends split the output
+		TS_ASSERT(scheduled.generateCalls <= scheduled.events.size() + count);
+	}
+
+public:
+	void test_fractional_tick_length() {
+		// 3.2 samples per tick, like the MT-32 driver at 32 kHz
+		const int lengths[] = { 1, 2, 3, 7, 64, 100, 333, 512, 1000, 1, 999 };
+		compare(32000, 10000, lengths, ARRAYSIZE(lengths));
+	}
+
+	void test_tick_at_buffer_end() {
+		// 10 samples per tick, so that ticks fall exactly on buffer ends
+		const int lengths[] = { 10, 10, 20, 5, 5, 30, 10, 1, 9, 100 };
+		compare(1000, 100, lengths, ARRAYSIZE(lengths));
+	}
+
+	void test_long_ticks() {
+		// Several buffers per tick
+		const int lengths[] = { 17, 50, 256, 3, 700, 1024, 88, 400 };
+		compare(22050, 250, lengths, ARRAYSIZE(lengths));
+	}
+};
@@ -0,0 +1,133 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/audiostream.h"
+#include "audio/mixer.h"
+#include "audio/rate.h"
+
+#include "helper.h"
+
+class RateConverterTestSuite : public CxxTest::TestSuite
+{
+private:
+	Audio::SeekableAudioStream *createConstantStream(const int sampleRate, const int samples, const int16 value, const bool isStereo) {
+		int16 *data = (int16 *)malloc(sizeof(int16) * samples * (isStereo ? 2 : 1));
+		for (int i = 0; i < samples * (isStereo ? 2 : 1); ++i)
+			WRITE_LE_UINT16(&data[i], value);
+
+		Common::SeekableReadStream *sD = new Common::MemoryReadStream((const byte *)data, sizeof(int16) * samples * (isStereo ? 2 : 1), DisposeAfterUse::YES);
+		return Audio::makeRawStream(sD, sampleRate, Audio::FLAG_16BITS | Audio::FLAG_LITTLE_ENDIAN | (isStereo ? Audio::FLAG_STEREO : 0));
+	}
+
+	void filterTestTemplate(const int inRate, const int outRate, const bool isStereo) {
+		const int16 value = 10000;
+		Audio::SeekableAudioStream *s = createConstantStream(inRate, inRate, value, isStereo);
+		Audio::RateConverter *converter = Audio::makeRateConverter(inRate, outRate, isStereo, false, Audio::kRateQualityHigh);
+
+		// Converting one second of input should result in (almost) one
+		// second of output. The filter delay swallows a few samples.
+		int16 *buffer = new int16[outRate * 4];
+		memset(buffer, 0, sizeof(int16) * outRate * 4);
+		const int frames = converter->flow(*s, buffer, outRate * 2, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+		TS_ASSERT_LESS_THAN_EQUALS(frames, outRate);
+		TS_ASSERT_LESS_THAN(outRate - frames, outRate / 100);
+
+		// Once the filter has been filled, a constant signal has to pass
+		// through unchanged.
+		for (int i = frames / 10; i < frames; ++i) {
+			TS_ASSERT_LESS_THAN_EQUALS(ABS(buffer[2 * i + 0] - value), 2);
+			TS_ASSERT_LESS_THAN_EQUALS(ABS(buffer[2 * i + 1] - value), 2);
+		}
+
+		delete[] buffer;
+		delete converter;
+		delete s;
+	}
+
+	void copyTestTemplate(const bool isStereo, const bool reverseStereo, const Audio::st_volume_t volL, const Audio::st_volume_t volR) {
+		const int sampleRate = 11025;
+		const int time = 1;
+		const int frames = sampleRate * time;
+
+		int16 *sine;
+		Audio::SeekableAudioStream *s = createSineStream<int16>(sampleRate, time, &sine, false, isStereo);
+		Audio::RateConverter *converter = Audio::makeRateConverter(sampleRate, sampleRate, isStereo, reverseStereo);
+
+		int16 *buffer = new int16[frames * 2];
+		memset(buffer, 0, sizeof(int16) * frames * 2);
+		TS_ASSERT_EQUALS(converter->flow(*s, buffer, frames, volL, volR), frames);
+
+		for (int i = 0; i < frames; ++i) {
+			const int in0 = sine[isStereo ? 2 * i : i];
+			const int in1 = isStereo ? sine[2 * i + 1] : in0;
+
+			TS_ASSERT_EQUALS(buffer[2 * i + (reverseStereo ? 1 : 0)], (in0 * volL) / Audio::Mixer::kMaxMixerVolume);
+			TS_ASSERT_EQUALS(buffer[2 * i + (reverseStereo ? 0 : 1)], (in1 * volR) / Audio::Mixer::kMaxMixerVolume);
+		}
+
+		delete[] sine;
+		delete[] buffer;
+		delete converter;
+		delete s;
+	}
+
+public:
+	void test_copy_mono() {
+		copyTestTemplate(false, false, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+	}
+
+	void test_copy_mono_volume() {
+		copyTestTemplate(false, false, 100, 37);
+	}
+
+	void test_copy_stereo() {
+		copyTestTemplate(true, false, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+	}
+
+	void test_copy_stereo_reversed() {
+		copyTestTemplate(true, true, 200, 13);
+	}
+
+	void test_copy_clamping() {
+		int16 *sine;
+		Audio::SeekableAudioStream *s = createSineStream<int16>(11025, 1, &sine, false, false);
+		Audio::RateConverter *converter = Audio::makeRateConverter(11025, 11025, false);
+
+		int16 *buffer = new int16[11025 * 2];
+		for (int i = 0; i < 11025; ++i) {
+			buffer[2 * i + 0] = 32000;
+			buffer[2 * i + 1] = -32000;
+		}
+
+		TS_ASSERT_EQUALS(converter->flow(*s, buffer, 11025, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume), 11025);
+
+		for (int i = 0; i < 11025; ++i) {
+			TS_ASSERT_EQUALS(buffer[2 * i + 0], CLIP<int>(32000 + sine[i], -32768, 32767));
+			TS_ASSERT_EQUALS(buffer[2 * i + 1], CLIP<int>(-32000 + sine[i], -32768, 32767));
+		}
+
+		delete[] sine;
+		delete[] buffer;
+		delete converter;
+		delete s;
+	}
+
+	void test_filter_upsample_mono() {
+		filterTestTemplate(11025, 48000, false);
+	}
+
+	void test_filter_upsample_stereo() {
+		filterTestTemplate(22050, 44100, true);
+	}
+
+	void test_filter_downsample() {
+		filterTestTemplate(44100, 22050, false);
+	}
+
+	void test_filter_high_rate() {
+		filterTestTemplate(96000, 48000, true);
+	}
+
+	void test_filter_odd_rate() {
+		filterTestTemplate(11127, 22050, false);
+	}
+};
@@ -0,0 +1,233 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/flathashmap.h"
+#include "common/hash-str.h"
+
+class FlatHashMapTestSuite : public CxxTest::TestSuite
+{
+	// Maps all keys to the same home slot
+	struct CollidingHash {
+		uint operator()(int x) const { return 0; }
+	};
+
+	public:
+	void test_empty_clear() {
+		Common::FlatHashMap<int, int> container;
+		TS_ASSERT(container.empty());
+		container[0] = 17;
+		container[1] = 33;
+		TS_ASSERT(!container.empty());
+		container.clear();
+		TS_ASSERT(container.empty());
+
+		Common::FlatHashMap<Common::String, Common::String, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> container2;
+		TS_ASSERT(container2.empty());
+		container2["foo"] = "bar";
+		container2["quux"] = "blub";
+		TS_ASSERT(!container2.empty());
+		TS_ASSERT(container2.contains("FOO"));
+		container2.clear(true);
+		TS_ASSERT(container2.empty());
+		TS_ASSERT(!container2.contains("foo"));
+	}
+
+	void test_contains() {
+		Common::FlatHashMap<int, int> container;
+		container[0] = 17;
+		container[1] = 33;
+		TS_ASSERT(container.contains(0));
+		TS_ASSERT(container.contains(1));
+		TS_ASSERT(!container.contains(17));
+		TS_ASSERT(!container.contains(-1));
+	}
+
+	void test_add_remove() {
+		Common::FlatHashMap<int, int> container;
+		container[0] = 17;
+		container[1] = 33;
+		container[2] = 45;
+		container[3] = 12;
+		container[4] = 96;
+		TS_ASSERT(container.contains(1));
+		container.erase(1);
+		TS_ASSERT(!container.contains(1));
+		container[1] = 42;
+		TS_ASSERT(container.contains(1));
+		container.erase(0);
+		TS_ASSERT(!container.empty());
+		container.erase(1);
+		TS_ASSERT(!container.empty());
+		container.erase(2);
+		TS_ASSERT(!container.empty());
+		container.erase(3);
+		TS_ASSERT(!container.empty());
+		container.erase(4);
+		TS_ASSERT(container.empty());
+		container[1] = 33;
+		TS_ASSERT(container.contains(1));
+		TS_ASSERT(!container.empty());
+		container.erase(1);
+		TS_ASSERT(container.empty());
+	}
+
+	void test_add_remove_iterator() {
+		Common::FlatHashMap<int, int> container;
+		container[0] = 17;
+		container[1] = 33;
+		container[2] = 45;
+		TS_ASSERT(container.contains(1));
+		container.erase(container.find(1));
+		TS_ASSERT(!container.contains(1));
+		TS_ASSERT_EQUALS(container.size(), (uint)2);
+		container.erase(container.find(0));
+		container.erase(container.find(2));
+		TS_ASSERT(container.empty());
+	}
+
+	void test_lookup_with_default() {
+		Common::FlatHashMap<int, int> container;
+		container[0] = 17;
+		container[1] = -1;
+		container[2] = 45;
+
+		// We take a const ref now to ensure that the map
+		// is not modified by getVal.
+		const Common::FlatHashMap<int, int> &containerRef = container;
+
+		TS_ASSERT_EQUALS(containerRef.getVal(0), 17);
+		TS_ASSERT_EQUALS(containerRef.getVal(1), -1);
+		TS_ASSERT_EQUALS(containerRef.getVal(17), 0);
+		TS_ASSERT_EQUALS(containerRef.getVal(0, -10), 17);
+		TS_ASSERT_EQUALS(containerRef.getVal(17, -10), -10);
+		TS_ASSERT_EQUALS(containerRef.size(), (uint)3);
+	}
+
+	void test_iterator_begin_end() {
+		Common::FlatHashMap<int, int> container;
+
+		// The container is initially empty ...
+		TS_ASSERT_EQUALS(container.begin(), container.end());
+
+		// ... then non-empty ...
+		container[324] = 33;
+		TS_ASSERT_DIFFERS(container.begin(), container.end());
+
+		// ... and again empty.
+		container.clear();
+		TS_ASSERT_EQUALS(container.begin(), container.end());
+	}
+
+	void test_hash_map_copy() {
+		Common::FlatHashMap<int, int> map1, container2;
+		map1[323] = 32;
+		container2 = map1;
+		TS_ASSERT_EQUALS(container2[323], 32);
+
+		Common::FlatHashMap<int, int> container3(container2);
+		container2[323] = 1;
+		TS_ASSERT_EQUALS(container3[323], 32);
+	}
+
+	void test_collision() {
+		Common::FlatHashMap<int, int, CollidingHash> h;
+		const int keys[] = { 5, 32+5, 64+5, 128+5 };
+		for (int i = 0; i < ARRAYSIZE(keys); ++i)
+			h[keys[i]] = i;
+		for (int i = 0; i < ARRAYSIZE(keys); ++i)
+			TS_ASSERT_EQUALS(h.getVal(keys[i], -1), i);
+
+		// Erasing an element of the chain has to keep the other ones
+		// reachable.
+		h.erase(keys[1]);
+		TS_ASSERT(!h.contains(keys[1]));
+		TS_ASSERT_EQUALS(h.getVal(keys[0], -1), 0);
+		TS_ASSERT_EQUALS(h.getVal(keys[2], -1), 2);
+		TS_ASSERT_EQUALS(h.getVal(keys[3], -1), 3);
+		h.erase(keys[0]);
+		TS_ASSERT_EQUALS(h.getVal(keys[2], -1), 2);
+		TS_ASSERT_EQUALS(h.getVal(keys[3], -1), 3);
+		h[keys[1]] = 1;
+		h.erase(keys[3]);
+		TS_ASSERT_EQUALS(h.getVal(keys[1], -1), 1);
+		TS_ASSERT_EQUALS(h.getVal(keys[2], -1), 2);
+		h.erase(keys[1]);
+		h.erase(keys[2]);
+		TS_ASSERT(h.empty());
+	}
+
+	void test_iterator() {
+		Common::FlatHashMap<int, int> container;
+		container[0] = 17;
+		container[1] = 33;
+		container[2] = 45;
+		container[3] = 12;
+		container[4] = 96;
+		container.erase(1);
+		container[1] = 42;
+		container.erase(0);
+		container.erase(1);
+
+		int found = 0;
+		Common::FlatHashMap<int, int>::iterator i;
+		for (i = container.begin(); i != container.end(); ++i) {
+			int key = i->_key;
+			TS_ASSERT(key >= 0 && key <= 4);
+			TS_ASSERT(!(found & (1 << key)));
+			found |= 1 << key;
+		}
+		TS_ASSERT(found == 16+8+4);
+
+		found = 0;
+		Common::FlatHashMap<int, int>::const_iterator j;
+		for (j = container.begin(); j != container.end(); ++j) {
+			int key = j->_key;
+			TS_ASSERT(key >= 0 && key <= 4);
+			TS_ASSERT(!(found & (1 << key)));
+			found |= 1 << key;
+		}
+		TS_ASSERT(found == 16+8+4);
+	}
+
+	void test_many() {
+		// Insert enough elements to make the map grow several times,
+		// then erase every other one and check that the rest is intact.
+		Common::FlatHashMap<uint, uint> container;
+		for (uint i = 0; i < 10000; ++i)
+			container[i * 7] = i;
+		TS_ASSERT_EQUALS(container.size(), (uint)10000);
+
+		for (uint i = 0; i < 10000; i += 2)
+			container.erase(i * 7);
+		TS_ASSERT_EQUALS(container.size(), (uint)5000);
+
+		for (uint i = 0; i < 10000; ++i) {
+			if (i & 1) {
+				TS_ASSERT_EQUALS(container.getVal(i * 7, 0xFFFFFFFF), i);
+			} else {
+				TS_ASSERT(!container.contains(i * 7));
+			}
+		}
+
+		uint count = 0;
+		for (Common::FlatHashMap<uint, uint>::const_iterator i = container.begin(); i != container.end(); ++i) {
+			TS_ASSERT_EQUALS(i->_key, i->_value * 7);
+			++count;
+		}
+		TS_ASSERT_EQUALS(count, (uint)5000);
+	}
+
+	void test_assign_while_growing() {
+		// The value has to end up in the new storage when operator[] and
+		// setVal() make the map grow
+		Common::FlatHashMap<uint, uint> container;
+		uint32 key = 1;
+		for (uint i = 0; i < 20000; ++i) {
+			key = key * 1103515245 + 12345;
+			if (i & 1)
+				container[key >> 4] = i;
+			else
+				container.setVal(key >> 4, i);
+			TS_ASSERT_EQUALS(container.getVal(key >> 4, 0xFFFFFFFF), i);
+		}
+	}
+};
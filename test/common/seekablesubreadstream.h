@@ -70,4 +70,25 @@ class SeekableSubReadStreamTestSuite : public CxxTest::TestSuite {
 		b = ssrs.readByte();
 		TS_ASSERT_EQUALS(b, 1);
 	}
+
+	void test_safe_interleaved() {
+		byte contents[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+		Common::MemoryReadStream ms(contents, 10);
+
+		Common::SafeSeekableSubReadStream ssrs1(&ms, 0, 5);
+		Common::SafeSeekableSubReadStream ssrs2(&ms, 5, 10);
+
+		for (int i = 0; i < 5; ++i) {
+			TS_ASSERT_EQUALS(ssrs1.readByte(), i);
+			TS_ASSERT_EQUALS(ssrs2.readByte(), i + 5);
+		}
+
+		TS_ASSERT(!ssrs1.eos());
+		ssrs1.readByte();
+		TS_ASSERT(ssrs1.eos());
+		TS_ASSERT(!ssrs2.eos());
+
+		ssrs2.seek(-2, SEEK_END);
+		TS_ASSERT_EQUALS(ssrs2.readByte(), 8);
+	}
 };
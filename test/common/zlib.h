@@ -0,0 +1,122 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/memstream.h"
+#include "common/zlib.h"
+
+#if defined(USE_ZLIB)
+
+#include <zlib.h>
+
+class ZlibTestSuite : public CxxTest::TestSuite {
+	enum {
+		kDataSize = 1024 * 1024
+	};
+
+	byte *_data;
+	byte *_compressed;
+	uint32 _compressedSize;
+
+public:
+	void setUp() {
+		// Some reasonably compressible, non-periodic data
+		_data = new byte[kDataSize];
+		uint32 seed = 1;
+		for (uint32 i = 0; i < kDataSize; ++i) {
+			seed = seed * 1103515245 + 12345;
+			_data[i] = (byte)((seed >> 16) & 0x0F) + (byte)(i >> 12);
+		}
+
+		// Compress as raw deflate data, i.e. without any header
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+		_compressedSize = deflateBound(&stream, kDataSize);
+		_compressed = (byte *)malloc(_compressedSize);
+
+		stream.next_in = _data;
+		stream.avail_in = kDataSize;
+		stream.next_out = _compressed;
+		stream.avail_out = _compressedSize;
+		deflate(&stream, Z_FINISH);
+		_compressedSize = stream.total_out;
+		deflateEnd(&stream);
+	}
+
+	void tearDown() {
+		delete[] _data;
+		free(_compressed);
+	}
+
+	void test_deflate_read() {
+		Common::SeekableReadStream *s = Common::wrapDeflateReadStream(new Common::MemoryReadStream(_compressed, _compressedSize), kDataSize);
+		TS_ASSERT_EQUALS(s->size(), kDataSize);
+
+		byte *buffer = new byte[kDataSize];
+		TS_ASSERT_EQUALS(s->read(buffer, kDataSize), (uint32)kDataSize);
+		TS_ASSERT_EQUALS(memcmp(buffer, _data, kDataSize), 0);
+		TS_ASSERT(!s->eos());
+
+		TS_ASSERT_EQUALS(s->read(buffer, 1), (uint32)0);
+		TS_ASSERT(s->eos());
+
+		delete[] buffer;
+		delete s;
+	}
+
+	void test_deflate_seek() {
+		Common::SeekableReadStream *s = Common::wrapDeflateReadStream(new Common::MemoryReadStream(_compressed, _compressedSize), kDataSize);
+		byte buffer[16];
+
+		const int32 positions[] = { 900000, 10, 300000, 299990, kDataSize - 16, 600000, 0, 512 * 1024 };
+		for (int i = 0; i < ARRAYSIZE(positions); ++i) {
+			s->seek(positions[i], SEEK_SET);
+			TS_ASSERT_EQUALS(s->pos(), positions[i]);
+			TS_ASSERT_EQUALS(s->read(buffer, sizeof(buffer)), sizeof(buffer));
+			TS_ASSERT_EQUALS(memcmp(buffer, _data + positions[i], sizeof(buffer)), 0);
+		}
+
+		s->seek(-100, SEEK_END);
+		TS_ASSERT_EQUALS(s->pos(), kDataSize - 100);
+		TS_ASSERT_EQUALS(s->read(buffer, sizeof(buffer)), sizeof(buffer));
+		TS_ASSERT_EQUALS(memcmp(buffer, _data + kDataSize - 100, sizeof(buffer)), 0);
+
+		delete s;
+	}
+
+	void test_deflate_seek_no_checkpoints() {
+		Common::SeekableReadStream *s = Common::wrapDeflateReadStream(new Common::MemoryReadStream(_compressed, _compressedSize), kDataSize, 0);
+		byte buffer[16];
+
+		const int32 positions[] = { 700000, 5, 400000, kDataSize - 16 };
+		for (int i = 0; i < ARRAYSIZE(positions); ++i) {
+			s->seek(positions[i], SEEK_SET);
+			TS_ASSERT_EQUALS(s->read(buffer, sizeof(buffer)), sizeof(buffer));
+			TS_ASSERT_EQUALS(memcmp(buffer, _data + positions[i], sizeof(buffer)), 0);
+		}
+
+		delete s;
+	}
+
+	void test_deflate_seek_thinning() {
+		// With a tiny interval, the checkpoint memory limit is hit early and
+		// the index has to be thinned out while reading.
+		Common::SeekableReadStream *s = Common::wrapDeflateReadStream(new Common::MemoryReadStream(_compressed, _compressedSize), kDataSize, 1024);
+		byte *buffer = new byte[kDataSize];
+
+		for (uint32 pos = 0; pos < kDataSize; pos += 4096)
+			TS_ASSERT_EQUALS(s->read(buffer + pos, 4096), (uint32)4096);
+		TS_ASSERT_EQUALS(memcmp(buffer, _data, kDataSize), 0);
+
+		for (int32 pos = kDataSize - 1000; pos > 0; pos -= 99999) {
+			s->seek(pos, SEEK_SET);
+			TS_ASSERT_EQUALS(s->read(buffer, 1000), (uint32)1000);
+			TS_ASSERT_EQUALS(memcmp(buffer, _data + pos, 1000), 0);
+		}
+
+		delete[] buffer;
+		delete s;
+	}
+};
+
+#endif
@@ -0,0 +1,174 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ * This is a utility for comparing the speed of Common::HashMap and
+ * Common::FlatHashMap, in nanoseconds per operation, for inserting,
+ * looking up (existing and missing keys), iterating and erasing. Build it
+ * with "make tools/hashbench".
+ *
+ * Usage: hashbench [elements]
+ *
+ * HashMap allocates its nodes from a MemoryPool, whose pages may not grow
+ * beyond 16 MB, so it can not hold much more than 500000 elements.
+ *
+ * The keys are modelled after the two users of FlatHashMap: addresses like
+ * the reg_t values in the SCI garbage collector's AddrSet, with the same
+ * weak hash function, and path names like those of the sword25 resource
+ * manager.
+ */
+
+// Disable symbol overrides so that we can use system headers.
+#define FORBIDDEN_SYMBOL_ALLOW_ALL
+
+#include "common/array.h"
+#include "common/flathashmap.h"
+#include "common/hash-str.h"
+#include "common/hashmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint32 s_seed;
+
+static uint32 nextRandom(uint32 max) {
+	s_seed = s_seed * 1103515245 + 12345;
+	return (s_seed >> 8) % max;
+}
+
+// Like reg_t and reg_t_Hash in engines/sci/engine/vm_types.h
+struct Address {
+	uint16 segment;
+	uint16 offset;
+
+	bool operator==(const Address &x) const {
+		return segment == x.segment && offset == x.offset;
+	}
+};
+
+struct Address_Hash {
+	uint operator()(const Address &x) const {
+		return (x.segment << 3) ^ x.offset ^ (x.offset << 16);
+	}
+};
+
+static Common::Array<Address> makeAddresses(uint count, uint32 seed) {
+	s_seed = seed;
+	Common::Array<Address> keys;
+	for (uint i = 0; i < count; i++) {
+		// Objects and lists in a few hundred segments
+		Address address = { (uint16)(1 + nextRandom(400)), (uint16)(nextRandom(4096) * 2) };
+		keys.push_back(address);
+	}
+	return keys;
+}
+
+static Common::Array<Common::String> makeNames(uint count, uint32 seed) {
+	static const char *const dirs[] = { "gfx/menu", "gfx/ui", "scripts", "sfx/ambience", "music", "fonts" };
+	static const char *const exts[] = { "png", "lua", "ogg", "xml", "fnt" };
+
+	s_seed = seed;
+	Common::Array<Common::String> keys;
+	for (uint i = 0; i < count; i++)
+		keys.push_back(Common::String::format("/%s/file_%05u.%s", dirs[nextRandom(ARRAYSIZE(dirs))], nextRandom(100000), exts[nextRandom(ARRAYSIZE(exts))]));
+	return keys;
+}
+
+// Keeps the compiler from dropping the lookups and the iteration
+static volatile uint s_sink;
+
+static double elapsed(clock_t start, uint ops) {
+	return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ops;
+}
+
+/**
+ * Runs all operations on a map of the given type, repeating them until
+ * about rounds * keys.size() operations of each kind were done.
+ */
+template<class Map, class Key>
+static void run(const char *name, const Common::Array<Key> &keys, const Common::Array<Key> &missingKeys, uint rounds) {
+	double insertTime = 0, hitTime = 0, missTime = 0, iterateTime = 0, eraseTime = 0;
+	uint found = 0, iterated = 0;
+
+	for (uint round = 0; round < rounds; round++) {
+		Map map;
+		clock_t start;
+
+		start = clock();
+		for (uint i = 0; i < keys.size(); i++)
+			map[keys[i]] = i;
+		insertTime += elapsed(start, keys.size());
+
+		start = clock();
+		for (uint i = 0; i < keys.size(); i++)
+			found += map.contains(keys[i]);
+		hitTime += elapsed(start, keys.size());
+
+		start = clock();
+		for (uint i = 0; i < missingKeys.size(); i++)
+			found += map.contains(missingKeys[i]);
+		missTime += elapsed(start, missingKeys.size());
+
+		start = clock();
+		for (typename Map::const_iterator i = map.begin(); i != map.end(); ++i)
+			iterated += i->_value;
+		iterateTime += elapsed(start, map.size());
+
+		start = clock();
+		for (uint i = 0; i < keys.size(); i++)
+			map.erase(keys[i]);
+		eraseTime += elapsed(start, keys.size());
+	}
+
+	s_sink = found + iterated;
+	printf("%-24s %8.1f %8.1f %8.1f %8.1f %8.1f\n", name, insertTime / rounds, hitTime / rounds,
+	       missTime / rounds, iterateTime / rounds, eraseTime / rounds);
+}
+
+int main(int argc, char *argv[]) {
+	const int count = argc > 1 ? atoi(argv[1]) : 10000;
+
+	if (count <= 0 || count > 500000) {
+		fprintf(stderr, "Usage: %s [elements]\n", argv[0]);
+		return 1;
+	}
+
+	const uint rounds = MAX(1, 4000000 / count);
+
+	printf("Time per operation in ns, %d keys, %u rounds\n", count, rounds);
+	printf("%-24s %8s %8s %8s %8s %8s\n", "", "insert", "hit", "miss", "iterate", "erase");
+
+	// The missing keys come from a different seed, and may now and then
+	// exist after all
+	const Common::Array<Address> addresses = makeAddresses(count, 1);
+	const Common::Array<Address> missingAddresses = makeAddresses(count, 2);
+	run<Common::HashMap<Address, uint, Address_Hash>, Address>("HashMap, address", addresses, missingAddresses, rounds);
+	run<Common::FlatHashMap<Address, uint, Address_Hash>, Address>("FlatHashMap, address", addresses, missingAddresses, rounds);
+
+	const Common::Array<Common::String> names = makeNames(count, 1);
+	const Common::Array<Common::String> missingNames = makeNames(count, 2);
+	run<Common::HashMap<Common::String, uint>, Common::String>("HashMap, name", names, missingNames, rounds);
+	run<Common::FlatHashMap<Common::String, uint>, Common::String>("FlatHashMap, name", names, missingNames, rounds);
+
+	return 0;
+}
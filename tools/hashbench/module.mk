@@ -0,0 +1,15 @@
+MODULE := tools/hashbench
+
+MODULE_OBJS := \
+	hashbench.o
+
+MODULE_DIRS += $(MODULE)/
+
+#
+# Like midibench, this is linked with the libraries of the main executable.
+# Build it with "make tools/hashbench".
+#
+tools/hashbench/hashbench$(EXEEXT): $(addprefix $(MODULE)/, $(MODULE_OBJS)) common/libcommon.a
+	$(QUIET_LINK)$(CXX) $(LDFLAGS) $+ $(LIBS) -o $@
+
+tools/hashbench: tools/hashbench/hashbench$(EXEEXT)
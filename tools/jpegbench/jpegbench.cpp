@@ -0,0 +1,489 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ * This is a utility for measuring how long Graphics::JPEG takes to decode
+ * an image and convert it to RGB. Build it with "make tools/jpegbench".
+ *
+ * Usage: jpegbench [seconds] [JPEG files...]
+ *
+ * Without files, it generates baseline JPEGs of a synthetic image in the
+ * sizes, qualities and chroma subsamplings games use, with the example
+ * tables of the JPEG standard. For those, it also reports the mean
+ * difference of the decoded image to the original.
+ */
+
+// Disable symbol overrides so that we can use system headers.
+#define FORBIDDEN_SYMBOL_ALLOW_ALL
+
+#include "common/array.h"
+#include "common/memstream.h"
+#include "graphics/jpeg.h"
+#include "graphics/pixelformat.h"
+#include "graphics/surface.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const byte s_zigzag[64] = {
+	 0,  1,  8, 16,  9,  2,  3, 10,
+	17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// Tables K.1 and K.2 of the JPEG standard, in natural order
+static const byte s_lumaQuant[64] = {
+	16, 11, 10, 16,  24,  40,  51,  61,
+	12, 12, 14, 19,  26,  58,  60,  55,
+	14, 13, 16, 24,  40,  57,  69,  56,
+	14, 17, 22, 29,  51,  87,  80,  62,
+	18, 22, 37, 56,  68, 109, 103,  77,
+	24, 35, 55, 64,  81, 104, 113,  92,
+	49, 64, 78, 87, 103, 121, 120, 101,
+	72, 92, 95, 98, 112, 100, 103,  99
+};
+
+static const byte s_chromaQuant[64] = {
+	17, 18, 24, 47, 99, 99, 99, 99,
+	18, 21, 26, 66, 99, 99, 99, 99,
+	24, 26, 56, 99, 99, 99, 99, 99,
+	47, 66, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// Tables K.3 to K.6 of the JPEG standard: code counts per length, then values
+static const byte s_lumaDC[16 + 12] = {
+	0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0,
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11
+};
+
+static const byte s_chromaDC[16 + 12] = {
+	0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11
+};
+
+static const byte s_lumaAC[16 + 162] = {
+	0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D,
+	0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+	0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+	0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+	0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+	0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+	0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+	0xF9, 0xFA
+};
+
+static const byte s_chromaAC[16 + 162] = {
+	0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77,
+	0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+	0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+	0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+	0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+	0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+	0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+	0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+	0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+	0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+	0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+	0xF9, 0xFA
+};
+
+/**
+ * Huffman codes of a table, built as described in annex C of the standard.
+ */
+struct HuffmanCodes {
+	uint16 code[256];
+	byte length[256];
+
+	HuffmanCodes(const byte *table) {
+		const byte *values = table + 16;
+		uint16 nextCode = 0;
+		int k = 0;
+
+		memset(length, 0, sizeof(length));
+		for (int len = 1; len <= 16; len++) {
+			for (int i = 0; i < table[len - 1]; i++, k++) {
+				code[values[k]] = nextCode++;
+				length[values[k]] = len;
+			}
+			nextCode <<= 1;
+		}
+	}
+};
+
+/**
+ * A minimal baseline JPEG encoder, just good enough for generating test
+ * images: a floating point DCT and the example Huffman tables.
+ */
+class Encoder {
+public:
+	Encoder() : _lumaDC(s_lumaDC), _chromaDC(s_chromaDC), _lumaAC(s_lumaAC), _chromaAC(s_chromaAC) {}
+
+	void encode(const byte *rgb, int width, int height, int quality, int factorH, int factorV, Common::Array<byte> &out);
+
+private:
+	void writeByte(byte b) { _out->push_back(b); }
+	void writeWord(uint16 w) { writeByte(w >> 8); writeByte(w & 0xFF); }
+	void writeTable(const byte *table, int size) { for (int i = 0; i < size; i++) writeByte(table[i]); }
+	void writeBits(uint32 bits, int count);
+	void flushBits();
+
+	void encodeBlock(const float *samples, const byte *quant, const HuffmanCodes &dc, const HuffmanCodes &ac, int &predictor);
+
+	HuffmanCodes _lumaDC, _chromaDC, _lumaAC, _chromaAC;
+	Common::Array<byte> *_out;
+	uint32 _bitBuffer;
+	int _bitCount;
+};
+
+void Encoder::writeBits(uint32 bits, int count) {
+	_bitBuffer = (_bitBuffer << count) | (bits & ((1 << count) - 1));
+	_bitCount += count;
+
+	while (_bitCount >= 8) {
+		const byte b = (_bitBuffer >> (_bitCount - 8)) & 0xFF;
+		writeByte(b);
+		if (b == 0xFF)
+			writeByte(0);
+		_bitCount -= 8;
+	}
+}
+
+void Encoder::flushBits() {
+	// Pad with one bits
+	if (_bitCount)
+		writeBits(0x7F, 8 - _bitCount);
+}
+
+void Encoder::encodeBlock(const float *samples, const byte *quant, const HuffmanCodes &dc, const HuffmanCodes &ac, int &predictor) {
+	int coefficients[64];
+
+	for (int v = 0; v < 8; v++) {
+		for (int u = 0; u < 8; u++) {
+			float sum = 0;
+			for (int y = 0; y < 8; y++) {
+				for (int x = 0; x < 8; x++)
+					sum += samples[y * 8 + x] * cos((2 * x + 1) * u * M_PI / 16) * cos((2 * y + 1) * v * M_PI / 16);
+			}
+			sum *= (u ? 0.5f : 0.5f / sqrt(2.0f)) * (v ? 0.5f : 0.5f / sqrt(2.0f));
+			coefficients[v * 8 + u] = (int)floor(sum / quant[v * 8 + u] + 0.5f);
+		}
+	}
+
+	int run = 0;
+	for (int i = 0; i < 64; i++) {
+		int value = coefficients[s_zigzag[i]];
+		if (!i) {
+			const int diff = value - predictor;
+			predictor = value;
+			value = diff;
+		} else if (!value) {
+			run++;
+			continue;
+		}
+
+		int size = 0;
+		for (int magnitude = ABS(value); magnitude; magnitude >>= 1)
+			size++;
+		const int bits = value < 0 ? value - 1 : value;
+
+		if (!i) {
+			writeBits(dc.code[size], dc.length[size]);
+		} else {
+			for (; run > 15; run -= 16)
+				writeBits(ac.code[0xF0], ac.length[0xF0]);
+			writeBits(ac.code[(run << 4) | size], ac.length[(run << 4) | size]);
+			run = 0;
+		}
+		writeBits(bits, size);
+	}
+
+	if (run)
+		writeBits(ac.code[0], ac.length[0]);
+}
+
+void Encoder::encode(const byte *rgb, int width, int height, int quality, int factorH, int factorV, Common::Array<byte> &out) {
+	_out = &out;
+	_bitBuffer = 0;
+	_bitCount = 0;
+
+	// Scale the quantization tables like the IJG library does
+	const int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+	byte quant[2][64];
+	for (int i = 0; i < 64; i++) {
+		quant[0][i] = CLIP((s_lumaQuant[i] * scale + 50) / 100, 1, 255);
+		quant[1][i] = CLIP((s_chromaQuant[i] * scale + 50) / 100, 1, 255);
+	}
+
+	// Convert to YCbCr, with the chroma planes subsampled by averaging
+	const int chromaW = (width + factorH - 1) / factorH, chromaH = (height + factorV - 1) / factorV;
+	Common::Array<float> planeY, planeCb, planeCr;
+	planeY.resize(width * height);
+	planeCb.resize(chromaW * chromaH);
+	planeCr.resize(chromaW * chromaH);
+	for (int i = 0; i < chromaW * chromaH; i++)
+		planeCb[i] = planeCr[i] = 0;
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			const byte *p = rgb + (y * width + x) * 3;
+			planeY[y * width + x] = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2] - 128;
+			planeCb[(y / factorV) * chromaW + x / factorH] += (-0.168736f * p[0] - 0.331264f * p[1] + 0.5f * p[2]) / (factorH * factorV);
+			planeCr[(y / factorV) * chromaW + x / factorH] += (0.5f * p[0] - 0.418688f * p[1] - 0.081312f * p[2]) / (factorH * factorV);
+		}
+	}
+
+	writeWord(0xFFD8);
+
+	static const byte jfif[] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+	writeWord(0xFFE0);
+	writeWord(2 + sizeof(jfif));
+	writeTable(jfif, sizeof(jfif));
+
+	for (int t = 0; t < 2; t++) {
+		writeWord(0xFFDB);
+		writeWord(2 + 65);
+		writeByte(t);
+		for (int i = 0; i < 64; i++)
+			writeByte(quant[t][s_zigzag[i]]);
+	}
+
+	writeWord(0xFFC0);
+	writeWord(8 + 3 * 3);
+	writeByte(8);
+	writeWord(height);
+	writeWord(width);
+	writeByte(3);
+	const byte components[3][3] = { { 1, (byte)(factorH << 4 | factorV), 0 }, { 2, 0x11, 1 }, { 3, 0x11, 1 } };
+	for (int c = 0; c < 3; c++)
+		writeTable(components[c], 3);
+
+	const byte *huffmanTables[4] = { s_lumaDC, s_lumaAC, s_chromaDC, s_chromaAC };
+	const byte huffmanIds[4] = { 0x00, 0x10, 0x01, 0x11 };
+	for (int t = 0; t < 4; t++) {
+		const int count = (t & 1) ? 162 : 12;
+		writeWord(0xFFC4);
+		writeWord(2 + 1 + 16 + count);
+		writeByte(huffmanIds[t]);
+		writeTable(huffmanTables[t], 16 + count);
+	}
+
+	writeWord(0xFFDA);
+	writeWord(6 + 2 * 3);
+	writeByte(3);
+	static const byte scanComponents[6] = { 1, 0x00, 2, 0x11, 3, 0x11 };
+	writeTable(scanComponents, 6);
+	writeByte(0);
+	writeByte(63);
+	writeByte(0);
+
+	int predictors[3] = { 0, 0, 0 };
+	float block[64];
+	const int mcuW = 8 * factorH, mcuH = 8 * factorV;
+
+	for (int mcuY = 0; mcuY < height; mcuY += mcuH) {
+		for (int mcuX = 0; mcuX < width; mcuX += mcuW) {
+			// Pixels beyond the edges repeat the last row and column
+			for (int by = 0; by < factorV; by++) {
+				for (int bx = 0; bx < factorH; bx++) {
+					for (int i = 0; i < 64; i++) {
+						const int x = MIN(mcuX + bx * 8 + i % 8, width - 1), y = MIN(mcuY + by * 8 + i / 8, height - 1);
+						block[i] = planeY[y * width + x];
+					}
+					encodeBlock(block, quant[0], _lumaDC, _lumaAC, predictors[0]);
+				}
+			}
+
+			for (int c = 0; c < 2; c++) {
+				const Common::Array<float> &plane = c ? planeCr : planeCb;
+				for (int i = 0; i < 64; i++) {
+					const int x = MIN(mcuX / factorH + i % 8, chromaW - 1), y = MIN(mcuY / factorV + i / 8, chromaH - 1);
+					block[i] = plane[y * chromaW + x];
+				}
+				encodeBlock(block, quant[1], _chromaDC, _chromaAC, predictors[1 + c]);
+			}
+		}
+	}
+
+	flushBits();
+	writeWord(0xFFD9);
+}
+
+/**
+ * Something like a rendered game scene: smooth gradients, some sharp edges
+ * and a little noise.
+ */
+static void makeImage(byte *rgb, int width, int height) {
+	uint32 noise = 1;
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			noise = noise * 1664525 + 1013904223;
+			const int grain = (int)(noise >> 29) - 4;
+			const bool inBox = ((x * 6 / width) + (y * 4 / height)) % 3 == 0;
+			const float wave = sin(x * 0.05f) * cos(y * 0.07f);
+
+			byte *p = rgb + (y * width + x) * 3;
+			p[0] = CLIP<int>((int)(x * 255 / width * 0.8f + 40 * wave) + grain + (inBox ? 60 : 0), 0, 255);
+			p[1] = CLIP<int>((int)(y * 255 / height * 0.7f + 60 * wave) + grain, 0, 255);
+			p[2] = CLIP<int>((int)(128 + 100 * sin((x + y) * 0.02f)) + grain - (inBox ? 50 : 0), 0, 255);
+		}
+	}
+}
+
+static double decodeTime(const Common::Array<byte> &data, int seconds, Graphics::Surface **result) {
+	const Graphics::PixelFormat format(4, 8, 8, 8, 8, 24, 16, 8, 0);
+	long count = 0;
+	clock_t start = clock(), now = start;
+
+	do {
+		Common::MemoryReadStream stream(&data[0], data.size());
+		Graphics::JPEG jpeg;
+		if (!jpeg.read(&stream)) {
+			fprintf(stderr, "Could not decode the image\n");
+			exit(1);
+		}
+
+		Graphics::Surface *surface = jpeg.getSurface(format);
+		if (!surface) {
+			fprintf(stderr, "Could not convert the image\n");
+			exit(1);
+		}
+
+		if (!count && result) {
+			*result = surface;
+		} else {
+			surface->free();
+			delete surface;
+		}
+
+		count++;
+		now = clock();
+	} while (now - start < (clock_t)seconds * CLOCKS_PER_SEC);
+
+	return (double)(now - start) / CLOCKS_PER_SEC / count;
+}
+
+static void printTime(const char *name, int width, int height, uint32 size, double time) {
+	printf("%-30s %8u bytes %8.2f ms %6.1f MB/s", name, size, time * 1000, width * height * 3 / time / 1000000);
+}
+
+int main(int argc, char *argv[]) {
+	const int seconds = argc > 1 ? atoi(argv[1]) : 2;
+
+	if (seconds <= 0) {
+		fprintf(stderr, "Usage: %s [seconds] [JPEG files...]\n", argv[0]);
+		return 1;
+	}
+
+	printf("Decoding and RGB conversion time per image, MB/s of RGB output\n");
+
+	if (argc > 2) {
+		for (int i = 2; i < argc; i++) {
+			FILE *file = fopen(argv[i], "rb");
+			if (!file) {
+				fprintf(stderr, "Could not open %s\n", argv[i]);
+				return 1;
+			}
+
+			Common::Array<byte> data;
+			byte buffer[4096];
+			size_t size;
+			while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+				for (size_t j = 0; j < size; j++)
+					data.push_back(buffer[j]);
+			}
+			fclose(file);
+
+			Graphics::Surface *surface = 0;
+			const double time = decodeTime(data, seconds, &surface);
+			printTime(argv[i], surface->w, surface->h, data.size(), time);
+			printf("\n");
+
+			surface->free();
+			delete surface;
+		}
+		return 0;
+	}
+
+	struct Image {
+		int width, height;
+		int quality;
+		int factorH, factorV;
+	};
+	static const Image images[] = {
+		{ 640, 480, 85, 2, 2 },
+		{ 640, 480, 85, 1, 1 },
+		{ 320, 240, 70, 2, 1 },
+		{ 320, 240, 95, 2, 2 },
+		{ 160, 120, 50, 2, 2 }
+	};
+
+	Encoder encoder;
+
+	for (int i = 0; i < ARRAYSIZE(images); i++) {
+		const Image &image = images[i];
+		byte *rgb = new byte[image.width * image.height * 3];
+		makeImage(rgb, image.width, image.height);
+
+		Common::Array<byte> data;
+		encoder.encode(rgb, image.width, image.height, image.quality, image.factorH, image.factorV, data);
+
+		Graphics::Surface *surface = 0;
+		const double time = decodeTime(data, seconds, &surface);
+
+		char name[40];
+		snprintf(name, sizeof(name), "%dx%d q%d 4:%d:%d", image.width, image.height, image.quality,
+		         4 / image.factorH, image.factorV == 2 ? 0 : 4 / image.factorH);
+		printTime(name, image.width, image.height, data.size(), time);
+
+		double difference = 0;
+		for (int y = 0; y < image.height; y++) {
+			for (int x = 0; x < image.width; x++) {
+				const uint32 pixel = *(const uint32 *)surface->getBasePtr(x, y);
+				const byte *p = rgb + (y * image.width + x) * 3;
+				difference += ABS((int)((pixel >> 24) & 0xFF) - p[0]) + ABS((int)((pixel >> 16) & 0xFF) - p[1]) + ABS((int)((pixel >> 8) & 0xFF) - p[2]);
+			}
+		}
+		printf(", mean difference %.2f\n", difference / (image.width * image.height * 3));
+
+		surface->free();
+		delete surface;
+		delete[] rgb;
+	}
+
+	return 0;
+}
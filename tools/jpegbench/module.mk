@@ -0,0 +1,15 @@
+MODULE := tools/jpegbench
+
+MODULE_OBJS := \
+	jpegbench.o
+
+MODULE_DIRS += $(MODULE)/
+
+#
+# Like midibench, this is linked with the libraries of the main executable.
+# Build it with "make tools/jpegbench".
+#
+tools/jpegbench/jpegbench$(EXEEXT): $(addprefix $(MODULE)/, $(MODULE_OBJS)) graphics/libgraphics.a common/libcommon.a
+	$(QUIET_LINK)$(CXX) $(LDFLAGS) $+ $(LIBS) -o $@
+
+tools/jpegbench: tools/jpegbench/jpegbench$(EXEEXT)
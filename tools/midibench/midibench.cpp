@@ -0,0 +1,533 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ * This is a utility for measuring how much CPU time the emulated MIDI
+ * synths need per second of music, with the render loop of
+ * MidiDriver_Emulated splitting the output at every timer tick, and with
+ * events scheduled ahead of rendering. Build it with "make tools/midibench".
+ * The MT-32 emulator is also measured in the silence after the music, with
+ * and without reverb, which shows what the decaying reverb tail costs.
+ *
+ * Usage: midibench [seconds] [buffer size] [SoundFont]
+ *
+ * The MT-32 emulator runs on synthetic ROMs, so no ROM files are needed.
+ * FluidSynth is only measured when it is enabled and given a SoundFont.
+ */
+
+// Disable symbol overrides so that we can use system headers.
+#define FORBIDDEN_SYMBOL_ALLOW_ALL
+
+#include "audio/fmopl.h"
+#include "audio/softsynth/emumidi.h"
+
+#ifdef USE_MT32EMU
+#include "audio/softsynth/mt32/mt32emu.h"
+#endif
+
+#ifdef USE_FLUIDSYNTH
+#include <fluidsynth.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint32 s_seed;
+
+static uint32 nextRandom(uint32 max) {
+	s_seed = s_seed * 1103515245 + 12345;
+	return (s_seed >> 16) % max;
+}
+
+/**
+ * The synth part of an emulated driver. The drivers in the tree can not
+ * be used here, because they need a backend and a mixer; this does the
+ * same render and event calls as they do.
+ */
+class BenchDriver : public MidiDriver_Emulated {
+public:
+	BenchDriver(int baseFreq, int rate, bool stereo, bool scheduleEvents)
+		: MidiDriver_Emulated(0), _rate(rate), _stereo(stereo) {
+		_baseFreq = baseFreq;
+		_scheduleEvents = scheduleEvents;
+	}
+
+	void close() {}
+
+	void send(uint32 b) {
+		if (scheduleEvent(b))
+			return;
+		play(b);
+	}
+
+	MidiChannel *allocateChannel() { return 0; }
+	MidiChannel *getPercussionChannel() { return 0; }
+
+	bool isStereo() const { return _stereo; }
+	int getRate() const { return _rate; }
+
+	bool schedulesEvents() const { return _scheduleEvents; }
+
+protected:
+	virtual void play(uint32 b) = 0;
+
+private:
+	int _rate;
+	bool _stereo;
+};
+
+#ifdef USE_MT32EMU
+
+static MT32Emu::Bit8u s_controlROM[65536];
+static MT32Emu::Bit8u s_pcmROM[512 * 1024];
+
+class MemoryFile : public MT32Emu::File {
+public:
+	MemoryFile(const MT32Emu::Bit8u *data, size_t size) : _data(data), _size(size), _pos(0) {}
+
+	void close() {}
+	size_t read(void *in, size_t size) {
+		if (size > _size - _pos)
+			size = _size - _pos;
+		memcpy(in, _data + _pos, size);
+		_pos += size;
+		return size;
+	}
+	bool readBit8u(MT32Emu::Bit8u *in) {
+		if (_pos >= _size)
+			return false;
+		*in = _data[_pos++];
+		return true;
+	}
+	size_t write(const void *, size_t) { return 0; }
+	bool writeBit8u(MT32Emu::Bit8u) { return false; }
+	bool isEOF() { return _pos >= _size; }
+
+private:
+	const MT32Emu::Bit8u *_data;
+	size_t _size, _pos;
+};
+
+static MT32Emu::File *openROM(void *, const char *filename, MT32Emu::File::OpenMode mode) {
+	if (mode != MT32Emu::File::OpenMode_read)
+		return 0;
+	if (!strcmp(filename, "MT32_CONTROL.ROM"))
+		return new MemoryFile(s_controlROM, sizeof(s_controlROM));
+	if (!strcmp(filename, "MT32_PCM.ROM"))
+		return new MemoryFile(s_pcmROM, sizeof(s_pcmROM));
+	return 0;
+}
+
+static void printDebug(void *, const char *, va_list) {
+}
+
+static void writeROMAddress(MT32Emu::Bit8u *ptr, uint16 address) {
+	ptr[0] = address & 0xFF;
+	ptr[1] = address >> 8;
+}
+
+static void makeTimbre(MT32Emu::Bit8u *ptr, int variant) {
+	MT32Emu::TimbreParam *timbre = (MT32Emu::TimbreParam *)ptr;
+	memset(timbre, 0, sizeof(*timbre));
+	memcpy(timbre->common.name, "SYNTHETIC ", 10);
+	timbre->common.pstruct12 = variant % 13;
+	timbre->common.pstruct34 = (variant * 5) % 13;
+	timbre->common.pmute = 1 + variant % 15;
+
+	for (int p = 0; p < 4; p++) {
+		MT32Emu::TimbreParam::partialParam &partial = timbre->partial[p];
+		partial.wg.coarse = 36 + (variant + p) % 24;
+		partial.wg.fine = 50;
+		partial.wg.keyfollow = 11;
+		partial.wg.bender = 1;
+		partial.wg.waveform = (variant + p) % 2;
+		partial.wg.pcmwave = (variant * 7 + p) % 128;
+		partial.wg.pulsewid = 20 + p * 10;
+		partial.wg.pwvelo = 7;
+
+		partial.env.depth = 2;
+		partial.env.sensitivity = 50;
+		partial.env.timekeyfollow = 1;
+		for (int i = 0; i < 4; i++)
+			partial.env.time[i] = 10 + i * 10;
+		for (int i = 0; i < 5; i++)
+			partial.env.level[i] = 50;
+
+		partial.lfo.rate = 40;
+		partial.lfo.depth = 10;
+		partial.lfo.modsense = 10;
+
+		partial.tvf.cutoff = 40 + variant % 50;
+		partial.tvf.resonance = variant % 20;
+		partial.tvf.keyfollow = 8;
+		partial.tvf.biaspoint = 64;
+		partial.tvf.biaslevel = 7;
+		partial.tvf.envdepth = 50;
+		partial.tvf.envsense = 50;
+		partial.tvf.envdkf = 1;
+		partial.tvf.envtkf = 1;
+		for (int i = 0; i < 5; i++)
+			partial.tvf.envtime[i] = 10 + i * 15;
+		for (int i = 0; i < 4; i++)
+			partial.tvf.envlevel[i] = 100 - i * 20;
+
+		partial.tva.level = 90;
+		partial.tva.velosens = 50;
+		partial.tva.biaspoint1 = 64;
+		partial.tva.biaslevel1 = 12;
+		partial.tva.biaspoint2 = 64;
+		partial.tva.biaslevel2 = 12;
+		partial.tva.envtkf = 1;
+		partial.tva.envvkf = 1;
+		for (int i = 0; i < 5; i++)
+			partial.tva.envtime[i] = 5 + i * 20;
+		for (int i = 0; i < 4; i++)
+			partial.tva.envlevel[i] = 100 - i * 10;
+	}
+}
+
+/**
+ * Fill the ROMs with just enough for the emulator to start: 16 timbres,
+ * referenced by both banks and the rhythm setup, and noise as PCM samples.
+ */
+static void makeROMs() {
+	memcpy(s_controlROM + 0x4010, "\000 ver1.07 10 Oct, 87 ", 22);
+
+	for (int i = 0; i < 128; i++) {
+		MT32Emu::Bit8u *pcm = s_controlROM + 0x3000 + i * 4;
+		pcm[0] = i;
+		pcm[1] = (i & 1) ? 0x80 : 0x10;
+		pcm[2] = 0x00;
+		pcm[3] = 0x50;
+	}
+
+	for (int i = 0; i < 16; i++)
+		makeTimbre(s_controlROM + 0x9000 + i * 256, i);
+	for (int i = 0; i < 64; i++) {
+		const uint16 address = 0x9000 + (i % 16) * 256;
+		writeROMAddress(s_controlROM + 0x8000 + i * 2, address);
+		writeROMAddress(s_controlROM + 0xC000 + i * 2, address - 0x4000);
+	}
+	for (int i = 0; i < 30; i++)
+		writeROMAddress(s_controlROM + 0x3200 + i * 2, 0x9000 + (i % 16) * 256);
+
+	for (int i = 0; i < 85; i++) {
+		MT32Emu::Bit8u *rhythm = s_controlROM + 0x73FE + i * 4;
+		rhythm[0] = i % 30;
+		rhythm[1] = 80;
+		rhythm[2] = 7;
+		rhythm[3] = 1;
+	}
+
+	static const MT32Emu::Bit8u reserveSettings[9] = { 3, 10, 6, 4, 3, 0, 0, 0, 6 };
+	memcpy(s_controlROM + 0x57B1, reserveSettings, 9);
+	for (int i = 0; i < 9; i++)
+		s_controlROM[0x57BA + i] = 7;
+	for (int i = 0; i < 8; i++)
+		s_controlROM[0x57CC + i] = i * 8;
+
+	uint32 noise = 1;
+	for (uint i = 0; i < sizeof(s_pcmROM); i++) {
+		noise = noise * 1664525 + 1013904223;
+		s_pcmROM[i] = noise >> 24;
+	}
+}
+
+// Set up like MidiDriver_MT32
+class MT32BenchDriver : public BenchDriver {
+public:
+	MT32BenchDriver(bool scheduleEvents, bool reverb) : BenchDriver(10000, 32000, true, scheduleEvents) {
+		MT32Emu::SynthProperties prop;
+		memset(&prop, 0, sizeof(prop));
+		prop.sampleRate = getRate();
+		prop.useReverb = reverb;
+		prop.useDefaultReverb = false;
+		prop.reverbType = 0;
+		prop.reverbTime = 5;
+		prop.reverbLevel = 3;
+		prop.printDebug = printDebug;
+		prop.openFile = openROM;
+
+		_synth = new MT32Emu::Synth();
+		if (!_synth->open(prop)) {
+			fprintf(stderr, "Could not start the MT-32 emulator\n");
+			exit(1);
+		}
+	}
+
+	~MT32BenchDriver() {
+		_synth->close();
+		delete _synth;
+	}
+
+protected:
+	void play(uint32 b) { _synth->playMsg(b); }
+	void generateSamples(int16 *buf, int len) { _synth->render(buf, len); }
+
+private:
+	MT32Emu::Synth *_synth;
+};
+
+#endif // USE_MT32EMU
+
+#ifdef USE_FLUIDSYNTH
+
+// Set up like MidiDriver_FluidSynth
+class FluidSynthBenchDriver : public BenchDriver {
+public:
+	FluidSynthBenchDriver(const char *soundFont, bool scheduleEvents) : BenchDriver(250, 44100, true, scheduleEvents) {
+		_settings = new_fluid_settings();
+		fluid_settings_setnum(_settings, "synth.sample-rate", getRate());
+		_synth = new_fluid_synth(_settings);
+		if (fluid_synth_sfload(_synth, soundFont, 1) == -1) {
+			fprintf(stderr, "Could not load the SoundFont %s\n", soundFont);
+			exit(1);
+		}
+	}
+
+	~FluidSynthBenchDriver() {
+		delete_fluid_synth(_synth);
+		delete_fluid_settings(_settings);
+	}
+
+protected:
+	void play(uint32 b) {
+		const byte chan = b & 0x0F;
+		const byte param1 = (b >> 8) & 0xFF;
+		const byte param2 = (b >> 16) & 0xFF;
+
+		switch (b & 0xF0) {
+		case 0x80:
+			fluid_synth_noteoff(_synth, chan, param1);
+			break;
+		case 0x90:
+			fluid_synth_noteon(_synth, chan, param1, param2);
+			break;
+		case 0xB0:
+			fluid_synth_cc(_synth, chan, param1, param2);
+			break;
+		case 0xC0:
+			fluid_synth_program_change(_synth, chan, param1);
+			break;
+		}
+	}
+
+	void generateSamples(int16 *buf, int len) {
+		fluid_synth_write_s16(_synth, len, buf, 0, 2, buf, 1, 2);
+	}
+
+private:
+	fluid_settings_t *_settings;
+	fluid_synth_t *_synth;
+};
+
+#endif // USE_FLUIDSYNTH
+
+/**
+ * A minimal AdLib driver, with one melodic voice per MIDI channel and a
+ * fixed instrument. It keeps the OPL emulator about as busy as the AdLib
+ * driver does, which itself does not schedule events.
+ */
+class OPLBenchDriver : public BenchDriver {
+public:
+	OPLBenchDriver(OPL::Config::DriverId driver, bool scheduleEvents) : BenchDriver(250, 22050, false, scheduleEvents) {
+		_opl = OPL::Config::create(driver, OPL::Config::kOpl2);
+		if (!_opl || !_opl->init(getRate())) {
+			fprintf(stderr, "Could not start the OPL emulator\n");
+			exit(1);
+		}
+
+		static const byte operatorOffsets[9] = { 0x00, 0x01, 0x02, 0x08, 0x09, 0x0A, 0x10, 0x11, 0x12 };
+		_opl->writeReg(0x01, 0x20);
+		for (int i = 0; i < 9; i++) {
+			const byte op = operatorOffsets[i];
+			_opl->writeReg(0x20 + op, 0x21);
+			_opl->writeReg(0x23 + op, 0x21);
+			_opl->writeReg(0x40 + op, 0x10);
+			_opl->writeReg(0x43 + op, 0x00);
+			_opl->writeReg(0x60 + op, 0xF2);
+			_opl->writeReg(0x63 + op, 0xF2);
+			_opl->writeReg(0x80 + op, 0x54);
+			_opl->writeReg(0x83 + op, 0x56);
+			_opl->writeReg(0xC0 + i, 0x06);
+		}
+	}
+
+	~OPLBenchDriver() {
+		delete _opl;
+	}
+
+protected:
+	void play(uint32 b) {
+		const byte chan = b & 0x0F;
+		const byte note = (b >> 8) & 0x7F;
+		if (chan >= 9)
+			return;
+
+		switch (b & 0xF0) {
+		case 0x80:
+			_opl->writeReg(0xB0 + chan, 0);
+			break;
+		case 0x90: {
+			static const uint16 frequencies[12] = { 343, 363, 385, 408, 432, 458, 485, 514, 544, 577, 611, 647 };
+			const uint16 freq = frequencies[note % 12];
+			const byte block = MIN(note / 12, 7);
+			_opl->writeReg(0xA0 + chan, freq & 0xFF);
+			_opl->writeReg(0xB0 + chan, 0x20 | (block << 2) | (freq >> 8));
+			break;
+		}
+		case 0xB0:
+			if (((b >> 8) & 0xFF) == 123)
+				_opl->writeReg(0xB0 + chan, 0);
+			break;
+		}
+	}
+
+	void generateSamples(int16 *buf, int len) {
+		_opl->readBuffer(buf, len);
+	}
+
+private:
+	OPL::OPL *_opl;
+};
+
+/**
+ * Plays random notes, with bursts of notes and pauses like in game music,
+ * from the timer callback like a MidiParser.
+ */
+struct Player {
+	MidiDriver *driver;
+	uint32 usPerTick;
+	uint32 time;
+	uint32 nextEvent;
+	uint32 endTime;	///< When the music stops for good, in microseconds
+};
+
+static void allNotesOff(MidiDriver *driver) {
+	for (byte chan = 1; chan < 10; chan++)
+		driver->send(0xB0 | chan | (123 << 8));
+}
+
+static void playerTimer(void *param) {
+	Player *player = (Player *)param;
+	player->time += player->usPerTick;
+
+	while (player->time >= player->nextEvent) {
+		if (player->nextEvent >= player->endTime) {
+			allNotesOff(player->driver);
+			player->nextEvent = 0xFFFFFFFF;
+			break;
+		}
+
+		const uint32 phase = (player->nextEvent / 1000000) % 10;
+		if (phase < 6) {
+			const byte chan = 1 + nextRandom(8);
+			if (nextRandom(3))
+				player->driver->send(0x90 | chan | ((36 + nextRandom(48)) << 8) | ((40 + nextRandom(80)) << 16));
+			else
+				player->driver->send(0x80 | chan | ((36 + nextRandom(48)) << 8));
+			if (!nextRandom(40))
+				player->driver->send(0xC0 | chan | (nextRandom(128) << 8));
+			if (!nextRandom(20))
+				player->driver->send(0x99 | ((35 + nextRandom(40)) << 8) | (100 << 16));
+		} else if (phase == 6) {
+			allNotesOff(player->driver);
+		}
+		player->nextEvent += nextRandom(100000);
+	}
+}
+
+/**
+ * Renders the given number of seconds and returns the CPU time it took,
+ * in milliseconds per second of output.
+ */
+static double render(BenchDriver *driver, int16 *buffer, int seconds, int bufferSize) {
+	const int channels = driver->isStereo() ? 2 : 1;
+	const long total = (long)seconds * driver->getRate();
+
+	const clock_t start = clock();
+	for (long done = 0; done < total; done += bufferSize)
+		driver->readBuffer(buffer, bufferSize * channels);
+	return (double)(clock() - start) * 1000 / CLOCKS_PER_SEC / seconds;
+}
+
+/**
+ * Plays the given number of seconds of music, followed by tailSeconds of
+ * silence, which are measured separately.
+ */
+static void run(const char *name, BenchDriver *driver, int seconds, int tailSeconds, int bufferSize) {
+	s_seed = 12345;
+	driver->open();
+	Player player = { driver, driver->getBaseTempo(), 0, 0, tailSeconds ? (uint32)seconds * 1000000 : 0xFFFFFFFF };
+	driver->setTimerCallback(&player, playerTimer);
+
+	int16 *buffer = new int16[bufferSize * (driver->isStereo() ? 2 : 1)];
+
+	printf("%-12s %-10s %8.1f ms", name, driver->schedulesEvents() ? "scheduled" : "per tick", render(driver, buffer, seconds, bufferSize));
+	if (tailSeconds)
+		printf(", %.1f ms in the %d s after the music", render(driver, buffer, tailSeconds, bufferSize), tailSeconds);
+	printf("\n");
+
+	delete[] buffer;
+	delete driver;
+}
+
+int main(int argc, char *argv[]) {
+	const int seconds = argc > 1 ? atoi(argv[1]) : 60;
+	const int bufferSize = argc > 2 ? atoi(argv[2]) : 2048;
+
+	if (seconds <= 0 || bufferSize <= 0) {
+		fprintf(stderr, "Usage: %s [seconds] [buffer size] [SoundFont]\n", argv[0]);
+		return 1;
+	}
+
+	printf("CPU time per second of music, %d s of music, buffers of %d samples\n", seconds, bufferSize);
+
+	// Every driver with the output split at every tick, then with scheduled events
+#ifdef USE_MT32EMU
+	makeROMs();
+	run("MT-32", new MT32BenchDriver(false, true), seconds, 0, bufferSize);
+	run("MT-32", new MT32BenchDriver(true, true), seconds, 0, bufferSize);
+#endif
+#ifdef USE_FLUIDSYNTH
+	if (argc > 3) {
+		run("FluidSynth", new FluidSynthBenchDriver(argv[3], false), seconds, 0, bufferSize);
+		run("FluidSynth", new FluidSynthBenchDriver(argv[3], true), seconds, 0, bufferSize);
+	}
+#endif
+	run("AdLib/MAME", new OPLBenchDriver(OPL::Config::parse("mame"), false), seconds, 0, bufferSize);
+	run("AdLib/MAME", new OPLBenchDriver(OPL::Config::parse("mame"), true), seconds, 0, bufferSize);
+#ifndef DISABLE_DOSBOX_OPL
+	run("AdLib/DOSBox", new OPLBenchDriver(OPL::Config::parse("db"), false), seconds, 0, bufferSize);
+	run("AdLib/DOSBox", new OPLBenchDriver(OPL::Config::parse("db"), true), seconds, 0, bufferSize);
+#endif
+
+	// The music again, followed by as much silence, with and without reverb
+#ifdef USE_MT32EMU
+	run("MT-32", new MT32BenchDriver(true, true), seconds, seconds, bufferSize);
+	run("MT-32/dry", new MT32BenchDriver(true, false), seconds, seconds, bufferSize);
+#endif
+
+	return 0;
+}
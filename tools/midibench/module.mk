@@ -0,0 +1,21 @@
+MODULE := tools/midibench
+
+MODULE_OBJS := \
+	midibench.o
+
+MODULE_DIRS += $(MODULE)/
+
+#
+# Unlike the other tools, this one uses the synths of the audio module, so
+# it is linked with the libraries of the main executable. Build it with
+# "make tools/midibench".
+#
+MIDIBENCH_LIBS := audio/libaudio.a common/libcommon.a
+ifdef USE_MT32EMU
+MIDIBENCH_LIBS := audio/softsynth/mt32/libmt32.a $(MIDIBENCH_LIBS)
+endif
+
+tools/midibench/midibench$(EXEEXT): $(addprefix $(MODULE)/, $(MODULE_OBJS)) $(MIDIBENCH_LIBS)
+	$(QUIET_LINK)$(CXX) $(LDFLAGS) $+ $(LIBS) -o $@
+
+tools/midibench: tools/midibench/midibench$(EXEEXT)
@@ -0,0 +1,184 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ * This is a utility for measuring the CPU time the mixer and the rate
+ * converters need, in nanoseconds per output sample. The mixer is run with
+ * 16, 64 and 256 active channels, the rate converters are run on their own,
+ * both with the linear and the polyphase filter converters. Build it with
+ * "make tools/mixbench".
+ *
+ * Usage: mixbench [seconds]
+ */
+
+// Disable symbol overrides so that we can use system headers.
+#define FORBIDDEN_SYMBOL_ALLOW_ALL
+
+#include "audio/audiostream.h"
+#include "audio/mixer_intern.h"
+#include "audio/rate.h"
+#include "audio/decoders/raw.h"
+#include "backends/modular-backend.h"
+#include "backends/mutex/null/null-mutex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+enum {
+	kOutputRate = 44100,
+	kBufferSize = 2048	///< Sample pairs mixed per call, like a typical audio callback
+};
+
+/**
+ * Just enough of a backend for the mixer, which needs mutexes and a clock.
+ */
+class BenchSystem : public ModularBackend {
+public:
+	BenchSystem() {
+		_mutexManager = (MutexManager *)new NullMutexManager();
+	}
+
+	bool pollEvent(Common::Event &event) { return false; }
+	uint32 getMillis() { return 0; }
+	void delayMillis(uint msecs) {}
+	void getTimeAndDate(TimeDate &t) const {}
+
+	Common::SeekableReadStream *createConfigReadStream() { return 0; }
+	Common::WriteStream *createConfigWriteStream() { return 0; }
+};
+
+/**
+ * The input sounds, with the rates and formats games use. They are looped
+ * forever, so every channel stays active.
+ */
+struct Sound {
+	int rate;
+	bool stereo;
+};
+
+static const Sound s_sounds[] = {
+	{ 11025, false },
+	{ 22050, false },
+	{ 44100, true },
+	{ 22050, true }
+};
+
+static Audio::AudioStream *makeSound(const Sound &sound) {
+	// One second of noise
+	const uint32 size = sound.rate * (sound.stereo ? 4 : 2);
+	byte *data = (byte *)malloc(size);
+	uint32 noise = sound.rate;
+	for (uint32 i = 0; i < size; i++) {
+		noise = noise * 1664525 + 1013904223;
+		data[i] = noise >> 24;
+	}
+
+	const byte flags = Audio::FLAG_16BITS | Audio::FLAG_LITTLE_ENDIAN | (sound.stereo ? Audio::FLAG_STEREO : 0);
+	return Audio::makeLoopingAudioStream(Audio::makeRawStream(data, size, sound.rate, flags), 0);
+}
+
+static const char *qualityName(Audio::RateConverterQuality quality) {
+	return quality == Audio::kRateQualityHigh ? "filter" : "linear";
+}
+
+static void benchMixer(uint channels, Audio::RateConverterQuality quality, int seconds) {
+	Audio::MixerImpl mixer(g_system, kOutputRate, channels);
+	mixer.setReady(true);
+	mixer.setRateConverterQuality(quality);
+
+	// Through the base class, for the default arguments
+	Audio::Mixer &baseMixer = mixer;
+	for (uint i = 0; i < channels; i++)
+		baseMixer.playStream(Audio::Mixer::kSFXSoundType, 0, makeSound(s_sounds[i % ARRAYSIZE(s_sounds)]));
+
+	byte *buffer = new byte[kBufferSize * 4];
+	const long total = (long)seconds * kOutputRate;
+
+	const clock_t start = clock();
+	for (long done = 0; done < total; done += kBufferSize)
+		mixer.mixCallback(buffer, kBufferSize * 4);
+	const double time = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	const double ns = time * 1e9 / total;
+	printf("mixer %3u channels %-8s %9.1f ns/sample %7.2f ns/channel sample\n", channels, qualityName(quality), ns, ns / channels);
+
+	delete[] buffer;
+}
+
+static void benchConverter(const Sound &sound, int outRate, Audio::RateConverterQuality quality, int seconds) {
+	Audio::AudioStream *stream = makeSound(sound);
+	Audio::RateConverter *converter = Audio::makeRateConverter(sound.rate, outRate, sound.stereo, false, quality);
+
+	// The converters mix into the buffer, so its contents don't matter
+	int16 *buffer = new int16[kBufferSize * 2];
+	memset(buffer, 0, kBufferSize * 4);
+	const long total = (long)seconds * outRate;
+
+	const clock_t start = clock();
+	for (long done = 0; done < total; done += kBufferSize)
+		converter->flow(*stream, buffer, kBufferSize, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+	const double time = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("rate  %5d -> %5d %-6s %-8s %9.1f ns/sample\n", sound.rate, outRate, sound.stereo ? "stereo" : "mono",
+	       qualityName(quality), time * 1e9 / total);
+
+	delete[] buffer;
+	delete converter;
+	delete stream;
+}
+
+int main(int argc, char *argv[]) {
+	const int seconds = argc > 1 ? atoi(argv[1]) : 10;
+
+	if (seconds <= 0) {
+		fprintf(stderr, "Usage: %s [seconds]\n", argv[0]);
+		return 1;
+	}
+
+	BenchSystem *system = new BenchSystem();
+	g_system = system;
+
+	printf("CPU time per output sample, %d s of output at %d Hz\n", seconds, kOutputRate);
+
+	static const uint channelCounts[] = { 16, 64, 256 };
+	for (int i = 0; i < ARRAYSIZE(channelCounts); i++) {
+		benchMixer(channelCounts[i], Audio::kRateQualityLow, seconds);
+		benchMixer(channelCounts[i], Audio::kRateQualityHigh, seconds);
+	}
+
+	static const Sound inputs[] = {
+		{ 11025, false },
+		{ 22050, false },
+		{ 22050, true },
+		{ 44100, true },
+		{ 48000, true }
+	};
+	for (int i = 0; i < ARRAYSIZE(inputs); i++) {
+		benchConverter(inputs[i], kOutputRate, Audio::kRateQualityLow, seconds);
+		benchConverter(inputs[i], kOutputRate, Audio::kRateQualityHigh, seconds);
+	}
+
+	g_system = 0;
+	delete system;
+	return 0;
+}
@@ -0,0 +1,17 @@
+MODULE := tools/mixbench
+
+MODULE_OBJS := \
+	mixbench.o
+
+MODULE_DIRS += $(MODULE)/
+
+#
+# Like midibench, this is linked with the libraries of the main executable.
+# Build it with "make tools/mixbench".
+#
+MIXBENCH_LIBS := audio/libaudio.a backends/libbackends.a common/libcommon.a
+
+tools/mixbench/mixbench$(EXEEXT): $(addprefix $(MODULE)/, $(MODULE_OBJS)) $(MIXBENCH_LIBS)
+	$(QUIET_LINK)$(CXX) $(LDFLAGS) $+ $(LIBS) -o $@
+
+tools/mixbench: tools/mixbench/mixbench$(EXEEXT)
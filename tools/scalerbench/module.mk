@@ -0,0 +1,20 @@
+MODULE := tools/scalerbench
+
+MODULE_OBJS := \
+	scalerbench.o
+
+MODULE_DIRS += $(MODULE)/
+
+#
+# Like midibench, this is linked with the libraries of the main executable.
+# Build it with "make tools/scalerbench".
+#
+SCALERBENCH_LIBS :=
+ifdef UNIX
+SCALERBENCH_LIBS := -lpthread
+endif
+
+tools/scalerbench/scalerbench$(EXEEXT): $(addprefix $(MODULE)/, $(MODULE_OBJS)) graphics/libgraphics.a common/libcommon.a
+	$(QUIET_LINK)$(CXX) $(LDFLAGS) $+ $(LIBS) $(SCALERBENCH_LIBS) -o $@
+
+tools/scalerbench: tools/scalerbench/scalerbench$(EXEEXT)
@@ -0,0 +1,313 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ * This is a utility for measuring how long the scalers take per frame,
+ * when run over the whole screen at once and when split into horizontal
+ * bands which are scaled by several threads, like the SDL backend does with
+ * the scaler_threads config key. It also checks that both produce the same
+ * output. Build it with "make tools/scalerbench".
+ *
+ * Usage: scalerbench [frames] [threads] [width] [height]
+ *
+ * The threads are only available on Unix, elsewhere the bands are scaled
+ * one after another.
+ */
+
+// Disable symbol overrides so that we can use system headers.
+#define FORBIDDEN_SYMBOL_ALLOW_ALL
+
+#include "graphics/scaler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#ifdef UNIX
+#include <pthread.h>
+#endif
+
+enum {
+	kMaxThreads = 8,			///< Like kMaxScalerThreads in SdlGraphicsManager
+	kMinBandHeight = 16			///< Like kMinScalerBandHeight in SdlGraphicsManager
+};
+
+struct Scaler {
+	const char *name;
+	ScalerProc *proc;
+	int factor;
+};
+
+static const Scaler s_scalers[] = {
+	{ "Normal1x", Normal1x, 1 },
+#ifdef USE_SCALERS
+	{ "Normal2x", Normal2x, 2 },
+	{ "Normal3x", Normal3x, 3 },
+	{ "AdvMame2x", AdvMame2x, 2 },
+	{ "AdvMame3x", AdvMame3x, 3 },
+	{ "2xSaI", _2xSaI, 2 },
+	{ "Super2xSaI", Super2xSaI, 2 },
+	{ "SuperEagle", SuperEagle, 2 },
+	{ "TV2x", TV2x, 2 },
+	{ "DotMatrix", DotMatrix, 2 },
+#ifdef USE_HQ_SCALERS
+	{ "HQ2x", HQ2x, 2 },
+	{ "HQ3x", HQ3x, 3 },
+#endif
+#endif
+};
+
+/** A horizontal band of the screen, to be scaled by one of the threads */
+struct Job {
+	const uint8 *src;
+	uint8 *dst;
+	int width, height;
+};
+
+static ScalerProc *s_jobProc;
+static uint32 s_jobSrcPitch, s_jobDstPitch;
+static Job s_jobs[kMaxThreads];
+static int s_numJobs, s_nextJob, s_unfinishedJobs;
+
+#ifdef UNIX
+
+// The same scheme as the scaler threads of the SDL backend: the main thread
+// works on the jobs as well, so there are threads - 1 extra threads.
+static pthread_t s_threads[kMaxThreads];
+static int s_numThreads = 1;
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_jobCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t s_doneCond = PTHREAD_COND_INITIALIZER;
+static bool s_threadsShouldQuit;
+
+static void runNextJob() {
+	const Job job = s_jobs[s_nextJob++];
+
+	pthread_mutex_unlock(&s_mutex);
+	s_jobProc(job.src, s_jobSrcPitch, job.dst, s_jobDstPitch, job.width, job.height);
+	pthread_mutex_lock(&s_mutex);
+
+	if (!--s_unfinishedJobs)
+		pthread_cond_signal(&s_doneCond);
+}
+
+static void *scalerThread(void *) {
+	pthread_mutex_lock(&s_mutex);
+	while (!s_threadsShouldQuit) {
+		if (s_nextJob < s_numJobs)
+			runNextJob();
+		else
+			pthread_cond_wait(&s_jobCond, &s_mutex);
+	}
+	pthread_mutex_unlock(&s_mutex);
+	return 0;
+}
+
+static int initThreads(int threads) {
+	s_threadsShouldQuit = false;
+	for (s_numThreads = 1; s_numThreads < threads; s_numThreads++) {
+		if (pthread_create(&s_threads[s_numThreads], 0, scalerThread, 0)) {
+			fprintf(stderr, "Could not create scaler thread\n");
+			break;
+		}
+	}
+	return s_numThreads;
+}
+
+static void deinitThreads() {
+	pthread_mutex_lock(&s_mutex);
+	s_threadsShouldQuit = true;
+	pthread_cond_broadcast(&s_jobCond);
+	pthread_mutex_unlock(&s_mutex);
+
+	for (int i = 1; i < s_numThreads; i++)
+		pthread_join(s_threads[i], 0);
+	s_numThreads = 1;
+}
+
+static void runJobs() {
+	pthread_mutex_lock(&s_mutex);
+	s_nextJob = 0;
+	s_unfinishedJobs = s_numJobs;
+	pthread_cond_broadcast(&s_jobCond);
+
+	while (true) {
+		while (s_nextJob < s_numJobs)
+			runNextJob();
+
+		if (!s_unfinishedJobs)
+			break;
+
+		pthread_cond_wait(&s_doneCond, &s_mutex);
+	}
+	pthread_mutex_unlock(&s_mutex);
+}
+
+#else
+
+static int initThreads(int threads) {
+	return 1;
+}
+
+static void deinitThreads() {
+}
+
+static void runJobs() {
+	for (s_nextJob = 0; s_nextJob < s_numJobs; s_nextJob++) {
+		const Job &job = s_jobs[s_nextJob];
+		s_jobProc(job.src, s_jobSrcPitch, job.dst, s_jobDstPitch, job.width, job.height);
+	}
+}
+
+#endif // UNIX
+
+/**
+ * Splits the rect into bands like SdlGraphicsManager::scaleRect() and scales
+ * them.
+ */
+static void scaleBanded(ScalerProc *proc, const uint8 *src, uint32 srcPitch, uint8 *dst, uint32 dstPitch,
+                        int width, int height, int factor, int bands) {
+	bands = MIN(bands, height / kMinBandHeight);
+
+	if (bands <= 1) {
+		proc(src, srcPitch, dst, dstPitch, width, height);
+		return;
+	}
+
+	int y = 0;
+	for (int i = 0; i < bands; i++) {
+		Job &job = s_jobs[i];
+		job.src = src + y * srcPitch;
+		job.dst = dst + y * factor * dstPitch;
+		job.width = width;
+		// Keep the bands aligned to 4 rows, as the pattern of the DotMatrix
+		// scaler depends on the row
+		job.height = (i == bands - 1) ? height - y : ((height - y) / (bands - i)) & ~3;
+		y += job.height;
+	}
+
+	s_jobProc = proc;
+	s_jobSrcPitch = srcPitch;
+	s_jobDstPitch = dstPitch;
+	s_numJobs = bands;
+	runJobs();
+}
+
+static double wallTime() {
+	// Not clock(), which adds up the CPU time of all threads
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/**
+ * Fills the screen with something like a game screen: areas of flat color,
+ * gradients and dithering, so the edge detecting scalers take all paths.
+ */
+static void makeScreen(uint16 *pixels, int pitch, int width, int height) {
+	uint32 noise = 1;
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			noise = noise * 1664525 + 1013904223;
+			uint16 color;
+
+			if (y < height / 3)
+				color = ((x / 8) & 0x1F) << 11 | ((y / 2) & 0x3F) << 5 | 0x10;
+			else if (y < height * 2 / 3)
+				color = ((x / 16 + y / 16) & 1) ? 0xF800 : (((x + y) & 1) ? 0x07E0 : 0x001F);
+			else
+				color = (noise >> 28) < 12 ? 0x8410 : (uint16)(noise >> 16);
+
+			pixels[y * pitch + x] = color;
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const int frames = argc > 1 ? atoi(argv[1]) : 100;
+	const int threads = argc > 2 ? atoi(argv[2]) : 4;
+	const int width = argc > 3 ? atoi(argv[3]) : 320;
+	const int height = argc > 4 ? atoi(argv[4]) : 200;
+
+	if (frames <= 0 || threads < 1 || threads > kMaxThreads || width <= 0 || height <= 0) {
+		fprintf(stderr, "Usage: %s [frames] [threads] [width] [height]\n", argv[0]);
+		return 1;
+	}
+
+	InitScalers(565);
+
+	// Like the tmpscreen of the SDL backend, with a border for the scalers
+	// reading around the edges
+	const int srcPitch = (width + 3) * 2;
+	uint16 *srcPixels = (uint16 *)calloc(srcPitch / 2 * (height + 3), 2);
+	uint8 *src = (uint8 *)srcPixels + srcPitch + 2;
+	makeScreen((uint16 *)src, srcPitch / 2, width, height);
+
+	const int dstPitch = width * 3 * 2;
+	const uint32 dstSize = dstPitch * height * 3;
+	uint8 *whole = (uint8 *)malloc(dstSize);
+	uint8 *banded = (uint8 *)malloc(dstSize);
+
+	const int bands = initThreads(threads);
+	printf("Time per %dx%d frame in ms, %d frames, %d bands\n", width, height, frames, bands);
+	printf("%-12s %8s %8s\n", "", "whole", "banded");
+
+	bool allIdentical = true;
+
+	for (int i = 0; i < ARRAYSIZE(s_scalers); i++) {
+		const Scaler &scaler = s_scalers[i];
+
+		memset(whole, 0, dstSize);
+		memset(banded, 0xFF, dstSize);
+
+		double start = wallTime();
+		for (int frame = 0; frame < frames; frame++)
+			scaler.proc(src, srcPitch, whole, dstPitch, width, height);
+		const double wholeTime = wallTime() - start;
+
+		start = wallTime();
+		for (int frame = 0; frame < frames; frame++)
+			scaleBanded(scaler.proc, src, srcPitch, banded, dstPitch, width, height, scaler.factor, bands);
+		const double bandedTime = wallTime() - start;
+
+		bool identical = true;
+		for (int y = 0; y < height * scaler.factor; y++) {
+			if (memcmp(whole + y * dstPitch, banded + y * dstPitch, width * scaler.factor * 2))
+				identical = false;
+		}
+		allIdentical &= identical;
+
+		printf("%-12s %8.2f %8.2f%s\n", scaler.name, wholeTime * 1000 / frames, bandedTime * 1000 / frames,
+		       identical ? "" : "   output differs");
+	}
+
+	deinitThreads();
+	DestroyScalers();
+	free(srcPixels);
+	free(whole);
+	free(banded);
+
+	return allIdentical ? 0 : 1;
+}
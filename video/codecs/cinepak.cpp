@@ -38,19 +38,85 @@ inline static void CPYUV2RGB(byte y, byte u, byte v, byte &r, byte &g, byte &b)
 	b = CLIP<int>(y + 2 * (u - 128), 0, 255);
 }
 
-#define PUT_PIXEL(offset, lum, u, v) \
-	if (_pixelFormat.bytesPerPixel != 1) { \
-		CPYUV2RGB(lum, u, v, r, g, b); \
-		if (_pixelFormat.bytesPerPixel == 2) \
-			*((uint16 *)_curFrame.surface->pixels + offset) = _pixelFormat.RGBToColor(r, g, b); \
-		else \
-			*((uint32 *)_curFrame.surface->pixels + offset) = _pixelFormat.RGBToColor(r, g, b); \
-	} else \
-		*((byte *)_curFrame.surface->pixels + offset) = lum
+/**
+ * Fill a 4x4 block with a V1 codebook entry, each pixel of which covers
+ * 2x2 pixels.
+ */
+template<typename PixelInt>
+static inline void putV1Block(PixelInt *dst, uint pitch, const CinepakCodebook &codebook) {
+	for (int i = 0; i < 2; i++) {
+		const PixelInt p0 = codebook.pixels[i * 2 + 0];
+		const PixelInt p1 = codebook.pixels[i * 2 + 1];
+
+		dst[0] = dst[1] = dst[pitch + 0] = dst[pitch + 1] = p0;
+		dst[2] = dst[3] = dst[pitch + 2] = dst[pitch + 3] = p1;
+		dst += 2 * pitch;
+	}
+}
+
+/**
+ * Fill a 2x2 quarter of a 4x4 block with a V4 codebook entry.
+ */
+template<typename PixelInt>
+static inline void putV4Quarter(PixelInt *dst, uint pitch, const CinepakCodebook &codebook) {
+	dst[0] = codebook.pixels[0];
+	dst[1] = codebook.pixels[1];
+	dst[pitch + 0] = codebook.pixels[2];
+	dst[pitch + 1] = codebook.pixels[3];
+}
+
+template<typename PixelInt>
+static void decodeStripVectors(Common::SeekableReadStream *stream, const CinepakStrip &strip, Graphics::Surface *surface, byte chunkID, uint32 chunkSize) {
+	uint32 flag = 0, mask = 0;
+	int32 startPos = stream->pos();
+	const uint pitch = surface->pitch / sizeof(PixelInt);
+
+	for (uint16 y = strip.rect.top; y < strip.rect.bottom; y += 4) {
+		PixelInt *dst = (PixelInt *)surface->getBasePtr(strip.rect.left, y);
+
+		for (uint16 x = strip.rect.left; x < strip.rect.right; x += 4, dst += 4) {
+			if ((chunkID & 0x01) && !(mask >>= 1)) {
+				if ((stream->pos() - startPos + 4) > (int32)chunkSize)
+					return;
+
+				flag  = stream->readUint32BE();
+				mask  = 0x80000000;
+			}
+
+			if (!(chunkID & 0x01) || (flag & mask)) {
+				if (!(chunkID & 0x02) && !(mask >>= 1)) {
+					if ((stream->pos() - startPos + 4) > (int32)chunkSize)
+						return;
+
+					flag  = stream->readUint32BE();
+					mask  = 0x80000000;
+				}
+
+				if ((chunkID & 0x02) || (~flag & mask)) {
+					if ((stream->pos() - startPos + 1) > (int32)chunkSize)
+						return;
+
+					putV1Block(dst, pitch, strip.v1_codebook[stream->readByte()]);
+				} else if (flag & mask) {
+					if ((stream->pos() - startPos + 4) > (int32)chunkSize)
+						return;
+
+					byte index[4] = { 0, 0, 0, 0 };
+					stream->read(index, 4);
+					putV4Quarter(dst,                 pitch, strip.v4_codebook[index[0]]);
+					putV4Quarter(dst + 2,             pitch, strip.v4_codebook[index[1]]);
+					putV4Quarter(dst + 2 * pitch,     pitch, strip.v4_codebook[index[2]]);
+					putV4Quarter(dst + 2 * pitch + 2, pitch, strip.v4_codebook[index[3]]);
+				}
+			}
+		}
+	}
+}
 
 CinepakDecoder::CinepakDecoder(int bitsPerPixel) : Codec() {
 	_curFrame.surface = NULL;
 	_curFrame.strips = NULL;
+	_stripsAllocated = 0;
 	_y = 0;
 
 	if (bitsPerPixel == 8)
@@ -75,8 +141,17 @@ const Graphics::Surface *CinepakDecoder::decodeImage(Common::SeekableReadStream
 	_curFrame.height = stream->readUint16BE();
 	_curFrame.stripCount = stream->readUint16BE();
 
-	if (_curFrame.strips == NULL)
-		_curFrame.strips = new CinepakStrip[_curFrame.stripCount];
+	if (_curFrame.stripCount > _stripsAllocated) {
+		// Keep the codebooks of the existing strips, which may be used by
+		// the following frames
+		CinepakStrip *strips = new CinepakStrip[_curFrame.stripCount];
+		for (uint16 i = 0; i < _stripsAllocated; i++)
+			strips[i] = _curFrame.strips[i];
+
+		delete[] _curFrame.strips;
+		_curFrame.strips = strips;
+		_stripsAllocated = _curFrame.stripCount;
+	}
 
 	debug (4, "Cinepak Frame: Width = %d, Height = %d, Strip Count = %d", _curFrame.width, _curFrame.height, _curFrame.stripCount);
 
@@ -97,10 +172,8 @@ const Graphics::Surface *CinepakDecoder::decodeImage(Common::SeekableReadStream
 
 	for (uint16 i = 0; i < _curFrame.stripCount; i++) {
 		if (i > 0 && !(_curFrame.flags & 1)) { // Use codebooks from last strip
-			for (uint16 j = 0; j < 256; j++) {
-				_curFrame.strips[i].v1_codebook[j] = _curFrame.strips[i - 1].v1_codebook[j];
-				_curFrame.strips[i].v4_codebook[j] = _curFrame.strips[i - 1].v4_codebook[j];
-			}
+			memcpy(_curFrame.strips[i].v1_codebook, _curFrame.strips[i - 1].v1_codebook, sizeof(_curFrame.strips[i].v1_codebook));
+			memcpy(_curFrame.strips[i].v4_codebook, _curFrame.strips[i - 1].v4_codebook, sizeof(_curFrame.strips[i].v4_codebook));
 		}
 
 		_curFrame.strips[i].id = stream->readUint16BE();
@@ -180,112 +253,47 @@ void CinepakDecoder::loadCodebook(Common::SeekableReadStream *stream, uint16 str
 			if ((stream->pos() - startPos + n) > (int32)chunkSize)
 				break;
 
+			byte y[4], u, v;
 			for (byte j = 0; j < 4; j++)
-				codebook[i].y[j] = stream->readByte();
+				y[j] = stream->readByte();
 
 			if (n == 6) {
-				codebook[i].u  = stream->readByte() + 128;
-				codebook[i].v  = stream->readByte() + 128;
+				u = stream->readByte() + 128;
+				v = stream->readByte() + 128;
 			} else {
 				// This codebook type indicates either greyscale or
 				// palettized video. For greyscale, default us to
 				// 128 for both u and v.
-				codebook[i].u  = 128;
-				codebook[i].v  = 128;
+				u = 128;
+				v = 128;
+			}
+
+			// Convert the entry to the output format right away, instead
+			// of converting it again for every block using it
+			for (byte j = 0; j < 4; j++) {
+				if (_pixelFormat.bytesPerPixel == 1) {
+					codebook[i].pixels[j] = y[j];
+				} else {
+					byte r, g, b;
+					CPYUV2RGB(y[j], u, v, r, g, b);
+					codebook[i].pixels[j] = _pixelFormat.RGBToColor(r, g, b);
+				}
 			}
 		}
 	}
 }
 
 void CinepakDecoder::decodeVectors(Common::SeekableReadStream *stream, uint16 strip, byte chunkID, uint32 chunkSize) {
-	uint32 flag = 0, mask = 0;
-	uint32 iy[4];
-	int32 startPos = stream->pos();
-	byte r = 0, g = 0, b = 0;
-
-	for (uint16 y = _curFrame.strips[strip].rect.top; y < _curFrame.strips[strip].rect.bottom; y += 4) {
-		iy[0] = _curFrame.strips[strip].rect.left + y * _curFrame.width;
-		iy[1] = iy[0] + _curFrame.width;
-		iy[2] = iy[1] + _curFrame.width;
-		iy[3] = iy[2] + _curFrame.width;
-
-		for (uint16 x = _curFrame.strips[strip].rect.left; x < _curFrame.strips[strip].rect.right; x += 4) {
-			if ((chunkID & 0x01) && !(mask >>= 1)) {
-				if ((stream->pos() - startPos + 4) > (int32)chunkSize)
-					return;
-
-				flag  = stream->readUint32BE();
-				mask  = 0x80000000;
-			}
-
-			if (!(chunkID & 0x01) || (flag & mask)) {
-				if (!(chunkID & 0x02) && !(mask >>= 1)) {
-					if ((stream->pos() - startPos + 4) > (int32)chunkSize)
-						return;
-
-					flag  = stream->readUint32BE();
-					mask  = 0x80000000;
-				}
-
-				if ((chunkID & 0x02) || (~flag & mask)) {
-					if ((stream->pos() - startPos + 1) > (int32)chunkSize)
-						return;
-
-					// Get the codebook
-					CinepakCodebook codebook = _curFrame.strips[strip].v1_codebook[stream->readByte()];
-
-					PUT_PIXEL(iy[0] + 0, codebook.y[0], codebook.u, codebook.v);
-					PUT_PIXEL(iy[0] + 1, codebook.y[0], codebook.u, codebook.v);
-					PUT_PIXEL(iy[1] + 0, codebook.y[0], codebook.u, codebook.v);
-					PUT_PIXEL(iy[1] + 1, codebook.y[0], codebook.u, codebook.v);
-
-					PUT_PIXEL(iy[0] + 2, codebook.y[1], codebook.u, codebook.v);
-					PUT_PIXEL(iy[0] + 3, codebook.y[1], codebook.u, codebook.v);
-					PUT_PIXEL(iy[1] + 2, codebook.y[1], codebook.u, codebook.v);
-					PUT_PIXEL(iy[1] + 3, codebook.y[1], codebook.u, codebook.v);
-
-					PUT_PIXEL(iy[2] + 0, codebook.y[2], codebook.u, codebook.v);
-					PUT_PIXEL(iy[2] + 1, codebook.y[2], codebook.u, codebook.v);
-					PUT_PIXEL(iy[3] + 0, codebook.y[2], codebook.u, codebook.v);
-					PUT_PIXEL(iy[3] + 1, codebook.y[2], codebook.u, codebook.v);
-
-					PUT_PIXEL(iy[2] + 2, codebook.y[3], codebook.u, codebook.v);
-					PUT_PIXEL(iy[2] + 3, codebook.y[3], codebook.u, codebook.v);
-					PUT_PIXEL(iy[3] + 2, codebook.y[3], codebook.u, codebook.v);
-					PUT_PIXEL(iy[3] + 3, codebook.y[3], codebook.u, codebook.v);
-				} else if (flag & mask) {
-					if ((stream->pos() - startPos + 4) > (int32)chunkSize)
-						return;
-
-					CinepakCodebook codebook = _curFrame.strips[strip].v4_codebook[stream->readByte()];
-					PUT_PIXEL(iy[0] + 0, codebook.y[0], codebook.u, codebook.v);
-					PUT_PIXEL(iy[0] + 1, codebook.y[1], codebook.u, codebook.v);
-					PUT_PIXEL(iy[1] + 0, codebook.y[2], codebook.u, codebook.v);
-					PUT_PIXEL(iy[1] + 1, codebook.y[3], codebook.u, codebook.v);
-
-					codebook = _curFrame.strips[strip].v4_codebook[stream->readByte()];
-					PUT_PIXEL(iy[0] + 2, codebook.y[0], codebook.u, codebook.v);
-					PUT_PIXEL(iy[0] + 3, codebook.y[1], codebook.u, codebook.v);
-					PUT_PIXEL(iy[1] + 2, codebook.y[2], codebook.u, codebook.v);
-					PUT_PIXEL(iy[1] + 3, codebook.y[3], codebook.u, codebook.v);
-
-					codebook = _curFrame.strips[strip].v4_codebook[stream->readByte()];
-					PUT_PIXEL(iy[2] + 0, codebook.y[0], codebook.u, codebook.v);
-					PUT_PIXEL(iy[2] + 1, codebook.y[1], codebook.u, codebook.v);
-					PUT_PIXEL(iy[3] + 0, codebook.y[2], codebook.u, codebook.v);
-					PUT_PIXEL(iy[3] + 1, codebook.y[3], codebook.u, codebook.v);
-
-					codebook = _curFrame.strips[strip].v4_codebook[stream->readByte()];
-					PUT_PIXEL(iy[2] + 2, codebook.y[0], codebook.u, codebook.v);
-					PUT_PIXEL(iy[2] + 3, codebook.y[1], codebook.u, codebook.v);
-					PUT_PIXEL(iy[3] + 2, codebook.y[2], codebook.u, codebook.v);
-					PUT_PIXEL(iy[3] + 3, codebook.y[3], codebook.u, codebook.v);
-				}
-			}
-
-			for (byte i = 0; i < 4; i++)
-				iy[i] += 4;
-		}
+	switch (_pixelFormat.bytesPerPixel) {
+	case 1:
+		decodeStripVectors<byte>(stream, _curFrame.strips[strip], _curFrame.surface, chunkID, chunkSize);
+		break;
+	case 2:
+		decodeStripVectors<uint16>(stream, _curFrame.strips[strip], _curFrame.surface, chunkID, chunkSize);
+		break;
+	default:
+		decodeStripVectors<uint32>(stream, _curFrame.strips[strip], _curFrame.surface, chunkID, chunkSize);
+		break;
 	}
 }
 
@@ -37,8 +37,8 @@
 namespace Video {
 
 struct CinepakCodebook {
-	byte y[4];
-	byte u, v;
+	// The four pixels of the entry, already converted to the output format
+	uint32 pixels[4];
 };
 
 struct CinepakStrip {
@@ -69,6 +69,7 @@ public:
 
 private:
 	CinepakFrame _curFrame;
+	uint16 _stripsAllocated;
 	int32 _y;
 	Graphics::PixelFormat _pixelFormat;
 
@@ -51,18 +51,17 @@ const Graphics::Surface *JPEGDecoder::decodeImage(Common::SeekableReadStream* st
 		return 0;
 	}
 
-	if (!_surface) {
+	if (!_surface)
 		_surface = new Graphics::Surface();
-		_surface->create(_jpeg->getWidth(), _jpeg->getHeight(), _pixelFormat.bytesPerPixel);
-	}
-
-	Graphics::Surface *frame = _jpeg->getSurface(_pixelFormat);
-	assert(frame);
 
-	_surface->copyFrom(*frame);
+	if (_surface->w != _jpeg->getWidth() || _surface->h != _jpeg->getHeight())
+		_surface->create(_jpeg->getWidth(), _jpeg->getHeight(), _pixelFormat.bytesPerPixel);
 
-	frame->free();
-	delete frame;
+	// Convert straight into our surface instead of going through a temporary
+	if (!_jpeg->convertTo(*_surface, _pixelFormat)) {
+		warning("Failed to convert JPEG frame");
+		return 0;
+	}
 
 	return _surface;
 }
@@ -0,0 +1,353 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "video/decode_ahead.h"
+
+#include "common/debug.h"
+#include "common/list.h"
+#include "common/system.h"
+#include "common/timer.h"
+#include "common/util.h"
+
+namespace Video {
+
+enum {
+	kTimerInterval = 10000,	///< Interval of the decoding callback, in microseconds
+	kMaxTimerDecodeTime = 5	///< Longest frame decode still done from the callback, in ms
+};
+
+// All decoders with a frame pool. The timer callback is removed whenever the
+// list changes, which also waits for a running invocation to finish, so the
+// callback never sees the list being modified.
+static Common::List<DecodeAheadVideoDecoder *> *s_activeDecoders = 0;
+
+DecodeAheadVideoDecoder::DecodeAheadVideoDecoder(VideoDecoder *decoder, uint frameCount, uint32 maxMemory, DisposeAfterUse::Flag disposeAfterUse)
+	: _decoder(decoder), _disposeAfterUse(disposeAfterUse), _maxFrameCount(frameCount), _maxMemory(maxMemory),
+	  _frames(0), _poolSize(0), _firstFrame(0), _queuedFrames(0), _underruns(0), _timerDecoding(false),
+	  _dirtyPalette(false) {
+
+	assert(_decoder);
+	memset(_palette, 0, sizeof(_palette));
+
+	if (_decoder->isVideoLoaded())
+		start();
+}
+
+DecodeAheadVideoDecoder::~DecodeAheadVideoDecoder() {
+	stop();
+
+	if (_disposeAfterUse == DisposeAfterUse::YES)
+		delete _decoder;
+}
+
+bool DecodeAheadVideoDecoder::loadFile(const Common::String &filename) {
+	close();
+
+	if (!_decoder->loadFile(filename))
+		return false;
+
+	start();
+	return true;
+}
+
+bool DecodeAheadVideoDecoder::loadStream(Common::SeekableReadStream *stream) {
+	close();
+
+	if (!_decoder->loadStream(stream))
+		return false;
+
+	start();
+	return true;
+}
+
+void DecodeAheadVideoDecoder::close() {
+	stop();
+	_decoder->close();
+	_dirtyPalette = false;
+	reset();
+}
+
+bool DecodeAheadVideoDecoder::isVideoLoaded() const {
+	return _decoder->isVideoLoaded();
+}
+
+// The frame properties don't change while a video is loaded, so these
+// don't have to be synchronized with the decoding callback.
+
+uint16 DecodeAheadVideoDecoder::getWidth() const {
+	return _decoder->getWidth();
+}
+
+uint16 DecodeAheadVideoDecoder::getHeight() const {
+	return _decoder->getHeight();
+}
+
+Graphics::PixelFormat DecodeAheadVideoDecoder::getPixelFormat() const {
+	return _decoder->getPixelFormat();
+}
+
+uint32 DecodeAheadVideoDecoder::getFrameCount() const {
+	return _decoder->getFrameCount();
+}
+
+const byte *DecodeAheadVideoDecoder::getPalette() {
+	if (!_frames)
+		return _decoder->getPalette();
+
+	_dirtyPalette = false;
+	return _palette;
+}
+
+bool DecodeAheadVideoDecoder::hasDirtyPalette() const {
+	if (!_frames)
+		return _decoder->hasDirtyPalette();
+
+	return _dirtyPalette;
+}
+
+uint32 DecodeAheadVideoDecoder::getElapsedTime() const {
+	Common::StackLock lock(_mutex);
+	return _decoder->getElapsedTime();
+}
+
+uint32 DecodeAheadVideoDecoder::getTimeToNextFrame() const {
+	Common::StackLock lock(_mutex);
+
+	// Without frames decoded ahead, the decoder is at the current frame
+	if (!_queuedFrames)
+		return _decoder->getTimeToNextFrame();
+
+	const uint32 beginTime = _frames[_firstFrame].beginTime;
+	const uint32 elapsedTime = _decoder->getElapsedTime();
+
+	if (beginTime <= elapsedTime)
+		return 0;
+
+	return beginTime - elapsedTime;
+}
+
+const Graphics::Surface *DecodeAheadVideoDecoder::decodeNextFrame() {
+	if (!_frames) {
+		const Graphics::Surface *surface = _decoder->decodeNextFrame();
+		_curFrame = _decoder->getCurFrame();
+		return surface;
+	}
+
+	Common::StackLock lock(_mutex);
+
+	if (!_queuedFrames) {
+		if (!decodeAhead())
+			return 0;
+
+		_underruns++;
+	}
+
+	Frame &frame = _frames[_firstFrame];
+	_firstFrame = (_firstFrame + 1) % _poolSize;
+	_queuedFrames--;
+	_curFrame++;
+
+	if (frame.dirtyPalette) {
+		memcpy(_palette, frame.palette, sizeof(_palette));
+		_dirtyPalette = true;
+	}
+
+	return frame.hasSurface ? &frame.surface : 0;
+}
+
+bool DecodeAheadVideoDecoder::endOfVideo() const {
+	Common::StackLock lock(_mutex);
+
+	if (_queuedFrames)
+		return false;
+
+	return _decoder->endOfVideo();
+}
+
+bool DecodeAheadVideoDecoder::prefetchFrame() {
+	if (!_frames)
+		return false;
+
+	Common::StackLock lock(_mutex);
+	return decodeAhead();
+}
+
+uint DecodeAheadVideoDecoder::getQueuedFrameCount() const {
+	Common::StackLock lock(_mutex);
+	return _queuedFrames;
+}
+
+void DecodeAheadVideoDecoder::pauseVideoIntern(bool pause) {
+	Common::StackLock lock(_mutex);
+	_decoder->pauseVideo(pause);
+}
+
+void DecodeAheadVideoDecoder::start() {
+	_curFrame = _decoder->getCurFrame();
+
+	const Graphics::PixelFormat format = _decoder->getPixelFormat();
+	const uint32 frameSize = _decoder->getWidth() * _decoder->getHeight() * format.bytesPerPixel;
+
+	// One more frame than decoded ahead is needed for the frame handed out
+	_poolSize = _maxFrameCount + 1;
+	if (_maxMemory && frameSize)
+		_poolSize = MIN<uint32>(_poolSize, _maxMemory / frameSize);
+
+	if (_poolSize < 2) {
+		debug(1, "DecodeAheadVideoDecoder: Not enough memory for decoding ahead, decoding synchronously");
+		_poolSize = 0;
+		return;
+	}
+
+	_frames = new Frame[_poolSize];
+	_firstFrame = _queuedFrames = 0;
+	_timerDecoding = true;
+
+	// Take over a palette which was set up while loading
+	if (_decoder->hasDirtyPalette()) {
+		const byte *palette = _decoder->getPalette();
+
+		if (palette) {
+			memcpy(_palette, palette, sizeof(_palette));
+			_dirtyPalette = true;
+		}
+	}
+
+	Common::TimerManager *timer = g_system->getTimerManager();
+	timer->removeTimerProc(&timerProc);
+
+	if (!s_activeDecoders)
+		s_activeDecoders = new Common::List<DecodeAheadVideoDecoder *>();
+	s_activeDecoders->push_back(this);
+
+	timer->installTimerProc(&timerProc, kTimerInterval, 0);
+}
+
+void DecodeAheadVideoDecoder::stop() {
+	if (!_frames)
+		return;
+
+	// This must not be called with _mutex locked, as the callback locks it
+	// while the timer manager is locked.
+	Common::TimerManager *timer = g_system->getTimerManager();
+	timer->removeTimerProc(&timerProc);
+
+	s_activeDecoders->remove(this);
+
+	if (!s_activeDecoders->empty()) {
+		timer->installTimerProc(&timerProc, kTimerInterval, 0);
+	} else {
+		delete s_activeDecoders;
+		s_activeDecoders = 0;
+	}
+
+	for (uint i = 0; i < _poolSize; i++)
+		_frames[i].surface.free();
+
+	delete[] _frames;
+	_frames = 0;
+	_poolSize = 0;
+	_firstFrame = _queuedFrames = 0;
+}
+
+bool DecodeAheadVideoDecoder::decodeAhead() {
+	// Keep the frame handed out last untouched
+	if (_queuedFrames + 1 >= _poolSize)
+		return false;
+
+	if (!_decoder->isVideoLoaded() || _decoder->getCurFrame() >= (int32)_decoder->getFrameCount() - 1)
+		return false;
+
+	Frame &frame = _frames[(_firstFrame + _queuedFrames) % _poolSize];
+
+	// The decoder's clock only starts with the first frame, which is due
+	// right away
+	if (_decoder->getCurFrame() < 0)
+		frame.beginTime = 0;
+	else
+		frame.beginTime = _decoder->getElapsedTime() + _decoder->getTimeToNextFrame();
+
+	const Graphics::Surface *surface = _decoder->decodeNextFrame();
+
+	frame.hasSurface = (surface != 0);
+	if (surface) {
+		if (frame.surface.w != surface->w || frame.surface.h != surface->h || frame.surface.bytesPerPixel != surface->bytesPerPixel) {
+			frame.surface.free();
+			frame.surface.create(surface->w, surface->h, surface->bytesPerPixel);
+		}
+
+		for (int y = 0; y < surface->h; y++)
+			memcpy(frame.surface.getBasePtr(0, y), surface->getBasePtr(0, y), surface->w * surface->bytesPerPixel);
+	}
+
+	frame.dirtyPalette = false;
+	if (_decoder->hasDirtyPalette()) {
+		const byte *palette = _decoder->getPalette();
+
+		if (palette) {
+			memcpy(frame.palette, palette, sizeof(frame.palette));
+			frame.dirtyPalette = true;
+		}
+	}
+
+	_queuedFrames++;
+	return true;
+}
+
+// The timer manager runs all callbacks one after another, so while a frame
+// is decoded here, music players and other callbacks are held up. A frame
+// is the smallest unit of work a VideoDecoder offers, so at most one frame
+// is decoded per invocation, for the decoder with the fewest frames queued.
+// Decoders whose frames take longer than kMaxTimerDecodeTime are skipped
+// altogether, at the price of their frames being decoded on the engine
+// thread, see prefetchFrame().
+void DecodeAheadVideoDecoder::timerProc(void *refCon) {
+	DecodeAheadVideoDecoder *next = 0;
+	uint nextQueued = 0;
+
+	for (Common::List<DecodeAheadVideoDecoder *>::iterator i = s_activeDecoders->begin(); i != s_activeDecoders->end(); ++i) {
+		Common::StackLock lock((*i)->_mutex);
+
+		if ((*i)->_timerDecoding && (!next || (*i)->_queuedFrames < nextQueued)) {
+			next = *i;
+			nextQueued = next->_queuedFrames;
+		}
+	}
+
+	if (!next)
+		return;
+
+	Common::StackLock lock(next->_mutex);
+	const uint32 startTime = g_system->getMillis();
+
+	// Only frames decoded here count, the engine thread may take as long
+	// as it likes
+	if (next->decodeAhead() && g_system->getMillis() - startTime > kMaxTimerDecodeTime) {
+		debug(1, "DecodeAheadVideoDecoder: Frame %d took too long to decode, no longer decoding from the timer", next->_decoder->getCurFrame());
+		next->_timerDecoding = false;
+	}
+}
+
+} // End of namespace Video
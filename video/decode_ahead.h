@@ -0,0 +1,146 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef VIDEO_DECODE_AHEAD_H
+#define VIDEO_DECODE_AHEAD_H
+
+#include "common/mutex.h"
+#include "common/types.h"
+
+#include "video/video_decoder.h"
+
+namespace Video {
+
+/**
+ * A VideoDecoder wrapper which decodes the frames of another decoder ahead
+ * of time, so that decodeNextFrame() usually only has to hand over a frame
+ * which is ready already.
+ *
+ * The frames are decoded from a timer callback, at most one frame per
+ * invocation for all wrappers together, and kept in a small pool of
+ * surfaces. Other timer callbacks, like music players, wait while a frame is
+ * decoded, so video whose frames take more than a few milliseconds to decode
+ * is only decoded ahead by prefetchFrame(). The surface
+ * returned by decodeNextFrame() is a pool surface and stays valid until the
+ * next call, just like with any other decoder. If no frame is ready when it
+ * is needed, it is decoded right away instead.
+ *
+ * Engines can enable decoding ahead for any decoder with a single line:
+ *
+ *   decoder = new Video::DecodeAheadVideoDecoder(decoder);
+ *
+ * Only the plain VideoDecoder interface is provided, seeking is not.
+ */
+class DecodeAheadVideoDecoder : public VideoDecoder {
+public:
+	/**
+	 * Wrap a decoder. If it already has a video loaded, decoding ahead
+	 * starts right away.
+	 *
+	 * @param decoder			the decoder to wrap
+	 * @param frameCount		the maximum number of frames decoded ahead
+	 * @param maxMemory			the maximum size of all pooled frames in bytes,
+	 *							or 0 for no limit. If not even two frames fit,
+	 *							all calls are simply passed to the decoder.
+	 * @param disposeAfterUse	whether to delete the decoder along with this one
+	 */
+	DecodeAheadVideoDecoder(VideoDecoder *decoder, uint frameCount = 4, uint32 maxMemory = 0,
+			DisposeAfterUse::Flag disposeAfterUse = DisposeAfterUse::YES);
+	virtual ~DecodeAheadVideoDecoder();
+
+	bool loadFile(const Common::String &filename);
+	bool loadStream(Common::SeekableReadStream *stream);
+	void close();
+	bool isVideoLoaded() const;
+
+	uint16 getWidth() const;
+	uint16 getHeight() const;
+	Graphics::PixelFormat getPixelFormat() const;
+	const byte *getPalette();
+	bool hasDirtyPalette() const;
+	uint32 getFrameCount() const;
+
+	uint32 getElapsedTime() const;
+	uint32 getTimeToNextFrame() const;
+	const Graphics::Surface *decodeNextFrame();
+	bool endOfVideo() const;
+
+	/**
+	 * Decode one more frame ahead, if there is room for it. Meant to be
+	 * called by engines instead of idling until the next frame is due.
+	 *
+	 * @return	whether a frame was decoded
+	 */
+	bool prefetchFrame();
+
+	/** Returns the number of frames currently decoded ahead */
+	uint getQueuedFrameCount() const;
+
+	/** Returns the number of frames which were not ready when needed */
+	uint32 getUnderrunCount() const { return _underruns; }
+
+protected:
+	void pauseVideoIntern(bool pause);
+	void addPauseTime(uint32 ms) {}
+
+private:
+	struct Frame {
+		Graphics::Surface surface;
+		bool hasSurface;	///< false if the decoder returned no surface for this frame
+		bool dirtyPalette;
+		byte palette[256 * 3];
+		uint32 beginTime;	///< Elapsed time at which the frame is due, in ms
+	};
+
+	VideoDecoder *_decoder;
+	DisposeAfterUse::Flag _disposeAfterUse;
+	uint _maxFrameCount;
+	uint32 _maxMemory;
+
+	// The pool is a ring buffer. The frame before _firstFrame is the one
+	// handed out last, and may not be overwritten until the next call to
+	// decodeNextFrame().
+	Frame *_frames;
+	uint _poolSize;
+	uint _firstFrame;
+	uint _queuedFrames;
+	uint32 _underruns;
+	bool _timerDecoding;	///< false once a frame took too long to decode from the timer
+
+	byte _palette[256 * 3];
+	bool _dirtyPalette;
+
+	mutable Common::Mutex _mutex;
+
+	void start();
+	void stop();
+	bool decodeAhead();
+
+	static void timerProc(void *refCon);
+};
+
+} // End of namespace Video
+
+#endif
@@ -73,6 +73,9 @@ QuickTimeDecoder::QuickTimeDecoder() {
 	_dirtyPalette = false;
 	_resFork = new Common::MacResManager();
 	_palette = 0;
+	_prefetchBuffer = 0;
+	_prefetchOffset = _prefetchLength = 0;
+	resetPlaybackStats();
 
 	initParseTable();
 }
@@ -121,18 +124,7 @@ uint32 QuickTimeDecoder::getFrameDuration() {
 	if (_videoStreamIndex < 0)
 		return 0;
 
-	uint32 curFrameIndex = 0;
-	for (int32 i = 0; i < _streams[_videoStreamIndex]->stts_count; i++) {
-		curFrameIndex += _streams[_videoStreamIndex]->stts_data[i].count;
-		if ((uint32)_curFrame < curFrameIndex) {
-			// Ok, now we have what duration this frame has.
-			return _streams[_videoStreamIndex]->stts_data[i].duration;
-		}
-	}
-
-	// This should never occur
-	error ("Cannot find duration for frame %d", _curFrame);
-	return 0;
+	return _streams[_videoStreamIndex]->samples[_curFrame].duration;
 }
 
 Graphics::PixelFormat QuickTimeDecoder::getPixelFormat() const {
@@ -145,37 +137,104 @@ Graphics::PixelFormat QuickTimeDecoder::getPixelFormat() const {
 }
 
 uint32 QuickTimeDecoder::findKeyFrame(uint32 frame) const {
-	for (int i = _streams[_videoStreamIndex]->keyframe_count - 1; i >= 0; i--)
-		if (_streams[_videoStreamIndex]->keyframes[i] <= frame)
-				return _streams[_videoStreamIndex]->keyframes[i];
-	
+	// The sync sample table is sorted, so look for the last key frame
+	// not after the requested frame with a binary search
+	const uint32 *keyframes = _streams[_videoStreamIndex]->keyframes;
+	uint32 lo = 0, hi = _streams[_videoStreamIndex]->keyframe_count;
+
+	while (lo < hi) {
+		uint32 mid = (lo + hi) / 2;
+		if (keyframes[mid] <= frame)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo > 0)
+		return keyframes[lo - 1];
+
 	// If none found, we'll assume the requested frame is a key frame
 	return frame;
 }
 
+bool QuickTimeDecoder::buildSampleIndex(MOVStreamContext *sc) {
+	sc->samples = new MOVsample[sc->nb_frames];
+	memset(sc->samples, 0, sc->nb_frames * sizeof(MOVsample));
+
+	// Timing, from the time-to-sample table
+	uint32 sample = 0;
+	uint32 time = 0;
+
+	for (int32 i = 0; i < sc->stts_count; i++) {
+		for (int32 j = 0; j < sc->stts_data[i].count; j++, sample++) {
+			sc->samples[sample].startTime = time;
+			sc->samples[sample].duration = sc->stts_data[i].duration;
+			time += sc->stts_data[i].duration;
+		}
+	}
+
+	// Location, from the sample-to-chunk, chunk offset and sample size
+	// tables. Samples without data keep a description id of 0.
+	sample = 0;
+	uint32 sampleToChunkIndex = 0;
+
+	for (uint32 i = 0; i < sc->chunk_count && sample < sc->nb_frames; i++) {
+		while (sampleToChunkIndex + 1 < sc->sample_to_chunk_sz && i >= sc->sample_to_chunk[sampleToChunkIndex + 1].first)
+			sampleToChunkIndex++;
+
+		if (sampleToChunkIndex >= sc->sample_to_chunk_sz || i < sc->sample_to_chunk[sampleToChunkIndex].first) {
+			warning("This chunk (%d) is imaginary", i);
+			return false;
+		}
+
+		const MOVstsc &entry = sc->sample_to_chunk[sampleToChunkIndex];
+		uint32 offset = sc->chunk_offsets[i];
+
+		for (uint32 j = 0; j < entry.count && sample < sc->nb_frames; j++, sample++) {
+			uint32 size = sc->sample_size;
+
+			if (!size) {
+				if (sample >= sc->sample_count) {
+					warning("Sample size of frame %d missing", sample);
+					return false;
+				}
+
+				size = sc->sample_sizes[sample];
+			}
+
+			sc->samples[sample].offset = offset;
+			sc->samples[sample].size = size;
+			sc->samples[sample].descId = entry.id;
+			offset += size;
+		}
+	}
+
+	return true;
+}
+
 void QuickTimeDecoder::seekToFrame(uint32 frame) {
 	assert(_videoStreamIndex >= 0);
 	assert(frame < _streams[_videoStreamIndex]->nb_frames);
 
+	_playbackStats.seeks++;
+
 	// Stop all audio (for now)
 	stopAudio();
 
-	// Track down the keyframe
-	_curFrame = findKeyFrame(frame) - 1;
-	while (_curFrame < (int32)frame - 1)
-		decodeNextFrame();
+	// Track down the keyframe. If we are already past it, but not past the
+	// requested frame, we can simply continue decoding from where we are.
+	int32 keyFrame = findKeyFrame(frame);
+	if (_curFrame < keyFrame - 1 || _curFrame >= (int32)frame)
+		_curFrame = keyFrame - 1;
 
-	// Map out the starting point
-	_nextFrameStartTime = 0;
-	uint32 curFrame = 0;
-
-	for (int32 i = 0; i < _streams[_videoStreamIndex]->stts_count && curFrame < frame; i++) {
-		for (int32 j = 0; j < _streams[_videoStreamIndex]->stts_data[i].count && curFrame < frame; j++) {
-			curFrame++;
-			_nextFrameStartTime += _streams[_videoStreamIndex]->stts_data[i].duration;
-		}
+	while (_curFrame < (int32)frame - 1) {
+		decodeNextFrameIntern();
+		_playbackStats.droppedFrames++;
 	}
 
+	// Map out the starting point
+	_nextFrameStartTime = _streams[_videoStreamIndex]->samples[frame].startTime;
+
 	// Adjust the video starting point
 	const Audio::Timestamp curVideoTime(0, _nextFrameStartTime, _streams[_videoStreamIndex]->time_scale);
 	_startTime = g_system->getMillis() - curVideoTime.msecs();
@@ -189,21 +248,27 @@ void QuickTimeDecoder::seekToFrame(uint32 frame) {
 		STSDEntry *entry = &_streams[_audioStreamIndex]->stsdEntries[0];
 		_audStream = Audio::makeQueuingAudioStream(entry->sampleRate, entry->channels == 2);
 
-		// First, we need to track down what audio sample we need
+		// First, we need to track down what audio sample we need, i.e. the
+		// number of samples which end before the video starting point
 		Audio::Timestamp curAudioTime(0, _streams[_audioStreamIndex]->time_scale);
 		uint sample = 0;
-		bool done = false;
-		for (int32 i = 0; i < _streams[_audioStreamIndex]->stts_count && !done; i++) {
-			for (int32 j = 0; j < _streams[_audioStreamIndex]->stts_data[i].count; j++) {
-				curAudioTime = curAudioTime.addFrames(_streams[_audioStreamIndex]->stts_data[i].duration);
-
-				if (curAudioTime > curVideoTime) {
-					done = true;
-					break;
-				}
-
-				sample++;
+		for (int32 i = 0; i < _streams[_audioStreamIndex]->stts_count; i++) {
+			const MOVstts &stts = _streams[_audioStreamIndex]->stts_data[i];
+
+			int32 lo = 0, hi = stts.count;
+			while (lo < hi) {
+				int32 mid = (lo + hi + 1) / 2;
+				if (curAudioTime.addFrames(mid * stts.duration) > curVideoTime)
+					hi = mid - 1;
+				else
+					lo = mid;
 			}
+
+			sample += lo;
+			if (lo < stts.count)
+				break;
+
+			curAudioTime = curAudioTime.addFrames(stts.count * stts.duration);
 		}
 
 		// Now to track down what chunk it's in
@@ -247,23 +312,20 @@ void QuickTimeDecoder::seekToTime(Audio::Timestamp time) {
 	if (_videoStreamIndex < 0)
 		error("Audio-only seeking not supported");
 
-	// Try to find the last frame that should have been decoded
-	uint32 frame = 0;
-	Audio::Timestamp totalDuration(0, _streams[_videoStreamIndex]->time_scale);
-	bool done = false;
+	// Try to find the last frame that should have been decoded, i.e. the
+	// first one which ends after the requested time
+	const MOVStreamContext *sc = _streams[_videoStreamIndex];
+	uint32 lo = 0, hi = sc->nb_frames;
 
-	for (int32 i = 0; i < _streams[_videoStreamIndex]->stts_count && !done; i++) {
-		for (int32 j = 0; j < _streams[_videoStreamIndex]->stts_data[i].count; j++) {
-			totalDuration = totalDuration.addFrames(_streams[_videoStreamIndex]->stts_data[i].duration);
-			if (totalDuration > time) {
-				done = true;
-				break;
-			}
-			frame++;
-		}
+	while (lo < hi) {
+		uint32 mid = (lo + hi) / 2;
+		if (Audio::Timestamp(0, sc->samples[mid].startTime + sc->samples[mid].duration, sc->time_scale) > time)
+			hi = mid;
+		else
+			lo = mid + 1;
 	}
 
-	seekToFrame(frame);
+	seekToFrame(lo);
 }
 
 Codec *QuickTimeDecoder::createCodec(uint32 codecTag, byte bitsPerPixel) {
@@ -325,6 +387,15 @@ Codec *QuickTimeDecoder::findDefaultVideoCodec() const {
 }
 
 const Graphics::Surface *QuickTimeDecoder::decodeNextFrame() {
+	const Graphics::Surface *frame = decodeNextFrameIntern();
+
+	if (!frame)
+		return 0;
+
+	return scaleSurface(frame);
+}
+
+const Graphics::Surface *QuickTimeDecoder::decodeNextFrameIntern() {
 	if (_videoStreamIndex < 0 || _curFrame >= (int32)getFrameCount() - 1)
 		return 0;
 
@@ -370,7 +441,7 @@ const Graphics::Surface *QuickTimeDecoder::decodeNextFrame() {
 		}
 	}
 
-	return scaleSurface(frame);
+	return frame;
 }
 
 const Graphics::Surface *QuickTimeDecoder::scaleSurface(const Graphics::Surface *frame) {
@@ -419,6 +490,7 @@ bool QuickTimeDecoder::loadFile(const Common::String &filename) {
 	_numStreams = 0;
 	_videoStreamIndex = _audioStreamIndex = -1;
 	_startTime = 0;
+	_prefetchLength = 0;
 
 	MOVatom atom = { 0, 0, 0xffffffff };
 
@@ -456,6 +528,7 @@ bool QuickTimeDecoder::loadStream(Common::SeekableReadStream *stream) {
 	_numStreams = 0;
 	_videoStreamIndex = _audioStreamIndex = -1;
 	_startTime = 0;
+	_prefetchLength = 0;
 
 	MOVatom atom = { 0, 0, 0xffffffff };
 
@@ -518,6 +591,12 @@ void QuickTimeDecoder::init() {
 
 	// Initialize video, if present
 	if (_videoStreamIndex >= 0) {
+		if (!buildSampleIndex(_streams[_videoStreamIndex]))
+			warning("QuickTimeDecoder: Incomplete sample tables, video will end early");
+
+		if (!_prefetchBuffer)
+			_prefetchBuffer = new byte[kPrefetchSize];
+
 		for (uint32 i = 0; i < _streams[_videoStreamIndex]->stsdEntryCount; i++) {
 			STSDEntry *entry = &_streams[_videoStreamIndex]->stsdEntries[i];
 			entry->videoCodec = createCodec(entry->codecTag, entry->bitsPerSample & 0x1F);
@@ -1238,9 +1317,21 @@ int QuickTimeDecoder::readWAVE(MOVatom atom) {
 void QuickTimeDecoder::close() {
 	stopAudio();
 
+	if (_playbackStats.prefetchHits + _playbackStats.prefetchMisses)
+		debug(1, "QuickTimeDecoder: %d of %d frame packets read ahead (%d bytes read), %d seeks, %d frames dropped",
+				_playbackStats.prefetchHits, _playbackStats.prefetchHits + _playbackStats.prefetchMisses,
+				_playbackStats.bytesRead, _playbackStats.seeks, _playbackStats.droppedFrames);
+	resetPlaybackStats();
+
+	delete[] _prefetchBuffer;
+	_prefetchBuffer = 0;
+	_prefetchLength = 0;
+
 	for (uint32 i = 0; i < _numStreams; i++)
 		delete _streams[i];
 
+	_numStreams = 0;
+
 	delete _fd;
 	_fd = 0;
 
@@ -1260,54 +1351,52 @@ Common::SeekableReadStream *QuickTimeDecoder::getNextFramePacket(uint32 &descId)
 	if (_videoStreamIndex < 0)
 		return NULL;
 
-	// First, we have to track down which chunk holds the sample and which sample in the chunk contains the frame we are looking for.
-	int32 totalSampleCount = 0;
-	int32 sampleInChunk = 0;
-	int32 actualChunk = -1;
+	const MOVStreamContext *sc = _streams[_videoStreamIndex];
+	const MOVsample &sample = sc->samples[getCurFrame()];
 
-	for (uint32 i = 0; i < _streams[_videoStreamIndex]->chunk_count; i++) {
-		int32 sampleToChunkIndex = -1;
+	descId = sample.descId;
+	if (!descId) {
+		warning ("Could not find data for frame %d", getCurFrame());
+		return NULL;
+	}
 
-		for (uint32 j = 0; j < _streams[_videoStreamIndex]->sample_to_chunk_sz; j++)
-			if (i >= _streams[_videoStreamIndex]->sample_to_chunk[j].first)
-				sampleToChunkIndex = j;
+	if (sample.size > kPrefetchSize) {
+		// Too large to be buffered, read it directly
+		_playbackStats.prefetchMisses++;
+		_fd->seek(sample.offset);
+		return _fd->readStream(sample.size);
+	}
 
-		if (sampleToChunkIndex < 0)
-			error("This chunk (%d) is imaginary", sampleToChunkIndex);
+	if (sample.offset < _prefetchOffset || sample.offset + sample.size > _prefetchOffset + _prefetchLength) {
+		_playbackStats.prefetchMisses++;
 
-		totalSampleCount += _streams[_videoStreamIndex]->sample_to_chunk[sampleToChunkIndex].count;
+		// Refill the buffer from this frame on, up to the end of the last
+		// following frame which still fits in
+		uint32 end = sample.offset + sample.size;
+		for (uint32 i = getCurFrame() + 1; i < sc->nb_frames; i++) {
+			const MOVsample &next = sc->samples[i];
+			if (!next.descId || next.offset < sample.offset || next.offset + next.size - sample.offset > kPrefetchSize)
+				break;
 
-		if (totalSampleCount > getCurFrame()) {
-			actualChunk = i;
-			descId = _streams[_videoStreamIndex]->sample_to_chunk[sampleToChunkIndex].id;
-			sampleInChunk = _streams[_videoStreamIndex]->sample_to_chunk[sampleToChunkIndex].count - totalSampleCount + getCurFrame();
-			break;
+			end = MAX(end, next.offset + next.size);
 		}
-	}
 
-	if (actualChunk < 0) {
-		warning ("Could not find data for frame %d", getCurFrame());
-		return NULL;
-	}
+		_fd->seek(sample.offset);
+		_prefetchOffset = sample.offset;
+		_prefetchLength = _fd->read(_prefetchBuffer, end - sample.offset);
+		_playbackStats.bytesRead += _prefetchLength;
 
-	// Next seek to that frame
-	_fd->seek(_streams[_videoStreamIndex]->chunk_offsets[actualChunk]);
-
-	// Then, if the chunk holds more than one frame, seek to where the frame we want is located
-	for (int32 i = getCurFrame() - sampleInChunk; i < getCurFrame(); i++) {
-		if (_streams[_videoStreamIndex]->sample_size != 0)
-			_fd->skip(_streams[_videoStreamIndex]->sample_size);
-		else
-			_fd->skip(_streams[_videoStreamIndex]->sample_sizes[i]);
+		if (_prefetchLength < sample.size) {
+			warning("Could not read data for frame %d", getCurFrame());
+			_prefetchLength = 0;
+			return NULL;
+		}
+	} else {
+		_playbackStats.prefetchHits++;
 	}
 
-	// Finally, read in the raw data for the frame
-	//printf ("Frame Data[%d]: Offset = %d, Size = %d\n", getCurFrame(), _fd->pos(), _streams[_videoStreamIndex]->sample_sizes[getCurFrame()]);
-
-	if (_streams[_videoStreamIndex]->sample_size != 0)
-		return _fd->readStream(_streams[_videoStreamIndex]->sample_size);
-
-	return _fd->readStream(_streams[_videoStreamIndex]->sample_sizes[getCurFrame()]);
+	// The packet is deleted right after decoding, before the buffer changes
+	return new Common::MemoryReadStream(_prefetchBuffer + sample.offset - _prefetchOffset, sample.size);
 }
 
 bool QuickTimeDecoder::checkAudioCodecSupport(uint32 tag) {
@@ -1479,6 +1568,7 @@ QuickTimeDecoder::MOVStreamContext::~MOVStreamContext() {
 	delete[] sample_to_chunk;
 	delete[] sample_sizes;
 	delete[] keyframes;
+	delete[] samples;
 	delete[] stsdEntries;
 	delete extradata;
 }
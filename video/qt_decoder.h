@@ -123,6 +123,18 @@ public:
 	void seekToFrame(uint32 frame);
 	void seekToTime(Audio::Timestamp time);
 
+	/** Statistics of frame packet reading and seeking */
+	struct PlaybackStats {
+		uint32 prefetchHits;	///< Frame packets served from the read-ahead buffer
+		uint32 prefetchMisses;	///< Frame packets which required reading from the file
+		uint32 bytesRead;	///< Total size of all read-ahead reads
+		uint32 seeks;	///< Number of seekToFrame() calls
+		uint32 droppedFrames;	///< Frames only decoded to reach a seek target
+	};
+
+	const PlaybackStats &getPlaybackStats() const { return _playbackStats; }
+	void resetPlaybackStats() { memset(&_playbackStats, 0, sizeof(_playbackStats)); }
+
 private:
 	// This is the file handle from which data is read from. It can be the actual file handle or a decompressed stream.
 	Common::SeekableReadStream *_fd;
@@ -149,6 +161,15 @@ private:
 		uint32 id;
 	};
 
+	/** Location and timing of a single video sample, built at load time */
+	struct MOVsample {
+		uint32 offset;
+		uint32 size;
+		uint32 startTime;	///< In units of the stream's time scale
+		uint32 duration;
+		uint32 descId;
+	};
+
 	struct STSDEntry {
 		STSDEntry();
 		~STSDEntry();
@@ -191,6 +212,7 @@ private:
 		uint32 *sample_sizes;
 		uint32 keyframe_count;
 		uint32 *keyframes;
+		MOVsample *samples;	///< Sample index with nb_frames entries, video streams only
 		int32 time_scale;
 		int time_rate;
 
@@ -246,6 +268,21 @@ private:
 	uint32 _nextFrameStartTime;
 	int8 _videoStreamIndex;
 	uint32 findKeyFrame(uint32 frame) const;
+	bool buildSampleIndex(MOVStreamContext *sc);
+	const Graphics::Surface *decodeNextFrameIntern();
+
+	// Read-ahead buffer for frame packets. It holds the file data from
+	// _prefetchOffset on, so that consecutive frames (and the audio data
+	// interleaved with them) are read with one call instead of one seek
+	// and read per frame.
+	enum {
+		kPrefetchSize = 128 * 1024
+	};
+
+	byte *_prefetchBuffer;
+	uint32 _prefetchOffset;
+	uint32 _prefetchLength;
+	PlaybackStats _playbackStats;
 
 	Graphics::Surface *_scaledSurface;
 	const Graphics::Surface *scaleSurface(const Graphics::Surface *frame);
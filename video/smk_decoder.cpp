@@ -56,66 +56,76 @@ enum SmkBlockTypes {
 class BitStream {
 public:
 	BitStream(byte *buf, uint32 length)
-		: _buf(buf), _end(buf+length), _bitCount(8) {
-		_curByte = *_buf++;
+		: _buf(buf), _end(buf + length), _bits(0), _bitCount(0) {
+		refill();
 	}
 
 	bool getBit();
 	byte getBits8();
 
-	byte peek8() const;
-	void skip(int n);
+	uint32 peek(uint n);
+	void skip(uint n);
 
 private:
+	void refill();
+
 	byte *_buf;
 	byte *_end;
-	byte _curByte;
-	byte  _bitCount;
+	uint32 _bits;	///< Bit reservoir, the next bit is the lowest one
+	uint _bitCount;	///< Number of valid bits in the reservoir
 };
 
-bool BitStream::getBit() {
+inline void BitStream::refill() {
+	while (_bitCount <= 24 && _buf < _end) {
+		_bits |= (uint32)*_buf++ << _bitCount;
+		_bitCount += 8;
+	}
+}
+
+inline bool BitStream::getBit() {
 	if (_bitCount == 0) {
-		assert(_buf < _end);
-		_curByte = *_buf++;
-		_bitCount = 8;
+		refill();
+		assert(_bitCount > 0);
 	}
 
-	bool v = _curByte & 1;
+	bool v = _bits & 1;
 
-	_curByte >>= 1;
+	_bits >>= 1;
 	--_bitCount;
 
 	return v;
 }
 
-byte BitStream::getBits8() {
-	assert(_buf < _end);
+inline byte BitStream::getBits8() {
+	if (_bitCount < 8) {
+		refill();
+		assert(_bitCount >= 8);
+	}
+
+	byte v = _bits & 0xff;
 
-	byte v = (*_buf << _bitCount) | _curByte;
-	_curByte = *_buf++ >> (8 - _bitCount);
+	_bits >>= 8;
+	_bitCount -= 8;
 
 	return v;
 }
 
-byte BitStream::peek8() const {
-	if (_buf == _end)
-		return _curByte;
+/**
+ * Returns the next n bits, without consuming them. Past the end of the
+ * data, the missing bits are 0.
+ */
+inline uint32 BitStream::peek(uint n) {
+	if (_bitCount < n)
+		refill();
 
-	assert(_buf < _end);
-	return (*_buf << _bitCount) | _curByte;
+	return _bits & ((1 << n) - 1);
 }
 
-void BitStream::skip(int n) {
-	assert(n <= 8);
-	_curByte >>= n;
+inline void BitStream::skip(uint n) {
+	assert(n <= _bitCount);
 
-	if (_bitCount >= n) {
-		_bitCount -= n;
-	} else {
-		assert(_buf < _end);
-		_bitCount = _bitCount + 8 - n;
-		_curByte = *_buf++ >> (8 - _bitCount);
-	}
+	_bits >>= n;
+	_bitCount -= n;
 }
 
 /*
@@ -190,7 +200,7 @@ uint16 SmallHuffmanTree::decodeTree(uint32 prefix, int length) {
 }
 
 uint16 SmallHuffmanTree::getCode(BitStream &bs) {
-	byte peek = bs.peek8();
+	byte peek = bs.peek(8);
 	uint16 *p = &_tree[_prefixtree[peek]];
 	bs.skip(_prefixlength[peek]);
 
@@ -217,7 +227,8 @@ public:
 	uint32 getCode(BitStream &bs);
 private:
 	enum {
-		SMK_NODE = 0x80000000
+		SMK_NODE = 0x80000000,
+		kLookupBits = 12
 	};
 
 	uint32 decodeTree(uint32 prefix, int length);
@@ -226,8 +237,12 @@ private:
 	uint32 *_tree;
 	uint32  _last[3];
 
-	uint32 _prefixtree[256];
-	byte _prefixlength[256];
+	// Decoding table for the next kLookupBits bits. Each entry holds the
+	// index of the leaf (or, for longer codes, the node) reached in the
+	// upper 24 bits, and the number of bits used to get there in the lower
+	// 8 bits. Leaves are referenced by index, because the values of the
+	// three recently used value leaves change while decoding.
+	uint32 _lookup[1 << kLookupBits];
 
 	/* Used during construction */
 	BitStream &_bs;
@@ -238,6 +253,8 @@ private:
 
 BigHuffmanTree::BigHuffmanTree(BitStream &bs, int allocSize)
 	: _bs(bs) {
+	memset(_lookup, 0, sizeof(_lookup));
+
 	uint32 bit = _bs.getBit();
 	if (!bit) {
 		_tree = new uint32[1];
@@ -246,9 +263,6 @@ BigHuffmanTree::BigHuffmanTree(BitStream &bs, int allocSize)
 		return;
 	}
 
-	for (uint32 i = 0; i < 256; ++i)
-		_prefixtree[i] = _prefixlength[i] = 0;
-
 	_loBytes = new SmallHuffmanTree(_bs);
 	_hiBytes = new SmallHuffmanTree(_bs);
 
@@ -298,11 +312,9 @@ uint32 BigHuffmanTree::decodeTree(uint32 prefix, int length) {
 
 		_tree[_treeSize] = v;
 
-		if (length <= 8) {
-			for (int i = 0; i < 256; i += (1 << length)) {
-				_prefixtree[prefix | i] = _treeSize;
-				_prefixlength[prefix | i] = length;
-			}
+		if (length <= (int)kLookupBits) {
+			for (int i = 0; i < (1 << kLookupBits); i += (1 << length))
+				_lookup[prefix | i] = (_treeSize << 8) | length;
 		}
 
 		for (int i = 0; i < 3; ++i) {
@@ -318,10 +330,8 @@ uint32 BigHuffmanTree::decodeTree(uint32 prefix, int length) {
 
 	uint32 t = _treeSize++;
 
-	if (length == 8) {
-		_prefixtree[prefix] = t;
-		_prefixlength[prefix] = 8;
-	}
+	if (length == (int)kLookupBits)
+		_lookup[prefix] = (t << 8) | kLookupBits;
 
 	uint32 r1 = decodeTree(prefix, length + 1);
 
@@ -331,11 +341,12 @@ uint32 BigHuffmanTree::decodeTree(uint32 prefix, int length) {
 	return r1+r2+1;
 }
 
-uint32 BigHuffmanTree::getCode(BitStream &bs) {
-	byte peek = bs.peek8();
-	uint32 *p = &_tree[_prefixtree[peek]];
-	bs.skip(_prefixlength[peek]);
+inline uint32 BigHuffmanTree::getCode(BitStream &bs) {
+	const uint32 entry = _lookup[bs.peek(kLookupBits)];
+	uint32 *p = &_tree[entry >> 8];
+	bs.skip(entry & 0xff);
 
+	// Codes longer than kLookupBits continue bit by bit
 	while (*p & SMK_NODE) {
 		if (bs.getBit())
 			p += (*p) & ~SMK_NODE;
@@ -522,6 +533,15 @@ void SmackerDecoder::close() {
 	reset();
 }
 
+// Byte masks for the pixels of a mono block row, the lowest bit of the map
+// selects the leftmost pixel
+static const uint32 s_monoMasks[16] = {
+	0x00000000, 0x000000FF, 0x0000FF00, 0x0000FFFF,
+	0x00FF0000, 0x00FF00FF, 0x00FFFF00, 0x00FFFFFF,
+	0xFF000000, 0xFF0000FF, 0xFF00FF00, 0xFF00FFFF,
+	0xFFFF0000, 0xFFFF00FF, 0xFFFFFF00, 0xFFFFFFFF
+};
+
 const Graphics::Surface *SmackerDecoder::decodeNextFrame() {
 	uint i;
 	uint32 chunkSize = 0;
@@ -583,11 +603,15 @@ const Graphics::Surface *SmackerDecoder::decodeNextFrame() {
 	uint stride = getWidth();
 	uint block = 0, blocks = bw*bh;
 
+	byte *pixels = (byte *)_surface->pixels;
+	uint blockRowSize = stride * 4 * doubleY;
+
 	byte *out;
 	uint type, run, j, mode;
-	uint32 p1, p2, clr, map;
-	byte hi, lo;
+	uint32 p1, p2, clr, map, row;
 
+	// The pixels of a block row are written as one little-endian 32-bit
+	// value each
 	while (block < blocks) {
 		type = _TypeTree->getCode(bs);
 		run = getBlockRun((type >> 2) & 0x3f);
@@ -597,15 +621,13 @@ const Graphics::Surface *SmackerDecoder::decodeNextFrame() {
 			while (run-- && block < blocks) {
 				clr = _MClrTree->getCode(bs);
 				map = _MMapTree->getCode(bs);
-				out = (byte *)_surface->pixels + (block / bw) * (stride * 4 * doubleY) + (block % bw) * 4;
-				hi = clr >> 8;
-				lo = clr & 0xff;
+				out = pixels + (block / bw) * blockRowSize + (block % bw) * 4;
+				const uint32 hi = (clr >> 8) * 0x01010101;
+				const uint32 lo = (clr & 0xff) * 0x01010101;
 				for (i = 0; i < 4; i++) {
+					row = (hi & s_monoMasks[map & 0xf]) | (lo & ~s_monoMasks[map & 0xf]);
 					for (j = 0; j < doubleY; j++) {
-						out[0] = (map & 1) ? hi : lo;
-						out[1] = (map & 2) ? hi : lo;
-						out[2] = (map & 4) ? hi : lo;
-						out[3] = (map & 8) ? hi : lo;
+						WRITE_LE_UINT32(out, row);
 						out += stride;
 					}
 					map >>= 4;
@@ -630,35 +652,31 @@ const Graphics::Surface *SmackerDecoder::decodeNextFrame() {
 			}
 
 			while (run-- && block < blocks) {
-				out = (byte *)_surface->pixels + (block / bw) * (stride * 4 * doubleY) + (block % bw) * 4;
+				out = pixels + (block / bw) * blockRowSize + (block % bw) * 4;
 				switch (mode) {
 					case 0:
 						for (i = 0; i < 4; ++i) {
 							p1 = _FullTree->getCode(bs);
 							p2 = _FullTree->getCode(bs);
+							row = p2 | (p1 << 16);
 							for (j = 0; j < doubleY; ++j) {
-								out[2] = p1 & 0xff;
-								out[3] = p1 >> 8;
-								out[0] = p2 & 0xff;
-								out[1] = p2 >> 8;
+								WRITE_LE_UINT32(out, row);
 								out += stride;
 							}
 						}
 						break;
 					case 1:
 						p1 = _FullTree->getCode(bs);
-						out[0] = out[1] = p1 & 0xFF;
-						out[2] = out[3] = p1 >> 8;
+						row = (p1 & 0xff) * 0x0101 | (p1 >> 8) * 0x01010000;
+						WRITE_LE_UINT32(out, row);
 						out += stride;
-						out[0] = out[1] = p1 & 0xFF;
-						out[2] = out[3] = p1 >> 8;
+						WRITE_LE_UINT32(out, row);
 						out += stride;
 						p2 = _FullTree->getCode(bs);
-						out[0] = out[1] = p2 & 0xFF;
-						out[2] = out[3] = p2 >> 8;
+						row = (p2 & 0xff) * 0x0101 | (p2 >> 8) * 0x01010000;
+						WRITE_LE_UINT32(out, row);
 						out += stride;
-						out[0] = out[1] = p2 & 0xFF;
-						out[2] = out[3] = p2 >> 8;
+						WRITE_LE_UINT32(out, row);
 						out += stride;
 						break;
 					case 2:
@@ -668,18 +686,9 @@ const Graphics::Surface *SmackerDecoder::decodeNextFrame() {
 							// http://article.gmane.org/gmane.comp.video.ffmpeg.devel/78768
 							p2 = _FullTree->getCode(bs);
 							p1 = _FullTree->getCode(bs);
-							for (j = 0; j < doubleY; ++j) {
-								out[0] = p1 & 0xff;
-								out[1] = p1 >> 8;
-								out[2] = p2 & 0xff;
-								out[3] = p2 >> 8;
-								out += stride;
-							}
-							for (j = 0; j < doubleY; ++j) {
-								out[0] = p1 & 0xff;
-								out[1] = p1 >> 8;
-								out[2] = p2 & 0xff;
-								out[3] = p2 >> 8;
+							row = p1 | (p2 << 16);
+							for (j = 0; j < 2 * doubleY; ++j) {
+								WRITE_LE_UINT32(out, row);
 								out += stride;
 							}
 						}
@@ -693,13 +702,11 @@ const Graphics::Surface *SmackerDecoder::decodeNextFrame() {
 				block++;
 			break;
 		case SMK_BLOCK_FILL:
-			uint32 col;
-			mode = type >> 8;
+			row = (type >> 8) * 0x01010101;
 			while (run-- && block < blocks) {
-				out = (byte *)_surface->pixels + (block / bw) * (stride * 4 * doubleY) + (block % bw) * 4;
-				col = mode * 0x01010101;
+				out = pixels + (block / bw) * blockRowSize + (block % bw) * 4;
 				for (i = 0; i < 4 * doubleY; ++i) {
-					out[0] = out[1] = out[2] = out[3] = col;
+					WRITE_LE_UINT32(out, row);
 					out += stride;
 				}
 				++block;